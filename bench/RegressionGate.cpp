@@ -0,0 +1,1032 @@
+// Headless regression gate for the simulations, so a tweak to a kernel or a parameter can't change what's on the
+// sphere, or how long a step takes, without someone noticing. Build and run with `make regress`.
+//
+// Each case runs the CPU version of a simulation from a fixed seed for a fixed number of steps, with disruptions at
+// fixed points, then renders its final state into six cube faces side by side, as an 8 bit gray image. That image
+// is compared with bench/golden/<case>.pgm. Cases without an image, like mesh_cache and reaction_diffusion_models,
+// check themselves.
+//
+// That first run is also the warm-up. The case then runs TIMING_RUNS more times, and the fastest of their median
+// times per step is compared with bench/golden/budgets.txt. Timing depends on the machine and whatever else it's
+// doing, so going over a budget is only a warning unless --strict-timing is given. The budgets file names the CPU and
+// compiler it was recorded with, and on any other the times are only reported: a budget from another machine says
+// nothing about this one.
+//
+// CI runs `make regress` on every change, which fails on images and self checks but not on timing. The reference
+// machine, a Mac with the Cinder checkout the app ships with, records the budgets with `make regress-budgets` and
+// runs `make regress-strict`, where going over one fails. Anywhere else regress-strict fails up front, since it has
+// nothing to hold the times to.
+//
+// On a regression it exits with 1, after writing <case>_actual.pgm and <case>_diff.ppm into the output directory.
+// In the diff, red is brighter than the golden image and blue darker. After an intended change, re-record the
+// goldens with `make regress-update` and commit them; that records budgets too, so redo those on the reference
+// machine with `make regress-budgets`.
+//
+// The goldens in bench/golden were recorded with g++ 12.2 on x86_64 Linux, without a Cinder checkout. The gate only
+// needs Cinder for glm's vector math and the fs alias, and draws every random number from SimRandom, so they were
+// built against a minimal stand-in for those headers whose dot, length, normalize (x * inversesqrt(dot(x, x))), min,
+// max, clamp, mix and cross are copied from glm 0.9.9. The float results then match a build against Cinder's glm.
+// If a build against the real Cinder disagrees, trust that one and re-record.
+//
+// Whether the shaders still do what these kernels do is checked separately, on a headless GL context, by
+// bench/ShaderGate.cpp (`make shader-gate`).
+//
+// Prints one JSON object per case on stdout:
+//   {"case":"network","steps":300,"changed_pixels":0,"changed_fraction":0.000000,"max_changed_fraction":0.001000,
+//    "us_per_step":31.2,"budget_us":45.0,"timing_delta":-0.307,"over_budget":false,"pass":true}
+//
+// Options:
+//   --golden <dir>    bench/golden by default
+//   --out <dir>       where failing cases write their images, bench/build/regress by default
+//   --filter <text>   only run cases whose name contains text
+//   --update          record new goldens and budgets instead of comparing
+//   --update-budgets  compare the images, then record the budgets for this machine if every case passed
+//   --skip-timing     only compare the images, without the timing runs
+//   --strict-timing   fail cases that go over their budget, on the machine the budgets were recorded on
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined( __APPLE__ )
+#include <sys/sysctl.h>
+#endif
+
+#include "cinder/Filesystem.h"
+#include "cinder/Log.h"
+
+#include "BirdRasterizer.h"
+#include "CubeFaces.h"
+#include "FlockingKernels.h"
+#include "MeshCache.h"
+#include "NetworkBatch.h"
+#include "NetworkFaceBuckets.h"
+#include "NetworkSim.h"
+#include "ReactionDiffusionKernels.h"
+#include "ReactionDiffusionModels.h"
+#include "ReactionDiffusionSphere.h"
+#include "SimRandom.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+// Runs of each case timed after the warm-up. The fastest is the least disturbed by other processes
+int const TIMING_RUNS = 5;
+// Budgets are recorded at this multiple of the time measured, so a busy machine doesn't fail a strict run
+double const BUDGET_HEADROOM = 2.0;
+
+struct GateOptions {
+	fs::path mGoldenDir = "bench/golden";
+	fs::path mOutDir = "bench/build/regress";
+	string mFilter;
+	bool mUpdate = false;
+	bool mUpdateBudgets = false;
+	bool mSkipTiming = false;
+	bool mStrictTiming = false;
+};
+
+// Six side x side faces next to each other, in CubeFaces order
+class FaceStrip {
+public:
+	explicit FaceStrip(int side) : mSide(side), mPixels((size_t) NUM_CUBE_FACES * side * side, 0) {}
+
+	int getWidth() const { return NUM_CUBE_FACES * mSide; }
+	int getHeight() const { return mSide; }
+	uint8_t & at(int face, int col, int row) { return mPixels[(size_t) row * getWidth() + face * mSide + col]; }
+
+	int mSide;
+	vector<uint8_t> mPixels;
+};
+
+// What a case hands back: the image to compare and how long each step took
+struct GateRun {
+	explicit GateRun(int side) : mImage(side) {}
+
+	template <typename Step>
+	void timeStep(Step const & step) {
+		auto start = std::chrono::steady_clock::now();
+		step();
+		mStepNs.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	double getMedianStepUs() {
+		std::sort(mStepNs.begin(), mStepNs.end());
+		return mStepNs.empty() ? 0.0 : mStepNs[mStepNs.size() / 2] / 1000.0;
+	}
+
+	FaceStrip mImage;
+	vector<double> mStepNs;
+	int mNumSteps = 0;
+	// Set by cases that check more than the image
+	string mFailure;
+};
+
+struct GateCase {
+	char const * mName;
+	int mSide;
+	// A pixel only counts as changed when it's off by more than this, and the case fails when more than
+	// mMaxChangedFraction of them are. Float results differ in the last bits between compilers, so only the
+	// network, which is integer logic once its graph is built, is held close to exact
+	int mPixelTolerance;
+	double mMaxChangedFraction;
+	std::function<void(GateRun &)> mRun;
+};
+
+// The same points every run, since getDisruptionVector() draws from the global Rand
+vec3 const GATE_DISRUPTIONS[] = {
+	normalize(vec3(0.6f, 0.3f, 0.7f)),
+	normalize(vec3(-0.5f, -0.4f, 0.2f))
+};
+
+void runNetwork(GateRun & run) {
+	NetworkSim sim;
+	sim.mRand.seed(1);
+	sim.setup();
+
+	run.mNumSteps = 300;
+	for (int step = 0; step < run.mNumSteps; step++) {
+		if (step == 100 || step == 200) {
+			sim.disrupt(GATE_DISRUPTIONS[step / 100 - 1]);
+		}
+		run.timeStep([&] { sim.step(); });
+	}
+
+	for (auto const & node : sim.mNetworkNodes) {
+		int face, col, row;
+		getCubeFaceTexel(normalize(node.mPos), run.mImage.mSide, face, col, row);
+		run.mImage.at(face, col, row) = node.mInfected ? 255 : 96;
+	}
+}
+
+// Independent worlds on one graph, stepped as a batch, each with its own disruptions. Each world has to match a
+// NetworkSim stepped alone from the same state. The image is how many worlds have each node infected
+void runNetworkBatch(GateRun & run) {
+	int const numWorlds = 12;
+
+	vector<NetworkSim> sims(numWorlds);
+	for (int world = 0; world < numWorlds; world++) {
+		sims[world].mRand.seed(1);
+		sims[world].setup();
+		sims[world].mRand.seed(100 + world);
+	}
+
+	NetworkBatch batch(std::make_shared<NetworkTopology>(sims[0]), NetworkRates(sims[0]));
+	for (auto const & sim : sims) {
+		batch.addWorld(sim);
+	}
+
+	run.mNumSteps = 300;
+	for (int step = 0; step < run.mNumSteps; step++) {
+		for (int world = 0; world < numWorlds; world++) {
+			if (step == 50 + 20 * world) {
+				sims[world].disrupt(GATE_DISRUPTIONS[world % 2]);
+				batch.disrupt(world, GATE_DISRUPTIONS[world % 2]);
+			}
+			sims[world].step();
+		}
+		run.timeStep([&] { batch.step(); });
+	}
+
+	int mismatched = 0;
+	for (int world = 0; world < numWorlds; world++) {
+		bool matches = batch.getNumInfected(world) == sims[world].getNumInfected();
+		for (auto const & node : sims[world].mNetworkNodes) {
+			matches = matches && batch.isInfected(world, node.mId) == node.mInfected;
+		}
+		mismatched += !matches;
+	}
+	if (mismatched > 0) {
+		std::ostringstream failure;
+		failure << mismatched << " of " << numWorlds << " batched worlds differ from the same world stepped alone";
+		run.mFailure = failure.str();
+	}
+
+	for (auto const & node : sims[0].mNetworkNodes) {
+		int numInfected = 0;
+		for (int world = 0; world < numWorlds; world++) {
+			numInfected += batch.isInfected(world, node.mId);
+		}
+		int face, col, row;
+		getCubeFaceTexel(normalize(node.mPos), run.mImage.mSide, face, col, row);
+		run.mImage.at(face, col, row) = 64 + 191 * numInfected / numWorlds;
+	}
+}
+
+// Plots what the layered network render draws on one face: points by their centers, lines sampled every half texel
+void drawNetworkNode(FaceStrip & image, int face, vec3 const & pos, int radius) {
+	CubeFaceFrustum frustum;
+	float s, t;
+	if (!isPointInCubeFace(pos, face, frustum) || !projectToCubeFace(pos, face, s, t)) {
+		return;
+	}
+	int const side = image.mSide;
+	int col = (int) std::floor((s + 1.0f) * 0.5f * side);
+	int row = (int) std::floor((t + 1.0f) * 0.5f * side);
+	for (int y = std::max(0, row - radius); y <= std::min(side - 1, row + radius); y++) {
+		for (int x = std::max(0, col - radius); x <= std::min(side - 1, col + radius); x++) {
+			image.at(face, x, y) = 255;
+		}
+	}
+}
+
+void drawNetworkLink(FaceStrip & image, int face, vec3 const & a, vec3 const & b) {
+	CubeFaceFrustum frustum;
+	int const side = image.mSide;
+	int numSamples = 2 * (int) std::ceil(length(b - a) * side) + 1;
+	for (int idx = 0; idx <= numSamples; idx++) {
+		vec3 pos = mix(a, b, (float) idx / numSamples);
+		float s, t;
+		if (!isPointInCubeFace(pos, face, frustum) || !projectToCubeFace(pos, face, s, t)) {
+			continue;
+		}
+		int col = std::min(side - 1, (int) std::floor((s + 1.0f) * 0.5f * side));
+		int row = std::min(side - 1, (int) std::floor((t + 1.0f) * 0.5f * side));
+		uint8_t & pixel = image.at(face, col, row);
+		pixel = std::max(pixel, (uint8_t) 96);
+	}
+}
+
+// The network's per-face buckets, which NetworkApp renders from, have to hold everything that shows up on each face.
+// Draws every face from its bucket alone and from the whole graph, and fails if they differ anywhere
+void runNetworkFaces(GateRun & run) {
+	NetworkSim sim;
+	sim.mRand.seed(1);
+	sim.setup();
+
+	int const side = run.mImage.mSide;
+	int const nodeRadius = 2;
+	CubeFaceFrustum frustum;
+	frustum.mMargin = CubeFaceFrustum::getMargin(nodeRadius + 1.0f, side);
+
+	NetworkFaceBuckets buckets;
+	run.mNumSteps = 20;
+	for (int step = 0; step < run.mNumSteps; step++) {
+		run.timeStep([&] { buckets = buildNetworkFaceBuckets(sim, frustum); });
+	}
+
+	auto getPos = [&] (uint32_t id) { return sim.mNetworkNodes[id].mPos; };
+	FaceStrip everything(side);
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int idx = buckets.mLinkStarts[face]; idx < buckets.mLinkStarts[face + 1]; idx++) {
+			drawNetworkLink(run.mImage, face, getPos(buckets.mLinkIndices[2 * idx]), getPos(buckets.mLinkIndices[2 * idx + 1]));
+		}
+		for (int idx = buckets.mNodeStarts[face]; idx < buckets.mNodeStarts[face + 1]; idx++) {
+			drawNetworkNode(run.mImage, face, getPos(buckets.mNodeIndices[idx]), nodeRadius);
+		}
+
+		for (auto const & link : sim.mNetworkLinks) {
+			drawNetworkLink(everything, face, getPos(link.first), getPos(link.second));
+		}
+		for (auto const & node : sim.mNetworkNodes) {
+			drawNetworkNode(everything, face, node.mPos, nodeRadius);
+		}
+	}
+
+	size_t missing = 0;
+	for (size_t idx = 0; idx < everything.mPixels.size(); idx++) {
+		missing += run.mImage.mPixels[idx] != everything.mPixels[idx];
+	}
+	if (missing > 0) {
+		std::ostringstream failure;
+		failure << missing << " pixels drawn from the whole graph are missing from the face buckets";
+		run.mFailure = failure.str();
+	}
+}
+
+// Draws the flock with BirdRasterizer, which has the same cube face layout. It's drawn with the default tiles, then no
+// birds and the flock again with smaller tiles through the same rasterizer, which has to clear every face and give the
+// same image, so changing the tile size of a live rasterizer is covered too
+void renderFlock(GateRun & run, FlockState const & flock) {
+	int const side = run.mImage.mSide;
+	size_t const faceBytes = (size_t) side * side * 3;
+	BirdRasterizer rasterizer;
+	BirdRasterOptions options;
+	options.mSide = side;
+	rasterizer.render(flock, options);
+	std::array<std::vector<uint8_t>, NUM_CUBE_FACES> defaultTiles;
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		uint8_t const * rgb = rasterizer.getFace(face);
+		defaultTiles[face].assign(rgb, rgb + faceBytes);
+	}
+
+	options.mTileSize = 16;
+	rasterizer.render(FlockState(), options);
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		uint8_t const * rgb = rasterizer.getFace(face);
+		if (run.mFailure.empty() && std::any_of(rgb, rgb + faceBytes, [] (uint8_t value) { return value != 0; })) {
+			run.mFailure = "switching to 16 pixel tiles left birds on face " + std::to_string(face);
+		}
+	}
+
+	rasterizer.render(flock, options);
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		uint8_t const * rgb = rasterizer.getFace(face);
+		if (run.mFailure.empty() && !std::equal(defaultTiles[face].begin(), defaultTiles[face].end(), rgb)) {
+			run.mFailure = "rasterizing with 16 pixel tiles changed face " + std::to_string(face);
+		}
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				run.mImage.at(face, col, row) = rgb[3 * (row * side + col)];
+			}
+		}
+	}
+}
+
+void runFlocking(GateRun & run) {
+	FlockingParams params;
+	SimRandom rand(1);
+	FlockState source, dest;
+	setupFlock(source, 1024, rand);
+	dest = source;
+
+	run.mNumSteps = 100;
+	for (int step = 0; step < run.mNumSteps; step++) {
+		if (step == 50) {
+			disruptFlock(source, GATE_DISRUPTIONS[0], params.mMaxSpeed);
+		}
+		run.timeStep([&] { stepFlock(source, dest, params); });
+		std::swap(source, dest);
+	}
+
+	renderFlock(run, source);
+}
+
+// Every pack and unpack has to stay within the bounds FlockingKernels.h gives, for the flock's own birds, and for
+// birds on the octahedron's edges and corners going as fast as the params allow, every way
+string checkPackedErrors(FlockState const & flock, FlockingParams const & params) {
+	float const velocityRange = getPackedVelocityRange(params);
+	vector<vec3> positions;
+	for (vec4 const & pos : flock.mPositions) {
+		positions.push_back(vec3(pos));
+	}
+	for (int axis = 0; axis < 3; axis++) {
+		for (float sign : { -1.0f, 1.0f }) {
+			vec3 corner(0.0f);
+			corner[axis] = sign;
+			positions.push_back(corner);
+			vec3 edge(sign);
+			edge[axis] = 0.0f;
+			positions.push_back(normalize(edge));
+		}
+	}
+
+	double maxPosition = 0.0, maxVelocity = 0.0, maxPhase = 0.0;
+	for (size_t idx = 0; idx < positions.size(); idx++) {
+		vec3 pos = positions[idx];
+		vec3 xAxis = normalize(cross(pos, std::abs(pos.x) < 0.9f ? vec3(1, 0, 0) : vec3(0, 1, 0)));
+		vec3 yAxis = cross(pos, xAxis);
+		for (int turn = 0; turn < 8; turn++) {
+			// Around the tangent plane, at the range and a little under the min speed
+			float angle = turn * glm::quarter_pi<float>();
+			vec3 dir = std::cos(angle) * xAxis + std::sin(angle) * yAxis;
+			vec3 vel = dir * (turn % 2 == 0 ? velocityRange : 0.9f * params.mMinSpeed);
+			float phase = idx < flock.mPositions.size() ? flock.mPositions[idx].w : turn * 0.8f;
+
+			vec3 unpackedPos, unpackedVel;
+			float unpackedPhase;
+			unpackBird(packBird(pos, vel, phase, velocityRange), velocityRange, unpackedPos, unpackedVel, unpackedPhase);
+
+			maxPosition = std::max(maxPosition, (double) std::atan2(length(cross(pos, unpackedPos)), dot(pos, unpackedPos)));
+			maxVelocity = std::max(maxVelocity, (double) length(unpackedVel - vel) / velocityRange);
+			double phaseError = std::fmod(std::abs(unpackedPhase - phase), glm::two_pi<double>());
+			maxPhase = std::max(maxPhase, std::min(phaseError, glm::two_pi<double>() - phaseError));
+		}
+	}
+
+	std::ostringstream failure;
+	if (maxPosition > PACKED_POSITION_ERROR) {
+		failure << "packed positions are off by up to " << maxPosition << " radians";
+	} else if (maxVelocity > PACKED_VELOCITY_ERROR) {
+		failure << "packed velocities are off by up to " << maxVelocity << " of the range";
+	} else if (maxPhase > PACKED_PHASE_ERROR) {
+		failure << "packed wing phases are off by up to " << maxPhase << " radians";
+	}
+	return failure.str();
+}
+
+// The flocking case on the packed state, which drifts from the plain one by the rounding at every step
+void runFlockingPacked(GateRun & run) {
+	FlockingParams params;
+	SimRandom rand(1);
+	FlockState flock;
+	setupFlock(flock, 1024, rand);
+	run.mFailure = checkPackedErrors(flock, params);
+
+	PackedFlockState source, dest;
+	packFlock(flock, source, getPackedVelocityRange(params));
+	vector<vec3> positions;
+
+	run.mNumSteps = 100;
+	for (int step = 0; step < run.mNumSteps; step++) {
+		if (step == 50) {
+			disruptPackedFlock(source, GATE_DISRUPTIONS[0], params.mMaxSpeed);
+		}
+		run.timeStep([&] { stepPackedFlock(source, dest, params, positions); });
+		std::swap(source, dest);
+	}
+
+	unpackFlock(source, flock);
+	renderFlock(run, flock);
+}
+
+void runReactionDiffusion(GateRun & run) {
+	typedef RDPresetGrayScottAlphaWaves Preset;
+
+	int const side = run.mImage.mSide;
+	ReactionDiffusionGrid source(side);
+	ReactionDiffusionGrid dest(side);
+	// ReactionDiffusionApp::setupCircleRD(20) on its 512 side grid
+	setupCircleReactionDiffusion(source, 20.0f * side / 512.0f);
+
+	run.mNumSteps = 1500;
+	for (int step = 0; step < run.mNumSteps; step++) {
+		if (step == 750) {
+			disruptReactionDiffusion(source, GATE_DISRUPTIONS[1]);
+		}
+		run.timeStep([&] { stepReactionDiffusionModel<Preset>(source, dest); });
+		std::swap(source, dest);
+	}
+
+	// B rarely goes past 0.5
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				float b = source.mB[source.getIndex(face, col, row)];
+				run.mImage.at(face, col, row) = (uint8_t) std::min(255.0f, std::max(0.0f, b * 510.0f + 0.5f));
+			}
+		}
+	}
+}
+
+// Runs the preset from its noisy steady state and checks every texel stays finite and within the given bounds, and
+// that the noise grew into a pattern rather than dying out, since an explicit step past its stable DT blows up
+template <typename Preset>
+string checkReactionDiffusionModel(GateRun & run, char const * name, int side, int numSteps, float bound) {
+	ReactionDiffusionGrid source(side);
+	ReactionDiffusionGrid dest(side);
+	setupReactionDiffusionModel<Preset>(source, 0.05f, side);
+
+	for (int step = 0; step < numSteps; step++) {
+		run.timeStep([&] { stepReactionDiffusionModel<Preset>(source, dest); });
+		std::swap(source, dest);
+	}
+	run.mNumSteps += numSteps;
+
+	float minA = source.mA[source.getIndex(0, 0, 0)];
+	float maxA = minA;
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				size_t idx = source.getIndex(face, col, row);
+				float a = source.mA[idx];
+				float b = source.mB[idx];
+				if (!std::isfinite(a) || !std::isfinite(b) || std::abs(a) > bound || std::abs(b) > bound) {
+					std::ostringstream failure;
+					failure << name << " left its bound of " << bound << " after " << numSteps << " steps, with " << a << ", " << b;
+					return failure.str();
+				}
+				minA = std::min(minA, a);
+				maxA = std::max(maxA, a);
+			}
+		}
+	}
+
+	if (maxA - minA < 0.1f) {
+		std::ostringstream failure;
+		failure << name << " settled back to uniform after " << numSteps << " steps, A spans only " << maxA - minA;
+		return failure.str();
+	}
+	return "";
+}
+
+// The presets without a shader of their own, which nothing else runs for long
+void runReactionDiffusionModels(GateRun & run) {
+	int const side = 32;
+	int const numSteps = 2000;
+
+	// FitzHugh-Nagumo's activator stays near the +-1 branches of its cubic, the Brusselator's X and Y near 1..4
+	run.mFailure = checkReactionDiffusionModel<RDPresetFitzHughNagumo>(run, "FitzHugh-Nagumo", side, numSteps, 1.5f);
+	if (run.mFailure.empty()) {
+		run.mFailure = checkReactionDiffusionModel<RDPresetBrusselator>(run, "Brusselator", side, numSteps, 10.0f);
+	}
+}
+
+// The sphere grid's Laplacian of f = dot(direction, k) has to come out near the true -2f, in units of its smallest
+// cell. On the plain cube grid it's off by up to 5x between face centers and corners
+string checkSphereLaplacian(RDSphereGrid const & sphere, ReactionDiffusionGrid & grid) {
+	int const side = sphere.getSide();
+	int const stride = grid.getStride();
+	int const offsets[RDSphereGrid::NUM_NEIGHBORS] = { -1, 1, -stride, stride, -stride - 1, -stride + 1, stride - 1, stride + 1 };
+	double const cellSize = glm::pi<double>() / (2.0 * side);
+	double const scale = (RDStencilIsotropic9::EDGE + 2.0 * RDStencilIsotropic9::CORNER) * cellSize * cellSize / std::sqrt(2.0);
+
+	vec3 const k = normalize(vec3(0.3f, 0.5f, 0.8f));
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				grid.mA[grid.getIndex(face, col, row)] = dot(sphere.getCellDirection(face, col, row), k);
+			}
+		}
+	}
+	grid.fillGhostCells();
+
+	double maxError = 0.0;
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				size_t idx = grid.getIndex(face, col, row);
+				double laplacian = 0.0;
+				for (int neighbor = 0; neighbor < RDSphereGrid::NUM_NEIGHBORS; neighbor++) {
+					float weight = sphere.getWeights((RDSphereGrid::Neighbor) neighbor)[row * side + col];
+					laplacian += weight * (grid.mA[idx + offsets[neighbor]] - grid.mA[idx]);
+				}
+				maxError = std::max(maxError, std::abs(laplacian / scale + 2.0 * grid.mA[idx]));
+			}
+		}
+	}
+
+	// The fit is exact for quadratics, what's left shrinks with the cell size
+	if (maxError > 0.05) {
+		std::ostringstream failure;
+		failure << "sphere grid Laplacian is off by up to " << maxError;
+		return failure.str();
+	}
+	return "";
+}
+
+// The reaction diffusion case on the sphere grid with as fine patterns, resampled to the cube faces like the render
+// shader does
+void runReactionDiffusionSphere(GateRun & run) {
+	typedef RDPresetGrayScottAlphaWaves Preset;
+
+	int const side = run.mImage.mSide;
+	RDSphereGrid sphere = RDSphereGrid::create<Preset::Stencil>(RDSphereGrid::getSideMatchingCube(side));
+	int const sphereSide = sphere.getSide();
+	ReactionDiffusionGrid source(sphereSide);
+	ReactionDiffusionGrid dest(sphereSide);
+	run.mFailure = checkSphereLaplacian(sphere, source);
+
+	// As ReactionDiffusionApp::setupSphere() does, for the cube case's circle
+	setupCircleReactionDiffusion(source, 20.0f * side / 512.0f * 4.0f * sphereSide / (glm::pi<float>() * side));
+
+	run.mNumSteps = 1500;
+	double steppedB = 0.0;
+	for (int step = 0; step < run.mNumSteps; step++) {
+		if (step == 750) {
+			disruptReactionDiffusionSphere(sphere, source, GATE_DISRUPTIONS[1]);
+		}
+		run.timeStep([&] { steppedB = stepReactionDiffusionSphere<Preset>(sphere, source, dest); });
+		std::swap(source, dest);
+	}
+
+	// Telemetry takes the total the step adds up instead of a sweep of its own
+	double totalB = source.getTotalB();
+	if (run.mFailure.empty() && std::abs(steppedB - totalB) > 1e-5 * std::max(1.0, totalB)) {
+		std::ostringstream failure;
+		failure << "the sphere step's total B is " << steppedB << ", a sweep of the grid gives " << totalB;
+		run.mFailure = failure.str();
+	}
+
+	source.fillGhostCells();
+	vector<float> faceB((size_t) side * side);
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		resampleReactionDiffusionSphere(source, face, side, faceB.data());
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				float b = faceB[row * side + col];
+				run.mImage.at(face, col, row) = (uint8_t) std::min(255.0f, std::max(0.0f, b * 510.0f + 0.5f));
+			}
+		}
+	}
+}
+
+// A mesh made up from a fixed seed, with texcoords or without, as ObjLoader leaves a TriMesh
+TriMeshRef makeGateMesh(bool texCoords) {
+	SimRandom rand(texCoords ? 2 : 3);
+	auto mesh = TriMesh::create(texCoords ? TriMesh::Format().positions(3).texCoords0(2) : TriMesh::Format().positions(3));
+	int const numVertices = 500;
+	for (int idx = 0; idx < numVertices; idx++) {
+		vec3 dir = rand.nextVec3();
+		mesh->appendPosition(dir * rand.nextFloat(10.0f));
+		if (texCoords) {
+			float u = rand.nextFloat();
+			mesh->appendTexCoord0(vec2(u, rand.nextFloat()));
+		}
+	}
+	for (int idx = 0; idx < 2 * numVertices; idx++) {
+		uint32_t corners[3];
+		for (uint32_t & corner : corners) {
+			corner = rand.nextUint() % numVertices;
+		}
+		mesh->appendTriangle(corners[0], corners[1], corners[2]);
+	}
+	return mesh;
+}
+
+bool isSameMesh(CachedMesh const & a, CachedMesh const & b) {
+	return a.getNumVertices() == b.getNumVertices() && a.getNumIndices() == b.getNumIndices()
+		&& std::memcmp(a.getVertices(), b.getVertices(), a.getNumVertices() * MESH_CACHE_FLOATS_PER_VERTEX * sizeof(float)) == 0
+		&& std::memcmp(a.getIndices(), b.getIndices(), a.getNumIndices() * sizeof(uint32_t)) == 0;
+}
+
+// Keeps what's logged while it's alive off the console, for cases that make the code under test log on purpose. A
+// passing run stays quiet, and the case can check the right thing was logged
+class ScopedLogCapture {
+public:
+	ScopedLogCapture() : mConsoleWasEnabled(log::manager()->isConsoleLoggingEnabled()) {
+		log::manager()->disableConsoleLogging();
+		mLogger = log::makeLogger<Capture>(& mLines);
+	}
+
+	~ScopedLogCapture() {
+		log::manager()->removeLogger(mLogger);
+		log::manager()->setConsoleLoggingEnabled(mConsoleWasEnabled);
+	}
+
+	bool hasLine(string const & text) const {
+		return std::any_of(mLines.begin(), mLines.end(), [&] (string const & line) { return line.find(text) != string::npos; });
+	}
+
+private:
+	struct Capture : public log::Logger {
+		explicit Capture(vector<string> * lines) : mLines(lines) {}
+		void write(log::Metadata const & meta, string const & text) override { mLines->push_back(text); }
+		vector<string> * mLines;
+	};
+
+	bool mConsoleWasEnabled;
+	vector<string> mLines;
+	decltype(log::makeLogger<Capture>(nullptr)) mLogger;
+};
+
+// The mesh cache has to give back exactly what the converter made from the TriMesh, and turn down files that are
+// stale, truncated, or would have the GPU read past the vertices. No image, and the timing is of the reads
+string checkMeshCache(GateRun & run) {
+	ScopedLogCapture logged;
+
+	fs::path dir = fs::temp_directory_path() / "DigitalLifeRegress";
+	fs::path cachePath = dir / "gate.dlmesh";
+	uint64_t const sourceHash = 0x1234;
+
+	for (bool texCoords : { true, false }) {
+		TriMeshRef triMesh = makeGateMesh(texCoords);
+		CachedMeshRef converted = convertToCachedMesh(* triMesh);
+
+		// Positions, texcoords and indices where the converter put them. The cache has no normals, the app's meshes are
+		// loaded without them
+		bool convertedMatches = converted->getNumVertices() == triMesh->getNumVertices() && converted->getNumIndices() == triMesh->getNumIndices();
+		for (uint32_t idx = 0; convertedMatches && idx < converted->getNumVertices(); idx++) {
+			float const * vert = converted->getVertices() + idx * MESH_CACHE_FLOATS_PER_VERTEX;
+			vec3 pos = triMesh->getPositions<3>()[idx];
+			vec2 uv = texCoords ? triMesh->getTexCoords0<2>()[idx] : vec2(0.0f);
+			convertedMatches = vert[0] == pos.x && vert[1] == pos.y && vert[2] == pos.z && vert[3] == uv.x && vert[4] == uv.y;
+		}
+		for (uint32_t idx = 0; convertedMatches && idx < converted->getNumIndices(); idx++) {
+			convertedMatches = converted->getIndices()[idx] == triMesh->getIndices()[idx];
+		}
+		if (!convertedMatches) {
+			return "converted mesh doesn't match its TriMesh";
+		}
+
+		if (!writeMeshCache(cachePath, sourceHash, * converted)) {
+			return "couldn't write " + cachePath.string();
+		}
+		CachedMeshRef read;
+		run.mNumSteps = 20;
+		for (int step = 0; step < run.mNumSteps; step++) {
+			run.timeStep([&] { read = readMeshCache(cachePath, sourceHash); });
+		}
+		if (!read || !isSameMesh(* read, * converted)) {
+			return "mesh read back from its cache doesn't match what was written";
+		}
+		if (readMeshCache(cachePath, sourceHash + 1)) {
+			return "mesh cache made from another source was used";
+		}
+	}
+
+	// Truncated by one index
+	vector<char> bytes;
+	{
+		std::ifstream in(cachePath.string(), std::ios::binary);
+		bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+	{
+		std::ofstream out(cachePath.string(), std::ios::binary | std::ios::trunc);
+		out.write(bytes.data(), bytes.size() - sizeof(uint32_t));
+	}
+	if (readMeshCache(cachePath, sourceHash)) {
+		return "truncated mesh cache was used";
+	}
+
+	// Whole, but with an index one past the vertices
+	CachedMeshRef mesh = convertToCachedMesh(* makeGateMesh(true));
+	vector<float> vertices(mesh->getVertices(), mesh->getVertices() + mesh->getNumVertices() * MESH_CACHE_FLOATS_PER_VERTEX);
+	vector<uint32_t> indices(mesh->getIndices(), mesh->getIndices() + mesh->getNumIndices());
+	indices[indices.size() / 2] = mesh->getNumVertices();
+	if (!writeMeshCache(cachePath, sourceHash, * CachedMesh::create(vertices, indices))) {
+		return "couldn't write " + cachePath.string();
+	}
+	if (readMeshCache(cachePath, sourceHash)) {
+		return "mesh cache with an index past its vertices was used";
+	}
+	if (!logged.hasLine("index past its vertices")) {
+		return "mesh cache with an index past its vertices was turned down without a warning";
+	}
+
+	fs::remove_all(dir);
+	return "";
+}
+
+void runMeshCache(GateRun & run) {
+	run.mFailure = checkMeshCache(run);
+}
+
+bool writePgm(fs::path const & path, FaceStrip const & image) {
+	std::ofstream out(path.string(), std::ios::binary);
+	out << "P5\n" << image.getWidth() << " " << image.getHeight() << "\n255\n";
+	out.write(reinterpret_cast<char const *>(image.mPixels.data()), image.mPixels.size());
+	return (bool) out;
+}
+
+bool readPgm(fs::path const & path, FaceStrip & image) {
+	std::ifstream in(path.string(), std::ios::binary);
+	string magic;
+	int width = 0, height = 0, maxValue = 0;
+	in >> magic >> width >> height >> maxValue;
+	in.get();
+	if (!in || magic != "P5" || width != image.getWidth() || height != image.getHeight() || maxValue != 255) {
+		return false;
+	}
+	in.read(reinterpret_cast<char *>(image.mPixels.data()), image.mPixels.size());
+	return (bool) in;
+}
+
+// The golden image dimmed, with the pixels that changed in red where they got brighter and blue where they got darker
+bool writeDiffPpm(fs::path const & path, FaceStrip const & golden, FaceStrip const & actual, int tolerance) {
+	vector<uint8_t> rgb(golden.mPixels.size() * 3);
+	for (size_t idx = 0; idx < golden.mPixels.size(); idx++) {
+		int delta = (int) actual.mPixels[idx] - (int) golden.mPixels[idx];
+		uint8_t base = golden.mPixels[idx] / 3;
+		uint8_t * pixel = & rgb[3 * idx];
+		if (delta > tolerance) {
+			pixel[0] = 255; pixel[1] = base; pixel[2] = base;
+		} else if (delta < -tolerance) {
+			pixel[0] = base; pixel[1] = base; pixel[2] = 255;
+		} else {
+			pixel[0] = pixel[1] = pixel[2] = base;
+		}
+	}
+
+	std::ofstream out(path.string(), std::ios::binary);
+	out << "P6\n" << golden.getWidth() << " " << golden.getHeight() << "\n255\n";
+	out.write(reinterpret_cast<char const *>(rgb.data()), rgb.size());
+	return (bool) out;
+}
+
+// Fastest median time per step of TIMING_RUNS more runs of the case, in microseconds
+double timeCase(GateCase const & gateCase) {
+	double fastest = 0.0;
+	for (int idx = 0; idx < TIMING_RUNS; idx++) {
+		GateRun run(gateCase.mSide);
+		gateCase.mRun(run);
+		double usPerStep = run.getMedianStepUs();
+		fastest = idx == 0 ? usPerStep : std::min(fastest, usPerStep);
+	}
+	return fastest;
+}
+
+// The CPU and compiler this was built with, which budgets only hold for
+string getTimingMachine() {
+	string cpu = "unknown CPU";
+#if defined( __APPLE__ )
+	char brand[256];
+	size_t size = sizeof(brand);
+	if (sysctlbyname("machdep.cpu.brand_string", brand, & size, nullptr, 0) == 0) {
+		cpu = brand;
+	}
+#else
+	std::ifstream in("/proc/cpuinfo");
+	for (string line; std::getline(in, line);) {
+		if (line.compare(0, 10, "model name") == 0 && line.find(':') != string::npos) {
+			cpu = line.substr(line.find(':') + 2);
+			break;
+		}
+	}
+#endif
+#if defined( __clang__ )
+	return cpu + ", clang " + __VERSION__;
+#else
+	return cpu + ", g++ " + __VERSION__;
+#endif
+}
+
+struct Budgets {
+	// getTimingMachine() of where they were recorded
+	string mMachine;
+	std::map<string, double> mUs;
+};
+
+// "<case> <microseconds per step>" lines, # for comments, and "# machine: " before the getTimingMachine() they hold for
+Budgets readBudgets(fs::path const & path) {
+	string const MACHINE = "# machine: ";
+
+	Budgets budgets;
+	std::ifstream in(path.string());
+	for (string line; std::getline(in, line);) {
+		if (line.compare(0, MACHINE.size(), MACHINE) == 0) {
+			budgets.mMachine = line.substr(MACHINE.size());
+			continue;
+		}
+		std::istringstream fields(line);
+		string name;
+		double us = 0.0;
+		if (line.empty() || line[0] == '#' || !(fields >> name >> us)) {
+			continue;
+		}
+		budgets.mUs[name] = us;
+	}
+	return budgets;
+}
+
+bool writeBudgets(fs::path const & path, Budgets const & budgets) {
+	std::ofstream out(path.string());
+	out << "# Median microseconds per step that bench/RegressionGate.cpp allows each case, recorded by `make regress-budgets`\n";
+	out << "# at " << BUDGET_HEADROOM << "x the fastest of " << TIMING_RUNS << " runs after a warm-up. Lower them by hand after a speed up\n";
+	out << "# to lock it in. Only enforced with --strict-timing, and only on the machine below\n";
+	out << "# machine: " << budgets.mMachine << "\n";
+	for (auto const & budget : budgets.mUs) {
+		char value[32];
+		std::snprintf(value, sizeof(value), "%.1f", budget.second);
+		out << budget.first << " " << value << "\n";
+	}
+	return (bool) out;
+}
+
+int main(int argc, char ** argv) {
+	GateOptions options;
+	for (int idx = 1; idx < argc; idx++) {
+		string arg = argv[idx];
+		if (arg == "--golden" && idx + 1 < argc) {
+			options.mGoldenDir = argv[++idx];
+		} else if (arg == "--out" && idx + 1 < argc) {
+			options.mOutDir = argv[++idx];
+		} else if (arg == "--filter" && idx + 1 < argc) {
+			options.mFilter = argv[++idx];
+		} else if (arg == "--update") {
+			options.mUpdate = true;
+		} else if (arg == "--update-budgets") {
+			options.mUpdateBudgets = true;
+		} else if (arg == "--skip-timing") {
+			options.mSkipTiming = true;
+		} else if (arg == "--strict-timing") {
+			options.mStrictTiming = true;
+		} else {
+			std::fprintf(stderr, "Usage: %s [--golden dir] [--out dir] [--filter text] [--update | --update-budgets] [--skip-timing | --strict-timing]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	vector<GateCase> cases = {
+		{ "network", 64, 0, 0.001, runNetwork },
+		{ "network_faces", 128, 0, 0.0, runNetworkFaces },
+		{ "network_batch", 64, 0, 0.001, runNetworkBatch },
+		{ "flocking", 128, 64, 0.01, runFlocking },
+		{ "flocking_packed", 128, 64, 0.01, runFlockingPacked },
+		{ "reaction_diffusion", 128, 8, 0.005, runReactionDiffusion },
+		{ "reaction_diffusion_sphere", 128, 8, 0.005, runReactionDiffusionSphere },
+		{ "reaction_diffusion_models", 0, 0, 0.0, runReactionDiffusionModels },
+		{ "mesh_cache", 0, 0, 0.0, runMeshCache }
+	};
+
+	fs::path budgetsPath = options.mGoldenDir / "budgets.txt";
+	Budgets budgets = readBudgets(budgetsPath);
+	string const machine = getTimingMachine();
+	bool const updatingBudgets = options.mUpdate || options.mUpdateBudgets;
+	bool const timed = updatingBudgets || !options.mSkipTiming;
+	// Times are only held to budgets recorded on this machine
+	bool const budgetsApply = !updatingBudgets && budgets.mMachine == machine;
+	bool passed = true;
+
+	if (timed && !updatingBudgets && !budgetsApply) {
+		std::fprintf(stderr, "%s%s holds for \"%s\", this is \"%s\". Only reporting times, record budgets for this machine "
+			"with `make regress-budgets`\n", options.mStrictTiming ? "" : "note: ", budgetsPath.string().c_str(),
+			budgets.mMachine.empty() ? "no machine" : budgets.mMachine.c_str(), machine.c_str());
+		passed = !options.mStrictTiming;
+	}
+	// Budgets from another machine don't mix with this one's, even for the cases a filter leaves out
+	if (updatingBudgets && budgets.mMachine != machine) {
+		budgets.mMachine = machine;
+		budgets.mUs.clear();
+	}
+
+	for (auto const & gateCase : cases) {
+		string name = gateCase.mName;
+		if (!options.mFilter.empty() && name.find(options.mFilter) == string::npos) {
+			continue;
+		}
+
+		GateRun run(gateCase.mSide);
+		gateCase.mRun(run);
+		double usPerStep = timed ? timeCase(gateCase) : run.getMedianStepUs();
+		fs::path goldenPath = options.mGoldenDir / (name + ".pgm");
+		// Cases with a side of 0 only check themselves
+		bool const hasImage = gateCase.mSide > 0;
+
+		if (options.mUpdate) {
+			if (!run.mFailure.empty()) {
+				std::fprintf(stderr, "%s: %s, not recording it\n", name.c_str(), run.mFailure.c_str());
+				return 1;
+			}
+			fs::create_directories(options.mGoldenDir);
+			if (hasImage && !writePgm(goldenPath, run.mImage)) {
+				std::fprintf(stderr, "Couldn't write %s\n", goldenPath.string().c_str());
+				return 1;
+			}
+			budgets.mUs[name] = usPerStep * BUDGET_HEADROOM;
+			std::printf("{\"case\":\"%s\",\"steps\":%d,\"us_per_step\":%.1f,\"budget_us\":%.1f,\"updated\":true}\n",
+				name.c_str(), run.mNumSteps, usPerStep, budgets.mUs[name]);
+			continue;
+		}
+
+		FaceStrip golden(gateCase.mSide);
+		if (hasImage && !readPgm(goldenPath, golden)) {
+			std::fprintf(stderr, "%s: no golden image at %s, record one with `make regress-update`\n", name.c_str(), goldenPath.string().c_str());
+			passed = false;
+			continue;
+		}
+
+		size_t changed = 0;
+		for (size_t idx = 0; idx < golden.mPixels.size(); idx++) {
+			if (std::abs((int) run.mImage.mPixels[idx] - (int) golden.mPixels[idx]) > gateCase.mPixelTolerance) {
+				changed++;
+			}
+		}
+		double changedFraction = golden.mPixels.empty() ? 0.0 : (double) changed / golden.mPixels.size();
+		bool imagePassed = changedFraction <= gateCase.mMaxChangedFraction;
+
+		if (options.mUpdateBudgets) {
+			budgets.mUs[name] = usPerStep * BUDGET_HEADROOM;
+		}
+		auto budget = budgets.mUs.find(name);
+		bool hasBudget = budgetsApply && budget != budgets.mUs.end();
+		double timingDelta = timed && hasBudget ? usPerStep / budget->second - 1.0 : 0.0;
+		bool overBudget = timingDelta > 0.0;
+		bool timingPassed = !overBudget || !options.mStrictTiming;
+		bool checkPassed = run.mFailure.empty();
+
+		std::printf("{\"case\":\"%s\",\"steps\":%d,\"changed_pixels\":%zu,\"changed_fraction\":%.6f,\"max_changed_fraction\":%.6f,"
+			"\"us_per_step\":%.1f,\"budget_us\":%.1f,\"timing_delta\":%.3f,\"over_budget\":%s,\"pass\":%s}\n",
+			name.c_str(), run.mNumSteps, changed, changedFraction, gateCase.mMaxChangedFraction,
+			usPerStep, hasBudget ? budget->second : 0.0, timingDelta, overBudget ? "true" : "false",
+			imagePassed && timingPassed && checkPassed ? "true" : "false");
+		std::fflush(stdout);
+
+		if (!imagePassed) {
+			fs::create_directories(options.mOutDir);
+			fs::path actualPath = options.mOutDir / (name + "_actual.pgm");
+			fs::path diffPath = options.mOutDir / (name + "_diff.ppm");
+			writePgm(actualPath, run.mImage);
+			writeDiffPpm(diffPath, golden, run.mImage, gateCase.mPixelTolerance);
+			std::fprintf(stderr, "%s: %.2f%% of pixels changed, %.2f%% allowed. See %s\n", name.c_str(), 100.0 * changedFraction,
+				100.0 * gateCase.mMaxChangedFraction, diffPath.string().c_str());
+		}
+		if (overBudget) {
+			std::fprintf(stderr, "%s: %s%.1fus per step, %+.0f%% over its %.1fus budget\n", name.c_str(),
+				options.mStrictTiming ? "" : "warning: ", usPerStep, 100.0 * timingDelta, budget->second);
+		}
+		if (!checkPassed) {
+			std::fprintf(stderr, "%s: %s\n", name.c_str(), run.mFailure.c_str());
+		}
+		if (budgetsApply && !hasBudget && timed) {
+			std::fprintf(stderr, "%s: no timing budget in %s\n", name.c_str(), budgetsPath.string().c_str());
+		}
+
+		passed = passed && imagePassed && timingPassed && checkPassed;
+	}
+
+	if (options.mUpdateBudgets && !passed) {
+		std::fprintf(stderr, "Not recording budgets while cases fail\n");
+		return 1;
+	}
+	if (updatingBudgets) {
+		if (!writeBudgets(budgetsPath, budgets)) {
+			std::fprintf(stderr, "Couldn't write %s\n", budgetsPath.string().c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,1266 @@
+// GL side of the regression gate. The regression gate only runs the CPU kernels, which claim to mirror the simulation
+// shaders, so this runs the shaders in resources/ on a headless GL context and holds them to those kernels.
+// Build and run with `make shader-gate`:
+//   DigitalLifeShaderGate --resources resources [--filter text] [--timing]
+//
+// It needs EGL with Mesa's surfaceless platform and a GL 4.1 core context, so no display or GPU. Mesa's llvmpipe is
+// enough, and is what the tolerances below were set on. The shaders are drawn the way the apps draw them: the same
+// programs, texture formats, filtering and wrapping, one full target quad per pass, and for reaction diffusion one
+// point through the layered geometry shader into all six faces.
+//
+// Cases:
+//   programs                    every program the apps create compiles and links, including ones no case runs
+//   constants                   #defines and consts in the shaders against the constants of the CPU kernels
+//   flocking_32                 FLRunBirdsVelocity_f + FLRunBirdsPosition_f against stepFlock(), 32 x 32 birds
+//   flocking_56                 the same at the app's 56 x 56, a side that isn't a power of two
+//   flocking_disrupt            FLDisruptBirds_f against disruptFlock()
+//   flocking_packed_32          FLRunBirdsPacked_f against stepPackedFlock(), 32 x 32 birds
+//   flocking_packed_56          the same at 56 x 56
+//   flocking_packed_disrupt     FLDisruptBirdsPacked_f against disruptPackedFlock()
+//   reaction_diffusion          RDRunReactionDiffusion_g/_f against stepReactionDiffusionModel(), alpha waves preset
+//   reaction_diffusion_disrupt  RDDisruptReactionDiffusion_f against disruptReactionDiffusion(), at the point
+//                               getReactionDiffusionDisruptionPoint() gives every path of ReactionDiffusionApp::disrupt()
+//   bird_render                 FLRenderBirds_v/_g/_f into a layered cube map camera against BirdRasterizer, face by face
+//   telemetry_samples           the blit and read backs the GPU simulations' telemetry is sampled with
+//
+// With --timing, the flocking cases also print the median time of a GPU step, for comparing the float and packed
+// layouts on the same renderer. llvmpipe times say nothing about a real GPU's, only about the two layouts.
+//
+// Not covered: the GL calls in the app classes themselves, which need Cinder's GL layer (which textures get bound to
+// which pass, the ping-ponging, setupCircleRD() drawing its circle), the render shaders other than FLRenderBirds
+// (FLRenderBirdsPacked_v, RDRender*, DLRender*, NWRender*), the matrices FboCubeMapLayered gives the cube map camera,
+// which bird_render builds from CubeFaces instead, and FrameStreamPublisher's readback. Those are only checked by
+// running the app.
+//
+// Prints one JSON object per case on stdout, and exits with 1 if any case fails:
+//   {"case":"flocking_32","birds":1024,"steps":3,"max_position_error":1.78814e-07,"max_velocity_error":1.23691e-07,
+//    "tolerance":0.0001,"pass":true}
+
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cinder/Filesystem.h"
+
+#include "BirdRasterizer.h"
+#include "CubeFaces.h"
+#include "FlockingKernels.h"
+#include "ReactionDiffusionKernels.h"
+#include "ReactionDiffusionModels.h"
+#include "SimRandom.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+typedef std::chrono::steady_clock Clock;
+
+// Steps the flocking cases take before comparing. Few enough that the flock hasn't had time to amplify rounding
+int const FLOCK_STEPS = 3;
+// Steps of the reaction diffusion case
+int const RD_STEPS = 20;
+int const RD_SIDE = 128;
+// GPU steps timed with --timing
+int const TIMING_STEPS = 5;
+
+// Relative errors the GPU may differ from the CPU by. The shaders sum the neighbours in another order, and llvmpipe's
+// normalize() and division aren't correctly rounded, so a few ulps of difference are expected. Anything that changes
+// which neighbours count, or a constant, is orders of magnitude past these
+float const FLOCK_TOLERANCE = 0.0001f;
+float const RD_TOLERANCE = 0.00001f;
+// Packed birds may land on the other side of a quantization step, so one step of each field is allowed
+float const PACKED_TOLERANCE_STEPS = 1.0f;
+// Birds or texels closer to the disruption radius than this can go either way
+float const DISRUPT_EDGE = 0.0001f;
+// Fraction of a face's lit texels the bird shaders and BirdRasterizer may disagree on, all of them on triangle edges
+float const BIRD_RENDER_TOLERANCE = 0.005f;
+
+struct GateOptions {
+	fs::path mResources = "resources";
+	string mFilter;
+	bool mTiming = false;
+};
+
+// One case's result. Values are printed in the order they were added
+struct CaseResult {
+	vector<std::pair<string, double>> mValues;
+	string mFailure;
+
+	void add(string const & key, double value) { mValues.push_back({ key, value }); }
+	void fail(string const & failure) {
+		if (mFailure.empty()) {
+			mFailure = failure;
+		}
+	}
+};
+
+struct ShaderCase {
+	string mName;
+	std::function<void(GateOptions const &, CaseResult &)> mRun;
+};
+
+// ---- GL plumbing
+
+bool createContext(string & error) {
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (!getPlatformDisplay) {
+		error = "no eglGetPlatformDisplayEXT";
+		return false;
+	}
+	EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, & major, & minor)) {
+		error = "no surfaceless EGL display";
+		return false;
+	}
+	eglBindAPI(EGL_OPENGL_API);
+
+	EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	eglChooseConfig(display, configAttribs, & config, 1, & numConfigs);
+
+	EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 1,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		error = "no GL 4.1 core context";
+		return false;
+	}
+	return true;
+}
+
+string readFile(fs::path const & path) {
+	std::ifstream in(path.string(), std::ios::binary);
+	std::stringstream contents;
+	contents << in.rdbuf();
+	return contents.str();
+}
+
+GLuint compileStage(GLenum stage, string const & source, string const & name, string & error) {
+	GLuint shader = glCreateShader(stage);
+	char const * text = source.c_str();
+	glShaderSource(shader, 1, & text, nullptr);
+	glCompileShader(shader);
+
+	GLint compiled = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, & compiled);
+	if (!compiled) {
+		char log[4096];
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		error = name + ": " + log;
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+// Vertex, fragment and optionally geometry shader from the resources directory, with ciPosition at attribute 0 and
+// ciModelViewProjection the identity, the way the apps' full target quads end up
+GLuint loadProgram(fs::path const & resources, string const & vertex, string const & fragment, string const & geometry, string & error) {
+	vector<std::pair<GLenum, string>> stages = { { GL_VERTEX_SHADER, vertex }, { GL_FRAGMENT_SHADER, fragment } };
+	if (!geometry.empty()) {
+		stages.push_back({ GL_GEOMETRY_SHADER, geometry });
+	}
+
+	GLuint program = glCreateProgram();
+	vector<GLuint> shaders;
+	for (auto const & stage : stages) {
+		string source = readFile(resources / stage.second);
+		if (source.empty()) {
+			error = "couldn't read " + (resources / stage.second).string();
+			return 0;
+		}
+		GLuint shader = compileStage(stage.first, source, stage.second, error);
+		if (!shader) {
+			return 0;
+		}
+		glAttachShader(program, shader);
+		shaders.push_back(shader);
+	}
+
+	glBindAttribLocation(program, 0, "ciPosition");
+	glBindFragDataLocation(program, 0, "FragColor");
+	glLinkProgram(program);
+	for (GLuint shader : shaders) {
+		glDeleteShader(shader);
+	}
+
+	GLint linked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, & linked);
+	if (!linked) {
+		char log[4096];
+		glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+		error = fragment + ": " + log;
+		return 0;
+	}
+
+	glUseProgram(program);
+	float const identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	glUniformMatrix4fv(glGetUniformLocation(program, "ciModelViewProjection"), 1, GL_FALSE, identity);
+	return program;
+}
+
+void setUniform(GLuint program, char const * name, float value) { glUniform1f(glGetUniformLocation(program, name), value); }
+void setUniform(GLuint program, char const * name, int value) { glUniform1i(glGetUniformLocation(program, name), value); }
+void setUniform(GLuint program, char const * name, vec3 const & value) { glUniform3f(glGetUniformLocation(program, name), value.x, value.y, value.z); }
+
+// The same uniforms FlockingApp::update() sets from its params
+void setFlockingUniforms(GLuint program, FlockingParams const & params) {
+	glUseProgram(program);
+	setUniform(program, "uMinSpeed", params.mMinSpeed);
+	setUniform(program, "uMaxSpeed", params.mMaxSpeed);
+	setUniform(program, "uMinForce", params.mMinForce);
+	setUniform(program, "uMaxForce", params.mMaxForce);
+	setUniform(program, "uSeparationDist", params.mSeparationDist);
+	setUniform(program, "uSeparationMod", params.mSeparationMod);
+	setUniform(program, "uAlignDist", params.mAlignDist);
+	setUniform(program, "uAlignMod", params.mAlignMod);
+	setUniform(program, "uCohesionDist", params.mCohesionDist);
+	setUniform(program, "uCohesionMod", params.mCohesionMod);
+	setUniform(program, "uFlapSpeed", params.mFlapSpeed);
+}
+
+// A full target quad in clip space, and a single point for the layered geometry shaders
+struct DrawMeshes {
+	GLuint mVao = 0;
+	GLuint mQuadVbo = 0;
+	GLuint mPointVao = 0;
+	GLuint mPointVbo = 0;
+
+	void setup() {
+		float const quad[] = { -1, -1, 0, 1, 1, -1, 0, 1, -1, 1, 0, 1, 1, 1, 0, 1 };
+		float const point[] = { 0, 0, 0, 1 };
+		setupMesh(mVao, mQuadVbo, quad, sizeof(quad));
+		setupMesh(mPointVao, mPointVbo, point, sizeof(point));
+	}
+
+	void drawQuad() const {
+		glBindVertexArray(mVao);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+
+	void drawPoint() const {
+		glBindVertexArray(mPointVao);
+		glDrawArrays(GL_POINTS, 0, 1);
+	}
+
+private:
+	static void setupMesh(GLuint & vao, GLuint & vbo, float const * data, size_t size) {
+		glGenVertexArrays(1, & vao);
+		glBindVertexArray(vao);
+		glGenBuffers(1, & vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+	}
+};
+
+DrawMeshes sMeshes;
+
+// A texture the way FlockingApp makes its state textures, with a framebuffer to draw into it
+struct StateTarget {
+	GLuint mTexture = 0;
+	GLuint mFbo = 0;
+
+	StateTarget(int side, GLenum internalFormat, GLenum format, GLenum type, void const * data) {
+		glGenTextures(1, & mTexture);
+		glBindTexture(GL_TEXTURE_2D, mTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, side, side, 0, format, type, data);
+
+		glGenFramebuffers(1, & mFbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, mFbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mTexture, 0);
+		glViewport(0, 0, side, side);
+	}
+
+	~StateTarget() {
+		glDeleteFramebuffers(1, & mFbo);
+		glDeleteTextures(1, & mTexture);
+	}
+
+	void read(GLenum format, GLenum type, void * data) const {
+		glBindTexture(GL_TEXTURE_2D, mTexture);
+		glGetTexImage(GL_TEXTURE_2D, 0, format, type, data);
+	}
+};
+
+void bindTexture(int unit, GLenum target, GLuint texture) {
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(target, texture);
+}
+
+// The larger error, where NaN counts as the largest there is
+float getWorse(float error, float other) {
+	return std::isnan(other) ? FLT_MAX : std::max(error, other);
+}
+
+double getMedian(vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return values.empty() ? 0.0 : values[values.size() / 2];
+}
+
+// ---- programs
+
+void runPrograms(GateOptions const & options, CaseResult & result) {
+	// Vertex, fragment and geometry shader of every gl::GlslProg::create() in src
+	vector<vector<string>> programs = {
+		{ "FLRunBirds_v.glsl", "FLRunBirdsVelocity_f.glsl", "" },
+		{ "FLRunBirds_v.glsl", "FLRunBirdsPosition_f.glsl", "" },
+		{ "FLRunBirds_v.glsl", "FLDisruptBirds_f.glsl", "" },
+		{ "FLRunBirds_v.glsl", "FLRunBirdsPacked_f.glsl", "" },
+		{ "FLRunBirds_v.glsl", "FLDisruptBirdsPacked_f.glsl", "" },
+		{ "FLRenderBirds_v.glsl", "FLRenderBirds_f.glsl", "FLRenderBirds_g.glsl" },
+		{ "FLRenderBirdsPacked_v.glsl", "FLRenderBirds_f.glsl", "FLRenderBirds_g.glsl" },
+		{ "RDRunReactionDiffusion_v.glsl", "RDRunReactionDiffusion_f.glsl", "RDRunReactionDiffusion_g.glsl" },
+		{ "RDRunReactionDiffusion_v.glsl", "RDDisruptReactionDiffusion_f.glsl", "RDRunReactionDiffusion_g.glsl" },
+		{ "RDRenderReactionDiffusion_v.glsl", "RDRenderReactionDiffusion_f.glsl", "RDRenderReactionDiffusion_g.glsl" },
+		{ "DLRenderIntoCubeMap_v.glsl", "DLRenderIntoCubeMap_f.glsl", "DLRenderIntoCubeMap_triangles_g.glsl" },
+		{ "DLRenderIntoCubeMap_v.glsl", "DLRenderIntoCubeMap_f.glsl", "NWRenderIntoCubeMap_lines_g.glsl" },
+		{ "DLRenderIntoCubeMap_v.glsl", "DLRenderIntoCubeMap_f.glsl", "NWRenderIntoCubeMap_points_g.glsl" },
+		{ "DLOutputCubeMapToRect_v.glsl", "DLOutputCubeMapToRect_f.glsl", "" },
+		{ "DLRenderOutputTexAsSphere_v.glsl", "DLRenderOutputTexAsSphere_f.glsl", "" }
+	};
+
+	for (auto const & program : programs) {
+		string error;
+		GLuint id = loadProgram(options.mResources, program[0], program[1], program[2], error);
+		if (!id) {
+			result.fail(error);
+		}
+		glDeleteProgram(id);
+	}
+	result.add("linked", programs.size());
+}
+
+// ---- constants
+
+// Every "#define NAME value" and "const float NAME = value;" of a shader, with commented out lines skipped
+std::map<string, double> readShaderConstants(fs::path const & path) {
+	std::map<string, double> constants;
+	std::istringstream lines(readFile(path));
+	string line;
+	while (std::getline(lines, line)) {
+		std::istringstream words(line);
+		string first, name, value;
+		words >> first;
+		if (first == "#define") {
+			words >> name >> value;
+		} else if (first == "const") {
+			string type, equals;
+			words >> type >> name >> equals >> value;
+		}
+		if (!name.empty() && !value.empty()) {
+			constants[name] = std::atof(value.c_str());
+		}
+	}
+	return constants;
+}
+
+// The weight each neighbour gets in a shader's convolute(), from its "weight * name" lines
+std::map<string, double> readConvoluteWeights(fs::path const & path) {
+	std::map<string, double> weights;
+	std::istringstream lines(readFile(path));
+	string line;
+	bool inConvolute = false;
+	while (std::getline(lines, line)) {
+		if (line.find("float convolute(") == 0) {
+			inConvolute = true;
+			continue;
+		}
+		if (inConvolute && line.find("}") == 0) {
+			break;
+		}
+		std::istringstream words(line);
+		string weight, times, name;
+		if (inConvolute && (words >> weight >> times >> name) && times == "*") {
+			weights[name] = std::atof(weight.c_str());
+		}
+	}
+	return weights;
+}
+
+void runConstants(GateOptions const & options, CaseResult & result) {
+	struct Expected {
+		string mShader;
+		string mName;
+		double mValue;
+	};
+	vector<Expected> expected = {
+		{ "FLRunBirdsVelocity_f.glsl", "SELF_EPSILON", FLOCK_SELF_EPSILON },
+		{ "FLRunBirdsPacked_f.glsl", "SELF_EPSILON", FLOCK_SELF_EPSILON },
+		{ "FLRunBirdsPacked_f.glsl", "UNORM16_MAX", PACKED_UNORM16_MAX },
+		{ "FLRunBirdsPacked_f.glsl", "VELOCITY_STEPS", PACKED_VELOCITY_STEPS },
+		{ "FLRunBirdsPacked_f.glsl", "PHASE_STEPS", PACKED_PHASE_STEPS },
+		{ "FLDisruptBirds_f.glsl", "DISRUPT_RADIUS", FLOCK_DISRUPT_RADIUS },
+		{ "FLDisruptBirdsPacked_f.glsl", "DISRUPT_RADIUS", FLOCK_DISRUPT_RADIUS },
+		{ "FLDisruptBirdsPacked_f.glsl", "UNORM16_MAX", PACKED_UNORM16_MAX },
+		{ "FLDisruptBirdsPacked_f.glsl", "VELOCITY_STEPS", PACKED_VELOCITY_STEPS },
+		{ "RDRunReactionDiffusion_f.glsl", "diffusionRateA", rd_presets::ShaderRates::DIFFUSION_A },
+		{ "RDRunReactionDiffusion_f.glsl", "diffusionRateB", rd_presets::ShaderRates::DIFFUSION_B },
+		{ "RDDisruptReactionDiffusion_f.glsl", "DISRUPT_RADIUS", RD_DISRUPT_RADIUS }
+	};
+
+	int numChecked = 0;
+	for (auto const & constant : expected) {
+		auto constants = readShaderConstants(options.mResources / constant.mShader);
+		auto found = constants.find(constant.mName);
+		if (found == constants.end()) {
+			result.fail(constant.mShader + " has no " + constant.mName);
+		} else if (std::abs(found->second - constant.mValue) > 1e-6 * std::abs(constant.mValue)) {
+			result.fail(constant.mShader + " has " + constant.mName + " " + std::to_string(found->second) + ", the CPU "
+				+ std::to_string(constant.mValue));
+		}
+		numChecked++;
+	}
+
+	// The stencil weights, which RDStencilIsotropic9 has for the Gray-Scott presets
+	auto weights = readConvoluteWeights(options.mResources / "RDRunReactionDiffusion_f.glsl");
+	std::map<string, double> expectedWeights = {
+		{ "ul", RDStencilIsotropic9::CORNER }, { "u", RDStencilIsotropic9::EDGE }, { "ur", RDStencilIsotropic9::CORNER },
+		{ "l", RDStencilIsotropic9::EDGE }, { "c", RDStencilIsotropic9::CENTER }, { "r", RDStencilIsotropic9::EDGE },
+		{ "bl", RDStencilIsotropic9::CORNER }, { "b", RDStencilIsotropic9::EDGE }, { "br", RDStencilIsotropic9::CORNER }
+	};
+	for (auto const & weight : expectedWeights) {
+		auto found = weights.find(weight.first);
+		if (found == weights.end() || std::abs(found->second - weight.second) > 1e-6) {
+			result.fail("convolute() in RDRunReactionDiffusion_f.glsl doesn't weigh " + weight.first + " by "
+				+ std::to_string(weight.second));
+		}
+		numChecked++;
+	}
+
+	result.add("checked", numChecked);
+}
+
+// ---- flocking
+
+struct FloatFlockTargets {
+	StateTarget mPositions;
+	StateTarget mVelocities;
+
+	FloatFlockTargets(int side, FlockState const & flock)
+		: mPositions(side, GL_RGBA32F, GL_RGBA, GL_FLOAT, flock.mPositions.data())
+		, mVelocities(side, GL_RGBA32F, GL_RGBA, GL_FLOAT, flock.mVelocities.data()) {}
+
+	void read(FlockState & flock) const {
+		mPositions.read(GL_RGBA, GL_FLOAT, flock.mPositions.data());
+		mVelocities.read(GL_RGBA, GL_FLOAT, flock.mVelocities.data());
+	}
+};
+
+struct FloatFlockPrograms {
+	GLuint mVelocity = 0;
+	GLuint mPosition = 0;
+	GLuint mDisrupt = 0;
+
+	bool load(fs::path const & resources, string & error) {
+		mVelocity = loadProgram(resources, "FLRunBirds_v.glsl", "FLRunBirdsVelocity_f.glsl", "", error);
+		mPosition = mVelocity ? loadProgram(resources, "FLRunBirds_v.glsl", "FLRunBirdsPosition_f.glsl", "", error) : 0;
+		mDisrupt = mPosition ? loadProgram(resources, "FLRunBirds_v.glsl", "FLDisruptBirds_f.glsl", "", error) : 0;
+		return mDisrupt != 0;
+	}
+};
+
+// Same passes as FlockingApp::update(): velocities from the source state, then positions from the source state
+void stepFloatFlockGpu(FloatFlockPrograms const & programs, FloatFlockTargets & src, FloatFlockTargets & dst) {
+	for (GLuint program : { programs.mVelocity, programs.mPosition }) {
+		glUseProgram(program);
+		setUniform(program, "uPositions", 0);
+		setUniform(program, "uVelocities", 1);
+		bindTexture(0, GL_TEXTURE_2D, src.mPositions.mTexture);
+		bindTexture(1, GL_TEXTURE_2D, src.mVelocities.mTexture);
+		glBindFramebuffer(GL_FRAMEBUFFER, program == programs.mVelocity ? dst.mVelocities.mFbo : dst.mPositions.mFbo);
+		sMeshes.drawQuad();
+	}
+}
+
+// Largest position error, and largest velocity error as a fraction of the max speed
+void compareFlocks(FlockState const & gpu, FlockState const & cpu, FlockingParams const & params, float & positionError, float & velocityError) {
+	positionError = 0.0f;
+	velocityError = 0.0f;
+	for (size_t idx = 0; idx < cpu.mPositions.size(); idx++) {
+		positionError = getWorse(positionError, length(vec3(gpu.mPositions[idx]) - vec3(cpu.mPositions[idx])));
+		velocityError = getWorse(velocityError, length(vec3(gpu.mVelocities[idx]) - vec3(cpu.mVelocities[idx])) / params.mMaxSpeed);
+	}
+}
+
+void setupGateFlock(FlockState & flock, int side) {
+	SimRandom rand(7);
+	setupFlock(flock, side * side, rand);
+}
+
+void runFloatFlocking(GateOptions const & options, CaseResult & result, int side) {
+	FlockingParams params;
+	FloatFlockPrograms programs;
+	string error;
+	if (!programs.load(options.mResources, error)) {
+		result.fail(error);
+		return;
+	}
+	for (GLuint program : { programs.mVelocity, programs.mPosition }) {
+		setFlockingUniforms(program, params);
+		setUniform(program, "uGridSide", side);
+	}
+
+	FlockState cpu;
+	setupGateFlock(cpu, side);
+	FloatFlockTargets a(side, cpu), b(side, cpu);
+	FloatFlockTargets * src = & a;
+	FloatFlockTargets * dst = & b;
+
+	FlockState next;
+	for (int step = 0; step < FLOCK_STEPS; step++) {
+		stepFlock(cpu, next, params);
+		std::swap(cpu, next);
+		stepFloatFlockGpu(programs, * src, * dst);
+		std::swap(src, dst);
+	}
+
+	// Read into zeros, so a readback that didn't happen can't pass
+	FlockState gpu;
+	gpu.mPositions.resize(cpu.mPositions.size());
+	gpu.mVelocities.resize(cpu.mVelocities.size());
+	src->read(gpu);
+	float positionError, velocityError;
+	compareFlocks(gpu, cpu, params, positionError, velocityError);
+
+	result.add("birds", side * side);
+	result.add("steps", FLOCK_STEPS);
+	result.add("max_position_error", positionError);
+	result.add("max_velocity_error", velocityError);
+	result.add("tolerance", FLOCK_TOLERANCE);
+	if (positionError > FLOCK_TOLERANCE || velocityError > FLOCK_TOLERANCE) {
+		result.fail("the shaders and stepFlock() disagree");
+	}
+
+	if (options.mTiming) {
+		vector<double> stepMs;
+		for (int step = 0; step < TIMING_STEPS; step++) {
+			auto start = Clock::now();
+			stepFloatFlockGpu(programs, * src, * dst);
+			glFinish();
+			stepMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+			std::swap(src, dst);
+		}
+		result.add("gpu_ms_per_step", getMedian(stepMs));
+	}
+}
+
+// A point on the flock's starting sphere with birds on both sides of the radius
+vec3 const FLOCK_DISRUPT_POINT = normalize(vec3(0.3f, -0.5f, 0.8f));
+
+void runFloatFlockingDisrupt(GateOptions const & options, CaseResult & result) {
+	int const side = 56;
+	FlockingParams params;
+	FloatFlockPrograms programs;
+	string error;
+	if (!programs.load(options.mResources, error)) {
+		result.fail(error);
+		return;
+	}
+
+	FlockState cpu;
+	setupGateFlock(cpu, side);
+	FloatFlockTargets src(side, cpu), dst(side, cpu);
+
+	// Same pass as FlockingApp::disrupt()
+	glUseProgram(programs.mDisrupt);
+	setUniform(programs.mDisrupt, "uGridSide", side);
+	setUniform(programs.mDisrupt, "uPositions", 0);
+	setUniform(programs.mDisrupt, "uVelocities", 1);
+	setUniform(programs.mDisrupt, "uDisruptPoint", FLOCK_DISRUPT_POINT);
+	setUniform(programs.mDisrupt, "uMaxSpeed", params.mMaxSpeed);
+	bindTexture(0, GL_TEXTURE_2D, src.mPositions.mTexture);
+	bindTexture(1, GL_TEXTURE_2D, src.mVelocities.mTexture);
+	glBindFramebuffer(GL_FRAMEBUFFER, dst.mVelocities.mFbo);
+	sMeshes.drawQuad();
+
+	FlockState gpu;
+	gpu.mVelocities.resize(cpu.mVelocities.size());
+	dst.mVelocities.read(GL_RGBA, GL_FLOAT, gpu.mVelocities.data());
+	FlockState before = cpu;
+	disruptFlock(cpu, FLOCK_DISRUPT_POINT, params.mMaxSpeed);
+
+	size_t disrupted = 0;
+	float velocityError = 0.0f;
+	for (size_t idx = 0; idx < cpu.mVelocities.size(); idx++) {
+		float dist = length(vec3(before.mPositions[idx]) - FLOCK_DISRUPT_POINT);
+		if (std::abs(dist - FLOCK_DISRUPT_RADIUS) < DISRUPT_EDGE) {
+			continue;
+		}
+		disrupted += dist < FLOCK_DISRUPT_RADIUS;
+		velocityError = getWorse(velocityError, length(vec3(gpu.mVelocities[idx]) - vec3(cpu.mVelocities[idx])) / params.mMaxSpeed);
+	}
+
+	result.add("birds", side * side);
+	result.add("disrupted", disrupted);
+	result.add("max_velocity_error", velocityError);
+	result.add("tolerance", FLOCK_TOLERANCE);
+	if (disrupted == 0) {
+		result.fail("the disruption point missed the flock");
+	}
+	if (velocityError > FLOCK_TOLERANCE) {
+		result.fail("FLDisruptBirds_f and disruptFlock() disagree");
+	}
+}
+
+// Largest errors between packed flocks, in quantization steps of each field
+void comparePackedFlocks(PackedFlockState const & gpu, PackedFlockState const & cpu, float & positionSteps,
+	float & velocitySteps, float & phaseSteps, size_t & numDiffering)
+{
+	positionSteps = velocitySteps = phaseSteps = 0.0f;
+	numDiffering = 0;
+	for (size_t idx = 0; idx < cpu.mBirds.size(); idx++) {
+		PackedBird a = gpu.mBirds[idx];
+		PackedBird b = cpu.mBirds[idx];
+		numDiffering += a.mPosition != b.mPosition || a.mVelocityPhase != b.mVelocityPhase;
+
+		auto fieldSteps = [] (uint32_t x, uint32_t y, int shift, uint32_t mask) {
+			return (float) std::abs((int) ((x >> shift) & mask) - (int) ((y >> shift) & mask));
+		};
+		positionSteps = std::max({ positionSteps, fieldSteps(a.mPosition, b.mPosition, 0, 0xffff), fieldSteps(a.mPosition, b.mPosition, 16, 0xffff) });
+		velocitySteps = std::max({ velocitySteps, fieldSteps(a.mVelocityPhase, b.mVelocityPhase, 0, 0x7ff),
+			fieldSteps(a.mVelocityPhase, b.mVelocityPhase, 11, 0x7ff) });
+		// The phase wraps around
+		float phase = fieldSteps(a.mVelocityPhase, b.mVelocityPhase, 22, 0x3ff);
+		phaseSteps = std::max(phaseSteps, std::min(phase, PACKED_PHASE_STEPS - phase));
+	}
+}
+
+void runPackedFlocking(GateOptions const & options, CaseResult & result, int side) {
+	FlockingParams params;
+	string error;
+	GLuint program = loadProgram(options.mResources, "FLRunBirds_v.glsl", "FLRunBirdsPacked_f.glsl", "", error);
+	if (!program) {
+		result.fail(error);
+		return;
+	}
+	setFlockingUniforms(program, params);
+	setUniform(program, "uGridSide", side);
+	setUniform(program, "uBirds", 0);
+
+	FlockState flock;
+	setupGateFlock(flock, side);
+	PackedFlockState cpu, next;
+	packFlock(flock, cpu, getPackedVelocityRange(params));
+
+	StateTarget a(side, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, cpu.mBirds.data());
+	StateTarget b(side, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, cpu.mBirds.data());
+	StateTarget * src = & a;
+	StateTarget * dst = & b;
+
+	// Same pass as FlockingApp::update()
+	auto stepGpu = [&] (float srcRange) {
+		glUseProgram(program);
+		setUniform(program, "uSrcVelocityRange", srcRange);
+		setUniform(program, "uDstVelocityRange", getPackedVelocityRange(params));
+		bindTexture(0, GL_TEXTURE_2D, src->mTexture);
+		glBindFramebuffer(GL_FRAMEBUFFER, dst->mFbo);
+		sMeshes.drawQuad();
+		std::swap(src, dst);
+	};
+
+	vector<vec3> positions;
+	for (int step = 0; step < FLOCK_STEPS; step++) {
+		float srcRange = cpu.mVelocityRange;
+		stepPackedFlock(cpu, next, params, positions);
+		std::swap(cpu, next);
+		stepGpu(srcRange);
+	}
+
+	PackedFlockState gpu;
+	gpu.mBirds.resize(cpu.mBirds.size());
+	src->read(GL_RG_INTEGER, GL_UNSIGNED_INT, gpu.mBirds.data());
+	float positionSteps, velocitySteps, phaseSteps;
+	size_t numDiffering;
+	comparePackedFlocks(gpu, cpu, positionSteps, velocitySteps, phaseSteps, numDiffering);
+
+	result.add("birds", side * side);
+	result.add("steps", FLOCK_STEPS);
+	result.add("differing_birds", numDiffering);
+	result.add("max_position_steps", positionSteps);
+	result.add("max_velocity_steps", velocitySteps);
+	result.add("max_phase_steps", phaseSteps);
+	result.add("tolerance_steps", PACKED_TOLERANCE_STEPS);
+	if (positionSteps > PACKED_TOLERANCE_STEPS || velocitySteps > PACKED_TOLERANCE_STEPS || phaseSteps > PACKED_TOLERANCE_STEPS) {
+		result.fail("FLRunBirdsPacked_f and stepPackedFlock() disagree");
+	}
+
+	if (options.mTiming) {
+		vector<double> stepMs;
+		for (int step = 0; step < TIMING_STEPS; step++) {
+			auto start = Clock::now();
+			stepGpu(getPackedVelocityRange(params));
+			glFinish();
+			stepMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		}
+		result.add("gpu_ms_per_step", getMedian(stepMs));
+	}
+}
+
+void runPackedFlockingDisrupt(GateOptions const & options, CaseResult & result) {
+	int const side = 56;
+	FlockingParams params;
+	string error;
+	GLuint program = loadProgram(options.mResources, "FLRunBirds_v.glsl", "FLDisruptBirdsPacked_f.glsl", "", error);
+	if (!program) {
+		result.fail(error);
+		return;
+	}
+
+	FlockState flock;
+	setupGateFlock(flock, side);
+	PackedFlockState cpu;
+	packFlock(flock, cpu, getPackedVelocityRange(params));
+	StateTarget src(side, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, cpu.mBirds.data());
+	StateTarget dst(side, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, cpu.mBirds.data());
+
+	// Same pass as FlockingApp::disrupt()
+	glUseProgram(program);
+	setUniform(program, "uBirds", 0);
+	setUniform(program, "uDisruptPoint", FLOCK_DISRUPT_POINT);
+	setUniform(program, "uVelocityRange", cpu.mVelocityRange);
+	setUniform(program, "uMaxSpeed", params.mMaxSpeed);
+	bindTexture(0, GL_TEXTURE_2D, src.mTexture);
+	glBindFramebuffer(GL_FRAMEBUFFER, dst.mFbo);
+	sMeshes.drawQuad();
+
+	PackedFlockState gpu;
+	gpu.mBirds.resize(cpu.mBirds.size());
+	dst.read(GL_RG_INTEGER, GL_UNSIGNED_INT, gpu.mBirds.data());
+	disruptPackedFlock(cpu, FLOCK_DISRUPT_POINT, params.mMaxSpeed);
+
+	float positionSteps, velocitySteps, phaseSteps;
+	size_t numDiffering;
+	comparePackedFlocks(gpu, cpu, positionSteps, velocitySteps, phaseSteps, numDiffering);
+
+	result.add("birds", side * side);
+	result.add("differing_birds", numDiffering);
+	result.add("max_position_steps", positionSteps);
+	result.add("max_velocity_steps", velocitySteps);
+	result.add("max_phase_steps", phaseSteps);
+	result.add("tolerance_steps", PACKED_TOLERANCE_STEPS);
+	// Positions and phases are passed through untouched
+	if (positionSteps > 0.0f || phaseSteps > 0.0f || velocitySteps > PACKED_TOLERANCE_STEPS) {
+		result.fail("FLDisruptBirdsPacked_f and disruptPackedFlock() disagree");
+	}
+}
+
+// ---- reaction diffusion
+
+// A cube map the way ReactionDiffusionApp makes its state, or FlockingApp its camera with GL_RGB8, with a layered
+// framebuffer to draw all six faces
+struct CubeTarget {
+	GLuint mTexture = 0;
+	GLuint mFbo = 0;
+	int mSide;
+
+	explicit CubeTarget(int side, GLenum internalFormat = GL_RGB32F) : mSide(side) {
+		glGenTextures(1, & mTexture);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, mTexture);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		for (int face = 0; face < NUM_CUBE_FACES; face++) {
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, internalFormat, side, side, 0, GL_RGB, GL_FLOAT, nullptr);
+		}
+
+		glGenFramebuffers(1, & mFbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, mFbo);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mTexture, 0);
+		glViewport(0, 0, side, side);
+	}
+
+	~CubeTarget() {
+		glDeleteFramebuffers(1, & mFbo);
+		glDeleteTextures(1, & mTexture);
+	}
+
+	// A in green and B in blue, like the shaders
+	void upload(ReactionDiffusionGrid const & grid) {
+		vector<float> texels(mSide * mSide * 3);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, mTexture);
+		for (int face = 0; face < NUM_CUBE_FACES; face++) {
+			for (int row = 0; row < mSide; row++) {
+				for (int col = 0; col < mSide; col++) {
+					size_t idx = grid.getIndex(face, col, row);
+					float * texel = & texels[(row * mSide + col) * 3];
+					texel[0] = 0.0f;
+					texel[1] = grid.mA[idx];
+					texel[2] = grid.mB[idx];
+				}
+			}
+			glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, 0, 0, mSide, mSide, GL_RGB, GL_FLOAT, texels.data());
+		}
+	}
+
+	void read(ReactionDiffusionGrid & grid) const {
+		vector<float> texels(mSide * mSide * 3);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, mTexture);
+		for (int face = 0; face < NUM_CUBE_FACES; face++) {
+			glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB, GL_FLOAT, texels.data());
+			for (int row = 0; row < mSide; row++) {
+				for (int col = 0; col < mSide; col++) {
+					size_t idx = grid.getIndex(face, col, row);
+					grid.mA[idx] = texels[(row * mSide + col) * 3 + 1];
+					grid.mB[idx] = texels[(row * mSide + col) * 3 + 2];
+				}
+			}
+		}
+	}
+};
+
+// Largest difference of A and B over every texel
+float compareGrids(ReactionDiffusionGrid const & gpu, ReactionDiffusionGrid const & cpu, size_t & numDiffering, float tolerance) {
+	float maxError = 0.0f;
+	numDiffering = 0;
+	int const side = cpu.getSide();
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				size_t idx = cpu.getIndex(face, col, row);
+				float error = std::max(std::abs(gpu.mA[idx] - cpu.mA[idx]), std::abs(gpu.mB[idx] - cpu.mB[idx]));
+				numDiffering += !(error <= tolerance);
+				maxError = getWorse(maxError, error);
+			}
+		}
+	}
+	return maxError;
+}
+
+void runReactionDiffusion(GateOptions const & options, CaseResult & result) {
+	string error;
+	GLuint program = loadProgram(options.mResources, "RDRunReactionDiffusion_v.glsl", "RDRunReactionDiffusion_f.glsl",
+		"RDRunReactionDiffusion_g.glsl", error);
+	if (!program) {
+		result.fail(error);
+		return;
+	}
+	typedef RDPresetGrayScottAlphaWaves Preset;
+	typedef rd_presets::AlphaWaves Rates;
+	setUniform(program, "gridSideLength", RD_SIDE);
+	setUniform(program, "uPrevFrame", 0);
+	setUniform(program, "feedRateA", Rates::FEED);
+	setUniform(program, "killRateB", Rates::KILL);
+
+	// The app's starting circle, wide enough to spread across the face edges by the end
+	ReactionDiffusionGrid cpu(RD_SIDE), next(RD_SIDE);
+	setupCircleReactionDiffusion(cpu, RD_SIDE * 0.45f);
+
+	CubeTarget a(RD_SIDE), b(RD_SIDE);
+	a.upload(cpu);
+	CubeTarget * src = & a;
+	CubeTarget * dst = & b;
+
+	for (int step = 0; step < RD_STEPS; step++) {
+		stepReactionDiffusionModel<Preset>(cpu, next);
+		std::swap(cpu, next);
+
+		// Same pass as ReactionDiffusionApp::update()
+		glUseProgram(program);
+		bindTexture(0, GL_TEXTURE_CUBE_MAP, src->mTexture);
+		glBindFramebuffer(GL_FRAMEBUFFER, dst->mFbo);
+		sMeshes.drawPoint();
+		std::swap(src, dst);
+	}
+
+	ReactionDiffusionGrid gpu(RD_SIDE);
+	src->read(gpu);
+	size_t numDiffering;
+	float maxError = compareGrids(gpu, cpu, numDiffering, RD_TOLERANCE);
+
+	result.add("side", RD_SIDE);
+	result.add("steps", RD_STEPS);
+	result.add("differing_texels", numDiffering);
+	result.add("max_error", maxError);
+	result.add("tolerance", RD_TOLERANCE);
+	if (maxError > RD_TOLERANCE) {
+		result.fail("RDRunReactionDiffusion_f and stepReactionDiffusionModel() disagree");
+	}
+}
+
+void runReactionDiffusionDisrupt(GateOptions const & options, CaseResult & result) {
+	string error;
+	GLuint program = loadProgram(options.mResources, "RDRunReactionDiffusion_v.glsl", "RDDisruptReactionDiffusion_f.glsl",
+		"RDRunReactionDiffusion_g.glsl", error);
+	if (!program) {
+		result.fail(error);
+		return;
+	}
+
+	// Pattern everywhere, so a disruption shows whichever way it goes
+	ReactionDiffusionGrid cpu(RD_SIDE);
+	cpu.clear(0.5f, 0.25f);
+	CubeTarget target(RD_SIDE);
+	target.upload(cpu);
+
+	// A disruption towards a cube corner, so it covers three faces
+	vec3 const dir = vec3(0.6f, 0.5f, 0.62f);
+	vec3 const point = getReactionDiffusionDisruptionPoint(dir);
+
+	glUseProgram(program);
+	setUniform(program, "gridSideLength", RD_SIDE);
+	setUniform(program, "uDisruptionPoint", point);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.mFbo);
+	sMeshes.drawPoint();
+
+	ReactionDiffusionGrid gpu(RD_SIDE);
+	target.read(gpu);
+	disruptReactionDiffusion(cpu, point);
+
+	// Texels right on the radius can go either way
+	size_t disrupted = 0;
+	size_t numDiffering = 0;
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < RD_SIDE; row++) {
+			for (int col = 0; col < RD_SIDE; col++) {
+				float dist = length(normalize(getCubeFaceTexelDirection(face, col, row, RD_SIDE)) - point);
+				if (std::abs(dist - RD_DISRUPT_RADIUS) < DISRUPT_EDGE) {
+					continue;
+				}
+				size_t idx = cpu.getIndex(face, col, row);
+				disrupted += dist < RD_DISRUPT_RADIUS;
+				numDiffering += gpu.mA[idx] != cpu.mA[idx] || gpu.mB[idx] != cpu.mB[idx];
+			}
+		}
+	}
+
+	result.add("side", RD_SIDE);
+	result.add("disrupted", disrupted);
+	result.add("differing_texels", numDiffering);
+	if (disrupted == 0) {
+		result.fail("the disruption missed the grid");
+	}
+	if (numDiffering > 0) {
+		result.fail("RDDisruptReactionDiffusion_f and disruptReactionDiffusion() disagree");
+	}
+}
+
+// ---- bird rendering
+
+// View projection of one face of a cube map camera at the origin, looking down the face's axis with a 90 degree frustum,
+// its x and y along the face's s and t, so a direction lands on the texel CubeFaces puts it on. Column major, the way
+// the geometry shader's uMatrices block takes it
+void getCubeFaceViewProjection(int face, float nearPlane, float farPlane, float * matrix) {
+	vec3 axis = getCubeFaceDirection(face, 0, 0);
+	vec3 sAxis = getCubeFaceDirection(face, 1, 0) - axis;
+	vec3 tAxis = getCubeFaceDirection(face, 0, 1) - axis;
+	float depthScale = (farPlane + nearPlane) / (farPlane - nearPlane);
+	float depthOffset = -2.0f * farPlane * nearPlane / (farPlane - nearPlane);
+
+	float const rows[4][4] = {
+		{ sAxis.x, sAxis.y, sAxis.z, 0.0f },
+		{ tAxis.x, tAxis.y, tAxis.z, 0.0f },
+		{ depthScale * axis.x, depthScale * axis.y, depthScale * axis.z, depthOffset },
+		{ axis.x, axis.y, axis.z, 0.0f }
+	};
+	for (int row = 0; row < 4; row++) {
+		for (int col = 0; col < 4; col++) {
+			matrix[col * 4 + row] = rows[row][col];
+		}
+	}
+}
+
+// FlockingApp::draw()'s pass of FLRenderBirds_v/_g/_f into the layered cube map camera, one point per bird, against
+// BirdRasterizer drawing every bird as its two triangles. The two only differ where a texel center lies on a
+// triangle's edge, which GL's fill rule and the rasterizer's inclusive edges settle differently
+void runBirdRender(GateOptions const & options, CaseResult & result) {
+	int const side = 512;
+	int const flockSide = 32;
+
+	string error;
+	GLuint program = loadProgram(options.mResources, "FLRenderBirds_v.glsl", "FLRenderBirds_f.glsl", "FLRenderBirds_g.glsl", error);
+	if (!program) {
+		result.fail(error);
+		return;
+	}
+
+	FlockState flock;
+	setupGateFlock(flock, flockSide);
+	StateTarget positions(flockSide, GL_RGBA32F, GL_RGBA, GL_FLOAT, flock.mPositions.data());
+	StateTarget velocities(flockSide, GL_RGBA32F, GL_RGBA, GL_FLOAT, flock.mVelocities.data());
+	setUniform(program, "uBirdPositions", 0);
+	setUniform(program, "uBirdVelocities", 1);
+	bindTexture(0, GL_TEXTURE_2D, positions.mTexture);
+	bindTexture(1, GL_TEXTURE_2D, velocities.mTexture);
+
+	// Bird indices the way FlockingApp::setup() makes them, and white like its ScopedColor
+	vector<vec2> birdIndices;
+	for (int row = 0; row < flockSide; row++) {
+		for (int col = 0; col < flockSide; col++) {
+			birdIndices.push_back((vec2(col, row) + 0.5f) / (float) flockSide);
+		}
+	}
+	GLuint vao, vbo;
+	glGenVertexArrays(1, & vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, & vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, birdIndices.size() * sizeof(vec2), birdIndices.data(), GL_STATIC_DRAW);
+	GLint indexAttrib = glGetAttribLocation(program, "birdIndex");
+	glEnableVertexAttribArray(indexAttrib);
+	glVertexAttribPointer(indexAttrib, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+	GLint colorAttrib = glGetAttribLocation(program, "ciColor");
+	if (colorAttrib >= 0) {
+		glVertexAttrib4f(colorAttrib, 1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	float matrices[NUM_CUBE_FACES * 16];
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		getCubeFaceViewProjection(face, 0.1f, 10.0f, & matrices[face * 16]);
+	}
+	GLuint matrixBuffer;
+	glGenBuffers(1, & matrixBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, matrixBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(matrices), matrices, GL_STATIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, matrixBuffer);
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "uMatrices"), 0);
+
+	CubeTarget camera(side, GL_RGB8);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDrawArrays(GL_POINTS, 0, (GLsizei) birdIndices.size());
+
+	BirdRasterizer rasterizer;
+	BirdRasterOptions rasterOptions;
+	rasterOptions.mSide = side;
+	rasterOptions.mSplatMaxExtent = 0.0f;
+	rasterOptions.mDenseTileBirds = 0;
+	rasterizer.render(flock, rasterOptions);
+
+	// Texels lit in one and not the other, per face, as a fraction of those lit in either
+	size_t litTexels = 0;
+	size_t differingTexels = 0;
+	float worstFace = 0.0f;
+	vector<uint8_t> texels((size_t) side * side * 3);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, camera.mTexture);
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB, GL_UNSIGNED_BYTE, texels.data());
+		uint8_t const * cpu = rasterizer.getFace(face);
+		size_t lit = 0, differing = 0;
+		for (size_t idx = 0; idx < texels.size(); idx += 3) {
+			bool gpuLit = texels[idx] > 127;
+			bool cpuLit = cpu[idx] > 127;
+			lit += gpuLit || cpuLit;
+			differing += gpuLit != cpuLit;
+		}
+		litTexels += lit;
+		differingTexels += differing;
+		worstFace = getWorse(worstFace, lit > 0 ? (float) differing / lit : 0.0f);
+	}
+
+	glDeleteBuffers(1, & matrixBuffer);
+	glDeleteBuffers(1, & vbo);
+	glDeleteVertexArrays(1, & vao);
+
+	result.add("birds", birdIndices.size());
+	result.add("side", side);
+	result.add("lit_texels", litTexels);
+	result.add("differing_texels", differingTexels);
+	result.add("worst_face_fraction", worstFace);
+	result.add("tolerance", BIRD_RENDER_TOLERANCE);
+	if (litTexels < birdIndices.size()) {
+		result.fail("the birds barely drew, " + std::to_string(litTexels) + " texels lit");
+	}
+	if (worstFace > BIRD_RENDER_TOLERANCE) {
+		result.fail("FLRenderBirds and BirdRasterizer disagree");
+	}
+}
+
+// ---- telemetry
+
+// ReactionDiffusionApp::collectTelemetry()'s blit of each face down to the sample grid and read back of B, and
+// FlockingApp::collectTelemetry()'s read back of the first rows of birds
+void runTelemetrySamples(GateOptions const & options, CaseResult & result) {
+	int const side = 512;
+	int const sampleSide = 40;
+
+	// Every texel's B says where it is, exactly, as a float
+	ReactionDiffusionGrid grid(side);
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				grid.mB[grid.getIndex(face, col, row)] = (float) ((face * side + row) * side + col);
+			}
+		}
+	}
+	CubeTarget cube(side);
+	cube.upload(grid);
+
+	// StateTarget is square and the strip of samples isn't, so it's sized again
+	StateTarget samples(1, GL_RGB32F, GL_RGB, GL_FLOAT, nullptr);
+	glBindTexture(GL_TEXTURE_2D, samples.mTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, NUM_CUBE_FACES * sampleSide, sampleSide, 0, GL_RGB, GL_FLOAT, nullptr);
+	GLuint faceFbo;
+	glGenFramebuffers(1, & faceFbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, faceFbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, samples.mFbo);
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, cube.mTexture, 0);
+		glBlitFramebuffer(0, 0, side, side, face * sampleSide, 0, (face + 1) * sampleSide, sampleSide, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+	glDeleteFramebuffers(1, & faceFbo);
+
+	GLuint pbo;
+	glGenBuffers(1, & pbo);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+	size_t const numSamples = NUM_CUBE_FACES * sampleSide * sampleSide;
+	glBufferData(GL_PIXEL_PACK_BUFFER, numSamples * sizeof(float), nullptr, GL_STREAM_READ);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, samples.mFbo);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glReadPixels(0, 0, NUM_CUBE_FACES * sampleSide, sampleSide, GL_BLUE, GL_FLOAT, nullptr);
+
+	// Each sample is one texel near its cell's center, on its own face. Centers falling on a texel edge can round
+	// either way
+	size_t misplaced = numSamples;
+	if (auto values = static_cast<float const *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, numSamples * sizeof(float), GL_MAP_READ_BIT))) {
+		misplaced = 0;
+		for (int face = 0; face < NUM_CUBE_FACES; face++) {
+			for (int row = 0; row < sampleSide; row++) {
+				for (int col = 0; col < sampleSide; col++) {
+					int texel = (int) values[row * NUM_CUBE_FACES * sampleSide + face * sampleSide + col];
+					int expectedCol = (int) ((col + 0.5f) * side / sampleSide);
+					int expectedRow = (int) ((row + 0.5f) * side / sampleSide);
+					misplaced += texel / (side * side) != face || std::abs(texel / side % side - expectedRow) > 1
+						|| std::abs(texel % side - expectedCol) > 1;
+				}
+			}
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+
+	// The first rows of a packed flock come back bird for bird
+	int const flockSide = 56;
+	int const sampleRows = (256 + flockSide - 1) / flockSide;
+	FlockState flock;
+	setupGateFlock(flock, flockSide);
+	PackedFlockState packed;
+	packFlock(flock, packed, getPackedVelocityRange(FlockingParams()));
+	StateTarget birds(flockSide, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, packed.mBirds.data());
+	size_t const birdBytes = sampleRows * flockSide * sizeof(PackedBird);
+	glBufferData(GL_PIXEL_PACK_BUFFER, birdBytes, nullptr, GL_STREAM_READ);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, birds.mFbo);
+	glReadPixels(0, 0, flockSide, sampleRows, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+	bool birdsMatch = false;
+	if (auto values = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, birdBytes, GL_MAP_READ_BIT)) {
+		birdsMatch = std::memcmp(values, packed.mBirds.data(), birdBytes) == 0;
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glDeleteBuffers(1, & pbo);
+
+	// How far the sampled order of the gate's scattered flock is from the whole flock's
+	float order, sampledOrder, meanSpeed;
+	measureFlock(flock.mVelocities.data(), flock.mVelocities.size(), order, meanSpeed);
+	measureFlock(flock.mVelocities.data(), sampleRows * flockSide, sampledOrder, meanSpeed);
+
+	result.add("samples", numSamples);
+	result.add("misplaced_samples", misplaced);
+	result.add("sampled_birds", sampleRows * flockSide);
+	result.add("flock_order", order);
+	result.add("sampled_flock_order", sampledOrder);
+	if (misplaced > 0) {
+		result.fail("the blit to the sample grid didn't take one texel per sample from its face");
+	}
+	if (!birdsMatch) {
+		result.fail("the packed birds' first rows didn't read back bird for bird");
+	}
+}
+
+int main(int argc, char ** argv) {
+	GateOptions options;
+	for (int idx = 1; idx < argc; idx++) {
+		string arg = argv[idx];
+		if (arg == "--resources" && idx + 1 < argc) {
+			options.mResources = argv[++idx];
+		} else if (arg == "--filter" && idx + 1 < argc) {
+			options.mFilter = argv[++idx];
+		} else if (arg == "--timing") {
+			options.mTiming = true;
+		} else {
+			std::fprintf(stderr, "Usage: %s [--resources dir] [--filter text] [--timing]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	string error;
+	if (!createContext(error)) {
+		std::fprintf(stderr, "Couldn't create a headless GL context: %s\n", error.c_str());
+		return 1;
+	}
+	std::fprintf(stderr, "%s, %s\n", (char const *) glGetString(GL_RENDERER), (char const *) glGetString(GL_VERSION));
+	sMeshes.setup();
+	glDisable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+
+	vector<ShaderCase> cases = {
+		{ "programs", runPrograms },
+		{ "constants", runConstants },
+		{ "flocking_32", [] (GateOptions const & options, CaseResult & result) { runFloatFlocking(options, result, 32); } },
+		{ "flocking_56", [] (GateOptions const & options, CaseResult & result) { runFloatFlocking(options, result, 56); } },
+		{ "flocking_disrupt", runFloatFlockingDisrupt },
+		{ "flocking_packed_32", [] (GateOptions const & options, CaseResult & result) { runPackedFlocking(options, result, 32); } },
+		{ "flocking_packed_56", [] (GateOptions const & options, CaseResult & result) { runPackedFlocking(options, result, 56); } },
+		{ "flocking_packed_disrupt", runPackedFlockingDisrupt },
+		{ "reaction_diffusion", runReactionDiffusion },
+		{ "reaction_diffusion_disrupt", runReactionDiffusionDisrupt },
+		{ "bird_render", runBirdRender },
+		{ "telemetry_samples", runTelemetrySamples }
+	};
+
+	bool passed = true;
+	for (auto const & shaderCase : cases) {
+		if (!options.mFilter.empty() && shaderCase.mName.find(options.mFilter) == string::npos) {
+			continue;
+		}
+
+		CaseResult result;
+		shaderCase.mRun(options, result);
+		GLenum glError = glGetError();
+		if (glError != GL_NO_ERROR) {
+			result.fail("GL error " + std::to_string(glError));
+		}
+
+		std::printf("{\"case\":\"%s\"", shaderCase.mName.c_str());
+		for (auto const & value : result.mValues) {
+			std::printf(",\"%s\":%g", value.first.c_str(), value.second);
+		}
+		std::printf(",\"pass\":%s}\n", result.mFailure.empty() ? "true" : "false");
+		std::fflush(stdout);
+
+		if (!result.mFailure.empty()) {
+			std::fprintf(stderr, "%s: %s\n", shaderCase.mName.c_str(), result.mFailure.c_str());
+			passed = false;
+		}
+	}
+
+	return passed ? 0 : 1;
+}
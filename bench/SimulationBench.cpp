@@ -0,0 +1,532 @@
+// Headless benchmarks for the parts of the simulations that don't need a GL context, so they can run on the Linux
+// build boxes. Build and run with `make bench`.
+//
+// Prints one JSON object per benchmark and size on stdout:
+//   {"bench":"flock_step","size":3136,"iterations":12,"ns_per_op":...,"p50_ns":...,"p99_ns":...,"ops_per_sec":...,
+//    "allocs_per_op":...,"alloc_bytes_per_op":...}
+//
+// Options:
+//   --filter <text>     only run benchmarks whose name contains text
+//   --min-time <sec>    minimum time spent timing each benchmark and size, 0.5 by default
+//   --resources <dir>   where to find the OBJ files, ./resources by default
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "cinder/DataSource.h"
+#include "cinder/Filesystem.h"
+#include "cinder/ObjLoader.h"
+#include "cinder/Rand.h"
+#include "cinder/TriMesh.h"
+
+#include "BirdRasterizer.h"
+#include "ByteCodec.h"
+#include "CubeFaces.h"
+#include "Disruption.h"
+#include "FlockingKernels.h"
+#include "FrameStream.h"
+#include "MeshCache.h"
+#include "NetworkBatch.h"
+#include "NetworkSim.h"
+#include "ReactionDiffusionKernels.h"
+#include "ReactionDiffusionModels.h"
+#include "ReactionDiffusionSphere.h"
+#include "TaskScheduler.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+// Every allocation in the process goes through these, so the benchmarks can report how much each op allocates
+static std::atomic<uint64_t> sNumAllocs(0);
+static std::atomic<uint64_t> sAllocBytes(0);
+
+void * operator new(size_t size) {
+	sNumAllocs.fetch_add(1, std::memory_order_relaxed);
+	sAllocBytes.fetch_add(size, std::memory_order_relaxed);
+	if (void * ptr = std::malloc(size ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void * operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void * ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void * ptr) noexcept {
+	std::free(ptr);
+}
+
+struct BenchOptions {
+	string mFilter;
+	double mMinTime = 0.5;
+	fs::path mResources = "resources";
+};
+
+class BenchRunner {
+public:
+	explicit BenchRunner(BenchOptions const & options) : mOptions(options) {}
+
+	bool isEnabled(string const & name) const {
+		return mOptions.mFilter.empty() || name.find(mOptions.mFilter) != string::npos;
+	}
+
+	// Runs op until min time has passed. Each call to op counts as opsPerCall ops. Setup runs before every call, untimed
+	void run(string const & name, size_t size, size_t opsPerCall, std::function<void()> const & setup, std::function<void()> const & op) {
+		typedef std::chrono::steady_clock Clock;
+
+		vector<double> callNs;
+		uint64_t allocs = 0;
+		uint64_t allocBytes = 0;
+		double totalNs = 0.0;
+
+		// One untimed warm up call, so lazy initialization doesn't land in the numbers
+		setup();
+		op();
+
+		while (callNs.size() < 3 || totalNs < mOptions.mMinTime * 1.0e9) {
+			setup();
+
+			uint64_t allocsBefore = sNumAllocs.load();
+			uint64_t bytesBefore = sAllocBytes.load();
+			auto start = Clock::now();
+
+			op();
+
+			auto end = Clock::now();
+			allocs += sNumAllocs.load() - allocsBefore;
+			allocBytes += sAllocBytes.load() - bytesBefore;
+
+			double ns = std::chrono::duration<double, std::nano>(end - start).count();
+			callNs.push_back(ns);
+			totalNs += ns;
+		}
+
+		std::sort(callNs.begin(), callNs.end());
+		double numOps = (double) callNs.size() * opsPerCall;
+		double p50 = callNs[callNs.size() / 2] / opsPerCall;
+		double p99 = callNs[std::min(callNs.size() - 1, (size_t) (callNs.size() * 0.99))] / opsPerCall;
+
+		std::printf("{\"bench\":\"%s\",\"size\":%zu,\"iterations\":%zu,\"ns_per_op\":%.1f,\"p50_ns\":%.1f,\"p99_ns\":%.1f,\"ops_per_sec\":%.1f,\"allocs_per_op\":%.2f,\"alloc_bytes_per_op\":%.1f}\n",
+			name.c_str(), size, callNs.size(), totalNs / numOps, p50, p99, numOps / (totalNs / 1.0e9), allocs / numOps, allocBytes / numOps);
+		std::fflush(stdout);
+	}
+
+	void run(string const & name, size_t size, size_t opsPerCall, std::function<void()> const & op) {
+		run(name, size, opsPerCall, [] {}, op);
+	}
+
+	BenchOptions const & getOptions() const { return mOptions; }
+
+private:
+	BenchOptions mOptions;
+};
+
+void benchNetwork(BenchRunner & runner) {
+	for (int numNodes : { 500, 2000, 8000 }) {
+		if (runner.isEnabled("network_graph_build")) {
+			std::unique_ptr<NetworkSim> sim;
+			runner.run("network_graph_build", numNodes, 1, [&] {
+				sim.reset(new NetworkSim());
+				sim->mNumNetworkNodes = numNodes;
+				sim->mRand.seed(numNodes);
+			}, [&] {
+				sim->setup();
+			});
+		}
+
+		NetworkSim sim;
+		sim.mNumNetworkNodes = numNodes;
+		sim.mRand.seed(numNodes);
+		sim.setup();
+
+		if (runner.isEnabled("network_step")) {
+			runner.run("network_step", numNodes, 1, [&] { sim.step(); });
+		}
+
+		if (runner.isEnabled("network_disrupt")) {
+			runner.run("network_disrupt", numNodes, 1, [&] { sim.disrupt(getDisruptionVector(randInt(6))); });
+		}
+	}
+}
+
+// Per world step, for K worlds on one 2000 node graph, stepped one NetworkSim at a time and as a NetworkBatch
+void benchNetworkBatch(BenchRunner & runner) {
+	bool separate = runner.isEnabled("network_worlds_separate");
+	bool batched = runner.isEnabled("network_batch_step");
+	if (!separate && !batched) {
+		return;
+	}
+
+	for (int numWorlds : { 1, 8, 64 }) {
+		vector<NetworkSim> sims(numWorlds);
+		for (int world = 0; world < numWorlds; world++) {
+			sims[world].mRand.seed(2000);
+			sims[world].setup();
+			sims[world].mRand.seed(world);
+		}
+
+		NetworkBatch batch(std::make_shared<NetworkTopology>(sims[0]), NetworkRates(sims[0]));
+		for (auto const & sim : sims) {
+			batch.addWorld(sim);
+		}
+
+		if (separate) {
+			runner.run("network_worlds_separate", numWorlds, numWorlds, [&] {
+				for (auto & sim : sims) {
+					sim.step();
+				}
+			});
+		}
+		if (batched) {
+			runner.run("network_batch_step", numWorlds, numWorlds, [&] { batch.step(); });
+		}
+	}
+}
+
+void benchDisruptionVector(BenchRunner & runner) {
+	if (!runner.isEnabled("disruption_vector")) {
+		return;
+	}
+
+	size_t const CALLS = 10000;
+	vec3 sink(0);
+	runner.run("disruption_vector", 1, CALLS, [&] {
+		for (size_t idx = 0; idx < CALLS; idx++) {
+			sink += getDisruptionVector(idx % 6);
+		}
+	});
+
+	// Keeps the calls from being optimized away
+	if (sink.x == 12345.0f) {
+		std::printf("\n");
+	}
+}
+
+void benchObjLoading(BenchRunner & runner) {
+	vector<fs::path> objPaths = {
+		runner.getOptions().mResources / "BoxSides.obj",
+		runner.getOptions().mResources / "CalibrationPreciseAlignment.obj",
+		runner.getOptions().mResources / ".." / "src" / "gen_cfig" / "installation_custom_adjusted_projector_sphere_cfig.obj"
+	};
+
+	fs::path cacheDir = fs::temp_directory_path() / "DigitalLifeBench";
+
+	for (auto & objPath : objPaths) {
+		if (!fs::exists(objPath)) {
+			std::fprintf(stderr, "Skipping missing OBJ: %s\n", objPath.string().c_str());
+			continue;
+		}
+
+		BufferRef objBuffer = loadFile(objPath)->getBuffer();
+		size_t objBytes = objBuffer->getSize();
+		string suffix = "_" + objPath.stem().string();
+
+		if (runner.isEnabled("obj_parse" + suffix)) {
+			runner.run("obj_parse" + suffix, objBytes, 1, [&] {
+				auto mesh = TriMesh::create(ObjLoader(DataSourceBuffer::create(objBuffer)), TriMesh::Format().positions(3).texCoords0(2));
+				if (mesh->getNumVertices() == 0) {
+					std::fprintf(stderr, "Parsed an empty mesh from: %s\n", objPath.string().c_str());
+				}
+			});
+		}
+
+		if (runner.isEnabled("obj_cache_load" + suffix)) {
+			fs::path cachePath = cacheDir / (objPath.filename().string() + ".dlmesh");
+			// The first load writes the cache, every timed one after that maps it
+			loadCachedObjMesh(loadFile(objPath), cachePath);
+
+			runner.run("obj_cache_load" + suffix, objBytes, 1, [&] {
+				auto mesh = loadCachedObjMesh(loadFile(objPath), cachePath);
+				if (mesh->getNumVertices() == 0) {
+					std::fprintf(stderr, "Loaded an empty mesh from: %s\n", cachePath.string().c_str());
+				}
+			});
+		}
+	}
+}
+
+void benchFlocking(BenchRunner & runner) {
+	FlockingParams params;
+
+	for (int numBirds : { 1024, 3136, 8192 }) {
+		Rand rand(numBirds);
+		FlockState source, dest;
+		setupFlock(source, numBirds, rand);
+		dest = source;
+
+		if (runner.isEnabled("flock_step")) {
+			runner.run("flock_step", numBirds, 1, [&] {
+				stepFlock(source, dest, params);
+				std::swap(source, dest);
+			});
+		}
+
+		if (runner.isEnabled("flock_disrupt")) {
+			runner.run("flock_disrupt", numBirds, 1, [&] { disruptFlock(source, normalize(rand.nextVec3()), params.mMaxSpeed); });
+		}
+
+		// The same flock at 8 bytes a bird instead of 32
+		if (runner.isEnabled("flock_step_packed")) {
+			PackedFlockState packedSource, packedDest;
+			packFlock(source, packedSource, getPackedVelocityRange(params));
+			vector<vec3> positions;
+			runner.run("flock_step_packed", numBirds, 1, [&] {
+				stepPackedFlock(packedSource, packedDest, params, positions);
+				std::swap(packedSource, packedDest);
+			});
+		}
+	}
+}
+
+// What forking and joining costs on the task scheduler, for tasks too small to matter, per parallelFor call. Compare
+// with the thread start and join every parallel stage used to pay
+void benchTaskScheduler(BenchRunner & runner) {
+	if (!runner.isEnabled("task_fork_join")) {
+		return;
+	}
+
+	TaskScheduler & scheduler = TaskScheduler::get();
+	for (size_t numTasks : { 8, 64, 512 }) {
+		vector<uint64_t> counts(numTasks, 0);
+		runner.run("task_fork_join", numTasks, 1, [&] {
+			scheduler.parallelFor(numTasks, scheduler.getConcurrency(), [&] (size_t task, size_t) { counts[task]++; });
+		});
+	}
+}
+
+void benchBirdRaster(BenchRunner & runner) {
+	if (!runner.isEnabled("flock_raster")) {
+		return;
+	}
+
+	for (int numBirds : { 3136, 16384, 65536 }) {
+		Rand rand(numBirds);
+		FlockState flock;
+		setupFlock(flock, numBirds, rand);
+
+		BirdRasterizer rasterizer;
+		BirdRasterOptions options;
+		options.mSide = 1024;
+		runner.run("flock_raster", numBirds, 1, [&] { rasterizer.render(flock, options); });
+	}
+}
+
+void benchReactionDiffusion(BenchRunner & runner) {
+	for (int side : { 128, 256, 512 }) {
+		ReactionDiffusionGrid source(side);
+		ReactionDiffusionGrid dest(side);
+		setupCircleReactionDiffusion(source, 20);
+
+		if (runner.isEnabled("rd_step")) {
+			// Reported per cell update, which is what the GPU version is usually compared by
+			runner.run("rd_step", side, (size_t) NUM_CUBE_FACES * side * side, [&] {
+				stepReactionDiffusionModel<RDPresetGrayScottAlphaWaves>(source, dest);
+				std::swap(source, dest);
+			});
+		}
+
+		if (runner.isEnabled("rd_disrupt")) {
+			Rand rand(side);
+			runner.run("rd_disrupt", side, 1, [&] { disruptReactionDiffusion(source, normalize(rand.nextVec3())); });
+		}
+	}
+}
+
+// Throughput of each compile time preset, reported per cell update
+template <typename Preset>
+void benchReactionDiffusionModel(BenchRunner & runner, string const & name) {
+	if (!runner.isEnabled(name)) {
+		return;
+	}
+
+	for (int side : { 128, 256, 512 }) {
+		ReactionDiffusionGrid source(side);
+		ReactionDiffusionGrid dest(side);
+		setupReactionDiffusionModel<Preset>(source, 0.05f, side);
+
+		runner.run(name, side, (size_t) NUM_CUBE_FACES * side * side, [&] {
+			stepReactionDiffusionModel<Preset>(source, dest);
+			std::swap(source, dest);
+		});
+	}
+}
+
+// The sphere grid that resolves patterns as finely as each cube side, reported per texel of that cube, so it compares
+// directly with rd_model_grayscott at the same side
+void benchReactionDiffusionSphere(BenchRunner & runner) {
+	typedef RDPresetGrayScottAlphaWaves Preset;
+
+	if (!runner.isEnabled("rd_sphere_step")) {
+		return;
+	}
+
+	for (int side : { 128, 256, 512 }) {
+		RDSphereGrid sphere = RDSphereGrid::create<Preset::Stencil>(RDSphereGrid::getSideMatchingCube(side));
+		ReactionDiffusionGrid source(sphere.getSide());
+		ReactionDiffusionGrid dest(sphere.getSide());
+		setupReactionDiffusionModel<Preset>(source, 0.05f, sphere.getSide());
+
+		runner.run("rd_sphere_step", side, (size_t) NUM_CUBE_FACES * side * side, [&] {
+			stepReactionDiffusionSphere<Preset>(sphere, source, dest);
+			std::swap(source, dest);
+		});
+	}
+}
+
+// Encoding and decoding a developed reaction-diffusion state the way checkpoints store it, reported per byte of raw state
+void benchCheckpointCodec(BenchRunner & runner) {
+	if (!runner.isEnabled("checkpoint_encode") && !runner.isEnabled("checkpoint_decode")) {
+		return;
+	}
+
+	for (int side : { 256, 512 }) {
+		ReactionDiffusionGrid source(side);
+		ReactionDiffusionGrid dest(side);
+		setupCircleReactionDiffusion(source, 20);
+		for (int step = 0; step < 1000; step++) {
+			stepReactionDiffusionModel<RDPresetGrayScottAlphaWaves>(source, dest);
+			std::swap(source, dest);
+		}
+
+		vector<float> state(source.mA);
+		state.insert(state.end(), source.mB.begin(), source.mB.end());
+		size_t stateBytes = state.size() * sizeof(float);
+
+		vector<uint8_t> encoded;
+		if (runner.isEnabled("checkpoint_encode")) {
+			runner.run("checkpoint_encode", side, stateBytes, [&] { encoded.clear(); }, [&] {
+				encodeBytes(reinterpret_cast<uint8_t const *>(state.data()), stateBytes, sizeof(float), encoded);
+			});
+		}
+
+		encoded.clear();
+		encodeBytes(reinterpret_cast<uint8_t const *>(state.data()), stateBytes, sizeof(float), encoded);
+		std::fprintf(stderr, "checkpoint side %d: %zu bytes encoded to %zu\n", side, stateBytes, encoded.size());
+
+		if (runner.isEnabled("checkpoint_decode")) {
+			vector<float> decoded(state.size());
+			runner.run("checkpoint_decode", side, stateBytes, [&] {
+				decodeBytes(encoded.data(), encoded.size(), reinterpret_cast<uint8_t *>(decoded.data()), stateBytes, sizeof(float));
+			});
+		}
+	}
+}
+
+// A strip the size of the app's output, mostly black with birds crossing it and a pattern drifting over one face, as
+// the app's `--output-stream` sends it. Each call encodes or decodes the next frame of it, one thread, for each tile side
+void benchFrameStream(BenchRunner & runner) {
+	if (!runner.isEnabled("frame_encode") && !runner.isEnabled("frame_decode")) {
+		return;
+	}
+
+	int const FACE_SIDE = 1024;
+	int const WIDTH = 6 * FACE_SIDE;
+	int const NUM_BIRDS = 400;
+	int const NUM_FRAMES = 16;
+
+	vector<uint8_t> pixels((size_t) WIDTH * FACE_SIDE * 4);
+	auto drawFrame = [&] (int frame) {
+		std::fill(pixels.begin(), pixels.end(), 0);
+		for (int y = 0; y < FACE_SIDE; y++) {
+			for (int x = 0; x < FACE_SIDE; x++) {
+				float value = std::sin(x * 0.027f + (frame / 2) * 0.05f) * std::cos(y * 0.031f);
+				if (value > 0.3f) {
+					uint8_t * pixel = & pixels[((size_t) y * WIDTH + 2 * FACE_SIDE + x) * 4];
+					pixel[0] = (uint8_t) (255.0f * value);
+					pixel[3] = 255;
+				}
+			}
+		}
+		for (int bird = 0; bird < NUM_BIRDS; bird++) {
+			int x = (bird * 7919 + frame * (1 + bird % 3)) % (WIDTH - 3);
+			int y = (bird * 104729) % (FACE_SIDE - 3);
+			for (int dy = 0; dy < 3; dy++) {
+				std::fill_n(& pixels[((size_t) (y + dy) * WIDTH + x) * 4], 12, 255);
+			}
+		}
+	};
+
+	for (int tileSide : { 16, 32, 64 }) {
+		FrameTileEncoder encoder(WIDTH, FACE_SIDE, tileSide);
+		vector<uint8_t> message;
+		int frame = 0;
+
+		if (runner.isEnabled("frame_encode")) {
+			runner.run("frame_encode", tileSide, 1, [&] { drawFrame(frame++ % NUM_FRAMES); }, [&] {
+				encoder.encode(pixels.data(), (size_t) WIDTH * 4, message);
+			});
+		}
+
+		// The sequence starts on a key frame, so decoding can go round it
+		vector<vector<uint8_t>> messages(NUM_FRAMES);
+		size_t totalBytes = 0;
+		encoder.requestKeyFrame();
+		for (frame = 0; frame < NUM_FRAMES; frame++) {
+			drawFrame(frame);
+			encoder.encode(pixels.data(), (size_t) WIDTH * 4, messages[frame]);
+			totalBytes += messages[frame].size();
+		}
+		std::fprintf(stderr, "frame stream tile %d: %zu bytes a frame encoded to %zu\n", tileSide, pixels.size(), totalBytes / NUM_FRAMES);
+
+		if (runner.isEnabled("frame_decode")) {
+			FrameTileDecoder decoder;
+			frame = 0;
+			runner.run("frame_decode", tileSide, 1, [&] {
+				vector<uint8_t> const & next = messages[frame++ % NUM_FRAMES];
+				decoder.decode(next.data(), next.size());
+			});
+		}
+	}
+}
+
+int main(int argc, char ** argv) {
+	BenchOptions options;
+	for (int idx = 1; idx < argc; idx++) {
+		string arg = argv[idx];
+		if (arg == "--filter" && idx + 1 < argc) {
+			options.mFilter = argv[++idx];
+		} else if (arg == "--min-time" && idx + 1 < argc) {
+			options.mMinTime = std::atof(argv[++idx]);
+		} else if (arg == "--resources" && idx + 1 < argc) {
+			options.mResources = argv[++idx];
+		} else {
+			std::fprintf(stderr, "Usage: %s [--filter text] [--min-time seconds] [--resources dir]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	randSeed(1);
+
+	BenchRunner runner(options);
+	benchNetwork(runner);
+	benchNetworkBatch(runner);
+	benchDisruptionVector(runner);
+	benchObjLoading(runner);
+	benchFlocking(runner);
+	benchBirdRaster(runner);
+	benchTaskScheduler(runner);
+	benchReactionDiffusion(runner);
+	benchReactionDiffusionModel<RDPresetGrayScottAlphaWaves>(runner, "rd_model_grayscott");
+	benchReactionDiffusionModel<RDPresetFitzHughNagumo>(runner, "rd_model_fitzhugh_nagumo");
+	benchReactionDiffusionModel<RDPresetBrusselator>(runner, "rd_model_brusselator");
+	benchReactionDiffusionSphere(runner);
+	benchCheckpointCodec(runner);
+	benchFrameStream(runner);
+
+	return 0;
+}
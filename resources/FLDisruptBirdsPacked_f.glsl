@@ -0,0 +1,63 @@
+#version 410
+
+// FLDisruptBirds_f.glsl on the packed state of FlockingKernels.h. Positions are left as they are
+
+uniform usampler2D uBirds;
+
+uniform float uVelocityRange;
+
+uniform vec3 uDisruptPoint;
+uniform float uMaxSpeed;
+
+out uvec2 FragColor; // new packed bird
+
+#define DISRUPT_RADIUS 0.45
+
+// Packing, the same as FlockingKernels.cpp
+
+#define UNORM16_MAX 65535.0
+#define VELOCITY_STEPS 1023.0
+
+float signNotZero(float v) {
+  return v >= 0.0 ? 1.0 : -1.0;
+}
+
+vec3 unpackOctahedral(uint bits) {
+  vec2 p = vec2(bits & 0xffffu, bits >> 16) * (2.0 / UNORM16_MAX) - 1.0;
+  float z = 1.0 - abs(p.x) - abs(p.y);
+  float fold = max(-z, 0.0);
+  p.x += p.x >= 0.0 ? -fold : fold;
+  p.y += p.y >= 0.0 ? -fold : fold;
+  return normalize(vec3(p, z));
+}
+
+void getTangentBasis(vec3 n, out vec3 xAxis, out vec3 yAxis) {
+  float hemisphere = signNotZero(n.z);
+  float a = -1.0 / (hemisphere + n.z);
+  float b = n.x * n.y * a;
+  xAxis = vec3(1.0 + hemisphere * n.x * n.x * a, hemisphere * b, -hemisphere * n.x);
+  yAxis = vec3(b, hemisphere + n.y * n.y * a, -n.y);
+}
+
+// The wing phase bits are kept, only the velocity is packed again
+uint packVelocity(uint bits, vec3 pos, vec3 vel, float range) {
+  vec3 xAxis, yAxis;
+  getTangentBasis(pos, xAxis, yAxis);
+  vec2 tangent = clamp(vec2(dot(vel, xAxis), dot(vel, yAxis)) / range, -1.0, 1.0);
+  uvec2 quantized = uvec2(floor(tangent * VELOCITY_STEPS + 0.5) + VELOCITY_STEPS);
+  return quantized.x | (quantized.y << 11) | (bits & 0xffc00000u);
+}
+
+void main() {
+  uvec2 bird = texelFetch(uBirds, ivec2(gl_FragCoord.xy), 0).xy;
+  vec3 pos = unpackOctahedral(bird.x);
+
+  vec3 fleeVec = pos - uDisruptPoint;
+
+  if (length(fleeVec) < DISRUPT_RADIUS) {
+    vec3 vel = normalize(fleeVec - (dot(fleeVec, pos) * normalize(pos))) * uMaxSpeed;
+    FragColor = uvec2(bird.x, packVelocity(bird.y, pos, vel, uVelocityRange));
+  } else {
+    FragColor = bird;
+  }
+}
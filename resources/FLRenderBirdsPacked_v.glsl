@@ -0,0 +1,57 @@
+#version 410
+
+// FLRenderBirds_v.glsl on the packed state of FlockingKernels.h
+
+in vec2 birdIndex;
+in vec4 ciColor;
+
+uniform usampler2D uBirds;
+
+out VertexData {
+  vec4 velocity;
+  vec4 color;
+  float wingPos;
+} vs_out;
+
+// Unpacking, the same as FlockingKernels.cpp. The velocity is only used for its direction, so its range doesn't matter
+
+#define UNORM16_MAX 65535.0
+#define VELOCITY_STEPS 1023.0
+#define PHASE_STEPS 1024.0
+#define TWO_PI 6.28318530718
+
+float signNotZero(float v) {
+  return v >= 0.0 ? 1.0 : -1.0;
+}
+
+vec3 unpackOctahedral(uint bits) {
+  vec2 p = vec2(bits & 0xffffu, bits >> 16) * (2.0 / UNORM16_MAX) - 1.0;
+  float z = 1.0 - abs(p.x) - abs(p.y);
+  float fold = max(-z, 0.0);
+  p.x += p.x >= 0.0 ? -fold : fold;
+  p.y += p.y >= 0.0 ? -fold : fold;
+  return normalize(vec3(p, z));
+}
+
+void getTangentBasis(vec3 n, out vec3 xAxis, out vec3 yAxis) {
+  float hemisphere = signNotZero(n.z);
+  float a = -1.0 / (hemisphere + n.z);
+  float b = n.x * n.y * a;
+  xAxis = vec3(1.0 + hemisphere * n.x * n.x * a, hemisphere * b, -hemisphere * n.x);
+  yAxis = vec3(b, hemisphere + n.y * n.y * a, -n.y);
+}
+
+void main() {
+  uvec2 bird = texelFetch(uBirds, ivec2(birdIndex * vec2(textureSize(uBirds, 0))), 0).xy;
+  vec3 position = unpackOctahedral(bird.x);
+
+  vec3 xAxis, yAxis;
+  getTangentBasis(position, xAxis, yAxis);
+  vec2 tangent = vec2(bird.y & 0x7ffu, (bird.y >> 11) & 0x7ffu) - VELOCITY_STEPS;
+  vec3 velocity = tangent.x * xAxis + tangent.y * yAxis;
+
+  gl_Position = vec4(position, 1);
+  vs_out.velocity = vec4(normalize(velocity), 0);
+  vs_out.color = ciColor;
+  vs_out.wingPos = float(bird.y >> 22) * (TWO_PI / PHASE_STEPS);
+}
@@ -0,0 +1,175 @@
+#version 410
+
+// FLRunBirdsVelocity_f.glsl and FLRunBirdsPosition_f.glsl in one pass, on the packed state of FlockingKernels.h:
+// each bird is 8 bytes of RG32UI instead of a texel in each of two RGBA32F textures
+
+uniform int uGridSide;
+
+uniform usampler2D uBirds;
+
+// What a packed velocity component of 1 is, in the source texture and the one written
+uniform float uSrcVelocityRange;
+uniform float uDstVelocityRange;
+
+out uvec2 FragColor;
+
+#define SELF_EPSILON 0.0000001
+
+uniform float uMinSpeed;
+uniform float uMaxSpeed;
+
+uniform float uMinForce;
+uniform float uMaxForce;
+
+uniform float uSeparationDist;
+uniform float uSeparationMod;
+uniform float uAlignDist;
+uniform float uAlignMod;
+uniform float uCohesionDist;
+uniform float uCohesionMod;
+
+uniform float uFlapSpeed;
+
+// Packing, the same as FlockingKernels.cpp
+
+#define UNORM16_MAX 65535.0
+#define VELOCITY_STEPS 1023.0
+#define PHASE_STEPS 1024.0
+#define TWO_PI 6.28318530718
+
+float signNotZero(float v) {
+  return v >= 0.0 ? 1.0 : -1.0;
+}
+
+uint packOctahedral(vec3 dir) {
+  vec2 p = dir.xy / (abs(dir.x) + abs(dir.y) + abs(dir.z));
+  if (dir.z < 0.0) {
+    p = (1.0 - abs(p.yx)) * vec2(signNotZero(p.x), signNotZero(p.y));
+  }
+  uvec2 quantized = uvec2(floor(clamp(p * 0.5 + 0.5, 0.0, 1.0) * UNORM16_MAX + 0.5));
+  return quantized.x | (quantized.y << 16);
+}
+
+vec3 unpackOctahedral(uint bits) {
+  vec2 p = vec2(bits & 0xffffu, bits >> 16) * (2.0 / UNORM16_MAX) - 1.0;
+  float z = 1.0 - abs(p.x) - abs(p.y);
+  float fold = max(-z, 0.0);
+  p.x += p.x >= 0.0 ? -fold : fold;
+  p.y += p.y >= 0.0 ? -fold : fold;
+  return normalize(vec3(p, z));
+}
+
+void getTangentBasis(vec3 n, out vec3 xAxis, out vec3 yAxis) {
+  float hemisphere = signNotZero(n.z);
+  float a = -1.0 / (hemisphere + n.z);
+  float b = n.x * n.y * a;
+  xAxis = vec3(1.0 + hemisphere * n.x * n.x * a, hemisphere * b, -hemisphere * n.x);
+  yAxis = vec3(b, hemisphere + n.y * n.y * a, -n.y);
+}
+
+uint packVelocityPhase(vec3 pos, vec3 vel, float phase, float range) {
+  vec3 xAxis, yAxis;
+  getTangentBasis(pos, xAxis, yAxis);
+  vec2 tangent = clamp(vec2(dot(vel, xAxis), dot(vel, yAxis)) / range, -1.0, 1.0);
+  uvec2 quantized = uvec2(floor(tangent * VELOCITY_STEPS + 0.5) + VELOCITY_STEPS);
+  uint packedPhase = uint(int(floor(phase * (PHASE_STEPS / TWO_PI) + 0.5))) & 0x3ffu;
+  return quantized.x | (quantized.y << 11) | (packedPhase << 22);
+}
+
+vec3 unpackTangent(uint bits, vec3 pos, float range) {
+  vec3 xAxis, yAxis;
+  getTangentBasis(pos, xAxis, yAxis);
+  vec2 tangent = (vec2(bits & 0x7ffu, (bits >> 11) & 0x7ffu) - VELOCITY_STEPS) * (range / VELOCITY_STEPS);
+  return tangent.x * xAxis + tangent.y * yAxis;
+}
+
+float unpackPhase(uint bits) {
+  return float(bits >> 22) * (TWO_PI / PHASE_STEPS);
+}
+
+vec3 limit(vec3 v, float lo, float hi) {
+  float len = length(v);
+  return max(lo, min(len, hi)) * normalize(v);
+}
+
+vec3 flockAccel(in vec3 selfPos, in vec3 selfVel) {
+  vec3 sepSteer = vec3(0);
+  int separationNeighbors = 0;
+
+  vec3 alignSteer = vec3(0);
+  int alignNeighbors = 0;
+
+  vec3 cohesionPosition = vec3(0);
+  int cohesionNeighbors = 0;
+
+  for (int x = 0; x < uGridSide; x++) {
+    for (int y = 0; y < uGridSide; y++) {
+      uvec2 other = texelFetch(uBirds, ivec2(x, y), 0).xy;
+      vec3 otherPos = unpackOctahedral(other.x);
+      float dist = length(otherPos - selfPos);
+
+      float isOther = float(dist > SELF_EPSILON);
+
+      // Branches like FLRunBirdsVelocity_f.glsl, 0 times the NaN from a bird's distance to itself is still NaN
+      bool withinSeparationDist = dist < isOther * uSeparationDist;
+      if (withinSeparationDist) {
+        sepSteer += normalize(selfPos - otherPos) / dist;
+        separationNeighbors++;
+      }
+
+      // Few birds are this close, so only their velocities get unpacked
+      bool withinAlignmentDist = dist < isOther * uAlignDist;
+      if (withinAlignmentDist) {
+        alignSteer += unpackTangent(other.y, otherPos, uSrcVelocityRange);
+        alignNeighbors++;
+      }
+
+      bool withinCohesionDist = dist < isOther * uCohesionDist;
+      cohesionPosition += float(withinCohesionDist) * otherPos;
+      cohesionNeighbors += int(withinCohesionDist) * 1;
+    }
+  }
+
+  if (separationNeighbors > 0) {
+    sepSteer /= float(separationNeighbors);
+    if (length(sepSteer) > 0) {
+      sepSteer = normalize(sepSteer) - selfVel;
+      sepSteer = limit(sepSteer, uMinForce, uMaxForce);
+    }
+  }
+
+  if (alignNeighbors > 0) {
+    alignSteer /= float(alignNeighbors);
+    alignSteer = normalize(alignSteer) - selfVel;
+    alignSteer = limit(alignSteer, uMinForce, uMaxForce);
+  }
+
+  vec3 cohesionSteer = vec3(0);
+  if (cohesionNeighbors > 0) {
+    cohesionPosition /= float(cohesionNeighbors);
+    cohesionSteer = normalize(cohesionPosition - selfPos) - selfVel;
+    cohesionSteer = limit(cohesionSteer, uMinForce, uMaxForce);
+  }
+
+  sepSteer *= uSeparationMod;
+  alignSteer *= uAlignMod;
+  cohesionSteer *= uCohesionMod;
+
+  return sepSteer + alignSteer + cohesionSteer;
+}
+
+void main() {
+  uvec2 bird = texelFetch(uBirds, ivec2(gl_FragCoord.xy), 0).xy;
+  vec3 pos = unpackOctahedral(bird.x);
+  vec3 vel = unpackTangent(bird.y, pos, uSrcVelocityRange);
+
+  vec3 newVel = vel + flockAccel(pos, vel);
+  // Project the velocity so it's tangent to the sphere
+  newVel = newVel - (dot(newVel, pos) * normalize(pos));
+  newVel = limit(newVel, uMinSpeed, uMaxSpeed);
+
+  // Make sure the position always stays normalized onto the sphere. The velocity goes in the basis of the position
+  // as it will be unpacked
+  uint newPos = packOctahedral(normalize(pos + vel));
+  FragColor = uvec2(newPos, packVelocityPhase(unpackOctahedral(newPos), newVel, unpackPhase(bird.y) + uFlapSpeed, uDstVelocityRange));
+}
@@ -1,8 +1,5 @@
 #version 410
 
-// #define FLAP_SPEED 0.32
-#define FLAP_SPEED 0.40
-
 uniform int uGridSide;
 uniform int uScreenWidth;
 uniform int uScreenHeight;
@@ -10,6 +7,9 @@ uniform int uScreenHeight;
 uniform sampler2D uPositions;
 uniform sampler2D uVelocities;
 
+// 0.40 by default, 0.32 is also nice
+uniform float uFlapSpeed;
+
 out vec4 FragColor;
 
 void main() {
@@ -20,5 +20,5 @@ void main() {
   // Make sure the position always stays normalized onto the sphere
   vec3 newPos = normalize(pos.xyz + vel);
 
-  FragColor = vec4(newPos, pos.a + FLAP_SPEED);
+  FragColor = vec4(newPos, pos.a + uFlapSpeed);
 }
@@ -37,19 +37,22 @@ vec3 flockAccel(in vec3 selfPos, in vec3 selfVel) {
   vec3 cohesionPosition = vec3(0);
   int cohesionNeighbors = 0;
 
-  for (float x = 0; x < 1.0; x += 1.0 / uGridSide) {
-    for (float y = 0; y < 1.0; y += 1.0 / uGridSide) {
-      vec2 texUV = vec2(x, y);
-      vec3 otherPos = texture(uPositions, texUV).xyz;
-      vec3 otherVel = texture(uVelocities, texUV).xyz;
+  // Texel indices rather than stepping a texture coordinate by 1 / uGridSide, which unless the side is a power of two
+  // adds up to land on the wrong side of texel edges, counting some birds twice and others not at all
+  for (int x = 0; x < uGridSide; x++) {
+    for (int y = 0; y < uGridSide; y++) {
+      vec3 otherPos = texelFetch(uPositions, ivec2(x, y), 0).xyz;
+      vec3 otherVel = texelFetch(uVelocities, ivec2(x, y), 0).xyz;
       float dist = length(otherPos - selfPos);
 
       float isOther = float(dist > SELF_EPSILON);
 
+      // A branch rather than multiplying by 0, which leaves the NaN of dividing by a bird's distance to itself
       bool withinSeparationDist = dist < isOther * uSeparationDist;
-      vec3 fromOther = normalize(selfPos - otherPos) / dist;
-      sepSteer += float(withinSeparationDist) * fromOther;
-      separationNeighbors += int(withinSeparationDist) * 1;
+      if (withinSeparationDist) {
+        sepSteer += normalize(selfPos - otherPos) / dist;
+        separationNeighbors++;
+      }
 
       bool withinAlignmentDist = dist < isOther * uAlignDist;
       alignSteer += float(withinAlignmentDist) * otherVel;
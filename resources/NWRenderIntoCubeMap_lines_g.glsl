@@ -0,0 +1,38 @@
+#version 410
+
+layout (lines) in;
+layout (line_strip, max_vertices = 2) out;
+
+in VertexData {
+  vec4 gColor;
+  vec2 gTexCoord0;
+} gs_in[];
+
+out vec4 aColor;
+out vec2 aTexCoord0;
+
+layout(std140) uniform uMatrices {
+  mat4 viewProjectionMatrix[6];
+};
+
+// The primitives come sorted by face, see NetworkFaceBuckets.h. First primitive of each face's run
+uniform int uFaceStarts[6];
+
+void main() {
+  int face = 0;
+  for (int idx = 1; idx < 6; idx++) {
+    if (gl_PrimitiveIDIn >= uFaceStarts[idx]) {
+      face = idx;
+    }
+  }
+  gl_Layer = face;
+
+  for (int i = 0; i < gl_in.length(); i++) {
+    aColor = gs_in[i].gColor;
+    aTexCoord0 = gs_in[i].gTexCoord0;
+    gl_Position = viewProjectionMatrix[face] * gl_in[i].gl_Position;
+    EmitVertex();
+  }
+
+  EndPrimitive();
+}
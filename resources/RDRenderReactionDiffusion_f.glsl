@@ -4,6 +4,8 @@ in highp vec3 aCubeMapTexCoord;
 in vec3 aFaceCenter;
 
 uniform samplerCube uGridSampler;
+// The grid is ReactionDiffusionSphere.h's equiangular one, with cells evenly spaced in atan of the face coordinates
+uniform bool uEquiangularGrid;
 
 out vec4 FragColor;
 
@@ -50,7 +52,10 @@ void main() {
   vec3 centerAngles = atan(abs(fromCenter));
   vec3 adjustedCoord = projectedCMCoord + ((1 + cos(4 * centerAngles)) / 32) * (1 - abs(aFaceCenter)) * normalize(fromCenter);
 
-  vec4 gridValues = texture(uGridSampler, adjustedCoord);
+  // The face axis component is +-1, which the warp leaves alone
+  vec3 sampleCoord = uEquiangularGrid ? atan(projectedCMCoord) * (4.0 / 3.14159265) : adjustedCoord;
+
+  vec4 gridValues = texture(uGridSampler, sampleCoord);
   float B = gridValues.b;
 
   FragColor = vec4(interpColorScheme(B), 1.0);
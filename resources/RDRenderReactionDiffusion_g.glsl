@@ -3,10 +3,11 @@
 layout (triangles) in;
 layout (triangle_strip, max_vertices = 3) out;
 
+// Members in the same order as RDRenderReactionDiffusion_v.glsl, which strict drivers require to link
 in VertexData {
+  int gFaceIndex;
   vec3 gCubeMapTexCoord;
   vec3 gFaceCenter;
-  int gFaceIndex;
 } gs_in[];
 
 out vec3 aCubeMapTexCoord;
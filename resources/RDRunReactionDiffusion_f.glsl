@@ -8,21 +8,8 @@ uniform samplerCube uPrevFrame;
 
 out vec4 FragColor;
 
-float convoluteA(float ul, float u, float ur, float l, float c, float r, float bl, float b, float br) {
-  return (
-    0.05 * ul +
-    0.2 * u +
-    0.05 * ur +
-    0.2 * l +
-    -1. * c +
-    0.2 * r +
-    0.05 * bl +
-    0.2 * b +
-    0.05 * br
-  );
-}
-
-float convoluteB(float ul, float u, float ur, float l, float c, float r, float bl, float b, float br) {
+// Same 3x3 weights for both chemicals. RDStencilIsotropic9 in ReactionDiffusionModels.h mirrors these
+float convolute(float ul, float u, float ur, float l, float c, float r, float bl, float b, float br) {
   return (
     0.05 * ul +
     0.2 * u +
@@ -42,7 +29,7 @@ const float diffusionRateB = 0.5;
 uniform float feedRateA;
 uniform float killRateB;
 
-// To make stuff get kind weird:
+// To make stuff get kind weird, see RDPresetGrayScottWeird:
 // const float diffusionRateA = 0.4;
 // const float diffusionRateB = 0.05;
 
@@ -66,8 +53,8 @@ void main() {
 
   float ABB = curA * curB * curB;
 
-  float diffA = diffusionRateA * convoluteA(ul.g, u.g, ur.g, l.g, curA, r.g, bl.g, b.g, br.g);
-  float diffB = diffusionRateB * convoluteB(ul.b, u.b, ur.b, l.b, curB, r.b, bl.b, b.b, br.b);
+  float diffA = diffusionRateA * convolute(ul.g, u.g, ur.g, l.g, curA, r.g, bl.g, b.g, br.g);
+  float diffB = diffusionRateB * convolute(ul.b, u.b, ur.b, l.b, curB, r.b, bl.b, b.b, br.b);
 
   float newA = curA + (diffA - ABB + feedRateA * (1.0 - curA));
   float newB = curB + (diffB + ABB - (feedRateA + killRateB) * curB);
@@ -0,0 +1,201 @@
+#include "ArduinoInput.h"
+
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "cinder/Log.h"
+
+using std::string;
+
+std::string const ArduinoInput::DEFAULT_DEVICE_PATTERN = "cu.usbmodem";
+
+namespace {
+	std::chrono::milliseconds const MIN_RECONNECT_DELAY(250);
+	std::chrono::milliseconds const MAX_RECONNECT_DELAY(8000);
+	// How long a read blocks before checking whether the thread should stop
+	int const READ_POLL_TIMEOUT_MS = 100;
+
+	speed_t getBaudRateSpeed(uint32_t baudRate) {
+		switch (baudRate) {
+			case 4800: return B4800;
+			case 19200: return B19200;
+			case 38400: return B38400;
+			case 57600: return B57600;
+			case 115200: return B115200;
+			default: return B9600;
+		}
+	}
+
+	// Full path of the first device under /dev whose name contains the pattern, or an empty string
+	string findDevice(string const & pattern) {
+		if (!pattern.empty() && pattern[0] == '/') {
+			return ::access(pattern.c_str(), F_OK) == 0 ? pattern : string();
+		}
+
+		DIR * dev = ::opendir("/dev");
+		if (!dev) {
+			return string();
+		}
+
+		std::vector<string> matches;
+		while (dirent * entry = ::readdir(dev)) {
+			string name = entry->d_name;
+			if (name.find(pattern) != string::npos) {
+				matches.push_back("/dev/" + name);
+			}
+		}
+		::closedir(dev);
+
+		if (matches.empty()) {
+			return string();
+		}
+		// readdir order isn't defined, so pick the same device every time
+		return *std::min_element(matches.begin(), matches.end());
+	}
+}
+
+ArduinoInput::ArduinoInput() : mRunning(false), mConnected(false), mNumDropped(0), mNumConnects(0), mEvents(256) {}
+
+ArduinoInput::~ArduinoInput() {
+	stop();
+}
+
+void ArduinoInput::start(string const & devicePattern, uint32_t baudRate) {
+	stop();
+
+	mDevicePattern = devicePattern;
+	mBaudRate = baudRate;
+	mRunning = true;
+	mThread = std::thread(& ArduinoInput::run, this);
+}
+
+void ArduinoInput::stop() {
+	mRunning = false;
+	if (mThread.joinable()) {
+		mThread.join();
+	}
+}
+
+void ArduinoInput::run() {
+	std::chrono::milliseconds reconnectDelay = MIN_RECONNECT_DELAY;
+	bool failureLogged = false;
+
+	while (mRunning) {
+		int fd = openDevice();
+
+		if (fd < 0) {
+			if (!failureLogged) {
+				CI_LOG_W("No active Arduino detected matching: " << mDevicePattern << ", retrying in the background");
+				failureLogged = true;
+			}
+			sleepFor(reconnectDelay);
+			reconnectDelay = std::min(reconnectDelay * 2, MAX_RECONNECT_DELAY);
+			continue;
+		}
+
+		mNumConnects.fetch_add(1, std::memory_order_relaxed);
+		mConnected = true;
+
+		// A device that opens and then hangs up straight away, like a half enumerated USB port, keeps backing off.
+		// Only one that actually sent something resets the delay
+		if (readUntilDisconnected(fd)) {
+			reconnectDelay = MIN_RECONNECT_DELAY;
+			failureLogged = false;
+		}
+
+		mConnected = false;
+		::close(fd);
+
+		if (mRunning) {
+			CI_LOG_W("Lost the connection to the arduino, reconnecting in " << reconnectDelay.count() << " ms");
+			sleepFor(reconnectDelay);
+			reconnectDelay = std::min(reconnectDelay * 2, MAX_RECONNECT_DELAY);
+		}
+	}
+}
+
+int ArduinoInput::openDevice() {
+	string path = findDevice(mDevicePattern);
+	if (path.empty()) {
+		return -1;
+	}
+
+	// Non-blocking so the open doesn't hang waiting for carrier detect. Reads wait in poll() instead
+	int fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0) {
+		CI_LOG_W("Failed to open arduino at port: " << path << " (errno " << errno << ")");
+		return -1;
+	}
+
+	// 8N1, raw bytes, at the requested baud rate
+	termios options;
+	if (::tcgetattr(fd, & options) == 0) {
+		::cfmakeraw(& options);
+		::cfsetispeed(& options, getBaudRateSpeed(mBaudRate));
+		::cfsetospeed(& options, getBaudRateSpeed(mBaudRate));
+		options.c_cflag |= (CLOCAL | CREAD);
+		::tcsetattr(fd, TCSANOW, & options);
+	}
+
+	CI_LOG_I("Successfully connected with arduino at port: " << path);
+	return fd;
+}
+
+bool ArduinoInput::readUntilDisconnected(int fd) {
+	uint8_t buffer[64];
+	bool anyRead = false;
+
+	while (mRunning) {
+		pollfd request = { fd, POLLIN, 0 };
+		int ready = ::poll(& request, 1, READ_POLL_TIMEOUT_MS);
+
+		if (ready < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return anyRead;
+		}
+		if (ready == 0) {
+			continue;
+		}
+
+		// Bytes can still be waiting after a hang up, so read before checking for one
+		if (request.revents & POLLIN) {
+			ssize_t numRead = ::read(fd, buffer, sizeof(buffer));
+			if (numRead == 0) {
+				return anyRead;
+			}
+			if (numRead < 0) {
+				if (errno == EAGAIN || errno == EINTR) {
+					continue;
+				}
+				return anyRead;
+			}
+
+			anyRead = true;
+			auto now = std::chrono::steady_clock::now();
+			for (ssize_t idx = 0; idx < numRead; idx++) {
+				if (!mEvents.push({ buffer[idx], now })) {
+					mNumDropped.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+		} else if (request.revents & (POLLHUP | POLLERR | POLLNVAL)) {
+			return anyRead;
+		}
+	}
+	return anyRead;
+}
+
+void ArduinoInput::sleepFor(std::chrono::milliseconds duration) {
+	auto wakeTime = std::chrono::steady_clock::now() + duration;
+	while (mRunning && std::chrono::steady_clock::now() < wakeTime) {
+		std::this_thread::sleep_for(std::min(duration, std::chrono::milliseconds(READ_POLL_TIMEOUT_MS)));
+	}
+}
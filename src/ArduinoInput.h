@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <cstdint>
+
+#include "SpscQueue.h"
+
+// One byte from the microphone Arduino, with the time the I/O thread read it
+struct ArduinoEvent {
+	uint8_t mMessage;
+	std::chrono::steady_clock::time_point mReceived;
+};
+
+// Owns the serial connection to the Arduino on a dedicated I/O thread. The thread finds the device, blocks on reads
+// while connected, and reconnects with exponential backoff when the device is missing or goes away. The backoff only
+// resets once a connection has read something. Every byte read is pushed onto a lock-free queue for the frame loop to
+// drain with pop(), so device enumeration and reads never happen on the render thread.
+class ArduinoInput {
+public:
+	// Any device under /dev whose name contains this is used, so a pseudo-terminal can stand in for the Arduino
+	static std::string const DEFAULT_DEVICE_PATTERN;
+
+	ArduinoInput();
+	~ArduinoInput();
+
+	// A pattern starting with '/' is taken as the full path of the device
+	void start(std::string const & devicePattern = DEFAULT_DEVICE_PATTERN, uint32_t baudRate = 9600);
+	void stop();
+
+	// Frame loop side. Returns false once the queue is empty
+	bool pop(ArduinoEvent & event) { return mEvents.pop(event); }
+
+	bool isConnected() const { return mConnected.load(std::memory_order_relaxed); }
+	// Events lost because the frame loop fell too far behind
+	uint64_t getNumDropped() const { return mNumDropped.load(std::memory_order_relaxed); }
+	// Times the device was opened, so a connection that keeps dropping shows up
+	uint64_t getNumConnects() const { return mNumConnects.load(std::memory_order_relaxed); }
+
+private:
+	void run();
+	int openDevice();
+	// Returns once the device is gone or stop() was called, with whether anything was read
+	bool readUntilDisconnected(int fd);
+	// Sleeps for the given time, waking early if stop() is called
+	void sleepFor(std::chrono::milliseconds duration);
+
+	std::string mDevicePattern;
+	uint32_t mBaudRate = 9600;
+
+	std::thread mThread;
+	std::atomic<bool> mRunning;
+	std::atomic<bool> mConnected;
+	std::atomic<uint64_t> mNumDropped;
+	std::atomic<uint64_t> mNumConnects;
+	SpscQueue<ArduinoEvent> mEvents;
+};
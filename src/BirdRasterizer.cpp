@@ -0,0 +1,257 @@
+#include "BirdRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "TaskScheduler.h"
+
+using namespace ci;
+
+namespace {
+	// Same as the defines in FLRenderBirds_g.glsl
+	float const BIRD_SIZE = 0.01f;
+	float const WING_SIZE = 0.025f;
+	float const MAX_FLAP_ANGLE = glm::pi<float>() * 0.25f;
+	float const FLAP_OFFSET = glm::pi<float>() * 0.12f;
+
+	// A bird can only show up on a face if its position is at least this far along the face's axis. Points on a
+	// face's own region are at least 1 / sqrt(3) along it, the rest is slack for the wings
+	float const MIN_FACE_ALIGNMENT = 0.5f;
+
+	float const SPLAT_RADIUS = 1.0f;
+
+	vec3 const FACE_AXES[NUM_CUBE_FACES] = { vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1) };
+
+	// Rotation of v about a unit axis it's perpendicular to, which is all the geometry shader's rotation_matrix() is used for
+	vec3 rotateAboutPerpendicularAxis(vec3 const & v, vec3 const & axis, float angle) {
+		return v * std::cos(angle) + cross(axis, v) * std::sin(angle);
+	}
+
+	float edgeFunction(vec2 const & a, vec2 const & b, vec2 const & p) {
+		return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+	}
+
+	void setTexel(uint8_t * face, int side, int col, int row) {
+		uint8_t * texel = face + 3 * ((size_t) row * side + col);
+		texel[0] = texel[1] = texel[2] = 255;
+	}
+
+	// Fills the texels of the tile whose centers are inside the triangle, from either winding
+	void rasterizeTriangle(uint8_t * face, int side, vec2 a, vec2 b, vec2 c, ivec2 const & tileMin, ivec2 const & tileMax) {
+		float area = edgeFunction(a, b, c);
+		if (area == 0.0f) {
+			return;
+		}
+		if (area < 0.0f) {
+			std::swap(b, c);
+		}
+
+		int minCol = std::max(tileMin.x, (int) std::floor(std::min({ a.x, b.x, c.x })));
+		int maxCol = std::min(tileMax.x - 1, (int) std::ceil(std::max({ a.x, b.x, c.x })));
+		int minRow = std::max(tileMin.y, (int) std::floor(std::min({ a.y, b.y, c.y })));
+		int maxRow = std::min(tileMax.y - 1, (int) std::ceil(std::max({ a.y, b.y, c.y })));
+
+		for (int row = minRow; row <= maxRow; row++) {
+			for (int col = minCol; col <= maxCol; col++) {
+				vec2 p(col + 0.5f, row + 0.5f);
+				if (edgeFunction(a, b, p) >= 0.0f && edgeFunction(b, c, p) >= 0.0f && edgeFunction(c, a, p) >= 0.0f) {
+					setTexel(face, side, col, row);
+				}
+			}
+		}
+	}
+
+	void rasterizeSplat(uint8_t * face, int side, vec2 const & center, ivec2 const & tileMin, ivec2 const & tileMax) {
+		int minCol = std::max(tileMin.x, (int) std::floor(center.x - SPLAT_RADIUS));
+		int maxCol = std::min(tileMax.x - 1, (int) std::floor(center.x + SPLAT_RADIUS));
+		int minRow = std::max(tileMin.y, (int) std::floor(center.y - SPLAT_RADIUS));
+		int maxRow = std::min(tileMax.y - 1, (int) std::floor(center.y + SPLAT_RADIUS));
+
+		for (int row = minRow; row <= maxRow; row++) {
+			for (int col = minCol; col <= maxCol; col++) {
+				vec2 offset = vec2(col + 0.5f, row + 0.5f) - center;
+				if (dot(offset, offset) <= SPLAT_RADIUS * SPLAT_RADIUS) {
+					setTexel(face, side, col, row);
+				}
+			}
+		}
+	}
+}
+
+void BirdRasterizer::render(FlockState const & flock, BirdRasterOptions const & options) {
+	mOptions = options;
+	mOptions.mTileSize = std::max(mOptions.mTileSize, 8);
+	mNumThreads = mOptions.mNumThreads > 0 ? mOptions.mNumThreads : TaskScheduler::get().getConcurrency();
+
+	// The bins depend on the tile size as well as the side, or a smaller tile size would leave most of each face unbinned
+	if (mSide != mOptions.mSide || mTileSize != mOptions.mTileSize) {
+		mSide = mOptions.mSide;
+		mTileSize = mOptions.mTileSize;
+		mTilesPerSide = (mSide + mTileSize - 1) / mTileSize;
+		for (int face = 0; face < NUM_CUBE_FACES; face++) {
+			mFaces[face].assign((size_t) mSide * mSide * 3, 0);
+			mTileBins[face].assign(mTilesPerSide * mTilesPerSide, std::vector<uint32_t>());
+		}
+	}
+	if (mThreadPrims.size() < mNumThreads) {
+		mThreadPrims.resize(mNumThreads);
+	}
+
+	// Project the birds onto every face they touch, in chunks
+	size_t numBirds = flock.mPositions.size();
+	size_t const CHUNK_BIRDS = 1024;
+	for (auto & threadPrims : mThreadPrims) {
+		for (auto & prims : threadPrims) {
+			prims.clear();
+		}
+	}
+	runParallel((numBirds + CHUNK_BIRDS - 1) / CHUNK_BIRDS, [&] (size_t chunk, size_t thread) {
+		projectBirds(flock, chunk * CHUNK_BIRDS, std::min(numBirds, (chunk + 1) * CHUNK_BIRDS), thread);
+	});
+
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		auto & facePrims = mFacePrims[face];
+		facePrims.clear();
+		for (size_t thread = 0; thread < mNumThreads; thread++) {
+			auto & prims = mThreadPrims[thread][face];
+			facePrims.insert(facePrims.end(), prims.begin(), prims.end());
+		}
+	}
+
+	runParallel(NUM_CUBE_FACES, [this] (size_t face, size_t) { binFace(face); });
+
+	// Counted after binning, which settles the dense tiles' birds
+	mNumTriangleBirds = 0;
+	mNumSplatBirds = 0;
+	for (auto const & facePrims : mFacePrims) {
+		for (auto const & prim : facePrims) {
+			(prim.mSplat ? mNumSplatBirds : mNumTriangleBirds)++;
+		}
+	}
+
+	size_t tilesPerFace = mTilesPerSide * mTilesPerSide;
+	runParallel(NUM_CUBE_FACES * tilesPerFace, [this, tilesPerFace] (size_t task, size_t) {
+		rasterizeTile(task / tilesPerFace, task % tilesPerFace);
+	});
+}
+
+void BirdRasterizer::runParallel(size_t numTasks, std::function<void(size_t task, size_t thread)> const & task) {
+	// Slots stand in for threads, each has its own projected birds
+	TaskScheduler::get().parallelFor(numTasks, mNumThreads, task);
+}
+
+void BirdRasterizer::projectBirds(FlockState const & flock, size_t begin, size_t end, size_t thread) {
+	auto & threadPrims = mThreadPrims[thread];
+	float halfSide = mSide * 0.5f;
+
+	for (size_t idx = begin; idx < end; idx++) {
+		vec3 pos = normalize(vec3(flock.mPositions[idx]));
+		vec3 vel = vec3(flock.mVelocities[idx]);
+		if (dot(vel, vel) <= 0.0f) {
+			continue;
+		}
+		vel = normalize(vel);
+
+		// The same vertices as the geometry shader
+		vec3 wingR = normalize(cross(pos, vel));
+		float wingAngle = std::sin(flock.mPositions[idx].w) * MAX_FLAP_ANGLE + FLAP_OFFSET;
+		vec3 verts[4] = {
+			pos + WING_SIZE * rotateAboutPerpendicularAxis(wingR, pos, wingAngle),
+			pos + BIRD_SIZE * vel,
+			pos - BIRD_SIZE * vel,
+			pos + WING_SIZE * rotateAboutPerpendicularAxis(-wingR, pos, -wingAngle)
+		};
+
+		for (int face = 0; face < NUM_CUBE_FACES; face++) {
+			if (dot(pos, FACE_AXES[face]) < MIN_FACE_ALIGNMENT) {
+				continue;
+			}
+
+			BirdPrim prim;
+			bool inFront = true;
+			for (int vert = 0; vert < 4 && inFront; vert++) {
+				float s, t;
+				inFront = projectToCubeFace(verts[vert], face, s, t);
+				prim.mVerts[vert] = (vec2(s, t) + 1.0f) * halfSide;
+			}
+			if (!inFront) {
+				continue;
+			}
+
+			prim.mMin = glm::min(glm::min(prim.mVerts[0], prim.mVerts[1]), glm::min(prim.mVerts[2], prim.mVerts[3]));
+			prim.mMax = glm::max(glm::max(prim.mVerts[0], prim.mVerts[1]), glm::max(prim.mVerts[2], prim.mVerts[3]));
+			if (prim.mMax.x < 0.0f || prim.mMax.y < 0.0f || prim.mMin.x >= mSide || prim.mMin.y >= mSide) {
+				continue;
+			}
+
+			prim.mCenter = (prim.mVerts[1] + prim.mVerts[2]) * 0.5f;
+			vec2 extent = prim.mMax - prim.mMin;
+			prim.mSplat = std::max(extent.x, extent.y) < mOptions.mSplatMaxExtent;
+			if (prim.mSplat) {
+				prim.mMin = prim.mCenter - SPLAT_RADIUS;
+				prim.mMax = prim.mCenter + SPLAT_RADIUS;
+			}
+
+			threadPrims[face].push_back(prim);
+		}
+	}
+}
+
+void BirdRasterizer::binFace(int face) {
+	auto & bins = mTileBins[face];
+	for (auto & bin : bins) {
+		bin.clear();
+	}
+
+	auto & prims = mFacePrims[face];
+	float tileSize = mOptions.mTileSize;
+	for (uint32_t idx = 0; idx < prims.size(); idx++) {
+		// A bird in a dense tile becomes a splat, which can grow past its own bounds, so pad by the splat radius
+		int minTileX = std::max(0, (int) std::floor((prims[idx].mMin.x - SPLAT_RADIUS) / tileSize));
+		int minTileY = std::max(0, (int) std::floor((prims[idx].mMin.y - SPLAT_RADIUS) / tileSize));
+		int maxTileX = std::min(mTilesPerSide - 1, (int) std::floor((prims[idx].mMax.x + SPLAT_RADIUS) / tileSize));
+		int maxTileY = std::min(mTilesPerSide - 1, (int) std::floor((prims[idx].mMax.y + SPLAT_RADIUS) / tileSize));
+
+		for (int tileY = minTileY; tileY <= maxTileY; tileY++) {
+			for (int tileX = minTileX; tileX <= maxTileX; tileX++) {
+				bins[tileY * mTilesPerSide + tileX].push_back(idx);
+			}
+		}
+	}
+
+	// The LOD is settled per bird, by the tile its center is in, so every tile it overlaps draws it the same way. Deciding
+	// per tile would draw a bird across a dense tile's edge as triangles on one side and a splat on the other
+	if (mOptions.mDenseTileBirds == 0) {
+		return;
+	}
+	for (auto & prim : prims) {
+		int tileX = glm::clamp((int) std::floor(prim.mCenter.x / tileSize), 0, mTilesPerSide - 1);
+		int tileY = glm::clamp((int) std::floor(prim.mCenter.y / tileSize), 0, mTilesPerSide - 1);
+		if (!prim.mSplat && bins[tileY * mTilesPerSide + tileX].size() > mOptions.mDenseTileBirds) {
+			prim.mSplat = true;
+		}
+	}
+}
+
+void BirdRasterizer::rasterizeTile(int face, int tile) {
+	ivec2 tileMin = ivec2(tile % mTilesPerSide, tile / mTilesPerSide) * mOptions.mTileSize;
+	ivec2 tileMax = glm::min(tileMin + ivec2(mOptions.mTileSize), ivec2(mSide));
+
+	uint8_t * faceTexels = mFaces[face].data();
+	for (int row = tileMin.y; row < tileMax.y; row++) {
+		std::fill_n(faceTexels + 3 * ((size_t) row * mSide + tileMin.x), 3 * (tileMax.x - tileMin.x), 0);
+	}
+
+	auto & bin = mTileBins[face][tile];
+	auto & prims = mFacePrims[face];
+
+	for (uint32_t idx : bin) {
+		BirdPrim const & prim = prims[idx];
+		if (prim.mSplat) {
+			rasterizeSplat(faceTexels, mSide, prim.mCenter, tileMin, tileMax);
+		} else {
+			rasterizeTriangle(faceTexels, mSide, prim.mVerts[0], prim.mVerts[1], prim.mVerts[2], tileMin, tileMax);
+			rasterizeTriangle(faceTexels, mSide, prim.mVerts[1], prim.mVerts[2], prim.mVerts[3], tileMin, tileMax);
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/Vector.h"
+
+#include "CubeFaces.h"
+#include "FlockingKernels.h"
+
+struct BirdRasterOptions {
+	// Side of each output face, in texels
+	int mSide = 1024;
+	int mTileSize = 64;
+	// Most threads of the task scheduler to split the work across, 0 for all of them
+	int mNumThreads = 0;
+
+	// Point sprite LOD. Birds that project to less than mSplatMaxExtent texels are drawn as a splat instead of their
+	// two triangles, and so is every bird centered in a tile that holds more than mDenseTileBirds of them, in whichever
+	// tiles it overlaps. 0 turns either off
+	float mSplatMaxExtent = 2.0f;
+	size_t mDenseTileBirds = 512;
+};
+
+// CPU renderer for the flock, for flocks too big for the per-bird geometry shader and for nodes without a GPU.
+// Builds the same two triangles per bird as FLRenderBirds_g.glsl, from the position, velocity and wing phase, and
+// rasterizes them into six RGB8 faces laid out like the GL cube map FlockingApp's cube map camera renders into,
+// white birds on black. Birds are binned per face and per tile, and tiles are rasterized in parallel.
+class BirdRasterizer {
+public:
+	BirdRasterizer() {}
+
+	void render(FlockState const & flock, BirdRasterOptions const & options);
+
+	int getSide() const { return mSide; }
+	// side * side RGB8 texels, row by row, ready for glTexSubImage2D on the matching cube map face
+	uint8_t const * getFace(int face) const { return mFaces[face].data(); }
+
+	// From the last render, counting a bird once for every face it landed on
+	size_t getNumTriangleBirds() const { return mNumTriangleBirds; }
+	size_t getNumSplatBirds() const { return mNumSplatBirds; }
+
+private:
+	// One bird projected onto one face, in texel coordinates
+	struct BirdPrim {
+		// Triangle strip, the same vertex order as the geometry shader
+		ci::vec2 mVerts[4];
+		ci::vec2 mCenter;
+		ci::vec2 mMin;
+		ci::vec2 mMax;
+		bool mSplat;
+	};
+
+	// Runs task(0) to task(numTasks - 1) on up to mNumThreads of the task scheduler's threads
+	void runParallel(size_t numTasks, std::function<void(size_t task, size_t thread)> const & task);
+
+	void projectBirds(FlockState const & flock, size_t begin, size_t end, size_t thread);
+	void binFace(int face);
+	void rasterizeTile(int face, int tile);
+
+	BirdRasterOptions mOptions;
+	// What the faces and tile bins were last sized for
+	int mSide = 0;
+	int mTileSize = 0;
+	int mTilesPerSide = 0;
+	size_t mNumThreads = 1;
+
+	std::array<std::vector<uint8_t>, NUM_CUBE_FACES> mFaces;
+
+	// Projected birds from each thread, for each face, merged into mFacePrims before binning
+	std::vector<std::array<std::vector<BirdPrim>, NUM_CUBE_FACES>> mThreadPrims;
+	std::array<std::vector<BirdPrim>, NUM_CUBE_FACES> mFacePrims;
+	// Indices into mFacePrims, per face and tile
+	std::array<std::vector<std::vector<uint32_t>>, NUM_CUBE_FACES> mTileBins;
+
+	size_t mNumTriangleBirds = 0;
+	size_t mNumSplatBirds = 0;
+};
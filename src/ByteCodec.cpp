@@ -0,0 +1,144 @@
+#include "ByteCodec.h"
+
+#include <cstring>
+
+using std::vector;
+
+namespace {
+	size_t const MIN_RUN = 4;
+
+	void writeVarint(uint64_t value, vector<uint8_t> & out) {
+		while (value >= 0x80) {
+			out.push_back((uint8_t) (value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((uint8_t) value);
+	}
+
+	bool readVarint(uint8_t const * & pos, uint8_t const * end, uint64_t & value) {
+		value = 0;
+		for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+			uint8_t byte = * pos++;
+			value |= (uint64_t) (byte & 0x7f) << shift;
+			if (!(byte & 0x80)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void writeLiteral(uint8_t const * data, size_t size, vector<uint8_t> & out) {
+		if (size == 0) {
+			return;
+		}
+		writeVarint((uint64_t) size << 1, out);
+		out.insert(out.end(), data, data + size);
+	}
+}
+
+void encodeBytes(uint8_t const * data, size_t size, uint32_t wordSize, vector<uint8_t> & out) {
+	if (wordSize == 0) {
+		wordSize = 1;
+	}
+
+	// Split into byte planes, the tail that doesn't fill a word goes on the end as it is
+	size_t numWords = size / wordSize;
+	vector<uint8_t> planes(size);
+	for (uint32_t plane = 0; plane < wordSize; plane++) {
+		uint8_t * dst = & planes[plane * numWords];
+		for (size_t word = 0; word < numWords; word++) {
+			dst[word] = data[word * wordSize + plane];
+		}
+	}
+	std::memcpy(planes.data() + numWords * wordSize, data + numWords * wordSize, size - numWords * wordSize);
+
+	// Delta against the previous byte, back to front so it can happen in place
+	for (size_t idx = size; idx-- > 1;) {
+		planes[idx] -= planes[idx - 1];
+	}
+
+	size_t idx = 0;
+	size_t literalStart = 0;
+	while (idx < size) {
+		// A word at a time through long runs first, e.g. the zeros of an unchanged area
+		size_t runEnd = idx + 1;
+		uint64_t const repeated = planes[idx] * 0x0101010101010101ull;
+		uint64_t word;
+		while (runEnd + sizeof(word) <= size) {
+			std::memcpy(& word, & planes[runEnd], sizeof(word));
+			if (word != repeated) {
+				break;
+			}
+			runEnd += sizeof(word);
+		}
+		while (runEnd < size && planes[runEnd] == planes[idx]) {
+			runEnd++;
+		}
+
+		if (runEnd - idx >= MIN_RUN) {
+			writeLiteral(planes.data() + literalStart, idx - literalStart, out);
+			writeVarint(((uint64_t) (runEnd - idx) << 1) | 1, out);
+			out.push_back(planes[idx]);
+			literalStart = runEnd;
+		}
+		idx = runEnd;
+	}
+	writeLiteral(planes.data() + literalStart, size - literalStart, out);
+}
+
+bool decodeBytes(uint8_t const * encoded, size_t encodedSize, uint8_t * out, size_t size, uint32_t wordSize) {
+	if (wordSize == 0) {
+		wordSize = 1;
+	}
+
+	vector<uint8_t> planes(size);
+	uint8_t const * pos = encoded;
+	uint8_t const * end = encoded + encodedSize;
+	size_t written = 0;
+
+	while (pos < end) {
+		uint64_t token;
+		if (!readVarint(pos, end, token)) {
+			return false;
+		}
+
+		uint64_t length = token >> 1;
+		if (length > size - written) {
+			return false;
+		}
+
+		if (token & 1) {
+			if (pos >= end) {
+				return false;
+			}
+			std::memset(planes.data() + written, * pos++, length);
+		} else {
+			if (length > (uint64_t) (end - pos)) {
+				return false;
+			}
+			std::memcpy(planes.data() + written, pos, length);
+			pos += length;
+		}
+		written += length;
+	}
+
+	if (written != size) {
+		return false;
+	}
+
+	// Undo the delta
+	for (size_t idx = 1; idx < size; idx++) {
+		planes[idx] += planes[idx - 1];
+	}
+
+	size_t numWords = size / wordSize;
+	for (uint32_t plane = 0; plane < wordSize; plane++) {
+		uint8_t const * src = & planes[plane * numWords];
+		for (size_t word = 0; word < numWords; word++) {
+			out[word * wordSize + plane] = src[word];
+		}
+	}
+	std::memcpy(out + numWords * wordSize, planes.data() + numWords * wordSize, size - numWords * wordSize);
+
+	return true;
+}
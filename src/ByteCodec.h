@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// A small lossless codec for blocks of simulation state: float textures, bit sets and the like.
+//
+// The bytes of each wordSize-byte word are split into planes, so the sign and exponent bytes of neighbouring floats
+// end up next to each other. Each byte is then replaced by its difference from the one before it, and runs of four or
+// more equal bytes are collapsed. Smooth or mostly constant data, like reaction-diffusion faces or the XOR of two
+// frames, comes out a small fraction of its size, and both directions run at memory speed rather than zlib speed.
+//
+// Encoded stream: a sequence of tokens, each a varint (length << 1 | isRun) followed by one byte for a run, or length
+// literal bytes otherwise.
+
+// Appends the encoded form of size bytes to out. A size that isn't a multiple of wordSize keeps its tail bytes unsplit
+void encodeBytes(uint8_t const * data, size_t size, uint32_t wordSize, std::vector<uint8_t> & out);
+
+// Decodes into exactly size bytes at out. Returns false if the stream is corrupt or doesn't decode to size bytes
+bool decodeBytes(uint8_t const * encoded, size_t encodedSize, uint8_t * out, size_t size, uint32_t wordSize);
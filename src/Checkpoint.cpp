@@ -0,0 +1,137 @@
+#include "Checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "cinder/Log.h"
+
+#include "ByteCodec.h"
+
+using namespace ci;
+using std::vector;
+
+char const CHECKPOINT_MAGIC[4] = { 'D', 'L', 'C', 'P' };
+
+void CheckpointWriter::addSection(char const * tag, void const * data, size_t size, uint32_t wordSize) {
+	auto bytes = static_cast<uint8_t const *>(data);
+	addSection(tag, vector<uint8_t>(bytes, bytes + size), wordSize);
+}
+
+void CheckpointWriter::addSection(char const * tag, vector<uint8_t> data, uint32_t wordSize) {
+	mSections.push_back({ std::string(tag, 4), wordSize, std::move(data) });
+}
+
+size_t CheckpointWriter::getRawSize() const {
+	size_t size = 0;
+	for (auto const & section : mSections) {
+		size += section.mData.size();
+	}
+	return size;
+}
+
+bool CheckpointWriter::write(fs::path const & path, uint64_t configHash, uint32_t cueIndex, double timelineTime) const {
+	CheckpointHeader header;
+	std::memcpy(header.mMagic, CHECKPOINT_MAGIC, sizeof(header.mMagic));
+	header.mVersion = CHECKPOINT_VERSION;
+	header.mConfigHash = configHash;
+	header.mTimelineTime = timelineTime;
+	header.mCueIndex = cueIndex;
+	header.mNumSections = mSections.size();
+
+	vector<CheckpointSection> table(mSections.size());
+	vector<vector<uint8_t>> encoded(mSections.size());
+	uint64_t offset = sizeof(CheckpointHeader) + table.size() * sizeof(CheckpointSection);
+
+	for (size_t idx = 0; idx < mSections.size(); idx++) {
+		auto const & section = mSections[idx];
+		encodeBytes(section.mData.data(), section.mData.size(), section.mWordSize, encoded[idx]);
+
+		std::memcpy(table[idx].mTag, section.mTag.data(), sizeof(table[idx].mTag));
+		table[idx].mWordSize = section.mWordSize;
+		table[idx].mRawSize = section.mData.size();
+		table[idx].mOffset = offset;
+		table[idx].mEncodedSize = encoded[idx].size();
+		offset += encoded[idx].size();
+	}
+
+	fs::path tempPath = path;
+	tempPath += ".tmp";
+
+	try {
+		fs::create_directories(path.parent_path());
+
+		{
+			std::ofstream out(tempPath.string(), std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<char const *>(& header), sizeof(header));
+			out.write(reinterpret_cast<char const *>(table.data()), table.size() * sizeof(CheckpointSection));
+			for (auto const & data : encoded) {
+				out.write(reinterpret_cast<char const *>(data.data()), data.size());
+			}
+			// Closed here so a failure to flush the last of it is caught too
+			out.close();
+			if (!out) {
+				CI_LOG_W("Failed to write checkpoint: " << tempPath);
+				std::remove(tempPath.string().c_str());
+				return false;
+			}
+		}
+
+		fs::rename(tempPath, path);
+	} catch (std::exception const & exc) {
+		// A half written temporary file would otherwise sit next to the checkpoints until the next write of this cue
+		CI_LOG_EXCEPTION("Failed to write checkpoint", exc);
+		std::remove(tempPath.string().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+CheckpointRef Checkpoint::load(fs::path const & path, uint64_t configHash) {
+	auto file = MappedFile::create(path);
+	if (!file || file->getSize() < sizeof(CheckpointHeader)) {
+		return nullptr;
+	}
+
+	auto header = reinterpret_cast<CheckpointHeader const *>(file->getData());
+	if (std::memcmp(header->mMagic, CHECKPOINT_MAGIC, sizeof(header->mMagic)) != 0
+		|| header->mVersion != CHECKPOINT_VERSION
+		|| header->mConfigHash != configHash) {
+		return nullptr;
+	}
+
+	// Every section has to lie inside the file
+	uint64_t tableEnd = sizeof(CheckpointHeader) + (uint64_t) header->mNumSections * sizeof(CheckpointSection);
+	if (file->getSize() < tableEnd) {
+		return nullptr;
+	}
+
+	auto table = reinterpret_cast<CheckpointSection const *>(file->getData() + sizeof(CheckpointHeader));
+	for (uint32_t idx = 0; idx < header->mNumSections; idx++) {
+		if (table[idx].mOffset < tableEnd || table[idx].mOffset + table[idx].mEncodedSize > file->getSize()) {
+			return nullptr;
+		}
+	}
+
+	return CheckpointRef(new Checkpoint(file));
+}
+
+CheckpointSection const * Checkpoint::findSection(char const * tag) const {
+	auto table = reinterpret_cast<CheckpointSection const *>(mFile->getData() + sizeof(CheckpointHeader));
+	for (uint32_t idx = 0; idx < getHeader().mNumSections; idx++) {
+		if (std::memcmp(table[idx].mTag, tag, sizeof(table[idx].mTag)) == 0) {
+			return & table[idx];
+		}
+	}
+	return nullptr;
+}
+
+bool Checkpoint::readSection(char const * tag, void * dest, size_t size) const {
+	auto section = findSection(tag);
+	if (!section || section->mRawSize != size) {
+		return false;
+	}
+
+	return decodeBytes(mFile->getData() + section->mOffset, section->mEncodedSize, static_cast<uint8_t *>(dest), size, section->mWordSize);
+}
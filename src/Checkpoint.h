@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/Filesystem.h"
+
+#include "MappedFile.h"
+
+// Binary snapshot of the simulations' state, so the playback timeline can be seeked without waiting through it.
+//
+// File layout (native endianness, 8-byte aligned headers):
+//   CheckpointHeader
+//   mNumSections * CheckpointSection
+//   each section's data, encoded with encodeBytes()
+//
+// Sections are tagged with four characters and owned by whichever simulation wrote them. A checkpoint is only used
+// if its version matches CHECKPOINT_VERSION and its config hash matches the running app, since a flock or grid of a
+// different size can't be restored into.
+
+uint32_t const CHECKPOINT_VERSION = 1;
+
+struct CheckpointHeader {
+	char mMagic[4];
+	uint32_t mVersion;
+	uint64_t mConfigHash;
+	double mTimelineTime;
+	uint32_t mCueIndex;
+	uint32_t mNumSections;
+};
+
+struct CheckpointSection {
+	char mTag[4];
+	uint32_t mWordSize;
+	uint64_t mRawSize;
+	uint64_t mOffset;
+	uint64_t mEncodedSize;
+};
+
+// Collects sections on the main thread, where the GL readbacks happen. Encoding and writing are left to write(), which
+// can run on a worker thread
+class CheckpointWriter {
+public:
+	void addSection(char const * tag, void const * data, size_t size, uint32_t wordSize);
+	void addSection(char const * tag, std::vector<uint8_t> data, uint32_t wordSize);
+
+	size_t getRawSize() const;
+
+	// Writes to a temporary file and renames it into place, so a crash mid-write never leaves a truncated checkpoint
+	bool write(ci::fs::path const & path, uint64_t configHash, uint32_t cueIndex, double timelineTime) const;
+
+private:
+	struct Section {
+		std::string mTag;
+		uint32_t mWordSize;
+		std::vector<uint8_t> mData;
+	};
+
+	std::vector<Section> mSections;
+};
+
+class Checkpoint;
+typedef std::shared_ptr<Checkpoint> CheckpointRef;
+
+// A mapped checkpoint file. Sections are decoded straight out of the mapping
+class Checkpoint {
+public:
+	// Returns nullptr if the file is missing, truncated, from another version or made with a different config
+	static CheckpointRef load(ci::fs::path const & path, uint64_t configHash);
+
+	uint32_t getCueIndex() const { return getHeader().mCueIndex; }
+	double getTimelineTime() const { return getHeader().mTimelineTime; }
+
+	bool hasSection(char const * tag) const { return findSection(tag) != nullptr; }
+	// Decodes a section into exactly size bytes at dest. Returns false if it's missing, a different size or corrupt
+	bool readSection(char const * tag, void * dest, size_t size) const;
+
+private:
+	explicit Checkpoint(MappedFileRef file) : mFile(file) {}
+
+	CheckpointHeader const & getHeader() const { return * reinterpret_cast<CheckpointHeader const *>(mFile->getData()); }
+	CheckpointSection const * findSection(char const * tag) const;
+
+	MappedFileRef mFile;
+};
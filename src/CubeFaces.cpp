@@ -0,0 +1,138 @@
+#include "CubeFaces.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ci;
+
+namespace {
+	// The depth, s and t axes of a face, as projectToCubeFace() uses them
+	void getCubeFaceAxes(int face, vec3 & depth, vec3 & s, vec3 & t) {
+		switch (face) {
+			case 0: depth = vec3(1, 0, 0); s = vec3(0, 0, -1); t = vec3(0, -1, 0); break;
+			case 1: depth = vec3(-1, 0, 0); s = vec3(0, 0, 1); t = vec3(0, -1, 0); break;
+			case 2: depth = vec3(0, 1, 0); s = vec3(1, 0, 0); t = vec3(0, 0, 1); break;
+			case 3: depth = vec3(0, -1, 0); s = vec3(1, 0, 0); t = vec3(0, 0, -1); break;
+			case 4: depth = vec3(0, 0, 1); s = vec3(1, 0, 0); t = vec3(0, -1, 0); break;
+			default: depth = vec3(0, 0, -1); s = vec3(-1, 0, 0); t = vec3(0, -1, 0); break;
+		}
+	}
+
+	int const NUM_FRUSTUM_PLANES = 6;
+
+	// Signed distances of a point from each plane of a face's frustum, all >= 0 inside it
+	void getFrustumDistances(vec3 const & point, int face, CubeFaceFrustum const & frustum, float * distances) {
+		vec3 depthAxis, sAxis, tAxis;
+		getCubeFaceAxes(face, depthAxis, sAxis, tAxis);
+		float depth = dot(point, depthAxis);
+		float s = dot(point, sAxis);
+		float t = dot(point, tAxis);
+		float extent = (1.0f + frustum.mMargin) * depth;
+
+		distances[0] = extent - s;
+		distances[1] = extent + s;
+		distances[2] = extent - t;
+		distances[3] = extent + t;
+		distances[4] = depth - frustum.mNear;
+		distances[5] = frustum.mFar - depth;
+	}
+}
+
+vec3 getCubeFaceDirection(int face, float s, float t) {
+	switch (face) {
+		case 0: return vec3(1, -t, -s); // positive X
+		case 1: return vec3(-1, -t, s); // negative X
+		case 2: return vec3(s, 1, t); // positive Y
+		case 3: return vec3(s, -1, -t); // negative Y
+		case 4: return vec3(s, -t, 1); // positive Z
+		default: return vec3(-s, -t, -1); // negative Z
+	}
+}
+
+vec3 getCubeFaceTexelDirection(int face, int col, int row, int side) {
+	float s = 2.0f * (col + 0.5f) / side - 1.0f;
+	float t = 2.0f * (row + 0.5f) / side - 1.0f;
+	return getCubeFaceDirection(face, s, t);
+}
+
+void getCubeFaceCoords(vec3 const & dir, int & face, float & s, float & t) {
+	float ax = std::abs(dir.x);
+	float ay = std::abs(dir.y);
+	float az = std::abs(dir.z);
+
+	if (ax >= ay && ax >= az) {
+		face = dir.x > 0 ? 0 : 1;
+		s = (dir.x > 0 ? -dir.z : dir.z) / ax;
+		t = -dir.y / ax;
+	} else if (ay >= az) {
+		face = dir.y > 0 ? 2 : 3;
+		s = dir.x / ay;
+		t = (dir.y > 0 ? dir.z : -dir.z) / ay;
+	} else {
+		face = dir.z > 0 ? 4 : 5;
+		s = (dir.z > 0 ? dir.x : -dir.x) / az;
+		t = -dir.y / az;
+	}
+}
+
+bool projectToCubeFace(vec3 const & dir, int face, float & s, float & t) {
+	// Distance along the face's axis, positive when in front of it
+	float depth;
+	switch (face) {
+		case 0: depth = dir.x; s = -dir.z; t = -dir.y; break;
+		case 1: depth = -dir.x; s = dir.z; t = -dir.y; break;
+		case 2: depth = dir.y; s = dir.x; t = dir.z; break;
+		case 3: depth = -dir.y; s = dir.x; t = -dir.z; break;
+		case 4: depth = dir.z; s = dir.x; t = -dir.y; break;
+		default: depth = -dir.z; s = -dir.x; t = -dir.y; break;
+	}
+
+	if (depth <= 0.0f) {
+		return false;
+	}
+	s /= depth;
+	t /= depth;
+	return true;
+}
+
+void getCubeFaceTexel(vec3 const & dir, int side, int & face, int & col, int & row) {
+	float s, t;
+	getCubeFaceCoords(dir, face, s, t);
+	col = std::min(side - 1, std::max(0, (int) std::floor((s + 1.0f) * 0.5f * side)));
+	row = std::min(side - 1, std::max(0, (int) std::floor((t + 1.0f) * 0.5f * side)));
+}
+
+bool isPointInCubeFace(vec3 const & point, int face, CubeFaceFrustum const & frustum) {
+	float distances[NUM_FRUSTUM_PLANES];
+	getFrustumDistances(point, face, frustum, distances);
+	for (float distance : distances) {
+		if (distance < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool isSegmentInCubeFace(vec3 const & a, vec3 const & b, int face, CubeFaceFrustum const & frustum) {
+	float distancesA[NUM_FRUSTUM_PLANES];
+	float distancesB[NUM_FRUSTUM_PLANES];
+	getFrustumDistances(a, face, frustum, distancesA);
+	getFrustumDistances(b, face, frustum, distancesB);
+
+	// Clip the segment's parameter range against each plane in turn, the distances are linear along it
+	float enter = 0.0f;
+	float exit = 1.0f;
+	for (int plane = 0; plane < NUM_FRUSTUM_PLANES; plane++) {
+		float da = distancesA[plane];
+		float db = distancesB[plane];
+		if (da < 0.0f && db < 0.0f) {
+			return false;
+		}
+		if (da < 0.0f) {
+			enter = std::max(enter, da / (da - db));
+		} else if (db < 0.0f) {
+			exit = std::min(exit, da / (da - db));
+		}
+	}
+	return enter <= exit;
+}
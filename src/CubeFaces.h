@@ -0,0 +1,42 @@
+#pragma once
+
+#include "cinder/Vector.h"
+
+// Texel addressing for the cube maps the simulations render into, following the GL cube map conventions: face 0 to 5
+// are +X, -X, +Y, -Y, +Z, -Z, and within a face (s, t) run from -1 to 1 along the texel columns and rows.
+// These match the face setup in RDRunReactionDiffusion_g.glsl, so CPU code can address the same texels the shaders do.
+
+int const NUM_CUBE_FACES = 6;
+
+// Direction through face coordinates (s, t), not normalized
+ci::vec3 getCubeFaceDirection(int face, float s, float t);
+
+// Direction through the center of texel (col, row) of a face with the given side length, not normalized
+ci::vec3 getCubeFaceTexelDirection(int face, int col, int row, int side);
+
+// The face a direction lands on, and its face coordinates there
+void getCubeFaceCoords(ci::vec3 const & dir, int & face, float & s, float & t);
+
+// Face coordinates of a direction projected onto a given face, which may lie outside [-1, 1] when the direction
+// belongs to a neighbouring face. Returns false if the direction points away from the face
+bool projectToCubeFace(ci::vec3 const & dir, int face, float & s, float & t);
+
+// The texel a direction lands on with nearest sampling
+void getCubeFaceTexel(ci::vec3 const & dir, int side, int & face, int & col, int & row);
+
+// The part of space a cube map camera at the origin draws into one face: its 90 degree frustum between the near and
+// far planes, widened by mMargin in face coordinates so wide points and lines just off the edge still count
+struct CubeFaceFrustum {
+	float mNear = 0.5f;
+	float mFar = 5.0f;
+	float mMargin = 0.0f;
+
+	// Margin for primitives that reach the given number of pixels past their position on a face with the given side
+	static float getMargin(float pixels, int side) { return 2.0f * pixels / side; }
+};
+
+// Whether a point lies inside a face's frustum
+bool isPointInCubeFace(ci::vec3 const & point, int face, CubeFaceFrustum const & frustum);
+
+// Whether any part of the segment from a to b lies inside a face's frustum
+bool isSegmentInCubeFace(ci::vec3 const & a, ci::vec3 const & b, int face, CubeFaceFrustum const & frustum);
@@ -1,16 +1,20 @@
 #include <string>
 #include <vector>
+#include <future>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
 
 #include "cinder/app/App.h"
 #include "cinder/app/RendererGl.h"
 #include "cinder/gl/gl.h"
 #include "cinder/Camera.h"
 #include "cinder/CameraUi.h"
-#include "cinder/ObjLoader.h"
-#include "cinder/Serial.h"
 #include "cinder/Log.h"
 #include "cinder/audio/audio.h"
 #include "cinder/Timer.h"
+#include "cinder/Utilities.h"
 
 #include "Syphon.h"
 #include "choreograph/Choreograph.h"
@@ -20,6 +24,18 @@
 #include "ReactionDiffusionApp.h"
 #include "FlockingApp.h"
 #include "NetworkApp.h"
+#include "StartupReport.h"
+#include "MeshCache.h"
+#include "FrameProfiler.h"
+#include "Disruption.h"
+#include "ArduinoInput.h"
+#include "DisruptionSource.h"
+#include "MemoryLedger.h"
+#include "PreviewWindow.h"
+#include "Checkpoint.h"
+#include "Telemetry.h"
+#include "FrameStreamPublisher.h"
+#include "TaskScheduler.h"
 
 using namespace ci;
 using namespace ci::app;
@@ -36,21 +52,41 @@ enum class AppType {
 	CALIB_SPHERE
 };
 
+// Profiler stage names, indexed by AppType
+char const * const UPDATE_STAGE_NAMES[] = { "ReactionDiffusion update", "Flocking update", "Network update", "CubeDebug update", "CalibSphere update" };
+char const * const DRAW_STAGE_NAMES[] = { "ReactionDiffusion draw", "Flocking draw", "Network draw", "CubeDebug draw", "CalibSphere draw" };
+// Telemetry names, indexed by AppType
+char const * const APP_TYPE_NAMES[] = { "reaction_diffusion", "flocking", "network", "cube_debug", "calib_sphere" };
+char const * const DISRUPT_STAGE_NAMES[] = { "ReactionDiffusion disrupt", "Flocking disrupt", "Network disrupt", "CubeDebug disrupt", "CalibSphere disrupt" };
+
+// A point on the playback timeline where the narration moves on to another simulation
+struct PlaybackCue {
+	char const * mName;
+	double mTime;
+	AppType mAppType;
+};
+
 enum class AppMode {
 	DEVELOPMENT,
 	DISPLAY
 };
 
-vec3 getDisruptionVector(uint8_t dir) {
-	assert(0 <= dir && dir <= 5);
-
-	float const SLICE_INC = M_TWO_PI / 6.0f;
-	float const SLICE_START = 0.0f; // No offset since microphones are in the middle of the slices
-
-	float zxAngle = dir * SLICE_INC + SLICE_START + randFloat(0.40f, 0.60f) * SLICE_INC; // rotation angle in the zx plane about the y-axis (right-handed rotations)
-	float yAngle = randFloat(M_PI * 3.0f / 9.0f, M_PI * 5.0f / 9.0f); // angle relative to the vertical axis. 0 is all the way up, PI is all the way down
+// Parsing, or reading the mesh cache, happens here, so this can run on a worker thread. Only the upload needs the GL context
+CachedMeshRef loadObjMesh(std::string const & resourceName) {
+	return loadCachedObjMesh(loadResource(resourceName), getMeshCacheDirectory() / (resourceName + ".dlmesh"));
+}
 
-	return getPointOnSphere(yAngle, zxAngle);
+// True once a background startup task has finished and its result can be collected. Blocks until then if wait is set
+template <typename T>
+bool isStartupTaskReady(std::future<T> const & task, bool wait) {
+	if (!task.valid()) {
+		return false;
+	}
+	if (wait) {
+		task.wait();
+		return true;
+	}
+	return task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
 }
 
 class DigitalLifeApp : public App {
@@ -60,24 +96,72 @@ class DigitalLifeApp : public App {
 	void setup() override;
 	void update() override;
 	void draw() override;
+	void cleanup() override;
 
 	void keyDown(KeyEvent evt) override;
 
-	SerialRef attemptArduinoCxn();
+	void startDisruptionSources();
+	void handleDisruptionEvents();
+	void applyDisruption(DisruptionEvent const & event, bool logEvent);
+	void toggleDisruptionRecording();
+	void setupPreviewPolicy();
+	RDShardOptions getShardOptions() const;
+	int getRDSphereSide() const;
+	bool getFlockPacked() const;
+	void startTelemetry();
+	void publishTelemetry();
+	void startOutputStream();
+
+	void enterPlaybackCue(size_t cueIndex);
+	void captureCheckpoint(size_t cueIndex, AppType ranAppType);
+	void seekToCue(size_t cueIndex);
+	uint64_t getCheckpointConfigHash() const;
+	fs::path getCheckpointPath(size_t cueIndex) const;
+
+	void finishStartupTasks();
+	void disruptActiveApp(vec3 dir);
+	void dumpFrameProfile();
 
 	// App variables
 	gl::FboRef mOutputFbo;
 	uint8_t mAppTextureBind = 0;
 	gl::BatchRef mOutputBatch;
 	ciSyphon::ServerRef mSyphonServer;
+	FrameStreamPublisher mOutputStream;
+
+	// Startup work that runs on the task scheduler. The GL halves are finished by finishStartupTasks() as each one becomes ready
+	StartupReport mStartupReport;
+	std::future<CachedMeshRef> mCubeObjLoad;
+	std::future<CachedMeshRef> mCalibObjLoad;
+	std::future<void> mNetworkGraphLoad;
+	std::future<audio::SourceFileRef> mNarrationLoad;
+	bool mFirstFrameDrawn = false;
+	bool mStartupTasksFinished = false;
+
+	FrameProfiler mProfiler;
+	TelemetryStream mTelemetry;
+	// IO forked during a frame, like publishing telemetry, which has to be done by the start of the next one
+	TaskGroup mFrameIoTasks { TaskPriority::IO };
+
+	MemoryAccount mOutputMemory { "Output" };
+	MemoryAccount mCalibrationMemory { "Calibration" };
 
 	// App state stuff
 	AppType mActiveAppType = AppType::REACTION_DIFFUSION;
 	AppMode mActiveAppMode = AppMode::DEVELOPMENT;
 
-	// Arduino connection stuff
-	SerialRef mArduinoCxn;
-	bool mArduinoNoCxnLogged = false;
+	// Arduino connection stuff. Runs on its own thread, the frame loop only drains its events
+	ArduinoInput mArduinoInput;
+
+	// Where disruptions come from: the Arduino, plus any replay or synthetic load asked for on the command line
+	struct ActiveDisruptionSource {
+		DisruptionSourceRef mSource;
+		uint64_t mNumApplied;
+		double mStartTime;
+	};
+	vector<ActiveDisruptionSource> mDisruptionSources;
+	vector<DisruptionEvent> mPendingDisruptions;
+	DisruptionRecorder mDisruptionRecorder;
 
 	// The simulations themselves
 	ReactionDiffusionApp mReactionDiffusionApp;
@@ -86,19 +170,31 @@ class DigitalLifeApp : public App {
 
 	// Narration playback and coordination stuff
 	audio::VoiceSamplePlayerNodeRef mNarrationPlayer;
+	// Cue seeked to before the narration finished loading, or -1
+	int mPendingNarrationCue = -1;
 	ci::Timer mPlaybackFrameTimer;
 	choreograph::Output<float> mPlaybackProgress = 0.0f;
 	choreograph::Output<float> mFrameAlpha = 0.0f;
 	choreograph::Timeline mPlaybackTimeline;
+	vector<PlaybackCue> mPlaybackCues;
+
+	// With `--capture-checkpoints`, each cue saves the state of the simulation that ran up to it as it's reached, so later
+	// runs can seek straight to it. Off by default, since reading the state back stalls the frame
+	bool mCaptureCheckpoints = false;
+	std::future<bool> mCheckpointWrite;
+	bool mSeekingToCue = false;
 
 	// Debug and config stuff
 	CameraPersp mCamera;
 	CameraUi mCameraUi;
 	gl::GlslProgRef mRenderTexAsSphereShader;
+	PreviewWindow mPreviewWindow;
 
 	FboCubeMapLayeredRef mSparckConfigDrawFbo;
 	gl::UboRef mSparckConfigDrawMatrices;
+	gl::GlslProgRef mSparckConfigCubeShader;
 	gl::BatchRef mSparckConfigCube;
+	gl::GlslProgRef mPreciseCalibShader;
 	gl::BatchRef mPreciseCalibObj;
 	gl::TextureCubeMapRef drawDebugCube();
 	gl::TextureCubeMapRef drawCalibObj();
@@ -109,51 +205,87 @@ void DigitalLifeApp::prepareSettings(Settings * settings) {
 }
 
 void DigitalLifeApp::setup() {
-	mOutputFbo = gl::Fbo::create(6 * OUTPUT_CUBE_MAP_SIDE, OUTPUT_CUBE_MAP_SIDE);
+	mStartupReport.start();
+
+	// Kick off everything that doesn't need the GL context first, so that it overlaps with the shader
+	// compilation and GL allocation below, which have to stay on the main thread. There's only the one context, and
+	// GL 4.1 on macOS has no parallel shader compile, so the programs still compile one after another
+	mCubeObjLoad = TaskScheduler::get().async(TaskPriority::IO, [this] {
+		StartupReport::ScopedPhase phase(mStartupReport, "Load BoxSides.obj");
+		return loadObjMesh("BoxSides.obj");
+	});
 
-	auto outputMesh = makeCubeMapToRowLayoutMesh_SPARCK(OUTPUT_CUBE_MAP_SIDE);
-	auto outputShader = gl::GlslProg::create(loadResource("DLOutputCubeMapToRect_v.glsl"), loadResource("DLOutputCubeMapToRect_f.glsl"));
-	outputShader->uniform("uCubeMap", mAppTextureBind);
+	mCalibObjLoad = TaskScheduler::get().async(TaskPriority::IO, [this] {
+		StartupReport::ScopedPhase phase(mStartupReport, "Load CalibrationPreciseAlignment.obj");
+		return loadObjMesh("CalibrationPreciseAlignment.obj");
+	});
 
-	mOutputBatch = gl::Batch::create(outputMesh, outputShader);
+	mNetworkGraphLoad = TaskScheduler::get().async(TaskPriority::BACKGROUND, [this] {
+		StartupReport::ScopedPhase phase(mStartupReport, "Build network graph");
+		mNetworkApp.setupGraph();
+	});
 
-	mSyphonServer = ciSyphon::Server::create();
-	mSyphonServer->setName("DigitalLifeServer");
+	// Only the file is opened and its decoder set up here. Creating the voice adds nodes to the audio context's graph,
+	// which is left to the main thread, in finishStartupTasks()
+	mNarrationLoad = TaskScheduler::get().async(TaskPriority::IO, [this] {
+		StartupReport::ScopedPhase phase(mStartupReport, "Load narration audio");
+		return audio::load(loadResource("AudioNarration.mp3"));
+	});
 
-	// Debug stuff
-	uint8_t cubeMatrixBufferBinding = 1;
-	mSparckConfigDrawFbo = FboCubeMapLayered::create(OUTPUT_CUBE_MAP_SIDE, OUTPUT_CUBE_MAP_SIDE);
-	mSparckConfigDrawMatrices = mSparckConfigDrawFbo->generateCameraMatrixBuffer();
-	mSparckConfigDrawMatrices->bindBufferBase(cubeMatrixBufferBinding);
+	startDisruptionSources();
 
-	auto cubeObj = ObjLoader(loadResource("BoxSides.obj"));
-	auto cubeVboMesh = gl::VboMesh::create(cubeObj, {
-		{gl::VboMesh::Layout().attrib(geom::Attrib::POSITION, 3), nullptr},
-		{gl::VboMesh::Layout().attrib(geom::Attrib::TEX_COORD_0, 2), nullptr}
-	});
-	auto cubeShader = gl::GlslProg::create(loadResource("DLRenderIntoCubeMap_v.glsl"), loadResource("DLRenderIntoCubeMap_f.glsl"), loadResource("DLRenderIntoCubeMap_triangles_g.glsl"));
-	mSparckConfigCube = gl::Batch::create(cubeVboMesh, cubeShader);
-	cubeShader->uniformBlock("uMatrices", cubeMatrixBufferBinding);
-
-	// More precise calibration stuff
-	auto calibObj = ObjLoader(loadResource("CalibrationPreciseAlignment.obj"));
-	auto calibVboMesh = gl::VboMesh::create(calibObj, {
-		{gl::VboMesh::Layout().attrib(geom::Attrib::POSITION, 3), nullptr},
-		{gl::VboMesh::Layout().attrib(geom::Attrib::TEX_COORD_0, 2), nullptr}
-	});
-	auto calibShader = gl::GlslProg::create(loadResource("DLRenderIntoCubeMap_v.glsl"), loadResource("DLRenderIntoCubeMap_f.glsl"), loadResource("DLRenderIntoCubeMap_triangles_g.glsl"));
-	mPreciseCalibObj = gl::Batch::create(calibVboMesh, calibShader);
-	calibShader->uniformBlock("uMatrices", cubeMatrixBufferBinding);
+	{
+		StartupReport::ScopedPhase phase(mStartupReport, "Output pipeline");
+
+		mOutputFbo = gl::Fbo::create(6 * OUTPUT_CUBE_MAP_SIDE, OUTPUT_CUBE_MAP_SIDE);
+
+		auto outputMesh = makeCubeMapToRowLayoutMesh_SPARCK(OUTPUT_CUBE_MAP_SIDE);
+		auto outputShader = gl::GlslProg::create(loadResource("DLOutputCubeMapToRect_v.glsl"), loadResource("DLOutputCubeMapToRect_f.glsl"));
+		outputShader->uniform("uCubeMap", mAppTextureBind);
+
+		mOutputBatch = gl::Batch::create(outputMesh, outputShader);
 
-	// App setup
-	mReactionDiffusionApp.setup();
-	mFlockingApp.setup();
-	mNetworkApp.setup();
+		// The default FBO format has a depth renderbuffer
+		mOutputMemory.addFbo(mOutputFbo, true);
+		mOutputMemory.addVboMesh(mOutputBatch->getVboMesh());
 
-	// Setup audio track and coordinated simulation changes
-	audio::SourceFileRef narrationTrackFile = audio::load(loadResource("AudioNarration.mp3"));
-	mNarrationPlayer = audio::Voice::create(narrationTrackFile);
+		mSyphonServer = ciSyphon::Server::create();
+		mSyphonServer->setName("DigitalLifeServer");
+	}
+
+	// Debug stuff. The meshes are attached once the OBJ files are loaded
+	{
+		StartupReport::ScopedPhase phase(mStartupReport, "Calibration shaders");
+
+		uint8_t cubeMatrixBufferBinding = 1;
+		mSparckConfigDrawFbo = FboCubeMapLayered::create(OUTPUT_CUBE_MAP_SIDE, OUTPUT_CUBE_MAP_SIDE);
+		mCalibrationMemory.addFbo(mSparckConfigDrawFbo);
+		mSparckConfigDrawMatrices = mSparckConfigDrawFbo->generateCameraMatrixBuffer();
+		mSparckConfigDrawMatrices->bindBufferBase(cubeMatrixBufferBinding);
+
+		mSparckConfigCubeShader = gl::GlslProg::create(loadResource("DLRenderIntoCubeMap_v.glsl"), loadResource("DLRenderIntoCubeMap_f.glsl"), loadResource("DLRenderIntoCubeMap_triangles_g.glsl"));
+		mSparckConfigCubeShader->uniformBlock("uMatrices", cubeMatrixBufferBinding);
+
+		// More precise calibration stuff
+		mPreciseCalibShader = gl::GlslProg::create(loadResource("DLRenderIntoCubeMap_v.glsl"), loadResource("DLRenderIntoCubeMap_f.glsl"), loadResource("DLRenderIntoCubeMap_triangles_g.glsl"));
+		mPreciseCalibShader->uniformBlock("uMatrices", cubeMatrixBufferBinding);
+	}
 
+	// App setup. The network's GL setup waits for its graph, in finishStartupTasks()
+	{
+		StartupReport::ScopedPhase phase(mStartupReport, "Reaction diffusion setup");
+		mReactionDiffusionApp.mShardOptions = getShardOptions();
+		mReactionDiffusionApp.mSphereSide = getRDSphereSide();
+		mReactionDiffusionApp.setup();
+	}
+
+	{
+		StartupReport::ScopedPhase phase(mStartupReport, "Flocking setup");
+		mFlockingApp.mPackedState = getFlockPacked();
+		mFlockingApp.setup();
+	}
+
+	// Setup coordinated simulation changes. The narration player itself is attached once it's loaded
 	mPlaybackTimeline.setDefaultRemoveOnFinish(false);
 
 	double const I1_start = secFromHMS(0, 0, 0.0);
@@ -170,8 +302,8 @@ void DigitalLifeApp::setup() {
 
 	mPlaybackTimeline.apply(& mPlaybackProgress)
 		.then<choreograph::RampTo>(narration_duration, narration_duration)
-		.startFn([&] { mNarrationPlayer->stop(); mNarrationPlayer->start(); })
-		.finishFn([&] { mNarrationPlayer->stop(); mPlaybackTimeline.resetTime(); });
+		.startFn([&] { if (mNarrationPlayer) { mNarrationPlayer->stop(); mNarrationPlayer->start(); } })
+		.finishFn([&] { if (mNarrationPlayer) { mNarrationPlayer->stop(); } mPlaybackTimeline.resetTime(); });
 
 	mPlaybackTimeline.apply(& mFrameAlpha)
 		.then<choreograph::RampTo>(1.0f, end_fade_dur)
@@ -193,13 +325,19 @@ void DigitalLifeApp::setup() {
 		.then<choreograph::Hold>(1.0f, narration_duration - N1_start - fade_dur - end_fade_dur) // N1
 		.then<choreograph::RampTo>(0.0f, end_fade_dur); // Long fade to black at end
 
-	mPlaybackTimeline.cue([&] { mActiveAppType = AppType::REACTION_DIFFUSION; }, I1_start);
-	mPlaybackTimeline.cue([&] { mActiveAppType = AppType::REACTION_DIFFUSION; }, I2_start);
-	mPlaybackTimeline.cue([&] { mActiveAppType = AppType::FLOCKING; }, D1_start);
-	mPlaybackTimeline.cue([&] { mActiveAppType = AppType::NETWORK; }, D2_start);
-	mPlaybackTimeline.cue([&] { mActiveAppType = AppType::REACTION_DIFFUSION; }, B1_start);
-	mPlaybackTimeline.cue([&] { mActiveAppType = AppType::FLOCKING; }, F1_start);
-	mPlaybackTimeline.cue([&] { mActiveAppType = AppType::NETWORK; }, N1_start);
+	mPlaybackCues = {
+		{ "I1", I1_start, AppType::REACTION_DIFFUSION },
+		{ "I2", I2_start, AppType::REACTION_DIFFUSION },
+		{ "D1", D1_start, AppType::FLOCKING },
+		{ "D2", D2_start, AppType::NETWORK },
+		{ "B1", B1_start, AppType::REACTION_DIFFUSION },
+		{ "F1", F1_start, AppType::FLOCKING },
+		{ "N1", N1_start, AppType::NETWORK }
+	};
+
+	for (size_t idx = 0; idx < mPlaybackCues.size(); idx++) {
+		mPlaybackTimeline.cue([this, idx] { enterPlaybackCue(idx); }, mPlaybackCues[idx].mTime);
+	}
 
 	mPlaybackFrameTimer.start();
 
@@ -207,6 +345,73 @@ void DigitalLifeApp::setup() {
 	mCamera.lookAt(vec3(0, 0, 3.5), vec3(0), vec3(0, 1, 0));
 	mCameraUi = CameraUi(& mCamera, getWindow());
 	mRenderTexAsSphereShader = gl::GlslProg::create(loadResource("DLRenderOutputTexAsSphere_v.glsl"), loadResource("DLRenderOutputTexAsSphere_f.glsl"));
+	mPreviewWindow.setup(mRenderTexAsSphereShader);
+	setupPreviewPolicy();
+
+	// `--capture-checkpoints` saves one at each cue, for development runs. A display run doesn't take the stall
+	auto const & args = getCommandLineArgs();
+	mCaptureCheckpoints = std::find(args.begin(), args.end(), "--capture-checkpoints") != args.end();
+
+	// `--seek-cue <name>` starts the run from a cue's checkpoint, e.g. `--seek-cue F1`
+	for (size_t idx = 0; idx + 1 < args.size(); idx++) {
+		if (args[idx] != "--seek-cue") {
+			continue;
+		}
+		auto cue = std::find_if(mPlaybackCues.begin(), mPlaybackCues.end(), [&] (PlaybackCue const & candidate) { return args[idx + 1] == candidate.mName; });
+		if (cue != mPlaybackCues.end()) {
+			seekToCue(cue - mPlaybackCues.begin());
+		} else {
+			CI_LOG_E("Unknown --seek-cue: " << args[idx + 1]);
+		}
+	}
+
+	startTelemetry();
+	startOutputStream();
+
+	mStartupReport.log("main thread setup finished");
+}
+
+void DigitalLifeApp::finishStartupTasks() {
+	if (mStartupTasksFinished) {
+		return;
+	}
+
+	// Anything the current app type or mode needs right now is waited for, everything else is picked up when it's ready
+	if (isStartupTaskReady(mNetworkGraphLoad, mActiveAppType == AppType::NETWORK)) {
+		mNetworkGraphLoad.get();
+		StartupReport::ScopedPhase phase(mStartupReport, "Network GL setup");
+		mNetworkApp.setup();
+	}
+
+	if (isStartupTaskReady(mCubeObjLoad, mActiveAppType == AppType::CUBE_DEBUG)) {
+		StartupReport::ScopedPhase phase(mStartupReport, "Upload BoxSides.obj");
+		mSparckConfigCube = gl::Batch::create(mCubeObjLoad.get()->createVboMesh(), mSparckConfigCubeShader);
+		mCalibrationMemory.addVboMesh(mSparckConfigCube->getVboMesh());
+	}
+
+	if (isStartupTaskReady(mCalibObjLoad, mActiveAppType == AppType::CALIB_SPHERE)) {
+		StartupReport::ScopedPhase phase(mStartupReport, "Upload CalibrationPreciseAlignment.obj");
+		mPreciseCalibObj = gl::Batch::create(mCalibObjLoad.get()->createVboMesh(), mPreciseCalibShader);
+		mCalibrationMemory.addVboMesh(mPreciseCalibObj->getVboMesh());
+	}
+
+	if (isStartupTaskReady(mNarrationLoad, mActiveAppMode == AppMode::DISPLAY)) {
+		StartupReport::ScopedPhase phase(mStartupReport, "Create narration voice");
+		mNarrationPlayer = audio::Voice::create(mNarrationLoad.get());
+		if (mPendingNarrationCue >= 0) {
+			// The timeline kept going from the cue while the narration loaded, and its progress is the narration's time
+			CI_LOG_I("Narration loaded, catching up with the seek to cue " << mPlaybackCues[mPendingNarrationCue].mName);
+			mNarrationPlayer->start();
+			mNarrationPlayer->getSamplePlayerNode()->seekToTime(mPlaybackProgress.value());
+			mPendingNarrationCue = -1;
+		}
+	}
+
+	if (!mNetworkGraphLoad.valid() && !mCubeObjLoad.valid() && !mCalibObjLoad.valid() && !mNarrationLoad.valid()) {
+		mStartupTasksFinished = true;
+		mStartupReport.log("all startup work finished");
+		CI_LOG_I(MemoryLedger::get().getReport());
+	}
 }
 
 void DigitalLifeApp::keyDown(KeyEvent evt) {
@@ -214,6 +419,23 @@ void DigitalLifeApp::keyDown(KeyEvent evt) {
 		quit();
 	}
 
+	// Available in display mode too, to see which stage is over budget at an installation
+	if (evt.getCode() == KeyEvent::KEY_p) {
+		dumpFrameProfile();
+	}
+
+	// Cycles the preview between full, reduced and off
+	if (evt.getCode() == KeyEvent::KEY_v) {
+		mPreviewWindow.cyclePolicy();
+		CI_LOG_I("Preview window: " << mPreviewWindow.getPolicy().getName());
+	}
+
+	// Live and high-water memory per simulation, for sizing the output and bird counts to a machine
+	if (evt.getCode() == KeyEvent::KEY_m) {
+		CI_LOG_I(MemoryLedger::get().getReport());
+	}
+
+
 	if (mActiveAppMode == AppMode::DEVELOPMENT) {
 		if (evt.getCode() == KeyEvent::KEY_1) {
 			mActiveAppType = AppType::REACTION_DIFFUSION;
@@ -227,15 +449,23 @@ void DigitalLifeApp::keyDown(KeyEvent evt) {
 			mActiveAppType = AppType::CALIB_SPHERE;
 		}
 
+		finishStartupTasks();
+
 		if (evt.getCode() == KeyEvent::KEY_d) {
-			switch (mActiveAppType) {
-				case AppType::REACTION_DIFFUSION: mReactionDiffusionApp.disrupt(getDisruptionVector(0)); break;
-				case AppType::FLOCKING: mFlockingApp.disrupt(getDisruptionVector(0)); break;
-				case AppType::NETWORK: mNetworkApp.disrupt(getDisruptionVector(0)); break;
-			}
+			applyDisruption({ getElapsedSeconds(), 0 }, false);
+		}
+
+		if (evt.getCode() == KeyEvent::KEY_r) {
+			toggleDisruptionRecording();
+		}
+
+		// F1 to F7 seek to the timeline cues, restoring the simulations from their checkpoints
+		int cueKey = evt.getCode() - KeyEvent::KEY_F1;
+		if (cueKey >= 0 && cueKey < (int) mPlaybackCues.size()) {
+			seekToCue(cueKey);
 		}
 
-		if (evt.getCode() == KeyEvent::KEY_SPACE) {
+		if (evt.getCode() == KeyEvent::KEY_SPACE && mNarrationPlayer) {
 			if (mNarrationPlayer->isPlaying()) {
 				mNarrationPlayer->pause();
 			} else {
@@ -245,69 +475,430 @@ void DigitalLifeApp::keyDown(KeyEvent evt) {
 	}
 }
 
-SerialRef DigitalLifeApp::attemptArduinoCxn() {
-	if (Serial::getDevices().size()) {
-		try {
-			auto cxnDevice = Serial::findDeviceByNameContains("cu.usbmodem", true);
-			auto cxn = Serial::create(cxnDevice, 9600);
+// Command line options:
+//   --serial-device <pattern>       device name pattern or path for the arduino, e.g. a pseudo-terminal standing in for it
+//   --record-disruptions <path>     log every disruption, whatever its source
+//   --replay-disruptions <path>     replay a recorded log
+//   --replay-speed <factor | max>   1 by default
+//   --synthetic-load <rate | r0,..,r5>  disruptions per second, in total or for each microphone
+//   --synthetic-duration <seconds>  runs forever by default
+void DigitalLifeApp::startDisruptionSources() {
+	std::string devicePattern = ArduinoInput::DEFAULT_DEVICE_PATTERN;
+	std::string recordPath, replayPath, syntheticRates;
+	double replaySpeed = 1.0;
+	double syntheticDuration = 0.0;
+
+	auto const & args = getCommandLineArgs();
+	for (size_t idx = 0; idx + 1 < args.size(); idx++) {
+		std::string const & value = args[idx + 1];
+		if (args[idx] == "--serial-device") {
+			devicePattern = value;
+		} else if (args[idx] == "--record-disruptions") {
+			recordPath = value;
+		} else if (args[idx] == "--replay-disruptions") {
+			replayPath = value;
+		} else if (args[idx] == "--replay-speed") {
+			replaySpeed = value == "max" ? 0.0 : std::atof(value.c_str());
+		} else if (args[idx] == "--synthetic-load") {
+			syntheticRates = value;
+		} else if (args[idx] == "--synthetic-duration") {
+			syntheticDuration = std::atof(value.c_str());
+		}
+	}
 
-			CI_LOG_I("Successfully connected with arduino at port: " << cxnDevice.getName());
-			mArduinoNoCxnLogged = false;
+	mArduinoInput.start(devicePattern, 9600);
+	mDisruptionSources.push_back({ ArduinoDisruptionSource::create(mArduinoInput), 0, 0.0 });
 
-			return cxn;
-		} catch (SerialExc exc) {
-			if (!mArduinoNoCxnLogged) {
-				CI_LOG_EXCEPTION("Failed to connect to arduino", exc);
-				mArduinoNoCxnLogged = true;
-			}
+	if (!replayPath.empty()) {
+		if (auto replay = DisruptionReplay::create(replayPath, replaySpeed)) {
+			mDisruptionSources.push_back({ replay, 0, 0.0 });
+		}
+	}
 
-			return nullptr;
+	if (!syntheticRates.empty()) {
+		std::array<double, 6> rates;
+		if (parseDisruptionRates(syntheticRates, rates)) {
+			mDisruptionSources.push_back({ SyntheticDisruptionSource::create(rates, syntheticDuration), 0, 0.0 });
+		} else {
+			CI_LOG_E("Bad --synthetic-load rates: " << syntheticRates);
 		}
-	} else if (!mArduinoNoCxnLogged) {
-		CI_LOG_W("No active Arduino detected!");
-		mArduinoNoCxnLogged = true;
 	}
 
-	return nullptr;
+	if (!recordPath.empty()) {
+		mDisruptionRecorder.open(recordPath);
+	}
 }
 
-void DigitalLifeApp::update() {
-	if (!mArduinoCxn) {
-		mArduinoCxn = attemptArduinoCxn();
-	}
-
-	if (mArduinoCxn && mArduinoCxn->getNumBytesAvailable() > 0 && (mActiveAppMode == AppMode::DEVELOPMENT || getElapsedSeconds() > 60)) {
-		uint8_t ardMessage;
-		mArduinoCxn->readAvailableBytes(& ardMessage, 1);
-				
-		if (0 <= ardMessage && ardMessage <= 5) {
-			CI_LOG_I("Disturb at: " << (int) ardMessage);
-			vec3 disruptionVector = getDisruptionVector(ardMessage);
-			switch (mActiveAppType) {
-				case AppType::REACTION_DIFFUSION: mReactionDiffusionApp.disrupt(disruptionVector); break;
-				case AppType::FLOCKING: mFlockingApp.disrupt(disruptionVector); break;
-				case AppType::NETWORK: mNetworkApp.disrupt(disruptionVector); break;
-				case AppType::CUBE_DEBUG: break;
-				case AppType::CALIB_SPHERE: break;
-			}
-		} else {
-			CI_LOG_W("weird value from microphones: " << (int) ardMessage);
+void DigitalLifeApp::handleDisruptionEvents() {
+	FrameProfiler::ScopedStage stage(mProfiler, "Disruption sources", false);
+
+	// Live disruptions are ignored for the first minute of a display run. They're still drained, so a backlog doesn't fire all at once later
+	bool acceptLiveEvents = mActiveAppMode == AppMode::DEVELOPMENT || getElapsedSeconds() > 60;
+	double now = getElapsedSeconds();
+
+	for (auto & active : mDisruptionSources) {
+		mPendingDisruptions.clear();
+		active.mSource->poll(now, mPendingDisruptions);
+
+		bool isLive = active.mSource->isLive();
+		if (isLive && !acceptLiveEvents) {
+			continue;
+		}
+
+		if (active.mNumApplied == 0 && !mPendingDisruptions.empty()) {
+			active.mStartTime = now;
+		}
+
+		for (auto & event : mPendingDisruptions) {
+			// Logging every event would skew the frame times under synthetic load, so only live ones are logged
+			applyDisruption(event, isLive);
+		}
+		active.mNumApplied += mPendingDisruptions.size();
+	}
+
+	// Report the sustained throughput of replays and synthetic load once they're done, along with the frame stages
+	for (auto it = mDisruptionSources.begin(); it != mDisruptionSources.end();) {
+		if (!it->mSource->isFinished()) {
+			++it;
+			continue;
+		}
+
+		double seconds = now - it->mStartTime;
+		CI_LOG_I("Finished " << it->mSource->getName() << " disruptions: " << it->mNumApplied << " in " << seconds << "s ("
+			<< (seconds > 0.0 ? it->mNumApplied / seconds : 0.0) << " per second)");
+		CI_LOG_I(mProfiler.getSummary());
+		it = mDisruptionSources.erase(it);
+	}
+}
+
+void DigitalLifeApp::applyDisruption(DisruptionEvent const & event, bool logEvent) {
+	if (0 <= event.mMessage && event.mMessage <= 5) {
+		// Only valid faces are recorded, so a replay never feeds a bad microphone value back in
+		mDisruptionRecorder.record(event);
+		if (logEvent) {
+			CI_LOG_I("Disturb at: " << (int) event.mMessage);
+		}
+		disruptActiveApp(getDisruptionVector(event.mMessage));
+	} else {
+		CI_LOG_W("weird value from microphones: " << (int) event.mMessage);
+	}
+}
+
+void DigitalLifeApp::toggleDisruptionRecording() {
+	if (mDisruptionRecorder.isOpen()) {
+		mDisruptionRecorder.close();
+		CI_LOG_I("Stopped recording disruptions");
+		return;
+	}
+
+	fs::path logPath = getDocumentsDirectory() / "DigitalLifeDisruptions.txt";
+	if (mDisruptionRecorder.open(logPath)) {
+		CI_LOG_I("Recording disruptions to: " << logPath);
+	}
+}
+
+// In display mode the preview only gets a reduced share of the frame, since the show goes out over Syphon.
+// Override with `--preview <full | reduced | off>`
+void DigitalLifeApp::setupPreviewPolicy() {
+	PreviewPolicy policy = mActiveAppMode == AppMode::DISPLAY ? PreviewPolicy::reduced() : PreviewPolicy::full();
+
+	auto const & args = getCommandLineArgs();
+	for (size_t idx = 0; idx + 1 < args.size(); idx++) {
+		if (args[idx] == "--preview" && !PreviewPolicy::parse(args[idx + 1], policy)) {
+			CI_LOG_E("Bad --preview policy: " << args[idx + 1]);
+		}
+	}
+
+	mPreviewWindow.setPolicy(policy);
+	CI_LOG_I("Preview window: " << policy.getName());
+}
+
+// Reaction diffusion runs on the GPU unless it's given shards, or the sphere grid below:
+//   --rd-shards <count>             worker processes to split the cube across
+//   --rd-side <texels>              per face, 2048 by default
+//   --rd-gather-side <texels>       resolution shown, 1024 by default
+//   --rd-transport <shm | socket>   how spawned workers talk, shm by default
+//   --rd-shard-port <port>          first loopback port for spawned socket workers, 47100 by default
+//   --rd-shard-hosts <a:p,b:p,..>   workers already started on other hosts, then this app's own address
+//   --rd-worker <path>              DigitalLifeRDWorker next to the app's executable by default
+RDShardOptions DigitalLifeApp::getShardOptions() const {
+	RDShardOptions options;
+#if defined( CINDER_MAC )
+	// The Xcode project copies the worker into Contents/MacOS. getAppPath() is the folder the bundle sits in there
+	options.mWorkerPath = getResourcePath().parent_path() / "MacOS" / "DigitalLifeRDWorker";
+#else
+	options.mWorkerPath = getAppPath() / "DigitalLifeRDWorker";
+#endif
+
+	auto const & args = getCommandLineArgs();
+	for (size_t idx = 0; idx + 1 < args.size(); idx++) {
+		std::string const & value = args[idx + 1];
+		if (args[idx] == "--rd-shards") {
+			options.mNumShards = std::atoi(value.c_str());
+		} else if (args[idx] == "--rd-side") {
+			options.mSide = std::atoi(value.c_str());
+		} else if (args[idx] == "--rd-gather-side") {
+			options.mGatherSide = std::atoi(value.c_str());
+		} else if (args[idx] == "--rd-transport") {
+			options.mTransport = value;
+		} else if (args[idx] == "--rd-shard-port") {
+			options.mBasePort = (uint16_t) std::atoi(value.c_str());
+		} else if (args[idx] == "--rd-shard-hosts") {
+			options.mHosts = split(value, ',');
+		} else if (args[idx] == "--rd-worker") {
+			options.mWorkerPath = value;
+		}
+	}
+
+	// A host list says how many workers there are
+	if (!options.mHosts.empty()) {
+		options.mNumShards = (int) options.mHosts.size() - 1;
+	}
+
+	return options;
+}
+
+// `--rd-sphere-side <texels | match>` steps reaction diffusion on the CPU, on a near uniform grid over the sphere
+// instead of the cube, see ReactionDiffusionSphere.h. `match` picks the side that resolves patterns as finely as the
+// GPU cube does at its face centers
+int DigitalLifeApp::getRDSphereSide() const {
+	auto const & args = getCommandLineArgs();
+	for (size_t idx = 0; idx + 1 < args.size(); idx++) {
+		if (args[idx] == "--rd-sphere-side") {
+			std::string const & value = args[idx + 1];
+			return value == "match" ? RDSphereGrid::getSideMatchingCube(mReactionDiffusionApp.mCubeMapSide) : std::atoi(value.c_str());
 		}
 	}
+	return 0;
+}
+
+// `--flock-state <float | packed>` keeps the flock in the 8 byte per bird layout of PackedBird on the GPU instead of
+// 32 bytes, for flocks big enough that reading every other bird each step is what limits them
+bool DigitalLifeApp::getFlockPacked() const {
+	auto const & args = getCommandLineArgs();
+	for (size_t idx = 0; idx + 1 < args.size(); idx++) {
+		if (args[idx] == "--flock-state") {
+			return args[idx + 1] == "packed";
+		}
+	}
+	return false;
+}
+
+// `--telemetry <path | udp:host:port | udp:port>` publishes simulation health, see Telemetry.h.
+// `--telemetry-rate <per second>` is 2 by default
+void DigitalLifeApp::startTelemetry() {
+	std::string destination;
+	double rate = 2.0;
+
+	auto const & args = getCommandLineArgs();
+	for (size_t idx = 0; idx + 1 < args.size(); idx++) {
+		if (args[idx] == "--telemetry") {
+			destination = args[idx + 1];
+		} else if (args[idx] == "--telemetry-rate") {
+			rate = std::atof(args[idx + 1].c_str());
+		}
+	}
+
+	if (!destination.empty() && mTelemetry.open(destination, rate)) {
+		CI_LOG_I("Publishing telemetry to " << destination << " " << rate << " times a second");
+	}
+}
+
+// Only the active simulation reports, the others aren't stepping. The frame count tells a frozen app from a dead one
+void DigitalLifeApp::publishTelemetry() {
+	FrameProfiler::ScopedStage stage(mProfiler, "Telemetry");
+
+	TelemetrySample sample;
+	sample.mTime = getElapsedSeconds();
+	sample.mFrame = getElapsedFrames();
+	sample.mActiveApp = APP_TYPE_NAMES[(int) mActiveAppType];
+	sample.mFps = getAverageFps();
+
+	switch (mActiveAppType) {
+		case AppType::REACTION_DIFFUSION: mReactionDiffusionApp.collectTelemetry(sample); break;
+		case AppType::FLOCKING: mFlockingApp.collectTelemetry(sample); break;
+		// The graph may still be building
+		case AppType::NETWORK: if (!mNetworkGraphLoad.valid()) { mNetworkApp.collectTelemetry(sample); } break;
+		case AppType::CUBE_DEBUG: break;
+		case AppType::CALIB_SPHERE: break;
+	}
+
+	// Formatting and writing the line can wait on the disk or the network, so it's done by the next frame instead
+	mFrameIoTasks.run([this, sample] { mTelemetry.publish(sample); });
+}
+
+// `--output-stream <tcp:host:port | path>` sends the output strip, alongside Syphon, to a DigitalLifeFrameStream
+// receiver on another machine, or records it to a file, see FrameStream.h
+void DigitalLifeApp::startOutputStream() {
+	auto const & args = getCommandLineArgs();
+	for (size_t idx = 0; idx + 1 < args.size(); idx++) {
+		if (args[idx] == "--output-stream" && mOutputStream.open(args[idx + 1], mOutputFbo->getWidth(), mOutputFbo->getHeight())) {
+			CI_LOG_I("Streaming the output to " << args[idx + 1]);
+		}
+	}
+}
+
+void DigitalLifeApp::enterPlaybackCue(size_t cueIndex) {
+	AppType ranAppType = mActiveAppType;
+	mActiveAppType = mPlaybackCues[cueIndex].mAppType;
+
+	// Don't overwrite a checkpoint with the state that was just restored from it
+	if (mCaptureCheckpoints && !mSeekingToCue) {
+		captureCheckpoint(cueIndex, ranAppType);
+	}
+}
+
+// Only the simulation that ran up to the cue has changed since the cue before, the others haven't stepped
+void DigitalLifeApp::captureCheckpoint(size_t cueIndex, AppType ranAppType) {
+	FrameProfiler::ScopedStage stage(mProfiler, "Checkpoint capture");
+
+	// Cues are tens of seconds apart, so the previous write is long done by now
+	if (mCheckpointWrite.valid()) {
+		mCheckpointWrite.get();
+	}
+
+	// The GL readbacks happen here, encoding and writing the file on a worker thread
+	auto writer = std::make_shared<CheckpointWriter>();
+	switch (ranAppType) {
+		case AppType::REACTION_DIFFUSION: mReactionDiffusionApp.saveState(* writer); break;
+		case AppType::FLOCKING: mFlockingApp.saveState(* writer); break;
+		// The graph may still be building if this is the first cue
+		case AppType::NETWORK: if (!mNetworkGraphLoad.valid()) { mNetworkApp.saveState(* writer); } break;
+		case AppType::CUBE_DEBUG: break;
+		case AppType::CALIB_SPHERE: break;
+	}
+
+	fs::path path = getCheckpointPath(cueIndex);
+	uint64_t configHash = getCheckpointConfigHash();
+	double time = mPlaybackCues[cueIndex].mTime;
+	mCheckpointWrite = TaskScheduler::get().async(TaskPriority::IO, [writer, path, configHash, cueIndex, time] {
+		return writer->write(path, configHash, cueIndex, time);
+	});
+
+	CI_LOG_I("Capturing checkpoint for cue " << mPlaybackCues[cueIndex].mName << " (" << writer->getRawSize() / (1024 * 1024) << "MB raw)");
+}
+
+void DigitalLifeApp::seekToCue(size_t cueIndex) {
+	PlaybackCue const & cue = mPlaybackCues[cueIndex];
+	Timer seekTimer(true);
+
+	// Restoring the network needs its graph, and the cue's app needs to be set up
+	if (mNetworkGraphLoad.valid()) {
+		mNetworkGraphLoad.wait();
+	}
+	mActiveAppType = cue.mAppType;
+	finishStartupTasks();
+
+	// A checkpoint still being written could be the one wanted
+	if (mCheckpointWrite.valid()) {
+		mCheckpointWrite.get();
+	}
+
+	// Each checkpoint only has the simulation that ran up to its cue, so each simulation comes from the latest one at or
+	// before this cue that has it. One that hadn't run yet by this cue keeps its starting state
+	bool restoredRD = false;
+	bool restoredFlocking = false;
+	bool restoredNetwork = false;
+	bool foundCheckpoint = false;
+	for (size_t idx = cueIndex + 1; idx-- > 0 && !(restoredRD && restoredFlocking && restoredNetwork);) {
+		auto checkpoint = Checkpoint::load(getCheckpointPath(idx), getCheckpointConfigHash());
+		if (!checkpoint) {
+			continue;
+		}
+		foundCheckpoint = foundCheckpoint || idx == cueIndex;
+		restoredRD = restoredRD || mReactionDiffusionApp.restoreState(* checkpoint);
+		restoredFlocking = restoredFlocking || mFlockingApp.restoreState(* checkpoint);
+		restoredNetwork = restoredNetwork || mNetworkApp.restoreState(* checkpoint);
+	}
+	if (!foundCheckpoint) {
+		CI_LOG_W("No checkpoint for cue " << cue.mName << " yet, play through it once in display mode with --capture-checkpoints to capture one");
+	}
+
+	mSeekingToCue = true;
+	mPlaybackTimeline.jumpTo(cue.mTime);
+	mSeekingToCue = false;
+	mPlaybackFrameTimer.start();
+
+	// After the jump, in case it restarted the narration from the top. A narration still loading is seeked once it's in
+	if (mNarrationPlayer) {
+		mNarrationPlayer->getSamplePlayerNode()->seekToTime(cue.mTime);
+	} else {
+		mPendingNarrationCue = (int) cueIndex;
+	}
+
+	CI_LOG_I("Seeked to cue " << cue.mName << " in " << seekTimer.getSeconds() * 1000.0 << "ms");
+}
+
+// Checkpoints can only be restored into simulations of the same size
+uint64_t DigitalLifeApp::getCheckpointConfigHash() const {
+	uint32_t config[] = {
+		(uint32_t) mReactionDiffusionApp.mCubeMapSide,
+		(uint32_t) mFlockingApp.mNumBirds,
+		(uint32_t) mNetworkApp.mSim.mNumNetworkNodes,
+		(uint32_t) mNetworkApp.mSim.mNumLinksPerNode
+	};
+	return hashMeshSource(reinterpret_cast<uint8_t const *>(config), sizeof(config));
+}
+
+fs::path DigitalLifeApp::getCheckpointPath(size_t cueIndex) const {
+	return getMeshCacheDirectory() / "Checkpoints" / (std::string("Cue") + mPlaybackCues[cueIndex].mName + ".dlcp");
+}
+
+void DigitalLifeApp::disruptActiveApp(vec3 dir) {
+	FrameProfiler::ScopedStage stage(mProfiler, DISRUPT_STAGE_NAMES[(int) mActiveAppType]);
+
+	switch (mActiveAppType) {
+		case AppType::REACTION_DIFFUSION: mReactionDiffusionApp.disrupt(dir); break;
+		case AppType::FLOCKING: mFlockingApp.disrupt(dir); break;
+		case AppType::NETWORK: mNetworkApp.disrupt(dir); break;
+		case AppType::CUBE_DEBUG: break;
+		case AppType::CALIB_SPHERE: break;
+	}
+}
+
+void DigitalLifeApp::dumpFrameProfile() {
+	fs::path tracePath = getDocumentsDirectory() / "DigitalLifeTrace.json";
+	mProfiler.writeChromeTrace(tracePath);
+
+	CI_LOG_I(mProfiler.getSummary());
+	CI_LOG_I(TaskScheduler::get().getStatsReport());
+	CI_LOG_I("Wrote frame trace to: " << tracePath);
+}
+
+void DigitalLifeApp::update() {
+	mProfiler.beginFrame();
+	TaskScheduler::get().beginFrame();
+	FrameProfiler::ScopedStage frameStage(mProfiler, "Update", false);
+
+	mFrameIoTasks.wait();
+
+	finishStartupTasks();
+
+	handleDisruptionEvents();
 
 	if (mActiveAppMode == AppMode::DISPLAY) {
 		mPlaybackTimeline.step(mPlaybackFrameTimer.getSeconds());
 		mPlaybackFrameTimer.start(); // Restart the timer each frame
+		finishStartupTasks(); // A cue may have just switched to an app that isn't set up yet
 	} else if (mActiveAppMode == AppMode::DEVELOPMENT) {
 			mFrameAlpha = 1.0f;
 	}
 
-	switch (mActiveAppType) {
-		case AppType::REACTION_DIFFUSION: mReactionDiffusionApp.update(); break;
-		case AppType::FLOCKING: mFlockingApp.update(); break;
-		case AppType::NETWORK: mNetworkApp.update(); break;
-		case AppType::CUBE_DEBUG: break;
-		case AppType::CALIB_SPHERE: break;
+	{
+		FrameProfiler::ScopedStage stage(mProfiler, UPDATE_STAGE_NAMES[(int) mActiveAppType]);
+
+		switch (mActiveAppType) {
+			case AppType::REACTION_DIFFUSION: mReactionDiffusionApp.update(); break;
+			case AppType::FLOCKING: mFlockingApp.update(); break;
+			case AppType::NETWORK: mNetworkApp.update(); break;
+			case AppType::CUBE_DEBUG: break;
+			case AppType::CALIB_SPHERE: break;
+		}
+	}
+
+	// A stage of its own, outside the simulation's
+	if (mTelemetry.isDue(getElapsedSeconds())) {
+		publishTelemetry();
 	}
 }
 
@@ -346,17 +937,25 @@ gl::TextureCubeMapRef DigitalLifeApp::drawCalibObj() {
 }
 
 void DigitalLifeApp::draw() {
+	FrameProfiler::ScopedStage frameStage(mProfiler, "Draw", false);
+
 	gl::TextureCubeMapRef appInstanceCubeMapFrame;
-	switch (mActiveAppType) {
-		case AppType::REACTION_DIFFUSION: appInstanceCubeMapFrame = mReactionDiffusionApp.draw(); break;
-		case AppType::FLOCKING: appInstanceCubeMapFrame = mFlockingApp.draw(); break;
-		case AppType::NETWORK: appInstanceCubeMapFrame = mNetworkApp.draw(); break;
-		case AppType::CUBE_DEBUG: appInstanceCubeMapFrame = drawDebugCube(); break;
-		case AppType::CALIB_SPHERE: appInstanceCubeMapFrame = drawCalibObj(); break;
+	{
+		FrameProfiler::ScopedStage stage(mProfiler, DRAW_STAGE_NAMES[(int) mActiveAppType]);
+
+		switch (mActiveAppType) {
+			case AppType::REACTION_DIFFUSION: appInstanceCubeMapFrame = mReactionDiffusionApp.draw(); break;
+			case AppType::FLOCKING: appInstanceCubeMapFrame = mFlockingApp.draw(); break;
+			case AppType::NETWORK: appInstanceCubeMapFrame = mNetworkApp.draw(); break;
+			case AppType::CUBE_DEBUG: appInstanceCubeMapFrame = drawDebugCube(); break;
+			case AppType::CALIB_SPHERE: appInstanceCubeMapFrame = drawCalibObj(); break;
+		}
 	}
 
 	// Draw the cubemap to the wide FBO
 	{
+		FrameProfiler::ScopedStage stage(mProfiler, "Cube map to strip");
+
 		gl::ScopedFramebuffer scpFbo(mOutputFbo);
 
 		gl::ScopedMatrices scpMat;
@@ -375,7 +974,10 @@ void DigitalLifeApp::draw() {
 	// Publish to Syphon
 
 	// This works with gaborpapp's version but not reza's
-	mSyphonServer->publishTexture(mOutputFbo->getColorTexture());
+	{
+		FrameProfiler::ScopedStage stage(mProfiler, "Syphon publish");
+		mSyphonServer->publishTexture(mOutputFbo->getColorTexture());
+	}
 
 	// This doesn't work on gaborpapp's version but does work on reza's *AND* on the current Syphon master branch
 	// mSyphonServer->bind(vec2(getWindowWidth(), getWindowHeight()));
@@ -385,36 +987,26 @@ void DigitalLifeApp::draw() {
 	// This works, with occasional glitches on gaborpapp's version but not reza's
 	// mSyphonServer->publishScreen();
 
-	// Draw the main window
-	gl::clear();
+	// And to anything listening for --output-stream
+	if (mOutputStream.isOpen()) {
+		FrameProfiler::ScopedStage stage(mProfiler, "Output stream");
+		mOutputStream.publish(mOutputFbo->getColorTexture(), getElapsedSeconds());
+	}
 
+	// Draw the main window
+	bool previewAtFullRate;
 	{
-		gl::ScopedDepth scpDepth(true);
-		gl::ScopedFaceCulling scpCull(true, GL_BACK);
-
-		gl::ScopedMatrices scpMat;
-		gl::setMatrices(mCamera);
-
-		gl::ScopedTextureBind scpTex(appInstanceCubeMapFrame);
-		gl::ScopedGlslProg scpShader(mRenderTexAsSphereShader);
-
-		mRenderTexAsSphereShader->uniform("uFrameAlpha", mFrameAlpha.value());
-
-		gl::draw(geom::Sphere().center(vec3(0)).radius(1.0f).subdivisions(50));
+		FrameProfiler::ScopedStage stage(mProfiler, "Preview window");
+		previewAtFullRate = mPreviewWindow.draw(mCamera, appInstanceCubeMapFrame, mFrameAlpha.value(), mActiveAppMode == AppMode::DEVELOPMENT);
 	}
 
-	gl::drawString(std::to_string(getAverageFps()), vec2(10.0f, getWindowHeight() - 40.0f), ColorA(1.0f, 1.0f, 1.0f, 1.0f));
+	if (!mFirstFrameDrawn) {
+		mFirstFrameDrawn = true;
+		mStartupReport.log("first frame drawn");
+	}
 
 	// Debug zone
-	if (mActiveAppMode == AppMode::DEVELOPMENT) {
-		{
-			gl::ScopedDepth scpDepth(true);
-			gl::ScopedMatrices scpMat;
-			gl::setMatrices(mCamera);
-
-			gl::drawCoordinateFrame(2.0f);
-		}
-
+	if (mActiveAppMode == AppMode::DEVELOPMENT && previewAtFullRate) {
 		{
 			mFlockingApp.mMenu->draw();
 		}
@@ -430,4 +1022,24 @@ void DigitalLifeApp::draw() {
 	}
 }
 
+// The scheduler outlives the app, so nothing it's still running for the app can be left behind
+void DigitalLifeApp::cleanup() {
+	for (auto task : { & mCubeObjLoad, & mCalibObjLoad }) {
+		if (task->valid()) {
+			task->wait();
+		}
+	}
+	if (mNetworkGraphLoad.valid()) {
+		mNetworkGraphLoad.wait();
+	}
+	if (mNarrationLoad.valid()) {
+		mNarrationLoad.wait();
+	}
+	if (mCheckpointWrite.valid()) {
+		mCheckpointWrite.wait();
+	}
+	mFrameIoTasks.wait();
+	mOutputStream.close();
+}
+
 CINDER_APP(DigitalLifeApp, RendererGl, & DigitalLifeApp::prepareSettings)
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cinder/Vector.h"
+
+// A random point on the sphere within the slice covered by microphone dir (0 to 5)
+ci::vec3 getDisruptionVector(uint8_t dir);
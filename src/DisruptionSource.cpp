@@ -0,0 +1,169 @@
+#include "DisruptionSource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+
+#include "cinder/Log.h"
+
+using std::vector;
+
+void ArduinoDisruptionSource::poll(double now, vector<DisruptionEvent> & events) {
+	auto steadyNow = std::chrono::steady_clock::now();
+
+	ArduinoEvent arduinoEvent;
+	while (mInput.pop(arduinoEvent)) {
+		double age = std::chrono::duration<double>(steadyNow - arduinoEvent.mReceived).count();
+		events.push_back({ now - age, arduinoEvent.mMessage });
+	}
+}
+
+DisruptionSourceRef DisruptionReplay::create(ci::fs::path const & path, double speed, size_t maxEventsPerFrame) {
+	std::ifstream in(path.string());
+	if (!in) {
+		CI_LOG_E("Couldn't open disruption log: " << path);
+		return nullptr;
+	}
+
+	vector<DisruptionEvent> events;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		std::istringstream fields(line);
+		double time;
+		int message;
+		if (!(fields >> time >> message) || message < 0 || message > 5) {
+			CI_LOG_W("Skipping bad line in disruption log: " << line);
+			continue;
+		}
+		events.push_back({ time, (uint8_t) message });
+	}
+
+	std::stable_sort(events.begin(), events.end(), [] (DisruptionEvent const & a, DisruptionEvent const & b) { return a.mTime < b.mTime; });
+
+	return DisruptionSourceRef(new DisruptionReplay(std::move(events), speed, maxEventsPerFrame));
+}
+
+DisruptionReplay::DisruptionReplay(vector<DisruptionEvent> events, double speed, size_t maxEventsPerFrame)
+	: mEvents(std::move(events)), mSpeed(speed), mMaxEventsPerFrame(std::max<size_t>(maxEventsPerFrame, 1)) {}
+
+void DisruptionReplay::poll(double now, vector<DisruptionEvent> & events) {
+	if (mStartTime < 0.0) {
+		mStartTime = now;
+	}
+
+	if (mSpeed <= 0.0) {
+		for (size_t count = 0; count < mMaxEventsPerFrame && mNextEvent < mEvents.size(); count++) {
+			events.push_back({ now, mEvents[mNextEvent++].mMessage });
+		}
+		return;
+	}
+
+	double logTime = (now - mStartTime) * mSpeed;
+	while (mNextEvent < mEvents.size() && mEvents[mNextEvent].mTime <= logTime) {
+		auto const & event = mEvents[mNextEvent++];
+		events.push_back({ mStartTime + event.mTime / mSpeed, event.mMessage });
+	}
+}
+
+DisruptionSourceRef SyntheticDisruptionSource::create(std::array<double, 6> const & rates, double duration, uint32_t seed) {
+	return DisruptionSourceRef(new SyntheticDisruptionSource(rates, duration, seed));
+}
+
+SyntheticDisruptionSource::SyntheticDisruptionSource(std::array<double, 6> const & rates, double duration, uint32_t seed)
+	: mRandom(seed), mDirection(rates.begin(), rates.end()), mDuration(duration)
+{
+	double totalRate = 0.0;
+	for (double rate : rates) {
+		totalRate += std::max(rate, 0.0);
+	}
+
+	// The sum of independent Poisson processes is one with the summed rate, each arrival landing on a microphone in
+	// proportion to its own rate
+	if (totalRate > 0.0) {
+		mArrivalGap = std::exponential_distribution<double>(totalRate);
+	} else {
+		mFinished = true;
+	}
+}
+
+void SyntheticDisruptionSource::poll(double now, vector<DisruptionEvent> & events) {
+	if (mFinished) {
+		return;
+	}
+
+	if (mStartTime < 0.0) {
+		mStartTime = now;
+		mNextTime = now + mArrivalGap(mRandom);
+	}
+
+	double endTime = mDuration > 0.0 ? std::min(now, mStartTime + mDuration) : now;
+	while (mNextTime <= endTime) {
+		events.push_back({ mNextTime, (uint8_t) mDirection(mRandom) });
+		mNextTime += mArrivalGap(mRandom);
+	}
+
+	if (mDuration > 0.0 && now >= mStartTime + mDuration) {
+		mFinished = true;
+	}
+}
+
+bool DisruptionRecorder::open(ci::fs::path const & path) {
+	close();
+
+	mOut.open(path.string(), std::ios::trunc);
+	if (!mOut) {
+		CI_LOG_E("Couldn't open disruption log for writing: " << path);
+		return false;
+	}
+
+	mStartTime = -1.0;
+	mOut << "# DigitalLife disruption log: <seconds since recording started> <microphone 0-5>\n";
+	mOut << std::fixed << std::setprecision(6);
+	return true;
+}
+
+void DisruptionRecorder::close() {
+	if (mOut.is_open()) {
+		mOut.close();
+	}
+}
+
+void DisruptionRecorder::record(DisruptionEvent const & event) {
+	if (!mOut.is_open()) {
+		return;
+	}
+
+	if (mStartTime < 0.0) {
+		mStartTime = event.mTime;
+	}
+	mOut << (event.mTime - mStartTime) << " " << (int) event.mMessage << "\n";
+}
+
+bool parseDisruptionRates(std::string const & text, std::array<double, 6> & rates) {
+	vector<double> values;
+	std::istringstream fields(text);
+	std::string field;
+	while (std::getline(fields, field, ',')) {
+		char * end = nullptr;
+		double value = std::strtod(field.c_str(), & end);
+		if (end == field.c_str() || value < 0.0) {
+			return false;
+		}
+		values.push_back(value);
+	}
+
+	if (values.size() == 1) {
+		rates.fill(values[0] / rates.size());
+	} else if (values.size() == rates.size()) {
+		std::copy(values.begin(), values.end(), rates.begin());
+	} else {
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/Filesystem.h"
+
+#include "ArduinoInput.h"
+
+// A disruption from one of the six microphones (0 to 5). The time is in app seconds, see getElapsedSeconds()
+struct DisruptionEvent {
+	double mTime;
+	uint8_t mMessage;
+};
+
+class DisruptionSource;
+typedef std::shared_ptr<DisruptionSource> DisruptionSourceRef;
+
+// Anything that produces disruptions: the live microphones, a replayed log or synthetic load
+class DisruptionSource {
+public:
+	virtual ~DisruptionSource() {}
+
+	// Appends every event that is due by now, oldest first
+	virtual void poll(double now, std::vector<DisruptionEvent> & events) = 0;
+
+	// Live sources are held back at the start of a display run, replays and synthetic load never are
+	virtual bool isLive() const { return false; }
+	// Finite sources report when they have delivered everything
+	virtual bool isFinished() const { return false; }
+	virtual std::string getName() const = 0;
+};
+
+// The microphone Arduino. Event times come from when the I/O thread read each byte, not from when it was drained
+class ArduinoDisruptionSource : public DisruptionSource {
+public:
+	static DisruptionSourceRef create(ArduinoInput & input) { return DisruptionSourceRef(new ArduinoDisruptionSource(input)); }
+
+	void poll(double now, std::vector<DisruptionEvent> & events) override;
+	bool isLive() const override { return true; }
+	std::string getName() const override { return "arduino"; }
+
+private:
+	ArduinoDisruptionSource(ArduinoInput & input) : mInput(input) {}
+
+	ArduinoInput & mInput;
+};
+
+// Plays back a log written by DisruptionRecorder, at its original pace times a speed factor, or as fast as possible
+class DisruptionReplay : public DisruptionSource {
+public:
+	// Speed of 0 or less replays at max speed, i.e. up to maxEventsPerFrame events every poll regardless of their times.
+	// Returns nullptr if the log can't be read
+	static DisruptionSourceRef create(ci::fs::path const & path, double speed = 1.0, size_t maxEventsPerFrame = 64);
+
+	void poll(double now, std::vector<DisruptionEvent> & events) override;
+	bool isFinished() const override { return mNextEvent >= mEvents.size(); }
+	std::string getName() const override { return "replay"; }
+
+	size_t getNumEvents() const { return mEvents.size(); }
+
+private:
+	DisruptionReplay(std::vector<DisruptionEvent> events, double speed, size_t maxEventsPerFrame);
+
+	// Times relative to the start of the recording
+	std::vector<DisruptionEvent> mEvents;
+	size_t mNextEvent = 0;
+	double mSpeed;
+	size_t mMaxEventsPerFrame;
+	double mStartTime = -1.0;
+};
+
+// Poisson arrivals on each microphone at its own rate, in events per second. Runs forever when duration is 0 or less
+class SyntheticDisruptionSource : public DisruptionSource {
+public:
+	static DisruptionSourceRef create(std::array<double, 6> const & rates, double duration = 0.0, uint32_t seed = 1);
+
+	void poll(double now, std::vector<DisruptionEvent> & events) override;
+	bool isFinished() const override { return mFinished; }
+	std::string getName() const override { return "synthetic"; }
+
+private:
+	SyntheticDisruptionSource(std::array<double, 6> const & rates, double duration, uint32_t seed);
+
+	std::mt19937 mRandom;
+	std::exponential_distribution<double> mArrivalGap;
+	std::discrete_distribution<int> mDirection;
+	double mDuration;
+	double mStartTime = -1.0;
+	double mNextTime = 0.0;
+	bool mFinished = false;
+};
+
+// Appends events to a text log, one `<seconds since recording started> <microphone>` line each, that DisruptionReplay can read back
+class DisruptionRecorder {
+public:
+	bool open(ci::fs::path const & path);
+	void close();
+	bool isOpen() const { return mOut.is_open(); }
+
+	void record(DisruptionEvent const & event);
+
+private:
+	std::ofstream mOut;
+	double mStartTime = -1.0;
+};
+
+// Parses "r" (spread evenly over the six microphones) or "r0,r1,r2,r3,r4,r5", in events per second
+bool parseDisruptionRates(std::string const & text, std::array<double, 6> & rates);
@@ -1,5 +1,8 @@
 #include "FlockingApp.h"
 
+#include <algorithm>
+#include <cstring>
+
 using namespace ci;
 
 extern uint32_t OUTPUT_CUBE_MAP_SIDE;
@@ -17,6 +20,8 @@ void FlockingApp::setup() {
 
 	// Initialize the positions FBO
 	Surface32f initialPos(mFboSide, mFboSide, true);
+	size_t initialSurfaceBytes = mFboSide * mFboSide * 4 * sizeof(float);
+	mMemory.addCpu(initialSurfaceBytes);
 	auto posIter = initialPos.getIter();
 	while (posIter.line()) {
 		while (posIter.pixel()) {
@@ -29,14 +34,10 @@ void FlockingApp::setup() {
 			// Note: the z and w coordinates don't matter at the moment - they're never used by the shader
 		}
 	}
-	auto posTex = gl::Texture2d::create(initialPos, fboTexFmt);
-	auto posFboFmt = gl::Fbo::Format().disableDepth().attachment(GL_COLOR_ATTACHMENT0, posTex);
-
-	mPositionsSource = gl::Fbo::create(mFboSide, mFboSide, posFboFmt);
-	mPositionsDest = gl::Fbo::create(mFboSide, mFboSide, fboDefaultFmt);
 
 	// Initialize the velocities FBO
 	Surface32f initialVel(mFboSide, mFboSide, true);
+	mMemory.addCpu(initialSurfaceBytes);
 	auto velIter = initialVel.getIter();
 	while (velIter.line()) {
 		while (velIter.pixel()) {
@@ -51,27 +52,28 @@ void FlockingApp::setup() {
 			velIter.b() = vel.z;
 		}
 	}
-	auto velTex = gl::Texture2d::create(initialVel, fboTexFmt);
-	auto velFboFmt = gl::Fbo::Format().disableDepth().attachment(GL_COLOR_ATTACHMENT0, velTex);
 
-	mVelocitiesSource = gl::Fbo::create(mFboSide, mFboSide, velFboFmt);
-	mVelocitiesDest = gl::Fbo::create(mFboSide, mFboSide, fboDefaultFmt);
+	if (mPackedState) {
+		setupPackedState(initialPos, initialVel);
+	} else {
+		auto posTex = gl::Texture2d::create(initialPos, fboTexFmt);
+		auto posFboFmt = gl::Fbo::Format().disableDepth().attachment(GL_COLOR_ATTACHMENT0, posTex);
 
-	// Initialize the birds update routine
-	mBirdPosUpdateProg = gl::GlslProg::create(app::loadResource("FLRunBirds_v.glsl"), app::loadResource("FLRunBirdsPosition_f.glsl"));
-	mBirdPosUpdateProg->uniform("uGridSide", mFboSide);
-	mBirdPosUpdateProg->uniform("uPositions", mPosTextureBind);
-	mBirdPosUpdateProg->uniform("uVelocities", mVelTextureBind);
+		mPositionsSource = gl::Fbo::create(mFboSide, mFboSide, posFboFmt);
+		mPositionsDest = gl::Fbo::create(mFboSide, mFboSide, fboDefaultFmt);
+		mMemory.addFbo(mPositionsSource, false);
+		mMemory.addFbo(mPositionsDest, false);
 
-	mBirdVelUpdateProg = gl::GlslProg::create(app::loadResource("FLRunBirds_v.glsl"), app::loadResource("FLRunBirdsVelocity_f.glsl"));
-	mBirdVelUpdateProg->uniform("uGridSide", mFboSide);
-	mBirdVelUpdateProg->uniform("uPositions", mPosTextureBind);
-	mBirdVelUpdateProg->uniform("uVelocities", mVelTextureBind);
+		auto velTex = gl::Texture2d::create(initialVel, fboTexFmt);
+		auto velFboFmt = gl::Fbo::Format().disableDepth().attachment(GL_COLOR_ATTACHMENT0, velTex);
 
-	mBirdDisruptProg = gl::GlslProg::create(app::loadResource("FLRunBirds_v.glsl"), app::loadResource("FLDisruptBirds_f.glsl"));
-	mBirdDisruptProg->uniform("uGridSide", mFboSide);
-	mBirdDisruptProg->uniform("uPositions", mPosTextureBind);
-	mBirdDisruptProg->uniform("uVelocities", mVelTextureBind);
+		mVelocitiesSource = gl::Fbo::create(mFboSide, mFboSide, velFboFmt);
+		mVelocitiesDest = gl::Fbo::create(mFboSide, mFboSide, fboDefaultFmt);
+		mMemory.addFbo(mVelocitiesSource, false);
+		mMemory.addFbo(mVelocitiesDest, false);
+
+		setupFloatPrograms();
+	}
 
 	// Initialize the bird positions index VBO
 	std::vector<vec2> posIndex(mNumBirds);
@@ -83,11 +85,17 @@ void FlockingApp::setup() {
 	auto birdsVbo = gl::Vbo::create(GL_ARRAY_BUFFER, posIndex, GL_STREAM_DRAW);
 	auto birdsBufferLayout = geom::BufferLayout({ geom::AttribInfo(geom::CUSTOM_0, 2, 0, 0) });
 	mBirdIndexMesh = gl::VboMesh::create(posIndex.size(), GL_POINTS, { { birdsBufferLayout, birdsVbo } });
+	mMemory.addVboMesh(mBirdIndexMesh);
 
 	// Initialize the birds render routine
-	mBirdRenderProg = gl::GlslProg::create(app::loadResource("FLRenderBirds_v.glsl"), app::loadResource("FLRenderBirds_f.glsl"), app::loadResource("FLRenderBirds_g.glsl"));
-	mBirdRenderProg->uniform("uBirdPositions", mPosTextureBind);
-	mBirdRenderProg->uniform("uBirdVelocities", mVelTextureBind);
+	if (mPackedState) {
+		mBirdRenderProg = gl::GlslProg::create(app::loadResource("FLRenderBirdsPacked_v.glsl"), app::loadResource("FLRenderBirds_f.glsl"), app::loadResource("FLRenderBirds_g.glsl"));
+		mBirdRenderProg->uniform("uBirds", mPosTextureBind);
+	} else {
+		mBirdRenderProg = gl::GlslProg::create(app::loadResource("FLRenderBirds_v.glsl"), app::loadResource("FLRenderBirds_f.glsl"), app::loadResource("FLRenderBirds_g.glsl"));
+		mBirdRenderProg->uniform("uBirdPositions", mPosTextureBind);
+		mBirdRenderProg->uniform("uBirdVelocities", mVelTextureBind);
+	}
 	mBirdRenderBatch = gl::Batch::create(mBirdIndexMesh, mBirdRenderProg, { {geom::CUSTOM_0, "birdIndex"} });
 
 	// Set up the cube map 360 degree camera
@@ -99,40 +107,112 @@ void FlockingApp::setup() {
 	auto cubeMapFboFmt = FboCubeMapLayered::Format().colorFormat(cubeMapFormat);
 
 	mCubeMapCamera = FboCubeMapLayered::create(OUTPUT_CUBE_MAP_SIDE, OUTPUT_CUBE_MAP_SIDE, cubeMapFboFmt);
+	mMemory.addFbo(mCubeMapCamera);
 
 	mCubeMapCameraMatrixBuffer = mCubeMapCamera->generateCameraMatrixBuffer();
 
 	// Set up params
 	mMenu = params::InterfaceGl::create(app::getWindow(), "Menu", app::toPixels(ivec2(200, 500)));
-	mMenu->addParam<float>("Min Speed", & mMinSpeed).min(0.0f).max(1.0f).precision(4).step(0.0001f);
-	mMenu->addParam<float>("Max Speed", & mMaxSpeed).min(0.0f).max(1.0f).precision(4).step(0.0001f);
-	mMenu->addParam<float>("Min Force", & mMinForce).min(0.0f).max(1.0f).precision(4).step(0.0001f);
-	mMenu->addParam<float>("Max Force", & mMaxForce).min(0.0f).max(1.0f).precision(4).step(0.0001f);
-	mMenu->addParam<float>("Separation Dist", & mSeparationDist).min(0.0f).max(1.0f).precision(4).step(0.0001f);
-	mMenu->addParam<float>("Separation Mod", & mSeparationMod).min(0.0f).max(1.0f).precision(4).step(0.0001f);
-	mMenu->addParam<float>("Align Dist", & mAlignDist).min(0.0f).max(1.0f).precision(4).step(0.0001f);
-	mMenu->addParam<float>("Align Mod", & mAlignMod).min(0.0f).max(1.0f).precision(4).step(0.0001f);
-	mMenu->addParam<float>("Cohesion Dist", & mCohesionDist).min(0.0f).max(1.0f).precision(4).step(0.0001f);
-	mMenu->addParam<float>("Cohesion Mod", & mCohesionMod).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Min Speed", & mParams.mMinSpeed).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Max Speed", & mParams.mMaxSpeed).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Min Force", & mParams.mMinForce).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Max Force", & mParams.mMaxForce).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Separation Dist", & mParams.mSeparationDist).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Separation Mod", & mParams.mSeparationMod).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Align Dist", & mParams.mAlignDist).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Align Mod", & mParams.mAlignMod).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Cohesion Dist", & mParams.mCohesionDist).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Cohesion Mod", & mParams.mCohesionMod).min(0.0f).max(1.0f).precision(4).step(0.0001f);
+	mMenu->addParam<float>("Flap Speed", & mParams.mFlapSpeed).min(0.0f).max(1.0f).precision(4).step(0.01f);
+	mMenu->addParam<bool>("CPU Render", & mRenderOnCpu);
+	mMenu->addParam<float>("CPU Splat Extent", & mCpuRasterOptions.mSplatMaxExtent).min(0.0f).max(32.0f).step(0.5f);
+
+	// The initial surfaces only live until the end of setup, they still count towards the high-water mark
+	mMemory.releaseCpu(2 * initialSurfaceBytes);
+}
+
+// Initialize the birds update routines
+void FlockingApp::setupFloatPrograms() {
+	mBirdPosUpdateProg = gl::GlslProg::create(app::loadResource("FLRunBirds_v.glsl"), app::loadResource("FLRunBirdsPosition_f.glsl"));
+	mBirdPosUpdateProg->uniform("uGridSide", mFboSide);
+	mBirdPosUpdateProg->uniform("uPositions", mPosTextureBind);
+	mBirdPosUpdateProg->uniform("uVelocities", mVelTextureBind);
+
+	mBirdVelUpdateProg = gl::GlslProg::create(app::loadResource("FLRunBirds_v.glsl"), app::loadResource("FLRunBirdsVelocity_f.glsl"));
+	mBirdVelUpdateProg->uniform("uGridSide", mFboSide);
+	mBirdVelUpdateProg->uniform("uPositions", mPosTextureBind);
+	mBirdVelUpdateProg->uniform("uVelocities", mVelTextureBind);
+
+	mBirdDisruptProg = gl::GlslProg::create(app::loadResource("FLRunBirds_v.glsl"), app::loadResource("FLDisruptBirds_f.glsl"));
+	mBirdDisruptProg->uniform("uGridSide", mFboSide);
+	mBirdDisruptProg->uniform("uPositions", mPosTextureBind);
+	mBirdDisruptProg->uniform("uVelocities", mVelTextureBind);
+}
+
+// The same starting state, packed
+void FlockingApp::setupPackedState(Surface32f const & initialPos, Surface32f const & initialVel) {
+	PackedFlockState initial;
+	initial.mBirds.resize(mNumBirds);
+	initial.mVelocityRange = getPackedVelocityRange(mParams);
+	for (int row = 0; row < mFboSide; row++) {
+		for (int col = 0; col < mFboSide; col++) {
+			ColorA pos = initialPos.getPixel(ivec2(col, row));
+			ColorA vel = initialVel.getPixel(ivec2(col, row));
+			initial.mBirds[row * mFboSide + col] = packBird(vec3(pos.r, pos.g, pos.b), vec3(vel.r, vel.g, vel.b), pos.a, initial.mVelocityRange);
+		}
+	}
+	mBirdsVelocityRange = initial.mVelocityRange;
+
+	// Integer textures can't be filtered
+	auto birdsTexFmt = gl::Texture2d::Format()
+		.internalFormat(GL_RG32UI)
+		.dataType(GL_UNSIGNED_INT)
+		.wrap(GL_REPEAT)
+		.minFilter(GL_NEAREST)
+		.magFilter(GL_NEAREST);
+	auto birdsTex = gl::Texture2d::create(initial.mBirds.data(), GL_RG_INTEGER, mFboSide, mFboSide, birdsTexFmt);
+
+	mBirdsSource = gl::Fbo::create(mFboSide, mFboSide, gl::Fbo::Format().disableDepth().attachment(GL_COLOR_ATTACHMENT0, birdsTex));
+	mBirdsDest = gl::Fbo::create(mFboSide, mFboSide, gl::Fbo::Format().disableDepth().colorTexture(birdsTexFmt));
+	mMemory.addFbo(mBirdsSource, false);
+	mMemory.addFbo(mBirdsDest, false);
+
+	// Checkpoints, telemetry and the CPU render path all read the flock back and unpack it
+	mPackedReadback.mBirds.resize(mNumBirds);
+	mCpuReadback.mPositions.resize(mNumBirds);
+	mCpuReadback.mVelocities.resize(mNumBirds);
+	mMemory.addCpu(mPackedReadback.mBirds);
+	mMemory.addCpu(mCpuReadback.mPositions);
+	mMemory.addCpu(mCpuReadback.mVelocities);
+
+	mBirdPackedUpdateProg = gl::GlslProg::create(app::loadResource("FLRunBirds_v.glsl"), app::loadResource("FLRunBirdsPacked_f.glsl"));
+	mBirdPackedUpdateProg->uniform("uGridSide", mFboSide);
+	mBirdPackedUpdateProg->uniform("uBirds", mPosTextureBind);
+
+	mBirdPackedDisruptProg = gl::GlslProg::create(app::loadResource("FLRunBirds_v.glsl"), app::loadResource("FLDisruptBirdsPacked_f.glsl"));
+	mBirdPackedDisruptProg->uniform("uBirds", mPosTextureBind);
 }
 
 void FlockingApp::update()
 {
-	// Update uniforms (assuming params can change any time)
-	mBirdVelUpdateProg->uniform("uMinSpeed", mMinSpeed);
-	mBirdVelUpdateProg->uniform("uMaxSpeed", mMaxSpeed);
+	// Update uniforms (assuming params can change any time). The packed state steps velocities and positions in one pass
+	auto velocityProg = mPackedState ? mBirdPackedUpdateProg : mBirdVelUpdateProg;
+	velocityProg->uniform("uMinSpeed", mParams.mMinSpeed);
+	velocityProg->uniform("uMaxSpeed", mParams.mMaxSpeed);
 
-	mBirdVelUpdateProg->uniform("uMinForce", mMinForce);
-	mBirdVelUpdateProg->uniform("uMaxForce", mMaxForce);
+	velocityProg->uniform("uMinForce", mParams.mMinForce);
+	velocityProg->uniform("uMaxForce", mParams.mMaxForce);
 	
-	mBirdVelUpdateProg->uniform("uSeparationDist", mSeparationDist);
-	mBirdVelUpdateProg->uniform("uSeparationMod", mSeparationMod);
-	mBirdVelUpdateProg->uniform("uAlignDist", mAlignDist);
-	mBirdVelUpdateProg->uniform("uAlignMod", mAlignMod);
-	mBirdVelUpdateProg->uniform("uCohesionDist", mCohesionDist);
-	mBirdVelUpdateProg->uniform("uCohesionMod", mCohesionMod);
+	velocityProg->uniform("uSeparationDist", mParams.mSeparationDist);
+	velocityProg->uniform("uSeparationMod", mParams.mSeparationMod);
+	velocityProg->uniform("uAlignDist", mParams.mAlignDist);
+	velocityProg->uniform("uAlignMod", mParams.mAlignMod);
+	velocityProg->uniform("uCohesionDist", mParams.mCohesionDist);
+	velocityProg->uniform("uCohesionMod", mParams.mCohesionMod);
+
+	(mPackedState ? mBirdPackedUpdateProg : mBirdPosUpdateProg)->uniform("uFlapSpeed", mParams.mFlapSpeed);
 
-	mBirdDisruptProg->uniform("uMaxSpeed", mMaxSpeed);
+	(mPackedState ? mBirdPackedDisruptProg : mBirdDisruptProg)->uniform("uMaxSpeed", mParams.mMaxSpeed);
 
 	// Run the simulation itself
 	gl::ScopedBlend scpBlend(false); // No alpha blending when running the simulation - because alpha is used for data
@@ -140,6 +220,26 @@ void FlockingApp::update()
 	gl::ScopedMatrices scpMat;
 	gl::setMatricesWindow(mFboSide, mFboSide);
 
+	if (mPackedState) {
+		// Packed with the speeds the params allow now, which can differ from the ones the source was packed with
+		float velocityRange = getPackedVelocityRange(mParams);
+		mBirdPackedUpdateProg->uniform("uSrcVelocityRange", mBirdsVelocityRange);
+		mBirdPackedUpdateProg->uniform("uDstVelocityRange", velocityRange);
+
+		{
+			gl::ScopedGlslProg scpShader(mBirdPackedUpdateProg);
+			gl::ScopedTextureBind scpBirdsTex(mBirdsSource->getColorTexture(), mPosTextureBind);
+
+			// Every texel gets written, and gl::clear() can't clear an integer target anyway
+			gl::ScopedFramebuffer scpFbo(mBirdsDest);
+			gl::drawSolidRect(Rectf(0, 0, mFboSide, mFboSide));
+		}
+
+		std::swap(mBirdsSource, mBirdsDest);
+		mBirdsVelocityRange = velocityRange;
+		return;
+	}
+
 	// Update velocities first
 	{
 		gl::ScopedGlslProg scpShader(mBirdVelUpdateProg);
@@ -172,6 +272,19 @@ void FlockingApp::disrupt(vec3 dir) {
 	gl::ScopedMatrices scpMat;
 	gl::setMatricesWindow(mFboSide, mFboSide);
 
+	if (mPackedState) {
+		mBirdPackedDisruptProg->uniform("uDisruptPoint", normalize(dir));
+		mBirdPackedDisruptProg->uniform("uVelocityRange", mBirdsVelocityRange);
+		gl::ScopedGlslProg scpShader(mBirdPackedDisruptProg);
+		gl::ScopedTextureBind scpBirdsTex(mBirdsSource->getColorTexture(), mPosTextureBind);
+
+		gl::ScopedFramebuffer scpFbo(mBirdsDest);
+		gl::drawSolidRect(Rectf(0, 0, mFboSide, mFboSide));
+
+		std::swap(mBirdsSource, mBirdsDest);
+		return;
+	}
+
 	// velocity update, but position doesn't change
 	mBirdDisruptProg->uniform("uDisruptPoint", normalize(dir));
 	gl::ScopedGlslProg scpShader(mBirdDisruptProg);
@@ -185,8 +298,118 @@ void FlockingApp::disrupt(vec3 dir) {
 	std::swap(mVelocitiesSource, mVelocitiesDest);
 }
 
+void FlockingApp::saveState(CheckpointWriter & writer) {
+	size_t const stateBytes = mNumBirds * sizeof(vec4);
+
+	// Saved unpacked, so a checkpoint restores into either layout
+	if (mPackedState) {
+		readBackPacked(mCpuReadback);
+		writer.addSection("FLPS", mCpuReadback.mPositions.data(), stateBytes, sizeof(float));
+		writer.addSection("FLVL", mCpuReadback.mVelocities.data(), stateBytes, sizeof(float));
+		return;
+	}
+
+	std::vector<vec4> state(mNumBirds);
+
+	{
+		gl::ScopedTextureBind scpTex(mPositionsSource->getColorTexture());
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, state.data());
+		writer.addSection("FLPS", state.data(), stateBytes, sizeof(float));
+	}
+	{
+		gl::ScopedTextureBind scpTex(mVelocitiesSource->getColorTexture());
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, state.data());
+		writer.addSection("FLVL", state.data(), stateBytes, sizeof(float));
+	}
+}
+
+bool FlockingApp::restoreState(Checkpoint const & checkpoint) {
+	std::vector<vec4> positions(mNumBirds);
+	std::vector<vec4> velocities(mNumBirds);
+	if (!checkpoint.readSection("FLPS", positions.data(), positions.size() * sizeof(vec4))
+		|| !checkpoint.readSection("FLVL", velocities.data(), velocities.size() * sizeof(vec4))) {
+		return false;
+	}
+
+	if (mPackedState) {
+		for (int idx = 0; idx < mNumBirds; idx++) {
+			mPackedReadback.mBirds[idx] = packBird(vec3(positions[idx]), vec3(velocities[idx]), positions[idx].w, mBirdsVelocityRange);
+		}
+		gl::ScopedTextureBind scpTex(mBirdsSource->getColorTexture());
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mFboSide, mFboSide, GL_RG_INTEGER, GL_UNSIGNED_INT, mPackedReadback.mBirds.data());
+		return true;
+	}
+
+	{
+		gl::ScopedTextureBind scpTex(mPositionsSource->getColorTexture());
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mFboSide, mFboSide, GL_RGBA, GL_FLOAT, positions.data());
+	}
+	{
+		gl::ScopedTextureBind scpTex(mVelocitiesSource->getColorTexture());
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mFboSide, mFboSide, GL_RGBA, GL_FLOAT, velocities.data());
+	}
+
+	return true;
+}
+
+void FlockingApp::collectTelemetry(TelemetrySample & sample) {
+	// Whole rows of the state texture, birds are laid out in no particular order
+	int const sampleRows = std::min(mFboSide, (mTelemetrySampleBirds + mFboSide - 1) / mFboSide);
+	int const numSamples = sampleRows * mFboSide;
+	size_t const bytes = numSamples * (mPackedState ? sizeof(PackedBird) : sizeof(vec4));
+	if (!mTelemetryPbo) {
+		mTelemetryPbo = gl::Pbo::create(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		mMemory.addPbo(mTelemetryPbo);
+		if (mPackedState) {
+			mTelemetryVelocities.resize(numSamples);
+			mMemory.addCpu(mTelemetryVelocities);
+		}
+	}
+
+	gl::ScopedBuffer scpBuf(mTelemetryPbo);
+
+	if (mTelemetryPending) {
+		if (void const * state = mTelemetryPbo->mapBufferRange(0, bytes, GL_MAP_READ_BIT)) {
+			vec4 const * velocities = static_cast<vec4 const *>(state);
+			if (mPackedState) {
+				PackedBird const * birds = static_cast<PackedBird const *>(state);
+				for (int idx = 0; idx < numSamples; idx++) {
+					vec3 position, velocity;
+					float wingPhase;
+					unpackBird(birds[idx], mTelemetryVelocityRange, position, velocity, wingPhase);
+					mTelemetryVelocities[idx] = vec4(velocity, 0.0f);
+				}
+				velocities = mTelemetryVelocities.data();
+			}
+			measureFlock(velocities, numSamples, mTelemetryOrder, mTelemetryMeanSpeed);
+			mTelemetryPbo->unmap();
+			mHasTelemetry = true;
+		}
+		mTelemetryPending = false;
+	}
+
+	if (mPackedState) {
+		gl::ScopedFramebuffer scpRead(GL_READ_FRAMEBUFFER, mBirdsSource->getId());
+		glReadPixels(0, 0, mFboSide, sampleRows, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+		mTelemetryVelocityRange = mBirdsVelocityRange;
+	} else {
+		gl::ScopedFramebuffer scpRead(GL_READ_FRAMEBUFFER, mVelocitiesSource->getId());
+		glReadPixels(0, 0, mFboSide, sampleRows, GL_RGBA, GL_FLOAT, nullptr);
+	}
+	mTelemetryPending = true;
+
+	if (mHasTelemetry) {
+		sample.mFlockOrder = mTelemetryOrder;
+		sample.mFlockMeanSpeed = mTelemetryMeanSpeed;
+	}
+}
+
 gl::TextureCubeMapRef FlockingApp::draw()
 {
+	if (mRenderOnCpu) {
+		return drawOnCpu();
+	}
+
 	// Draw the birds into the 360 degree camera FBO
 	{
 		// Bind the 360 camera framebuffer
@@ -199,8 +422,9 @@ gl::TextureCubeMapRef FlockingApp::draw()
 
 		gl::clear(Color(0, 0, 0));
 
-		gl::ScopedTextureBind scpPosTex(mPositionsSource->getColorTexture(), mPosTextureBind);
-		gl::ScopedTextureBind scpVelTex(mVelocitiesSource->getColorTexture(), mVelTextureBind);
+		// The packed state is all in the one texture
+		gl::ScopedTextureBind scpPosTex((mPackedState ? mBirdsSource : mPositionsSource)->getColorTexture(), mPosTextureBind);
+		gl::ScopedTextureBind scpVelTex((mPackedState ? mBirdsSource : mVelocitiesSource)->getColorTexture(), mVelTextureBind);
 
 		gl::ScopedColor scpColor(Color(1, 1, 1));
 
@@ -215,3 +439,59 @@ gl::TextureCubeMapRef FlockingApp::draw()
 	// Return the 360 camera's color texture
 	return mCubeMapCamera->getColorTex();
 }
+
+gl::TextureCubeMapRef FlockingApp::drawOnCpu() {
+	mCpuRasterOptions.mSide = OUTPUT_CUBE_MAP_SIDE;
+
+	if (!mCpuRenderTex) {
+		auto cubeMapFormat = gl::TextureCubeMap::Format()
+			.magFilter(GL_LINEAR)
+			.minFilter(GL_LINEAR)
+			.internalFormat(GL_RGB8);
+		mCpuRenderTex = gl::TextureCubeMap::create(OUTPUT_CUBE_MAP_SIDE, OUTPUT_CUBE_MAP_SIDE, cubeMapFormat);
+		mMemory.addTexture(mCpuRenderTex);
+
+		// The packed state has had its readback since setup
+		if (mCpuReadback.mPositions.empty()) {
+			mCpuReadback.mPositions.resize(mNumBirds);
+			mCpuReadback.mVelocities.resize(mNumBirds);
+			mMemory.addCpu(mCpuReadback.mPositions);
+			mMemory.addCpu(mCpuReadback.mVelocities);
+		}
+		mMemory.addCpu(NUM_CUBE_FACES * OUTPUT_CUBE_MAP_SIDE * OUTPUT_CUBE_MAP_SIDE * 3);
+	}
+
+	// The simulation state textures are laid out bird by bird, the same as FlockState
+	if (mPackedState) {
+		readBackPacked(mCpuReadback);
+	} else {
+		{
+			gl::ScopedTextureBind scpTex(mPositionsSource->getColorTexture());
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, mCpuReadback.mPositions.data());
+		}
+		{
+			gl::ScopedTextureBind scpTex(mVelocitiesSource->getColorTexture());
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, mCpuReadback.mVelocities.data());
+		}
+	}
+
+	mCpuRasterizer.render(mCpuReadback, mCpuRasterOptions);
+
+	gl::ScopedTextureBind scpTex(mCpuRenderTex);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, 0, 0, OUTPUT_CUBE_MAP_SIDE, OUTPUT_CUBE_MAP_SIDE, GL_RGB, GL_UNSIGNED_BYTE, mCpuRasterizer.getFace(face));
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	return mCpuRenderTex;
+}
+
+void FlockingApp::readBackPacked(FlockState & flock) {
+	{
+		gl::ScopedTextureBind scpTex(mBirdsSource->getColorTexture());
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, mPackedReadback.mBirds.data());
+	}
+	mPackedReadback.mVelocityRange = mBirdsVelocityRange;
+	unpackFlock(mPackedReadback, flock);
+}
@@ -4,11 +4,18 @@
 
 #include "cinder/app/App.h"
 #include "cinder/gl/gl.h"
+#include "cinder/gl/Pbo.h"
 #include "cinder/Rand.h"
 #include "cinder/params/Params.h"
 
 #include "FboCubeMapLayered.h"
 
+#include "FlockingKernels.h"
+#include "BirdRasterizer.h"
+#include "MemoryLedger.h"
+#include "Checkpoint.h"
+#include "Telemetry.h"
+
 class FlockingApp {
 public:
 	FlockingApp() {};
@@ -16,26 +23,34 @@ public:
 	void setup();
 	void update();
 	ci::gl::TextureCubeMapRef draw();
+	// Reads the flock back and draws it with BirdRasterizer instead of the geometry shader, into a cube map with the same layout
+	ci::gl::TextureCubeMapRef drawOnCpu();
 	void disrupt(ci::vec3 dir);
 
-	float mMinSpeed = 0.0030;
-	float mMaxSpeed = 0.0080;
+	void setupFloatPrograms();
+	void setupPackedState(ci::Surface32f const & initialPos, ci::Surface32f const & initialVel);
+	// Reads the packed state back and unpacks it
+	void readBackPacked(FlockState & flock);
+
+	// Reads the position and velocity textures back from the GPU, or uploads them again
+	void saveState(CheckpointWriter & writer);
+	bool restoreState(Checkpoint const & checkpoint);
 
-	float mMinForce = 0.0000;
-	float mMaxForce = 0.0010;
+	// Order and mean speed, of the first mTelemetrySampleBirds birds rather than the whole flock. Their velocities are
+	// copied into a pixel buffer, which is read on the next call
+	void collectTelemetry(TelemetrySample & sample);
 
-	float mSeparationDist = 0.0450;
-	float mSeparationMod = 0.2203;
-	float mAlignDist = 0.0600;
-	float mAlignMod = 0.0500;
-	float mCohesionDist = 0.0530;
-	float mCohesionMod = 0.0500;
+	FlockingParams mParams;
 
 	int mNumBirds = 56 * 56; // 3136
 	// int mNumBirds = 64 * 64; // 4096
 	// int mNumBirds = 8192; // 4096 * 2
 	int mFboSide;
 
+	// Keeps the flock in the 8 byte per bird PackedBird layout of FlockingKernels.h, in one RG32UI texture, instead
+	// of the position and velocity RGBA32F textures. Set before setup()
+	bool mPackedState = false;
+
 	uint8_t mPosTextureBind = 0;
 	uint8_t mVelTextureBind = 1;
 	uint8_t mCubeMapCameraMatrixBind = 2;
@@ -50,6 +65,14 @@ public:
 
 	ci::gl::GlslProgRef mBirdDisruptProg;
 
+	// The packed state, stepped in one pass. The velocity range is the one the source was packed with
+	ci::gl::FboRef mBirdsSource;
+	ci::gl::FboRef mBirdsDest;
+	float mBirdsVelocityRange = 0.0f;
+	ci::gl::GlslProgRef mBirdPackedUpdateProg;
+	ci::gl::GlslProgRef mBirdPackedDisruptProg;
+	PackedFlockState mPackedReadback;
+
 	ci::gl::VboMeshRef mBirdIndexMesh;
 	ci::gl::GlslProgRef mBirdRenderProg;
 	ci::gl::BatchRef mBirdRenderBatch;
@@ -57,5 +80,26 @@ public:
 	FboCubeMapLayeredRef mCubeMapCamera;
 	ci::gl::UboRef mCubeMapCameraMatrixBuffer;
 
+	// CPU render path, for flocks too big for the geometry shader
+	bool mRenderOnCpu = false;
+	BirdRasterOptions mCpuRasterOptions;
+	BirdRasterizer mCpuRasterizer;
+	FlockState mCpuReadback;
+	ci::gl::TextureCubeMapRef mCpuRenderTex;
+
 	ci::params::InterfaceGlRef mMenu;
+
+	// Rounded up to whole rows of the state texture. The order of that many birds heading every which way reads a few
+	// hundredths above the whole flock's, see telemetry_samples in the shader gate, well under a flock that's lined up
+	int const mTelemetrySampleBirds = 256;
+	ci::gl::PboRef mTelemetryPbo;
+	// The packed samples, unpacked
+	std::vector<ci::vec4> mTelemetryVelocities;
+	bool mTelemetryPending = false;
+	float mTelemetryOrder = 0.0f;
+	float mTelemetryMeanSpeed = 0.0f;
+	float mTelemetryVelocityRange = 0.0f;
+	bool mHasTelemetry = false;
+
+	MemoryAccount mMemory { "Flocking" };
 };
\ No newline at end of file
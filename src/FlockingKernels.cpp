@@ -0,0 +1,331 @@
+#include "FlockingKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "glm/gtc/constants.hpp"
+
+using namespace ci;
+
+namespace {
+	// Unlike the GLSL version this leaves zero vectors alone instead of producing NaNs
+	vec3 limit(vec3 const & v, float lo, float hi) {
+		float len = length(v);
+		if (len <= 0.0f) {
+			return v;
+		}
+		return std::max(lo, std::min(len, hi)) * (v / len);
+	}
+
+	// The packing below is repeated in the FL*Packed*.glsl shaders, keep them in step
+
+	// round() can go either way on ties in GLSL, this is what the shaders do instead
+	float roundHalfUp(float v) {
+		return std::floor(v + 0.5f);
+	}
+
+	float signNotZero(float v) {
+		return v >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	// Projects onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper
+	uint32_t packOctahedral(vec3 const & direction) {
+		float norm = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+		float x = direction.x / norm;
+		float y = direction.y / norm;
+		if (direction.z < 0.0f) {
+			float foldedX = (1.0f - std::abs(y)) * signNotZero(x);
+			y = (1.0f - std::abs(x)) * signNotZero(y);
+			x = foldedX;
+		}
+		uint32_t packedX = (uint32_t) roundHalfUp(std::max(0.0f, std::min(1.0f, x * 0.5f + 0.5f)) * PACKED_UNORM16_MAX);
+		uint32_t packedY = (uint32_t) roundHalfUp(std::max(0.0f, std::min(1.0f, y * 0.5f + 0.5f)) * PACKED_UNORM16_MAX);
+		return packedX | (packedY << 16);
+	}
+
+	// Unfolds the lower half without a branch, which is cheaper in the shaders
+	vec3 unpackOctahedral(uint32_t bits) {
+		float x = (bits & 0xffff) * (2.0f / PACKED_UNORM16_MAX) - 1.0f;
+		float y = (bits >> 16) * (2.0f / PACKED_UNORM16_MAX) - 1.0f;
+		float z = 1.0f - std::abs(x) - std::abs(y);
+		float fold = std::max(-z, 0.0f);
+		x += x >= 0.0f ? -fold : fold;
+		y += y >= 0.0f ? -fold : fold;
+		return normalize(vec3(x, y, z));
+	}
+
+	// A basis of the plane tangent to the unit vector normal with no branch but the hemisphere, from "Building an
+	// Orthonormal Basis, Revisited" (Duff et al. 2017)
+	void getTangentBasis(vec3 const & normal, vec3 & xAxis, vec3 & yAxis) {
+		float sign = signNotZero(normal.z);
+		float a = -1.0f / (sign + normal.z);
+		float b = normal.x * normal.y * a;
+		xAxis = vec3(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+		yAxis = vec3(b, sign + normal.y * normal.y * a, -normal.y);
+	}
+
+	// An 11 bit snorm, stored with an offset so it needs no sign extension
+	uint32_t packVelocityComponent(float v) {
+		return (uint32_t) (roundHalfUp(std::max(-1.0f, std::min(1.0f, v)) * PACKED_VELOCITY_STEPS) + PACKED_VELOCITY_STEPS);
+	}
+
+	// Position is the decoded one, so packing and unpacking use the same basis
+	uint32_t packVelocityPhase(vec3 const & position, vec3 const & velocity, float wingPhase, float velocityRange) {
+		vec3 xAxis, yAxis;
+		getTangentBasis(position, xAxis, yAxis);
+		uint32_t packedX = packVelocityComponent(dot(velocity, xAxis) / velocityRange);
+		uint32_t packedY = packVelocityComponent(dot(velocity, yAxis) / velocityRange);
+		// Wraps around, through the int for negative phases
+		uint32_t packedPhase = (uint32_t) (int32_t) roundHalfUp(wingPhase * (PACKED_PHASE_STEPS / glm::two_pi<float>())) & 0x3ff;
+		return packedX | (packedY << 11) | (packedPhase << 22);
+	}
+
+	vec3 unpackTangent(uint32_t bits, vec3 const & position, float velocityRange) {
+		vec3 xAxis, yAxis;
+		getTangentBasis(position, xAxis, yAxis);
+		float scale = velocityRange / PACKED_VELOCITY_STEPS;
+		float x = ((float) (bits & 0x7ff) - PACKED_VELOCITY_STEPS) * scale;
+		float y = ((float) ((bits >> 11) & 0x7ff) - PACKED_VELOCITY_STEPS) * scale;
+		return x * xAxis + y * yAxis;
+	}
+
+	float unpackPhase(uint32_t bits) {
+		return (bits >> 22) * (glm::two_pi<float>() / PACKED_PHASE_STEPS);
+	}
+
+	// Flocks are read through a view with getNumBirds(), getPosition(idx) and getVelocity(idx, position), so the same
+	// search runs on the plain and the packed state
+	template <typename FlockView>
+	vec3 flockAccel(FlockView const & flock, vec3 const & selfPos, vec3 const & selfVel, FlockingParams const & params) {
+		vec3 sepSteer(0);
+		int separationNeighbors = 0;
+
+		vec3 alignSteer(0);
+		int alignNeighbors = 0;
+
+		vec3 cohesionPosition(0);
+		int cohesionNeighbors = 0;
+
+		size_t numBirds = flock.getNumBirds();
+		for (size_t idx = 0; idx < numBirds; idx++) {
+			vec3 otherPos = flock.getPosition(idx);
+			float dist = length(otherPos - selfPos);
+
+			if (dist <= FLOCK_SELF_EPSILON) {
+				continue;
+			}
+
+			if (dist < params.mSeparationDist) {
+				sepSteer += normalize(selfPos - otherPos) / dist;
+				separationNeighbors++;
+			}
+
+			if (dist < params.mAlignDist) {
+				alignSteer += flock.getVelocity(idx, otherPos);
+				alignNeighbors++;
+			}
+
+			if (dist < params.mCohesionDist) {
+				cohesionPosition += otherPos;
+				cohesionNeighbors++;
+			}
+		}
+
+		if (separationNeighbors > 0) {
+			sepSteer /= (float) separationNeighbors;
+			if (length(sepSteer) > 0) {
+				sepSteer = normalize(sepSteer) - selfVel;
+				sepSteer = limit(sepSteer, params.mMinForce, params.mMaxForce);
+			}
+		}
+
+		if (alignNeighbors > 0) {
+			alignSteer /= (float) alignNeighbors;
+			alignSteer = normalize(alignSteer) - selfVel;
+			alignSteer = limit(alignSteer, params.mMinForce, params.mMaxForce);
+		}
+
+		vec3 cohesionSteer(0);
+		if (cohesionNeighbors > 0) {
+			cohesionPosition /= (float) cohesionNeighbors;
+			cohesionSteer = normalize(cohesionPosition - selfPos) - selfVel;
+			cohesionSteer = limit(cohesionSteer, params.mMinForce, params.mMaxForce);
+		}
+
+		return sepSteer * params.mSeparationMod + alignSteer * params.mAlignMod + cohesionSteer * params.mCohesionMod;
+	}
+
+	struct PlainFlockView {
+		FlockState const & mFlock;
+
+		size_t getNumBirds() const { return mFlock.mPositions.size(); }
+		vec3 getPosition(size_t idx) const { return vec3(mFlock.mPositions[idx]); }
+		vec3 getVelocity(size_t idx, vec3 const &) const { return vec3(mFlock.mVelocities[idx]); }
+	};
+
+	// Positions come unpacked once a step, the search reads every one for every bird. Velocities are only unpacked for
+	// the few birds close enough to align with
+	struct PackedFlockView {
+		PackedFlockState const & mFlock;
+		std::vector<vec3> const & mPositions;
+
+		size_t getNumBirds() const { return mPositions.size(); }
+		vec3 getPosition(size_t idx) const { return mPositions[idx]; }
+		vec3 getVelocity(size_t idx, vec3 const & position) const {
+			return unpackTangent(mFlock.mBirds[idx].mVelocityPhase, position, mFlock.mVelocityRange);
+		}
+	};
+
+	// Same random starting state as FlockingApp::setup(), from either generator
+	template <typename RandT>
+	void setupFlockFrom(FlockState & flock, int numBirds, RandT & rand) {
+		flock.mPositions.resize(numBirds);
+		flock.mVelocities.resize(numBirds);
+
+		for (int idx = 0; idx < numBirds; idx++) {
+			vec3 pos = rand.nextVec3();
+			flock.mPositions[idx] = vec4(pos, rand.nextFloat(glm::two_pi<float>()));
+
+			// Projects the velocity to a plane tangent to the unit sphere
+			vec3 vel = rand.nextVec3();
+			vel = 0.001f * normalize(vel - dot(vel, pos) * pos);
+			flock.mVelocities[idx] = vec4(vel, 0);
+		}
+	}
+}
+
+void setupFlock(FlockState & flock, int numBirds, Rand & rand) {
+	setupFlockFrom(flock, numBirds, rand);
+}
+
+void setupFlock(FlockState & flock, int numBirds, SimRandom & rand) {
+	setupFlockFrom(flock, numBirds, rand);
+}
+
+void stepFlock(FlockState const & src, FlockState & dst, FlockingParams const & params, size_t begin, size_t end) {
+	for (size_t idx = begin; idx < end; idx++) {
+		vec4 pos = src.mPositions[idx];
+		vec3 selfPos = vec3(pos);
+		vec3 vel = vec3(src.mVelocities[idx]);
+
+		vec3 newVel = vel + flockAccel(PlainFlockView { src }, selfPos, vel, params);
+		// Project the velocity so it's tangent to the sphere
+		newVel = newVel - dot(newVel, selfPos) * normalize(selfPos);
+		newVel = limit(newVel, params.mMinSpeed, params.mMaxSpeed);
+		dst.mVelocities[idx] = vec4(newVel, 1);
+
+		// Make sure the position always stays normalized onto the sphere
+		dst.mPositions[idx] = vec4(normalize(selfPos + vel), pos.w + params.mFlapSpeed);
+	}
+}
+
+void stepFlock(FlockState const & src, FlockState & dst, FlockingParams const & params) {
+	dst.mPositions.resize(src.mPositions.size());
+	dst.mVelocities.resize(src.mVelocities.size());
+	stepFlock(src, dst, params, 0, src.mPositions.size());
+}
+
+void disruptFlock(FlockState & flock, vec3 const & point, float maxSpeed) {
+	for (size_t idx = 0; idx < flock.mPositions.size(); idx++) {
+		vec3 pos = vec3(flock.mPositions[idx]);
+		vec3 fleeVec = pos - point;
+
+		if (length(fleeVec) < FLOCK_DISRUPT_RADIUS) {
+			vec3 tangentFlee = fleeVec - dot(fleeVec, pos) * normalize(pos);
+			flock.mVelocities[idx] = vec4(maxSpeed * normalize(tangentFlee), 1);
+		}
+	}
+}
+
+void measureFlock(vec4 const * velocities, size_t numBirds, float & order, float & meanSpeed) {
+	vec3 sumVel(0.0f);
+	float sumSpeed = 0.0f;
+	for (size_t idx = 0; idx < numBirds; idx++) {
+		vec3 vel = vec3(velocities[idx]);
+		sumVel += vel;
+		sumSpeed += length(vel);
+	}
+
+	order = sumSpeed > 0.0f ? length(sumVel) / sumSpeed : 0.0f;
+	meanSpeed = numBirds > 0 ? sumSpeed / numBirds : 0.0f;
+}
+
+PackedBird packBird(vec3 const & position, vec3 const & velocity, float wingPhase, float velocityRange) {
+	PackedBird bird;
+	bird.mPosition = packOctahedral(position);
+	bird.mVelocityPhase = packVelocityPhase(unpackOctahedral(bird.mPosition), velocity, wingPhase, velocityRange);
+	return bird;
+}
+
+void unpackBird(PackedBird bird, float velocityRange, vec3 & position, vec3 & velocity, float & wingPhase) {
+	position = unpackOctahedral(bird.mPosition);
+	velocity = unpackTangent(bird.mVelocityPhase, position, velocityRange);
+	wingPhase = unpackPhase(bird.mVelocityPhase);
+}
+
+void packFlock(FlockState const & flock, PackedFlockState & packed, float velocityRange) {
+	packed.mBirds.resize(flock.mPositions.size());
+	packed.mVelocityRange = velocityRange;
+	for (size_t idx = 0; idx < packed.mBirds.size(); idx++) {
+		vec4 const & pos = flock.mPositions[idx];
+		packed.mBirds[idx] = packBird(vec3(pos), vec3(flock.mVelocities[idx]), pos.w, velocityRange);
+	}
+}
+
+void unpackFlock(PackedFlockState const & packed, FlockState & flock) {
+	flock.mPositions.resize(packed.mBirds.size());
+	flock.mVelocities.resize(packed.mBirds.size());
+	for (size_t idx = 0; idx < packed.mBirds.size(); idx++) {
+		vec3 pos, vel;
+		float wingPhase;
+		unpackBird(packed.mBirds[idx], packed.mVelocityRange, pos, vel, wingPhase);
+		flock.mPositions[idx] = vec4(pos, wingPhase);
+		flock.mVelocities[idx] = vec4(vel, 1);
+	}
+}
+
+void unpackFlockPositions(PackedFlockState const & flock, std::vector<vec3> & positions) {
+	positions.resize(flock.mBirds.size());
+	for (size_t idx = 0; idx < positions.size(); idx++) {
+		positions[idx] = unpackOctahedral(flock.mBirds[idx].mPosition);
+	}
+}
+
+void stepPackedFlock(PackedFlockState const & src, std::vector<vec3> const & positions, PackedFlockState & dst,
+	FlockingParams const & params, size_t begin, size_t end)
+{
+	PackedFlockView view { src, positions };
+	for (size_t idx = begin; idx < end; idx++) {
+		vec3 selfPos = positions[idx];
+		vec3 vel = unpackTangent(src.mBirds[idx].mVelocityPhase, selfPos, src.mVelocityRange);
+		float wingPhase = unpackPhase(src.mBirds[idx].mVelocityPhase);
+
+		vec3 newVel = vel + flockAccel(view, selfPos, vel, params);
+		newVel = newVel - dot(newVel, selfPos) * normalize(selfPos);
+		newVel = limit(newVel, params.mMinSpeed, params.mMaxSpeed);
+
+		dst.mBirds[idx] = packBird(normalize(selfPos + vel), newVel, wingPhase + params.mFlapSpeed, dst.mVelocityRange);
+	}
+}
+
+void stepPackedFlock(PackedFlockState const & src, PackedFlockState & dst, FlockingParams const & params, std::vector<vec3> & positions) {
+	unpackFlockPositions(src, positions);
+	dst.mBirds.resize(src.mBirds.size());
+	dst.mVelocityRange = getPackedVelocityRange(params);
+	stepPackedFlock(src, positions, dst, params, 0, src.mBirds.size());
+}
+
+void disruptPackedFlock(PackedFlockState & flock, vec3 const & point, float maxSpeed) {
+	for (PackedBird & bird : flock.mBirds) {
+		vec3 pos, vel;
+		float wingPhase;
+		unpackBird(bird, flock.mVelocityRange, pos, vel, wingPhase);
+		vec3 fleeVec = pos - point;
+
+		// Only the velocity is packed again, the position stays exactly where it was
+		if (length(fleeVec) < FLOCK_DISRUPT_RADIUS) {
+			vec3 tangentFlee = fleeVec - dot(fleeVec, pos) * normalize(pos);
+			bird.mVelocityPhase = packVelocityPhase(pos, maxSpeed * normalize(tangentFlee), wingPhase, flock.mVelocityRange);
+		}
+	}
+}
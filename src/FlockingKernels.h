@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/Vector.h"
+#include "cinder/Rand.h"
+
+#include "SimRandom.h"
+
+// Tunable flocking behaviour, shared by the GPU simulation and the CPU kernels below
+struct FlockingParams {
+	float mMinSpeed = 0.0030;
+	float mMaxSpeed = 0.0080;
+
+	float mMinForce = 0.0000;
+	float mMaxForce = 0.0010;
+
+	float mSeparationDist = 0.0450;
+	float mSeparationMod = 0.2203;
+	float mAlignDist = 0.0600;
+	float mAlignMod = 0.0500;
+	float mCohesionDist = 0.0530;
+	float mCohesionMod = 0.0500;
+
+	// uFlapSpeed in FLRunBirdsPosition_f.glsl and FLRunBirdsPacked_f.glsl
+	float mFlapSpeed = 0.40;
+};
+
+// Constants the FL*.glsl shaders #define as well, bench/ShaderGate.cpp checks they still agree
+float const FLOCK_SELF_EPSILON = 0.0000001f;
+float const FLOCK_DISRUPT_RADIUS = 0.45f;
+
+// CPU copy of the flock, in the same layout as FlockingApp's position and velocity textures
+struct FlockState {
+	// xyz is a unit position on the sphere, w the wing phase
+	std::vector<ci::vec4> mPositions;
+	// xyz is a velocity tangent to the sphere, w is unused
+	std::vector<ci::vec4> mVelocities;
+};
+
+// Same random starting state as FlockingApp::setup()
+void setupFlock(FlockState & flock, int numBirds, ci::Rand & rand);
+// The same from SimRandom, which gives the same flock on every platform
+void setupFlock(FlockState & flock, int numBirds, SimRandom & rand);
+
+// One simulation step from src into dst, the same brute force all-pairs search as FLRunBirdsVelocity_f.glsl and
+// FLRunBirdsPosition_f.glsl. Like the shaders, both the new positions and velocities are computed from the old state.
+// Only birds [begin, end) of dst are written, so the work can be split up.
+void stepFlock(FlockState const & src, FlockState & dst, FlockingParams const & params, size_t begin, size_t end);
+void stepFlock(FlockState const & src, FlockState & dst, FlockingParams const & params);
+
+// Same as FLDisruptBirds_f.glsl, point has to be normalized
+void disruptFlock(FlockState & flock, ci::vec3 const & point, float maxSpeed);
+
+// Alignment and mean speed of the flock, for telemetry, from velocities in the FlockState layout. Order is
+// |sum of velocities| / sum of speeds
+void measureFlock(ci::vec4 const * velocities, size_t numBirds, float & order, float & meanSpeed);
+
+// A bird in 8 bytes instead of FlockState's 32, the layout of FlockingApp's packed state texture (RG32UI)
+struct PackedBird {
+	// Octahedral position, x in the low 16 bits and y in the high, as unorms
+	uint32_t mPosition;
+	// Velocity as x and y in a tangent basis at the decoded position, 11 bits each in units of the velocity range,
+	// then the wing phase in the top 10 bits
+	uint32_t mVelocityPhase;
+};
+
+// Quantization of the packed layout, the same in the FL*Packed*.glsl shaders
+float const PACKED_UNORM16_MAX = 65535.0f;
+float const PACKED_VELOCITY_STEPS = 1023.0f;
+float const PACKED_PHASE_STEPS = 1024.0f;
+
+// The whole flock packed. Decoding takes the velocity range it was packed with
+struct PackedFlockState {
+	std::vector<PackedBird> mBirds;
+	float mVelocityRange = 0.0f;
+};
+
+// Worst case errors of a pack and unpack: the angle between the positions in radians, the velocity error as a
+// fraction of the velocity range, and the wing phase error in radians. The regression gate holds the encoding to them
+float const PACKED_POSITION_ERROR = 0.00007f;
+float const PACKED_VELOCITY_ERROR = 0.0008f;
+float const PACKED_PHASE_ERROR = 0.0031f;
+
+// No speed the params allow gets clamped
+inline float getPackedVelocityRange(FlockingParams const & params) { return std::max(params.mMinSpeed, params.mMaxSpeed); }
+
+PackedBird packBird(ci::vec3 const & position, ci::vec3 const & velocity, float wingPhase, float velocityRange);
+// The wing phase comes back in [0, 2 pi), which is all the render shader and BirdRasterizer look at
+void unpackBird(PackedBird bird, float velocityRange, ci::vec3 & position, ci::vec3 & velocity, float & wingPhase);
+
+void packFlock(FlockState const & flock, PackedFlockState & packed, float velocityRange);
+void unpackFlock(PackedFlockState const & packed, FlockState & flock);
+
+// The search reads every bird's position for every bird, so on the CPU they're unpacked once a step
+void unpackFlockPositions(PackedFlockState const & flock, std::vector<ci::vec3> & positions);
+
+// stepFlock() on the packed state, the same as FLRunBirdsPacked_f.glsl, with src's positions from unpackFlockPositions().
+// dst is packed with its own velocity range, which the first version leaves to the caller. The wing phase is rounded
+// every step, so it advances by a multiple of 2 pi / 1024 (0.3988 a step for the default 0.40)
+void stepPackedFlock(PackedFlockState const & src, std::vector<ci::vec3> const & positions, PackedFlockState & dst,
+	FlockingParams const & params, size_t begin, size_t end);
+// Unpacks the positions into the scratch space given
+void stepPackedFlock(PackedFlockState const & src, PackedFlockState & dst, FlockingParams const & params, std::vector<ci::vec3> & positions);
+
+// Same as disruptFlock(), and FLDisruptBirdsPacked_f.glsl
+void disruptPackedFlock(PackedFlockState & flock, ci::vec3 const & point, float maxSpeed);
@@ -0,0 +1,219 @@
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <thread>
+
+using namespace ci;
+using std::vector;
+
+namespace {
+	uint32_t getThreadTag() {
+		return (uint32_t) std::hash<std::thread::id>()(std::this_thread::get_id());
+	}
+
+	double percentile(vector<double> & sortedValues, double pct) {
+		if (sortedValues.empty()) {
+			return 0.0;
+		}
+		size_t rank = (size_t) std::ceil(pct / 100.0 * sortedValues.size());
+		return sortedValues[std::min(sortedValues.size(), std::max<size_t>(rank, 1)) - 1];
+	}
+}
+
+FrameProfiler::ScopedStage::ScopedStage(FrameProfiler & profiler, char const * stage, bool timeGpu) : mProfiler(profiler), mGpuStartQuery(0) {
+	mSample.mStage = stage;
+	mSample.mFrame = profiler.mFrame;
+	mSample.mThread = getThreadTag();
+	mSample.mGpuStartNs = -1;
+	mSample.mGpuEndNs = -1;
+
+	if (timeGpu && profiler.mGpuTimingSupported) {
+		mGpuStartQuery = profiler.acquireQuery();
+		glQueryCounter(mGpuStartQuery, GL_TIMESTAMP);
+	}
+
+	mSample.mCpuStartNs = profiler.getNowNs();
+}
+
+FrameProfiler::ScopedStage::~ScopedStage() {
+	mSample.mCpuEndNs = mProfiler.getNowNs();
+
+	if (mGpuStartQuery) {
+		// The GPU times get filled in by beginFrame() a frame or two later, once the queries have results
+		GLuint endQuery = mProfiler.acquireQuery();
+		glQueryCounter(endQuery, GL_TIMESTAMP);
+		mProfiler.mPendingGpuSamples.push_back({ mSample, mGpuStartQuery, endQuery });
+	} else {
+		mProfiler.record(mSample);
+	}
+}
+
+FrameProfiler::FrameProfiler(size_t capacity) : mEpoch(std::chrono::steady_clock::now()), mWriteIndex(0) {
+	mCapacity = 1;
+	while (mCapacity < capacity) {
+		mCapacity <<= 1;
+	}
+
+	mSlots.reset(new Slot[mCapacity]);
+	for (size_t idx = 0; idx < mCapacity; idx++) {
+		mSlots[idx].mSequence.store(0, std::memory_order_relaxed);
+	}
+}
+
+FrameProfiler::~FrameProfiler() {
+	// Queries are only ever created once beginFrame() has run, i.e. with a GL context around
+	for (auto & pending : mPendingGpuSamples) {
+		mFreeQueries.push_back(pending.mStartQuery);
+		mFreeQueries.push_back(pending.mEndQuery);
+	}
+	if (!mFreeQueries.empty()) {
+		glDeleteQueries(mFreeQueries.size(), mFreeQueries.data());
+	}
+}
+
+int64_t FrameProfiler::getNowNs() const {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mEpoch).count();
+}
+
+GLuint FrameProfiler::acquireQuery() {
+	if (mFreeQueries.empty()) {
+		GLuint query;
+		glGenQueries(1, & query);
+		return query;
+	}
+
+	GLuint query = mFreeQueries.back();
+	mFreeQueries.pop_back();
+	return query;
+}
+
+void FrameProfiler::beginFrame() {
+	// Timestamp queries are core since GL 3.3, which every context this app runs on has
+	mGpuTimingSupported = true;
+	mFrame++;
+
+	// Keep the GPU clock lined up with the CPU one, so both can share a timeline in the trace
+	GLint64 gpuNowNs;
+	glGetInteger64v(GL_TIMESTAMP, & gpuNowNs);
+	mGpuToCpuOffsetNs = getNowNs() - gpuNowNs;
+
+	// Queries finish in the order they were issued, so stop at the first one that isn't done yet
+	size_t numResolved = 0;
+	for (auto & pending : mPendingGpuSamples) {
+		GLint available = 0;
+		glGetQueryObjectiv(pending.mEndQuery, GL_QUERY_RESULT_AVAILABLE, & available);
+		if (!available) {
+			break;
+		}
+
+		GLuint64 gpuStartNs, gpuEndNs;
+		glGetQueryObjectui64v(pending.mStartQuery, GL_QUERY_RESULT, & gpuStartNs);
+		glGetQueryObjectui64v(pending.mEndQuery, GL_QUERY_RESULT, & gpuEndNs);
+
+		pending.mSample.mGpuStartNs = (int64_t) gpuStartNs + mGpuToCpuOffsetNs;
+		pending.mSample.mGpuEndNs = (int64_t) gpuEndNs + mGpuToCpuOffsetNs;
+		record(pending.mSample);
+
+		mFreeQueries.push_back(pending.mStartQuery);
+		mFreeQueries.push_back(pending.mEndQuery);
+		numResolved++;
+	}
+
+	mPendingGpuSamples.erase(mPendingGpuSamples.begin(), mPendingGpuSamples.begin() + numResolved);
+}
+
+void FrameProfiler::record(Sample const & sample) {
+	uint64_t index = mWriteIndex.fetch_add(1, std::memory_order_relaxed);
+	Slot & slot = mSlots[index & (mCapacity - 1)];
+
+	slot.mSequence.store(2 * index + 1, std::memory_order_release);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.mSample = sample;
+	slot.mSequence.store(2 * index + 2, std::memory_order_release);
+}
+
+vector<FrameProfiler::Sample> FrameProfiler::getSamples() const {
+	uint64_t end = mWriteIndex.load(std::memory_order_acquire);
+	uint64_t begin = end > mCapacity ? end - mCapacity : 0;
+
+	vector<Sample> samples;
+	samples.reserve(end - begin);
+
+	for (uint64_t index = begin; index < end; index++) {
+		Slot const & slot = mSlots[index & (mCapacity - 1)];
+
+		uint64_t before = slot.mSequence.load(std::memory_order_acquire);
+		Sample sample = slot.mSample;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t after = slot.mSequence.load(std::memory_order_relaxed);
+
+		// Skip slots that were mid-write, or already overwritten by a newer sample
+		if (before == after && before == 2 * index + 2) {
+			samples.push_back(sample);
+		}
+	}
+
+	return samples;
+}
+
+void FrameProfiler::writeChromeTrace(fs::path const & path) const {
+	auto samples = getSamples();
+
+	std::ofstream out(path.string(), std::ios::trunc);
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+
+	for (auto & sample : samples) {
+		out << ",\n{\"name\":\"" << sample.mStage << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << sample.mThread
+			<< ",\"ts\":" << sample.mCpuStartNs / 1000.0 << ",\"dur\":" << (sample.mCpuEndNs - sample.mCpuStartNs) / 1000.0
+			<< ",\"args\":{\"frame\":" << sample.mFrame << "}}";
+
+		if (sample.mGpuStartNs >= 0) {
+			out << ",\n{\"name\":\"" << sample.mStage << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":0"
+				<< ",\"ts\":" << sample.mGpuStartNs / 1000.0 << ",\"dur\":" << (sample.mGpuEndNs - sample.mGpuStartNs) / 1000.0
+				<< ",\"args\":{\"frame\":" << sample.mFrame << "}}";
+		}
+	}
+
+	out << "\n]}\n";
+}
+
+std::string FrameProfiler::getSummary() const {
+	auto samples = getSamples();
+
+	std::map<std::string, vector<double>> cpuMs;
+	std::map<std::string, vector<double>> gpuMs;
+	for (auto & sample : samples) {
+		cpuMs[sample.mStage].push_back((sample.mCpuEndNs - sample.mCpuStartNs) / 1.0e6);
+		if (sample.mGpuStartNs >= 0) {
+			gpuMs[sample.mStage].push_back((sample.mGpuEndNs - sample.mGpuStartNs) / 1.0e6);
+		}
+	}
+
+	std::ostringstream summary;
+	summary << std::fixed << std::setprecision(3);
+	summary << "Frame stages over " << samples.size() << " samples (ms, p50 / p95 / p99):";
+
+	for (auto & stage : cpuMs) {
+		auto & cpu = stage.second;
+		std::sort(cpu.begin(), cpu.end());
+		summary << "\n  " << std::setw(32) << std::left << stage.first << " n " << std::setw(6) << cpu.size()
+			<< " cpu " << percentile(cpu, 50) << " / " << percentile(cpu, 95) << " / " << percentile(cpu, 99);
+
+		auto gpuIt = gpuMs.find(stage.first);
+		if (gpuIt != gpuMs.end()) {
+			auto & gpu = gpuIt->second;
+			std::sort(gpu.begin(), gpu.end());
+			summary << "   gpu " << percentile(gpu, 50) << " / " << percentile(gpu, 95) << " / " << percentile(gpu, 99);
+		}
+	}
+
+	return summary.str();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/gl/gl.h"
+#include "cinder/Filesystem.h"
+
+// Per-stage frame timing. Stages are timed on the CPU and, for stages issued from the GL thread, on the GPU with
+// timestamp queries. Finished samples go into a fixed size lock-free ring, so recording never allocates or blocks,
+// and the ring can be dumped as Chrome trace-event JSON (load it in chrome://tracing) or summarized as percentiles.
+class FrameProfiler {
+public:
+	struct Sample {
+		// Must point to a string literal, samples only keep the pointer
+		char const * mStage;
+		uint32_t mFrame;
+		uint32_t mThread;
+		int64_t mCpuStartNs;
+		int64_t mCpuEndNs;
+		// Both -1 when the stage had no GPU timing
+		int64_t mGpuStartNs;
+		int64_t mGpuEndNs;
+	};
+
+	// Times a stage for as long as it's in scope
+	class ScopedStage {
+	public:
+		ScopedStage(FrameProfiler & profiler, char const * stage, bool timeGpu = true);
+		~ScopedStage();
+
+	private:
+		FrameProfiler & mProfiler;
+		Sample mSample;
+		GLuint mGpuStartQuery;
+	};
+
+	// Capacity is rounded up to a power of two
+	explicit FrameProfiler(size_t capacity = 1 << 16);
+	~FrameProfiler();
+
+	// Call once per frame on the GL thread. Collects GPU timings that have become available since the last frame
+	void beginFrame();
+	uint32_t getFrame() const { return mFrame; }
+
+	// Thread safe, from any number of threads
+	void record(Sample const & sample);
+
+	// Copies out the samples still in the ring, oldest first
+	std::vector<Sample> getSamples() const;
+
+	void writeChromeTrace(ci::fs::path const & path) const;
+	// p50/p95/p99 of the CPU and GPU time of every stage in the ring
+	std::string getSummary() const;
+
+	int64_t getNowNs() const;
+
+private:
+	struct Slot {
+		// Odd while the slot is being written, so readers can skip torn samples
+		std::atomic<uint64_t> mSequence;
+		Sample mSample;
+	};
+
+	struct PendingGpuSample {
+		Sample mSample;
+		GLuint mStartQuery;
+		GLuint mEndQuery;
+	};
+
+	GLuint acquireQuery();
+
+	std::chrono::steady_clock::time_point mEpoch;
+	uint32_t mFrame = 0;
+
+	std::unique_ptr<Slot[]> mSlots;
+	size_t mCapacity;
+	std::atomic<uint64_t> mWriteIndex;
+
+	// GL thread only
+	bool mGpuTimingSupported = false;
+	int64_t mGpuToCpuOffsetNs = 0;
+	std::vector<GLuint> mFreeQueries;
+	std::vector<PendingGpuSample> mPendingGpuSamples;
+};
@@ -0,0 +1,226 @@
+#include "FrameStream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "cinder/Log.h"
+
+#include "ByteCodec.h"
+#include "Sockets.h"
+#include "TaskScheduler.h"
+
+using std::vector;
+
+namespace {
+	uint32_t const BYTES_PER_PIXEL = 4;
+
+	// Far past the 6144 x 1024 strip, but small enough that a corrupt header can't make a receiver allocate gigabytes
+	size_t const MAX_FRAME_BYTES = 256 * 1024 * 1024;
+
+	// Once a message has started, the rest of it has this long to arrive
+	double const MESSAGE_BODY_TIMEOUT_SECONDS = 10.0;
+
+	// Scratch space for a tile's bytes on each thread that can run a slot of parallelFor
+	void reserveTileScratch(vector<vector<uint8_t>> & scratch, size_t maxThreads, int tileSide) {
+		size_t numSlots = std::max<size_t>(1, std::min(maxThreads, (size_t) TaskScheduler::get().getConcurrency()));
+		scratch.resize(std::max(scratch.size(), numSlots));
+		for (auto & tile : scratch) {
+			tile.resize((size_t) tileSide * tileSide * BYTES_PER_PIXEL);
+		}
+	}
+}
+
+FrameTileEncoder::FrameTileEncoder(int width, int height, int tileSide) :
+	mWidth(width), mHeight(height), mTileSide(tileSide),
+	mTilesWide((width + tileSide - 1) / tileSide), mTilesHigh((height + tileSide - 1) / tileSide),
+	mPrevious((size_t) width * height * BYTES_PER_PIXEL, 0), mRowMessages(mTilesHigh), mRowChangedTiles(mTilesHigh, 0)
+{}
+
+void FrameTileEncoder::encode(uint8_t const * pixels, size_t rowBytes, vector<uint8_t> & message, size_t maxThreads) {
+	bool const keyFrame = mKeyFrameRequested;
+	mKeyFrameRequested = false;
+	if (keyFrame) {
+		std::fill(mPrevious.begin(), mPrevious.end(), 0);
+	}
+
+	reserveTileScratch(mTileScratch, maxThreads, mTileSide);
+	size_t const previousRowBytes = (size_t) mWidth * BYTES_PER_PIXEL;
+
+	// A row of tiles to a task, so each writes its own part of the message and the tiles stay in order
+	TaskScheduler::get().parallelFor(mTilesHigh, maxThreads, [&] (size_t tileRow, size_t slot) {
+		vector<uint8_t> & out = mRowMessages[tileRow];
+		uint8_t * scratch = mTileScratch[slot].data();
+		out.clear();
+		mRowChangedTiles[tileRow] = 0;
+
+		int const top = (int) tileRow * mTileSide;
+		int const height = std::min(mTileSide, mHeight - top);
+		for (int tileCol = 0; tileCol < mTilesWide; tileCol++) {
+			int const left = tileCol * mTileSide;
+			size_t const tileRowBytes = (size_t) std::min(mTileSide, mWidth - left) * BYTES_PER_PIXEL;
+			auto getCurrent = [&] (int row) { return pixels + (top + row) * rowBytes + left * BYTES_PER_PIXEL; };
+			auto getPrevious = [&] (int row) { return mPrevious.data() + (top + row) * previousRowBytes + left * BYTES_PER_PIXEL; };
+
+			int row = 0;
+			while (row < height && std::memcmp(getCurrent(row), getPrevious(row), tileRowBytes) == 0) {
+				row++;
+			}
+			if (row == height) {
+				continue;
+			}
+
+			for (row = 0; row < height; row++) {
+				uint8_t const * current = getCurrent(row);
+				uint8_t * previous = getPrevious(row);
+				uint8_t * delta = scratch + row * tileRowBytes;
+				for (size_t idx = 0; idx < tileRowBytes; idx++) {
+					delta[idx] = current[idx] ^ previous[idx];
+				}
+				std::memcpy(previous, current, tileRowBytes);
+			}
+
+			size_t headerAt = out.size();
+			out.resize(headerAt + sizeof(FrameTileHeader));
+			encodeBytes(scratch, tileRowBytes * height, BYTES_PER_PIXEL, out);
+
+			FrameTileHeader tile;
+			tile.mTileIndex = (uint32_t) (tileRow * mTilesWide + tileCol);
+			tile.mEncodedSize = (uint32_t) (out.size() - headerAt - sizeof(FrameTileHeader));
+			std::memcpy(out.data() + headerAt, & tile, sizeof(tile));
+			mRowChangedTiles[tileRow]++;
+		}
+	});
+
+	FrameHeader header;
+	header.mMagic = FrameHeader::MAGIC;
+	header.mFrameIndex = mFrameIndex++;
+	header.mWidth = mWidth;
+	header.mHeight = mHeight;
+	header.mTileSide = mTileSide;
+	header.mFlags = keyFrame ? FrameHeader::KEY_FRAME : 0;
+	header.mNumTiles = 0;
+	header.mPayloadSize = 0;
+	for (int tileRow = 0; tileRow < mTilesHigh; tileRow++) {
+		header.mNumTiles += mRowChangedTiles[tileRow];
+		header.mPayloadSize += (uint32_t) mRowMessages[tileRow].size();
+	}
+	mNumChangedTiles = header.mNumTiles;
+
+	message.resize(sizeof(header) + header.mPayloadSize);
+	std::memcpy(message.data(), & header, sizeof(header));
+	size_t offset = sizeof(header);
+	for (auto const & rowMessage : mRowMessages) {
+		if (!rowMessage.empty()) {
+			std::memcpy(message.data() + offset, rowMessage.data(), rowMessage.size());
+			offset += rowMessage.size();
+		}
+	}
+}
+
+bool FrameTileDecoder::decode(uint8_t const * message, size_t size, size_t maxThreads) {
+	FrameHeader header;
+	if (size < sizeof(header)) {
+		CI_LOG_W("Frame message is too short");
+		return false;
+	}
+	std::memcpy(& header, message, sizeof(header));
+
+	size_t const frameBytes = (size_t) header.mWidth * header.mHeight * BYTES_PER_PIXEL;
+	if (header.mMagic != FrameHeader::MAGIC || header.mPayloadSize != size - sizeof(header) || header.mTileSide == 0
+		|| frameBytes == 0 || frameBytes > MAX_FRAME_BYTES)
+	{
+		CI_LOG_W("Frame message header is corrupt");
+		mHasFrame = false;
+		return false;
+	}
+
+	bool const keyFrame = (header.mFlags & FrameHeader::KEY_FRAME) != 0;
+	if (keyFrame) {
+		mWidth = header.mWidth;
+		mHeight = header.mHeight;
+		mTileSide = header.mTileSide;
+		mFrame.assign(frameBytes, 0);
+	} else if (!mHasFrame || header.mWidth != (uint32_t) mWidth || header.mHeight != (uint32_t) mHeight
+		|| header.mTileSide != (uint32_t) mTileSide || header.mFrameIndex != mFrameIndex + 1)
+	{
+		// Quietly, since every delta frame until the next key frame ends up here
+		mHasFrame = false;
+		return false;
+	}
+
+	// Tiles come in increasing order, which also means no two of them write the same pixels
+	int const tilesWide = (mWidth + mTileSide - 1) / mTileSide;
+	uint32_t const numTiles = (uint32_t) (tilesWide * ((mHeight + mTileSide - 1) / mTileSide));
+	mTiles.clear();
+	size_t offset = sizeof(header);
+	for (uint32_t idx = 0; idx < header.mNumTiles; idx++) {
+		FrameTileHeader tile;
+		if (size - offset < sizeof(tile)) {
+			break;
+		}
+		std::memcpy(& tile, message + offset, sizeof(tile));
+		offset += sizeof(tile);
+		if (tile.mEncodedSize > size - offset || tile.mTileIndex >= numTiles
+			|| (!mTiles.empty() && tile.mTileIndex <= mTiles.back().mTileIndex))
+		{
+			break;
+		}
+		mTiles.push_back({ tile.mTileIndex, tile.mEncodedSize, message + offset });
+		offset += tile.mEncodedSize;
+	}
+	if (mTiles.size() != header.mNumTiles || offset != size) {
+		CI_LOG_W("Frame message tiles are corrupt");
+		mHasFrame = false;
+		return false;
+	}
+
+	reserveTileScratch(mTileScratch, maxThreads, mTileSide);
+	size_t const frameRowBytes = (size_t) mWidth * BYTES_PER_PIXEL;
+	std::atomic<bool> corrupt(false);
+
+	TaskScheduler::get().parallelFor(mTiles.size(), maxThreads, [&] (size_t idx, size_t slot) {
+		TileEntry const & tile = mTiles[idx];
+		int const top = (int) (tile.mTileIndex / tilesWide) * mTileSide;
+		int const left = (int) (tile.mTileIndex % tilesWide) * mTileSide;
+		int const height = std::min(mTileSide, mHeight - top);
+		size_t const tileRowBytes = (size_t) std::min(mTileSide, mWidth - left) * BYTES_PER_PIXEL;
+
+		uint8_t * delta = mTileScratch[slot].data();
+		if (!decodeBytes(tile.mEncoded, tile.mEncodedSize, delta, tileRowBytes * height, BYTES_PER_PIXEL)) {
+			corrupt = true;
+			return;
+		}
+		for (int row = 0; row < height; row++) {
+			uint8_t * pixels = mFrame.data() + (top + row) * frameRowBytes + left * BYTES_PER_PIXEL;
+			for (size_t byte = 0; byte < tileRowBytes; byte++) {
+				pixels[byte] ^= delta[row * tileRowBytes + byte];
+			}
+		}
+	});
+
+	if (corrupt) {
+		CI_LOG_W("Frame message tile doesn't decode");
+		mHasFrame = false;
+		return false;
+	}
+
+	mFrameIndex = header.mFrameIndex;
+	mHasFrame = true;
+	return true;
+}
+
+bool receiveFrameMessage(int fd, vector<uint8_t> & message, double timeoutSeconds) {
+	FrameHeader header;
+	if (!receiveAll(fd, & header, sizeof(header), timeoutSeconds)) {
+		return false;
+	}
+	if (header.mMagic != FrameHeader::MAGIC || header.mPayloadSize > MAX_FRAME_BYTES) {
+		CI_LOG_E("Frame stream is out of step, or not a frame stream");
+		return false;
+	}
+
+	message.resize(sizeof(header) + header.mPayloadSize);
+	std::memcpy(message.data(), & header, sizeof(header));
+	return receiveAll(fd, message.data() + sizeof(header), header.mPayloadSize, MESSAGE_BODY_TIMEOUT_SECONDS);
+}
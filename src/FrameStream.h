@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Lossless compression of the output strip for sending it out of the process, to a projector host or a recorder.
+//
+// The frame is split into square tiles. A tile that's byte for byte the same as in the frame before isn't sent at
+// all. A changed one is XORed with what it was, which leaves zeros wherever it didn't change, and encoded with
+// ByteCodec. A key frame is encoded against a black frame, so even then the background costs nothing, and a decoder
+// can start from one. Most of the strip is black most of the time, and during fades to black nothing changes at all
+// once the frame is black.
+//
+// A message is a FrameHeader followed by mNumTiles tiles, each a FrameTileHeader followed by its encoded bytes. Frames
+// go out in the order they were encoded, in the layout they were given, e.g. bottom row first for a GL readback.
+
+struct FrameHeader {
+	static uint32_t const MAGIC = 0x53464c44; // "DLFS"
+	static uint32_t const KEY_FRAME = 1;
+
+	uint32_t mMagic;
+	// Counts encoded frames, so a decoder can tell it missed one
+	uint32_t mFrameIndex;
+	uint32_t mWidth;
+	uint32_t mHeight;
+	uint32_t mTileSide;
+	uint32_t mFlags;
+	uint32_t mNumTiles;
+	// Bytes after the header
+	uint32_t mPayloadSize;
+};
+
+struct FrameTileHeader {
+	// Row major over the tiles, tiles along the right and top edges can be partial
+	uint32_t mTileIndex;
+	uint32_t mEncodedSize;
+};
+
+// The frame's pixels are 4 bytes each, with rows rowBytes apart
+class FrameTileEncoder {
+public:
+	FrameTileEncoder(int width, int height, int tileSide);
+
+	// The next frame is encoded against black and marked as a key frame, e.g. for a decoder that just connected
+	void requestKeyFrame() { mKeyFrameRequested = true; }
+
+	// Replaces message with the frame encoded against the previous one. Changed tiles are found and encoded on up to
+	// maxThreads threads of the task scheduler
+	void encode(uint8_t const * pixels, size_t rowBytes, std::vector<uint8_t> & message, size_t maxThreads = 1);
+
+	int getWidth() const { return mWidth; }
+	int getHeight() const { return mHeight; }
+	int getNumTiles() const { return mTilesWide * mTilesHigh; }
+	// Of the last frame encoded
+	int getNumChangedTiles() const { return mNumChangedTiles; }
+	size_t getFrameBytes() const { return mPrevious.size(); }
+
+private:
+	int mWidth;
+	int mHeight;
+	int mTileSide;
+	int mTilesWide;
+	int mTilesHigh;
+
+	uint32_t mFrameIndex = 0;
+	bool mKeyFrameRequested = true;
+	int mNumChangedTiles = 0;
+
+	// The last frame encoded, tightly packed
+	std::vector<uint8_t> mPrevious;
+	// Encoded tiles for each row of tiles, and a tile's XOR for each thread
+	std::vector<std::vector<uint8_t>> mRowMessages;
+	std::vector<std::vector<uint8_t>> mTileScratch;
+	std::vector<int> mRowChangedTiles;
+};
+
+// Rebuilds the full frames on the receiving end
+class FrameTileDecoder {
+public:
+	// Applies one message to the frame. Fails on a corrupt message, or a delta frame that doesn't follow the last frame
+	// decoded, and then waits for the next key frame
+	bool decode(uint8_t const * message, size_t size, size_t maxThreads = 1);
+
+	bool hasFrame() const { return mHasFrame; }
+	int getWidth() const { return mWidth; }
+	int getHeight() const { return mHeight; }
+	uint32_t getFrameIndex() const { return mFrameIndex; }
+	// Tightly packed, 4 bytes a pixel, in the layout the encoder was given
+	uint8_t const * getPixels() const { return mFrame.data(); }
+
+private:
+	struct TileEntry {
+		uint32_t mTileIndex;
+		uint32_t mEncodedSize;
+		uint8_t const * mEncoded;
+	};
+
+	bool mHasFrame = false;
+	int mWidth = 0;
+	int mHeight = 0;
+	int mTileSide = 0;
+	uint32_t mFrameIndex = 0;
+
+	std::vector<uint8_t> mFrame;
+	std::vector<TileEntry> mTiles;
+	std::vector<std::vector<uint8_t>> mTileScratch;
+};
+
+// Reads one whole message from a socket into message. Waits up to timeoutSeconds for it to start, or forever if
+// negative
+bool receiveFrameMessage(int fd, std::vector<uint8_t> & message, double timeoutSeconds);
@@ -0,0 +1,166 @@
+#include "FrameStreamPublisher.h"
+
+#include <algorithm>
+
+#include "cinder/Log.h"
+
+#include "Sockets.h"
+
+using namespace ci;
+using std::string;
+
+namespace {
+	// Small enough that a bird crossing a tile doesn't drag much unchanged black into the encode, see frame_encode in
+	// the bench
+	int const TILE_SIDE = 32;
+
+	// The strip's changed tiles are split over this many threads where there are cores for them, without taking every
+	// core from the simulations
+	size_t const ENCODE_THREADS = 4;
+
+	// Frames encoded between key frames, so a recording can be played from partway in and a receiver that lost its
+	// place picks up again within a few seconds at the rate frames get through
+	int const KEY_FRAME_INTERVAL = 60;
+
+	// Short, since a connect attempt holds up one of the IO threads
+	double const CONNECT_TIMEOUT_SECONDS = 0.25;
+	double const CONNECT_INTERVAL_SECONDS = 1.0;
+}
+
+bool FrameStreamPublisher::open(string const & destination, int width, int height) {
+	close();
+
+	if (destination.compare(0, 4, "tcp:") == 0) {
+		if (!parseHostPort(destination.substr(4), mHost, mPort)) {
+			CI_LOG_E("Bad output stream address: " << destination);
+			return false;
+		}
+	} else {
+		mFile.open(destination, std::ios::binary | std::ios::trunc);
+		if (!mFile) {
+			CI_LOG_E("Couldn't open output stream file for writing: " << destination);
+			return false;
+		}
+	}
+
+	mEncoder.reset(new FrameTileEncoder(width, height, TILE_SIDE));
+	mMemory.addCpu(mEncoder->getFrameBytes());
+
+	size_t const bytes = (size_t) width * height * 4;
+	for (auto & pbo : mPbos) {
+		pbo = gl::Pbo::create(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		mMemory.addPbo(pbo);
+	}
+
+	mNextConnectTime = 0.0;
+	return true;
+}
+
+void FrameStreamPublisher::close() {
+	mEncodeTasks.wait();
+	mSendTasks.wait();
+
+	if (mMappedPbo >= 0) {
+		gl::ScopedBuffer scpBuf(mPbos[mMappedPbo]);
+		mPbos[mMappedPbo]->unmap();
+		mMappedPbo = -1;
+	}
+	mPendingPbo = -1;
+	if (mEncoder) {
+		CI_LOG_I("Output stream sent " << mNumPublished << " frames, dropped " << mNumDropped);
+	}
+	mNumPublished = 0;
+	mNumDropped = 0;
+	mFramesSinceKeyFrame = 0;
+	for (auto & pbo : mPbos) {
+		pbo.reset();
+	}
+	mMemory.releaseAll();
+
+	mEncoder.reset();
+	closeSocket(mSocket);
+	if (mFile.is_open()) {
+		mFile.close();
+	}
+}
+
+void FrameStreamPublisher::publish(gl::Texture2dRef const & tex, double now) {
+	if (!mEncoder) {
+		return;
+	}
+
+	// The mapped PBO stays mapped until the encoder is done with it, and the message until it's sent
+	if (!mEncodeTasks.isDone() || !mSendTasks.isDone()) {
+		mNumDropped++;
+		return;
+	}
+
+	if (mMappedPbo >= 0) {
+		gl::ScopedBuffer scpBuf(mPbos[mMappedPbo]);
+		mPbos[mMappedPbo]->unmap();
+		mMappedPbo = -1;
+	}
+
+	// Nothing is read back or encoded without a receiver. A new one gets a key frame first
+	if (!mFile.is_open() && mSocket < 0) {
+		mPendingPbo = -1;
+		if (now >= mNextConnectTime) {
+			mNextConnectTime = now + CONNECT_INTERVAL_SECONDS;
+			mSendTasks.run([this] { connect(); });
+		}
+		return;
+	}
+
+	// Last frame's readback is long since copied, so mapping it doesn't wait on the GPU
+	if (mPendingPbo >= 0) {
+		gl::ScopedBuffer scpBuf(mPbos[mPendingPbo]);
+		auto pixels = static_cast<uint8_t const *>(mPbos[mPendingPbo]->mapBufferRange(0, mEncoder->getFrameBytes(), GL_MAP_READ_BIT));
+		if (pixels) {
+			mMappedPbo = mPendingPbo;
+			mEncodeTasks.run([this, pixels] {
+				if (++mFramesSinceKeyFrame >= KEY_FRAME_INTERVAL) {
+					mEncoder->requestKeyFrame();
+				}
+				mEncoder->encode(pixels, (size_t) mEncoder->getWidth() * 4, mMessage, ENCODE_THREADS);
+				if (reinterpret_cast<FrameHeader const *>(mMessage.data())->mFlags & FrameHeader::KEY_FRAME) {
+					mFramesSinceKeyFrame = 0;
+				}
+				mSendTasks.run([this] { send(); });
+			});
+		}
+	}
+
+	int readbackPbo = mPendingPbo == 0 ? 1 : 0;
+	{
+		gl::ScopedBuffer scpBuf(mPbos[readbackPbo]);
+		gl::ScopedTextureBind scpTex(tex);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	mPendingPbo = readbackPbo;
+}
+
+void FrameStreamPublisher::connect() {
+	mSocket = connectTcp(mHost, mPort, CONNECT_TIMEOUT_SECONDS);
+	if (mSocket >= 0) {
+		CI_LOG_I("Output stream connected to " << mHost << ":" << mPort);
+		mEncoder->requestKeyFrame();
+	}
+}
+
+void FrameStreamPublisher::send() {
+	// Whatever follows a frame that didn't make it out is a delta against it, so the next one has to be a key frame
+	if (mFile.is_open()) {
+		if (!mFile.write(reinterpret_cast<char const *>(mMessage.data()), mMessage.size()).flush()) {
+			CI_LOG_W("Couldn't write a frame to the output stream file");
+			mFile.clear();
+			mEncoder->requestKeyFrame();
+			return;
+		}
+	} else if (!sendAll(mSocket, mMessage.data(), mMessage.size())) {
+		CI_LOG_W("Output stream receiver went away");
+		closeSocket(mSocket);
+		mEncoder->requestKeyFrame();
+		return;
+	}
+	mNumPublished++;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Pbo.h"
+#include "cinder/gl/Texture.h"
+
+#include "FrameStream.h"
+#include "MemoryLedger.h"
+#include "TaskScheduler.h"
+
+// Sends the output strip out of the process as a FrameStream, to a DigitalLifeFrameStream receiver or a recording.
+//
+// Each frame is read back into one of two PBOs, and the one read back the frame before, long since copied, is mapped
+// and handed to a background task to encode, then to an IO task to send. Nothing on the main thread waits on the GPU
+// or the network. While the previous frame is still being encoded or sent, frames are dropped rather than queued, so
+// a slow link lowers the rate the receiver sees instead of the app's.
+//
+// That is the normal case, not just on a slow link: encoding the full 6144 x 1024 strip takes 20 to 30 ms on one
+// core, depending on how much of it changes, which is more than a 60 Hz frame. So the stream carries every second or
+// third frame at best and is no per-frame record of the output. A key frame goes out every KEY_FRAME_INTERVAL frames encoded, on every connect, and after
+// any frame that failed to send or write, so a receiver or a recording can always pick up again from the next one.
+class FrameStreamPublisher {
+public:
+	// "tcp:host:port" connects to a receiver, and keeps trying once a second whenever there isn't one. Anything else
+	// is a file to record to
+	bool open(std::string const & destination, int width, int height);
+	// Call with the GL context current. Waits for the frame being sent, and releases everything open() registered
+	void close();
+	bool isOpen() const { return mEncoder != nullptr; }
+
+	void publish(ci::gl::Texture2dRef const & tex, double now);
+
+	uint64_t getNumPublished() const { return mNumPublished; }
+	uint64_t getNumDropped() const { return mNumDropped; }
+
+private:
+	// On the IO tasks
+	void connect();
+	void send();
+
+	std::unique_ptr<FrameTileEncoder> mEncoder;
+	std::vector<uint8_t> mMessage;
+
+	std::string mHost;
+	uint16_t mPort = 0;
+	int mSocket = -1;
+	double mNextConnectTime = 0.0;
+	std::ofstream mFile;
+
+	std::array<ci::gl::PboRef, 2> mPbos;
+	// The PBO with a frame read back into it and not encoded yet, or -1, and the one the encoder has mapped, or -1
+	int mPendingPbo = -1;
+	int mMappedPbo = -1;
+
+	TaskGroup mEncodeTasks { TaskPriority::BACKGROUND };
+	TaskGroup mSendTasks { TaskPriority::IO };
+
+	// Counted on the encode tasks
+	int mFramesSinceKeyFrame = 0;
+
+	// Counted on the IO tasks
+	std::atomic<uint64_t> mNumPublished { 0 };
+	uint64_t mNumDropped = 0;
+
+	// The readback buffers and the encoder's frame, for as long as the stream is open
+	MemoryAccount mMemory { "OutputStream" };
+};
@@ -0,0 +1,34 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFileRef MappedFile::create(ci::fs::path const & path) {
+	int fd = ::open(path.string().c_str(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+
+	struct stat fileStat;
+	if (::fstat(fd, & fileStat) != 0 || fileStat.st_size <= 0) {
+		::close(fd);
+		return nullptr;
+	}
+
+	size_t size = (size_t) fileStat.st_size;
+	void * data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+
+	return MappedFileRef(new MappedFile(static_cast<uint8_t const *>(data), size));
+}
+
+MappedFile::~MappedFile() {
+	::munmap(const_cast<uint8_t *>(mData), mSize);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+
+#include "cinder/Filesystem.h"
+
+class MappedFile;
+typedef std::shared_ptr<MappedFile> MappedFileRef;
+
+// A read-only memory mapping of a whole file, unmapped when the last reference goes away
+class MappedFile {
+public:
+	// Returns nullptr if the file doesn't exist or can't be mapped
+	static MappedFileRef create(ci::fs::path const & path);
+
+	~MappedFile();
+
+	uint8_t const * getData() const { return mData; }
+	size_t getSize() const { return mSize; }
+
+private:
+	MappedFile(uint8_t const * data, size_t size) : mData(data), mSize(size) {}
+
+	uint8_t const * mData;
+	size_t mSize;
+};
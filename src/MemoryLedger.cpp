@@ -0,0 +1,178 @@
+#include "MemoryLedger.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace ci;
+
+namespace {
+	char const * const KIND_NAMES[] = { "textures", "renderbuffers", "vbos", "cpu" };
+
+	double toMegabytes(int64_t bytes) {
+		return bytes / (1024.0 * 1024.0);
+	}
+
+	void addToUsage(MemoryLedger::Usage & usage, int64_t bytes) {
+		usage.mLiveBytes += bytes;
+		usage.mHighWaterBytes = std::max(usage.mHighWaterBytes, usage.mLiveBytes);
+	}
+
+	int64_t getTextureBytes(GLenum internalFormat, int width, int height, int layers, bool mipmapped) {
+		int64_t bytes = (int64_t) getBytesPerTexel(internalFormat) * width * height * layers;
+		// A full mip chain adds a third on top of the base level
+		return mipmapped ? bytes * 4 / 3 : bytes;
+	}
+}
+
+MemoryLedger & MemoryLedger::get() {
+	static MemoryLedger sLedger;
+	return sLedger;
+}
+
+void MemoryLedger::add(std::string const & owner, MemoryKind kind, int64_t bytes) {
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto & ownerUsage = mOwners[owner];
+	addToUsage(ownerUsage.mKinds[(size_t) kind], bytes);
+	addToUsage(ownerUsage.mTotal, bytes);
+	addToUsage(mTotal, bytes);
+}
+
+MemoryLedger::Usage MemoryLedger::getUsage(std::string const & owner, MemoryKind kind) const {
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto it = mOwners.find(owner);
+	return it != mOwners.end() ? it->second.mKinds[(size_t) kind] : Usage();
+}
+
+MemoryLedger::Usage MemoryLedger::getUsage(std::string const & owner) const {
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto it = mOwners.find(owner);
+	return it != mOwners.end() ? it->second.mTotal : Usage();
+}
+
+MemoryLedger::Usage MemoryLedger::getTotalUsage() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mTotal;
+}
+
+std::string MemoryLedger::getReport() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(1);
+	report << "Memory by owner (MB, live / high-water):";
+
+	for (auto & owner : mOwners) {
+		report << "\n  " << std::setw(20) << std::left << owner.first
+			<< " total " << toMegabytes(owner.second.mTotal.mLiveBytes) << " / " << toMegabytes(owner.second.mTotal.mHighWaterBytes);
+
+		for (size_t kind = 0; kind < (size_t) MemoryKind::COUNT; kind++) {
+			auto & usage = owner.second.mKinds[kind];
+			if (usage.mHighWaterBytes > 0) {
+				report << "   " << KIND_NAMES[kind] << " " << toMegabytes(usage.mLiveBytes) << " / " << toMegabytes(usage.mHighWaterBytes);
+			}
+		}
+	}
+
+	report << "\n  " << std::setw(20) << std::left << "All" << " total " << toMegabytes(mTotal.mLiveBytes) << " / " << toMegabytes(mTotal.mHighWaterBytes);
+	return report.str();
+}
+
+size_t getBytesPerTexel(GLenum internalFormat) {
+	switch (internalFormat) {
+		case GL_R8: return 1;
+		case GL_RG8: return 2;
+		case GL_R32F: return 4;
+		case GL_RGB8:
+		case GL_RGBA8:
+		case GL_SRGB8_ALPHA8:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+			return 4;
+		case GL_RGB16F:
+		case GL_RGBA16F:
+		case GL_RG32UI:
+			return 8;
+		case GL_RGB32F:
+		case GL_RGBA32F:
+			return 16;
+		default:
+			return 4;
+	}
+}
+
+void MemoryAccount::addTexture(gl::Texture2dRef const & tex) {
+	if (tex) {
+		add(MemoryKind::TEXTURE, getTextureBytes(tex->getInternalFormat(), tex->getWidth(), tex->getHeight(), 1, tex->hasMipmapping()));
+	}
+}
+
+void MemoryAccount::addTexture(gl::TextureCubeMapRef const & tex) {
+	if (tex) {
+		add(MemoryKind::TEXTURE, getTextureBytes(tex->getInternalFormat(), tex->getWidth(), tex->getHeight(), 6, tex->hasMipmapping()));
+	}
+}
+
+void MemoryAccount::addFbo(gl::FboRef const & fbo, bool hasDepthRenderbuffer) {
+	addTexture(fbo->getColorTexture());
+	addTexture(fbo->getDepthTexture());
+	if (hasDepthRenderbuffer) {
+		add(MemoryKind::RENDERBUFFER, getTextureBytes(GL_DEPTH_COMPONENT24, fbo->getWidth(), fbo->getHeight(), 1, false));
+	}
+}
+
+void MemoryAccount::addFbo(gl::FboCubeMapRef const & fbo) {
+	addTexture(fbo->getTextureCubeMap());
+	// The depth buffer is a single face sized renderbuffer, shared by all six faces
+	add(MemoryKind::RENDERBUFFER, getTextureBytes(GL_DEPTH_COMPONENT24, fbo->getWidth(), fbo->getHeight(), 1, false));
+}
+
+void MemoryAccount::addFbo(FboCubeMapLayeredRef const & fbo) {
+	addTexture(fbo->getColorTex());
+	add(MemoryKind::TEXTURE, getTextureBytes(GL_DEPTH_COMPONENT24, fbo->getWidth(), fbo->getHeight(), 6, false));
+}
+
+void MemoryAccount::addVbo(gl::VboRef const & vbo) {
+	if (vbo) {
+		add(MemoryKind::VBO, vbo->getSize());
+	}
+}
+
+void MemoryAccount::addPbo(gl::PboRef const & pbo) {
+	if (pbo) {
+		add(MemoryKind::VBO, pbo->getSize());
+	}
+}
+
+void MemoryAccount::addVboMesh(gl::VboMeshRef const & mesh) {
+	for (auto & layoutVbo : mesh->getVertexArrayLayoutVbos()) {
+		addVbo(layoutVbo.second);
+	}
+	addVbo(mesh->getIndexVbo());
+}
+
+void MemoryAccount::addCpu(size_t bytes) {
+	add(MemoryKind::CPU, bytes);
+}
+
+void MemoryAccount::releaseCpu(size_t bytes) {
+	add(MemoryKind::CPU, -(int64_t) bytes);
+}
+
+void MemoryAccount::releaseAll() {
+	for (size_t kind = 0; kind < mBytes.size(); kind++) {
+		if (mBytes[kind] != 0) {
+			MemoryLedger::get().add(mOwner, (MemoryKind) kind, -mBytes[kind]);
+			mBytes[kind] = 0;
+		}
+	}
+}
+
+void MemoryAccount::add(MemoryKind kind, int64_t bytes) {
+	mBytes[(size_t) kind] += bytes;
+	MemoryLedger::get().add(mOwner, kind, bytes);
+}
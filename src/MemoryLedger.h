@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/VboMesh.h"
+#include "cinder/gl/Pbo.h"
+
+#include "FboCubeMapLayered.h"
+
+enum class MemoryKind {
+	TEXTURE,
+	RENDERBUFFER,
+	VBO,
+	CPU,
+	COUNT
+};
+
+// Process wide tally of the memory each owner (a simulation, the output pipeline, calibration) has allocated, by kind.
+// Keeps live bytes and the high-water mark of each, so the footprint of a configuration can be read off on demand.
+// GPU sizes are estimates from the internal format and size, drivers may pad or compress.
+class MemoryLedger {
+public:
+	struct Usage {
+		int64_t mLiveBytes = 0;
+		int64_t mHighWaterBytes = 0;
+	};
+
+	static MemoryLedger & get();
+
+	// Thread safe. Negative bytes release
+	void add(std::string const & owner, MemoryKind kind, int64_t bytes);
+
+	Usage getUsage(std::string const & owner, MemoryKind kind) const;
+	Usage getUsage(std::string const & owner) const;
+	Usage getTotalUsage() const;
+
+	// One line per owner with live / high-water MB per kind
+	std::string getReport() const;
+
+private:
+	MemoryLedger() {}
+
+	struct OwnerUsage {
+		std::array<Usage, (size_t) MemoryKind::COUNT> mKinds;
+		Usage mTotal;
+	};
+
+	mutable std::mutex mMutex;
+	std::map<std::string, OwnerUsage> mOwners;
+	Usage mTotal;
+};
+
+// Bytes per texel of the internal formats this app uses. Three channel formats are counted padded to four, as drivers store them
+size_t getBytesPerTexel(GLenum internalFormat);
+
+// An owner's handle on the ledger. Allocations are registered through it right after they're created, and everything
+// it registered is released from the ledger when it goes away
+class MemoryAccount {
+public:
+	explicit MemoryAccount(std::string const & owner) : mOwner(owner) { mBytes.fill(0); }
+	~MemoryAccount() { releaseAll(); }
+
+	MemoryAccount(MemoryAccount const &) = delete;
+	MemoryAccount & operator=(MemoryAccount const &) = delete;
+
+	void addTexture(ci::gl::Texture2dRef const & tex);
+	void addTexture(ci::gl::TextureCubeMapRef const & tex);
+	// Color and depth textures, plus a depth renderbuffer when the format had one
+	void addFbo(ci::gl::FboRef const & fbo, bool hasDepthRenderbuffer);
+	void addFbo(ci::gl::FboCubeMapRef const & fbo);
+	// Layered cube map FBOs are created with a depth cube map alongside the color one
+	void addFbo(FboCubeMapLayeredRef const & fbo);
+	void addVbo(ci::gl::VboRef const & vbo);
+	// Every vertex buffer plus the index buffer
+	void addVboMesh(ci::gl::VboMeshRef const & mesh);
+	// Counted with the VBOs, as buffer memory
+	void addPbo(ci::gl::PboRef const & pbo);
+	void addCpu(size_t bytes);
+	template <typename T>
+	void addCpu(std::vector<T> const & buffer) { addCpu(buffer.capacity() * sizeof(T)); }
+	// For short lived buffers, e.g. a surface that only lives until its texture is uploaded
+	void releaseCpu(size_t bytes);
+
+	void releaseAll();
+
+	std::string const & getOwner() const { return mOwner; }
+
+private:
+	void add(MemoryKind kind, int64_t bytes);
+
+	std::string mOwner;
+	std::array<int64_t, (size_t) MemoryKind::COUNT> mBytes;
+};
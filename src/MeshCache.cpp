@@ -0,0 +1,176 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "cinder/ObjLoader.h"
+#include "cinder/Log.h"
+#include "cinder/Utilities.h"
+
+using namespace ci;
+using std::vector;
+
+char const MESH_CACHE_MAGIC[4] = { 'D', 'L', 'M', 'C' };
+
+CachedMeshRef CachedMesh::create(MappedFileRef file) {
+	auto header = reinterpret_cast<MeshCacheHeader const *>(file->getData());
+
+	CachedMeshRef mesh(new CachedMesh());
+	mesh->mFile = file;
+	mesh->mNumVertices = header->mNumVertices;
+	mesh->mNumIndices = header->mNumIndices;
+	mesh->mVertices = reinterpret_cast<float const *>(file->getData() + sizeof(MeshCacheHeader));
+	mesh->mIndices = reinterpret_cast<uint32_t const *>(mesh->mVertices + header->mNumVertices * MESH_CACHE_FLOATS_PER_VERTEX);
+	return mesh;
+}
+
+CachedMeshRef CachedMesh::create(vector<float> vertices, vector<uint32_t> indices) {
+	CachedMeshRef mesh(new CachedMesh());
+	mesh->mOwnedVertices = std::move(vertices);
+	mesh->mOwnedIndices = std::move(indices);
+	mesh->mNumVertices = mesh->mOwnedVertices.size() / MESH_CACHE_FLOATS_PER_VERTEX;
+	mesh->mNumIndices = mesh->mOwnedIndices.size();
+	mesh->mVertices = mesh->mOwnedVertices.data();
+	mesh->mIndices = mesh->mOwnedIndices.data();
+	return mesh;
+}
+
+gl::VboMeshRef CachedMesh::createVboMesh() const {
+	size_t const stride = MESH_CACHE_FLOATS_PER_VERTEX * sizeof(float);
+
+	auto vertexBuf = gl::Vbo::create(GL_ARRAY_BUFFER, mNumVertices * stride, mVertices, GL_STATIC_DRAW);
+	auto vertexFmt = geom::BufferLayout({
+		geom::AttribInfo(geom::POSITION, 3, stride, 0),
+		geom::AttribInfo(geom::TEX_COORD_0, 2, stride, 3 * sizeof(float))
+	});
+	auto indexBuf = gl::Vbo::create(GL_ELEMENT_ARRAY_BUFFER, mNumIndices * sizeof(uint32_t), mIndices, GL_STATIC_DRAW);
+
+	return gl::VboMesh::create(mNumVertices, GL_TRIANGLES, { { vertexFmt, vertexBuf } }, mNumIndices, GL_UNSIGNED_INT, indexBuf);
+}
+
+uint64_t hashMeshSource(uint8_t const * data, size_t size) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t idx = 0; idx < size; idx++) {
+		hash ^= data[idx];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+CachedMeshRef convertToCachedMesh(TriMesh const & mesh) {
+	size_t numVertices = mesh.getNumVertices();
+	vec3 const * positions = mesh.getPositions<3>();
+	// Not every OBJ has texture coordinates
+	vec2 const * texCoords = mesh.hasTexCoords0() ? mesh.getTexCoords0<2>() : nullptr;
+
+	vector<float> vertices(numVertices * MESH_CACHE_FLOATS_PER_VERTEX);
+	for (size_t idx = 0; idx < numVertices; idx++) {
+		float * vert = & vertices[idx * MESH_CACHE_FLOATS_PER_VERTEX];
+		vert[0] = positions[idx].x;
+		vert[1] = positions[idx].y;
+		vert[2] = positions[idx].z;
+		vert[3] = texCoords ? texCoords[idx].x : 0.0f;
+		vert[4] = texCoords ? texCoords[idx].y : 0.0f;
+	}
+
+	return CachedMesh::create(std::move(vertices), mesh.getIndices());
+}
+
+bool writeMeshCache(fs::path const & cachePath, uint64_t sourceHash, CachedMesh const & mesh) {
+	MeshCacheHeader header;
+	std::memcpy(header.mMagic, MESH_CACHE_MAGIC, sizeof(header.mMagic));
+	header.mVersion = MESH_CACHE_VERSION;
+	header.mSourceHash = sourceHash;
+	header.mNumVertices = mesh.getNumVertices();
+	header.mNumIndices = mesh.getNumIndices();
+	header.mFloatsPerVertex = MESH_CACHE_FLOATS_PER_VERTEX;
+	header.mReserved = 0;
+
+	// Write to a temporary file and rename it into place, so a crash mid-write can't leave a truncated cache behind
+	fs::path tempPath = cachePath;
+	tempPath += ".tmp";
+
+	try {
+		fs::create_directories(cachePath.parent_path());
+
+		{
+			std::ofstream out(tempPath.string(), std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<char const *>(& header), sizeof(header));
+			out.write(reinterpret_cast<char const *>(mesh.getVertices()), mesh.getNumVertices() * MESH_CACHE_FLOATS_PER_VERTEX * sizeof(float));
+			out.write(reinterpret_cast<char const *>(mesh.getIndices()), mesh.getNumIndices() * sizeof(uint32_t));
+			if (!out) {
+				out.close();
+				std::remove(tempPath.string().c_str());
+				return false;
+			}
+		}
+
+		fs::rename(tempPath, cachePath);
+	} catch (std::exception const & exc) {
+		CI_LOG_EXCEPTION("Failed to write mesh cache", exc);
+		std::remove(tempPath.string().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+CachedMeshRef readMeshCache(fs::path const & cachePath, uint64_t sourceHash) {
+	auto file = MappedFile::create(cachePath);
+	if (!file || file->getSize() < sizeof(MeshCacheHeader)) {
+		return nullptr;
+	}
+
+	auto header = reinterpret_cast<MeshCacheHeader const *>(file->getData());
+	if (std::memcmp(header->mMagic, MESH_CACHE_MAGIC, sizeof(header->mMagic)) != 0
+		|| header->mVersion != MESH_CACHE_VERSION
+		|| header->mFloatsPerVertex != MESH_CACHE_FLOATS_PER_VERTEX
+		|| header->mSourceHash != sourceHash) {
+		return nullptr;
+	}
+
+	size_t expectedSize = sizeof(MeshCacheHeader)
+		+ (size_t) header->mNumVertices * MESH_CACHE_FLOATS_PER_VERTEX * sizeof(float)
+		+ (size_t) header->mNumIndices * sizeof(uint32_t);
+	if (file->getSize() != expectedSize || header->mNumIndices % 3 != 0) {
+		return nullptr;
+	}
+
+	// The indices go straight to the GPU, where one past the vertices would draw garbage, or worse
+	auto mesh = CachedMesh::create(file);
+	uint32_t const * indices = mesh->getIndices();
+	for (uint32_t idx = 0; idx < mesh->getNumIndices(); idx++) {
+		if (indices[idx] >= mesh->getNumVertices()) {
+			CI_LOG_W("Mesh cache has an index past its vertices: " << cachePath);
+			return nullptr;
+		}
+	}
+
+	return mesh;
+}
+
+fs::path getMeshCacheDirectory() {
+	return getHomeDirectory() / "Library" / "Caches" / "DigitalLife";
+}
+
+CachedMeshRef loadCachedObjMesh(DataSourceRef objSource, fs::path const & cachePath) {
+	BufferRef objBuffer = objSource->getBuffer();
+	uint64_t sourceHash = hashMeshSource(static_cast<uint8_t const *>(objBuffer->getData()), objBuffer->getSize());
+
+	if (auto cached = readMeshCache(cachePath, sourceHash)) {
+		return cached;
+	}
+
+	CI_LOG_I("Mesh cache miss, parsing OBJ for: " << cachePath.filename());
+
+	auto triMesh = TriMesh::create(ObjLoader(DataSourceBuffer::create(objBuffer)), TriMesh::Format().positions(3).texCoords0(2));
+	auto mesh = convertToCachedMesh(* triMesh);
+
+	// Not being able to write the cache only costs the next launch another parse
+	if (!writeMeshCache(cachePath, sourceHash, * mesh)) {
+		CI_LOG_W("Failed to write mesh cache: " << cachePath);
+	}
+
+	return mesh;
+}
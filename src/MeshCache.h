@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/DataSource.h"
+#include "cinder/Filesystem.h"
+#include "cinder/TriMesh.h"
+#include "cinder/gl/VboMesh.h"
+
+#include "MappedFile.h"
+
+// Binary cache of an OBJ mesh, already de-duplicated and interleaved the way gl::VboMesh wants it.
+//
+// File layout (native endianness, everything 4-byte aligned so it can be used straight out of a memory mapping):
+//   MeshCacheHeader
+//   mNumVertices * MESH_CACHE_FLOATS_PER_VERTEX floats: position xyz, texcoord uv
+//   mNumIndices uint32 triangle indices
+//
+// A cache file is only used if its version matches MESH_CACHE_VERSION and its source hash matches the OBJ it was made
+// from, otherwise the OBJ is parsed again and the cache file rewritten.
+
+uint32_t const MESH_CACHE_VERSION = 1;
+uint32_t const MESH_CACHE_FLOATS_PER_VERTEX = 5;
+
+struct MeshCacheHeader {
+	char mMagic[4];
+	uint32_t mVersion;
+	uint64_t mSourceHash;
+	uint32_t mNumVertices;
+	uint32_t mNumIndices;
+	uint32_t mFloatsPerVertex;
+	uint32_t mReserved;
+};
+
+class CachedMesh;
+typedef std::shared_ptr<CachedMesh> CachedMeshRef;
+
+class CachedMesh {
+public:
+	// Points into a mapped cache file
+	static CachedMeshRef create(MappedFileRef file);
+	// Owns freshly converted data
+	static CachedMeshRef create(std::vector<float> vertices, std::vector<uint32_t> indices);
+
+	uint32_t getNumVertices() const { return mNumVertices; }
+	uint32_t getNumIndices() const { return mNumIndices; }
+	float const * getVertices() const { return mVertices; }
+	uint32_t const * getIndices() const { return mIndices; }
+
+	// Has to be called on the thread that owns the GL context
+	ci::gl::VboMeshRef createVboMesh() const;
+
+private:
+	CachedMesh() {}
+
+	MappedFileRef mFile;
+	std::vector<float> mOwnedVertices;
+	std::vector<uint32_t> mOwnedIndices;
+
+	uint32_t mNumVertices = 0;
+	uint32_t mNumIndices = 0;
+	float const * mVertices = nullptr;
+	uint32_t const * mIndices = nullptr;
+};
+
+// 64 bit FNV-1a, used to tie cache files to the exact bytes of their source
+uint64_t hashMeshSource(uint8_t const * data, size_t size);
+
+// Interleaves a triangulated mesh with positions and texcoords into the cache layout
+CachedMeshRef convertToCachedMesh(ci::TriMesh const & mesh);
+
+bool writeMeshCache(ci::fs::path const & cachePath, uint64_t sourceHash, CachedMesh const & mesh);
+// Returns nullptr if the file is missing, truncated, from another version, made from a different source, or has an
+// index past its vertices
+CachedMeshRef readMeshCache(ci::fs::path const & cachePath, uint64_t sourceHash);
+
+// Where cache files for this app live. Created by writeMeshCache() when needed
+ci::fs::path getMeshCacheDirectory();
+
+// Loads an OBJ through its cache file, parsing it and writing the cache on a miss. Does no GL work, so it can run on a worker thread
+CachedMeshRef loadCachedObjMesh(ci::DataSourceRef objSource, ci::fs::path const & cachePath);
@@ -1,54 +1,42 @@
 #include "NetworkApp.h"
 
+#include "cinder/Log.h"
+
 using namespace ci;
 using std::vector;
 
 extern uint32_t OUTPUT_CUBE_MAP_SIDE;
 
+// In pixels of the double resolution cube map
+float const NODE_POINT_SIZE = 5.0f;
+
 void NetworkApp::setup()
 {
-	// Set up the 360 degree cube map camera
+	// Set up the 360 degree cube map camera, at twice the output resolution so the thin lines come out smoother
 	auto cubeMapFormat = gl::TextureCubeMap::Format()
 		.magFilter(GL_LINEAR)
 		.minFilter(GL_LINEAR)
 		.internalFormat(GL_RGB8)
 		.mipmap();
 
-	auto cubeMapFboFmt = gl::FboCubeMap::Format()
-		.textureCubeMapFormat(cubeMapFormat);
+	auto cubeMapFboFmt = FboCubeMapLayered::Format().colorFormat(cubeMapFormat);
 
-	mOutputCubeFbo = gl::FboCubeMap::create(OUTPUT_CUBE_MAP_SIDE * 2, OUTPUT_CUBE_MAP_SIDE * 2, cubeMapFboFmt);
+	int const cubeMapSide = OUTPUT_CUBE_MAP_SIDE * 2;
+	mOutputCubeFbo = FboCubeMapLayered::create(cubeMapSide, cubeMapSide, cubeMapFboFmt);
+	mMemory.addFbo(mOutputCubeFbo);
 
-	mRenderToCubeMap = gl::getStockShader(gl::ShaderDef().color());
+	mOutputCubeMatrices = mOutputCubeFbo->generateCameraMatrixBuffer();
 
-	// Set up the simulation data
-	for (int idx = 0; idx < mNumNetworkNodes; idx++) {
-		mNetworkNodes.push_back(NetworkNode(idx, randVec3()));
-		if (randFloat() < 0.1) { mNetworkNodes[idx].mInfected = true; }
-	}
-
-	vector<NetworkNode *> nodePointers;
-	for (auto & node : mNetworkNodes) {
-		nodePointers.push_back(& node);
-	}
-
-	for (auto & node : mNetworkNodes) {
-		// Sort according to distance
-		std::sort(nodePointers.begin(), nodePointers.end(), [& node] (NetworkNode * p1, NetworkNode * p2) {
-			float d1 = distance(node.mPos, p1->mPos);
-			float d2 = distance(node.mPos, p2->mPos);
-			return d1 < d2;
-		});
-		// Take the nearest ones, knowing the the first one will be the node itself
-		for (int i = 1; i <= mNumLinksPerNode; i++) {
-			node.mLinks.insert(nodePointers[i]->mId);
-			nodePointers[i]->mLinks.insert(node.mId);
-			mNetworkLinks.push_back(std::make_pair(nodePointers[i]->mId, node.mId));
-		}
-	}
+	// Sort the static geometry into faces. Wide enough for the whole of a point whose center is just off a face
+	CubeFaceFrustum frustum;
+	frustum.mMargin = CubeFaceFrustum::getMargin(NODE_POINT_SIZE * 0.5f + 1.0f, cubeMapSide);
+	mFaceBuckets = buildNetworkFaceBuckets(mSim, frustum);
+	mMemory.addCpu(mFaceBuckets.mNodeIndices);
+	mMemory.addCpu(mFaceBuckets.mLinkIndices);
 
 	// Set up OpenGL data structures on the GPU
-	size_t numNodes = mNetworkNodes.size();
+	size_t numNodes = mSim.mNetworkNodes.size();
+	mMemory.addCpu(mSim.getByteSize());
 
 	// lol this is literally just to avoid having a shader warning all the time :/
 	auto emptyTexCoordsBuf = gl::Vbo::create(GL_ARRAY_BUFFER, vector<vec2>(numNodes));
@@ -57,122 +45,93 @@ void NetworkApp::setup()
 	vector<vec3> nodePositions(numNodes);
 	vector<vec3> nodeColors(numNodes);
 	for (int idx = 0; idx < numNodes; idx++) {
-		nodePositions[idx] = mNetworkNodes[idx].mPos;
-		nodeColors[idx] = mNetworkNodes[idx].mInfected ? vec3(1, 0, 0) : vec3(0, 0, 1);
+		nodePositions[idx] = mSim.mNetworkNodes[idx].mPos;
+		nodeColors[idx] = mSim.mNetworkNodes[idx].mInfected ? vec3(1, 0, 0) : vec3(0, 0, 1);
 	}
 
 	auto nodesBuf = gl::Vbo::create(GL_ARRAY_BUFFER, nodePositions);
 	auto nodesFmt = geom::BufferLayout({ geom::AttribInfo(geom::POSITION, 3, 0, 0) });
-	auto nodeColorsBuf = gl::Vbo::create(GL_ARRAY_BUFFER, nodeColors, GL_DYNAMIC_DRAW);
+	mNodeColorsVbo = gl::Vbo::create(GL_ARRAY_BUFFER, nodeColors, GL_DYNAMIC_DRAW);
 	auto nodeColorsFmt = geom::BufferLayout({ geom::AttribInfo(geom::COLOR, 3, 0, 0) });
-	mNodesMesh = gl::VboMesh::create(numNodes, GL_POINTS, { { nodesFmt, nodesBuf }, { nodeColorsFmt, nodeColorsBuf }, { emptyTexCoordsFmt, emptyTexCoordsBuf } });
-
-	size_t numLinks = mNetworkLinks.size();
-
-	vector<vec3> linkPositions(2 * numLinks);
-	vector<vec3> linkColors(2 * numLinks);
-	for (int idx = 0; idx < numLinks; idx++) {
-		uint id1 = mNetworkLinks[idx].first;
-		uint id2 = mNetworkLinks[idx].second;
-		linkPositions[2 * idx] = mNetworkNodes[id1].mPos;
-		linkPositions[2 * idx + 1] = mNetworkNodes[id2].mPos;
-		linkColors[2 * idx] = mNetworkNodes[id1].mInfected ? vec3(1, 0, 0) : vec3(0, 0, 1);
-		linkColors[2 * idx + 1] = mNetworkNodes[id2].mInfected ? vec3(1, 0, 0) : vec3(0, 0, 1);
-	}
+	vector<std::pair<geom::BufferLayout, gl::VboRef>> nodeVertices = { { nodesFmt, nodesBuf }, { nodeColorsFmt, mNodeColorsVbo }, { emptyTexCoordsFmt, emptyTexCoordsBuf } };
 
-	auto linksBuf = gl::Vbo::create(GL_ARRAY_BUFFER, linkPositions);
-	auto linksFmt = geom::BufferLayout({ geom::AttribInfo(geom::POSITION, 3, 0, 0) });
-	auto linkColorsBuf = gl::Vbo::create(GL_ARRAY_BUFFER, linkColors, GL_DYNAMIC_DRAW);
-	auto linkColorsFmt = geom::BufferLayout({ geom::AttribInfo(geom::COLOR, 3, 0, 0) });
-	mLinksMesh = gl::VboMesh::create(2 * numLinks, GL_LINES, { { linksFmt, linksBuf }, { linkColorsFmt, linkColorsBuf }, { emptyTexCoordsFmt, emptyTexCoordsBuf } });
-}
+	// Links draw between the node vertices, so their colors follow the nodes' without an upload of their own
+	auto nodeIndicesBuf = gl::Vbo::create(GL_ELEMENT_ARRAY_BUFFER, mFaceBuckets.mNodeIndices);
+	auto nodesMesh = gl::VboMesh::create(numNodes, GL_POINTS, nodeVertices, mFaceBuckets.mNodeIndices.size(), GL_UNSIGNED_INT, nodeIndicesBuf);
+	mMemory.addVboMesh(nodesMesh);
 
-void NetworkApp::update()
-{
-	vector<bool> willBeInfected(mNetworkNodes.size(), false);
-
-	for (int idx = 0; idx < mNetworkNodes.size(); idx++) {
-		auto & node = mNetworkNodes[idx];
-		if (node.mInfected) {
-			if (randFloat() < mNodeDisinfectChance) { willBeInfected[node.mId] = false; } else { willBeInfected[node.mId] = true; }
-			for (uint otherId : node.mLinks) {
-				if (randFloat() < mSpreadInfectionChance) { willBeInfected[otherId] = true; }
-			}
-		}
-	}
+	auto linkIndicesBuf = gl::Vbo::create(GL_ELEMENT_ARRAY_BUFFER, mFaceBuckets.mLinkIndices);
+	auto linksMesh = gl::VboMesh::create(numNodes, GL_LINES, nodeVertices, mFaceBuckets.mLinkIndices.size(), GL_UNSIGNED_INT, linkIndicesBuf);
+	mMemory.addVbo(linkIndicesBuf);
 
-	uint numInfected = std::accumulate(willBeInfected.begin(), willBeInfected.end(), 0, [] (uint count, bool inf) { return count + (inf ? 1 : 0); });
-	if (numInfected < mMinInfected) {
-		for (auto & node : mNetworkNodes) {
-			if (randFloat() < (float) mMinInfected / mNumNetworkNodes) { willBeInfected[node.mId] = true; }
-		}
-	}
+	// Each primitive goes to the layer of the face run it's in
+	auto nodesProg = gl::GlslProg::create(app::loadResource("DLRenderIntoCubeMap_v.glsl"), app::loadResource("DLRenderIntoCubeMap_f.glsl"), app::loadResource("NWRenderIntoCubeMap_points_g.glsl"));
+	nodesProg->uniform("uFaceStarts", mFaceBuckets.mNodeStarts, NUM_CUBE_FACES);
+	mNodesBatch = gl::Batch::create(nodesMesh, nodesProg);
 
-	for (int idx = 0; idx < mNetworkNodes.size(); idx++) {
-		mNetworkNodes[idx].mInfected = willBeInfected[idx];
-	}
+	auto linksProg = gl::GlslProg::create(app::loadResource("DLRenderIntoCubeMap_v.glsl"), app::loadResource("DLRenderIntoCubeMap_f.glsl"), app::loadResource("NWRenderIntoCubeMap_lines_g.glsl"));
+	linksProg->uniform("uFaceStarts", mFaceBuckets.mLinkStarts, NUM_CUBE_FACES);
+	mLinksBatch = gl::Batch::create(linksMesh, linksProg);
+
+	CI_LOG_I("Network faces get " << mFaceBuckets.mNodeIndices.size() << " of " << NUM_CUBE_FACES * numNodes << " nodes and "
+		<< mFaceBuckets.mLinkIndices.size() / 2 << " of " << NUM_CUBE_FACES * mSim.mNetworkLinks.size() << " links");
+}
 
+void NetworkApp::update()
+{
+	mSim.step();
 	this->setColorAttribs();
 }
 
 void NetworkApp::setColorAttribs() {
-	vector<vec3> nodeColors(mNetworkNodes.size());
-	for (int idx = 0; idx < mNetworkNodes.size(); idx++) {
-		nodeColors[idx] = mNetworkNodes[idx].mInfected ? vec3(1, 0, 0) : vec3(0, 0, 1);
-	}
-
-	mNodesMesh->findAttrib(geom::COLOR)->second->copyData(vectorByteSize(nodeColors), nodeColors.data());
-
-	vector<vec3> linkColors(2 * mNetworkLinks.size());
-	for (int idx = 0; idx < mNetworkLinks.size(); idx++) {
-		uint id1 = mNetworkLinks[idx].first;
-		uint id2 = mNetworkLinks[idx].second;
-		linkColors[2 * idx] = mNetworkNodes[id1].mInfected ? vec3(1, 0, 0) : vec3(0, 0, 1);
-		linkColors[2 * idx + 1] = mNetworkNodes[id2].mInfected ? vec3(1, 0, 0) : vec3(0, 0, 1);
+	vector<vec3> nodeColors(mSim.mNetworkNodes.size());
+	for (int idx = 0; idx < mSim.mNetworkNodes.size(); idx++) {
+		nodeColors[idx] = mSim.mNetworkNodes[idx].mInfected ? vec3(1, 0, 0) : vec3(0, 0, 1);
 	}
 
-	mLinksMesh->findAttrib(geom::COLOR)->second->copyData(vectorByteSize(linkColors), linkColors.data());
+	mNodeColorsVbo->copyData(vectorByteSize(nodeColors), nodeColors.data());
 }
 
 void NetworkApp::disrupt(vec3 dir) {
-	float const DISRUPT_RADIUS = 0.45;
-	vec3 const disruptDir = normalize(dir);
+	mSim.disrupt(dir);
+	this->setColorAttribs();
+}
 
-	for (auto & node : mNetworkNodes) {
-		if (distance(node.mPos, disruptDir) < DISRUPT_RADIUS) {
-			node.mInfected = true;
-		}
+bool NetworkApp::restoreState(Checkpoint const & checkpoint) {
+	if (!mSim.restoreState(checkpoint)) {
+		return false;
 	}
-
-	this->setColorAttribs();
+	// The meshes don't exist yet if the graph was restored before the GL setup
+	if (mNodeColorsVbo) {
+		this->setColorAttribs();
+	}
+	return true;
 }
 
 gl::TextureCubeMapRef NetworkApp::draw()
 {
-	gl::context()->pushFramebuffer();
-
-	gl::ScopedDepth scpDepth(true);
-
-	gl::ScopedViewport scpView(0, 0, mOutputCubeFbo->getWidth(), mOutputCubeFbo->getHeight());
-	gl::ScopedMatrices scpMat;
-
-	gl::pointSize(5.0);
+	{
+		gl::ScopedFramebuffer scpFbo(GL_FRAMEBUFFER, mOutputCubeFbo->getId());
 
-	gl::ScopedGlslProg scpShader(mRenderToCubeMap);
-
-	for (uint8_t dir = 0; dir < 6; ++dir) {
-		gl::setProjectionMatrix(ci::CameraPersp(mOutputCubeFbo->getWidth(), mOutputCubeFbo->getHeight(), 90.0f, 0.5, 5.0).getProjectionMatrix());
-		gl::setViewMatrix(mOutputCubeFbo->calcViewMatrix(GL_TEXTURE_CUBE_MAP_POSITIVE_X + dir, vec3(0)));
-		mOutputCubeFbo->bindFramebufferFace(GL_TEXTURE_CUBE_MAP_POSITIVE_X + dir);
+		gl::ScopedDepth scpDepth(true);
+		gl::ScopedViewport scpView(0, 0, mOutputCubeFbo->getWidth(), mOutputCubeFbo->getHeight());
 
 		gl::clear(ColorA(0, 0, 0, 0));
-		gl::draw(mLinksMesh);
-		gl::draw(mNodesMesh);
-	}
 
-	gl::pointSize(1.0);
+		mOutputCubeMatrices->bindBufferBase(mOutputCubeMatricesBind);
+		mLinksBatch->getGlslProg()->uniformBlock("uMatrices", mOutputCubeMatricesBind);
+		mNodesBatch->getGlslProg()->uniformBlock("uMatrices", mOutputCubeMatricesBind);
 
-	gl::context()->popFramebuffer();
+		gl::pointSize(NODE_POINT_SIZE);
+		mLinksBatch->draw();
+		mNodesBatch->draw();
+		gl::pointSize(1.0);
+	}
 
-	return mOutputCubeFbo->getTextureCubeMap();
+	auto cubeMapTex = mOutputCubeFbo->getColorTex();
+	{
+		gl::ScopedTextureBind scpTex(cubeMapTex);
+		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	}
+	return cubeMapTex;
 }
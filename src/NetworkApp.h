@@ -1,31 +1,25 @@
 #pragma once
 
 #include <vector>
-#include <unordered_set>
-#include <utility>
-#include <algorithm>
-#include <numeric>
 
-#include "cinder/Rand.h"
+#include "cinder/app/App.h"
+#include "cinder/gl/gl.h"
 
 #include "CoreMath.h"
+#include "FboCubeMapLayered.h"
 
-class NetworkNode {
-public:
-	bool mInfected = false;
-	uint mId;
-	vec3 mPos;
-	std::unordered_set<uint> mLinks;
-
-	NetworkNode(uint id, vec3 pos) : mId(id), mPos(pos) {}
-};
-
-typedef std::shared_ptr<NetworkNode> NetworkNodeRef;
+#include "NetworkSim.h"
+#include "NetworkFaceBuckets.h"
+#include "MemoryLedger.h"
+#include "Telemetry.h"
 
 class NetworkApp {
 public:
 	NetworkApp() {}
 
+	// Builds the node graph. Touches no GL state, so it can run on a worker thread during startup
+	void setupGraph() { mSim.setup(); }
+	// Creates the GL resources for a graph built by setupGraph()
 	void setup();
 	void update();
 	ci::gl::TextureCubeMapRef draw();
@@ -33,18 +27,26 @@ public:
 
 	void setColorAttribs();
 
-	int const mNumNetworkNodes = 2000;
-	int const mNumLinksPerNode = 8;
-	float const mNodeDisinfectChance = 0.04;
-	float const mSpreadInfectionChance = 0.007;
-	int const mMinInfected = 20;
+	void saveState(CheckpointWriter & writer) const { mSim.saveState(writer); }
+	bool restoreState(Checkpoint const & checkpoint);
+
+	void collectTelemetry(TelemetrySample & sample) const {
+		sample.mNetworkInfected = mSim.getNumInfected();
+		sample.mNetworkNodes = mSim.mNetworkNodes.size();
+	}
+
+	NetworkSim mSim;
 
-	std::vector<NetworkNode> mNetworkNodes;
-	std::vector<std::pair<uint, uint>> mNetworkLinks;
+	// Sorted by face once the graph is built, the nodes and links meshes index into the same node vertices
+	NetworkFaceBuckets mFaceBuckets;
+	ci::gl::VboRef mNodeColorsVbo;
+	ci::gl::BatchRef mNodesBatch;
+	ci::gl::BatchRef mLinksBatch;
 
-	ci::gl::VboMeshRef mNodesMesh;
-	ci::gl::VboMeshRef mLinksMesh;
+	// Every face in one pass, see NWRenderIntoCubeMap_*_g.glsl
+	FboCubeMapLayeredRef mOutputCubeFbo;
+	ci::gl::UboRef mOutputCubeMatrices;
+	uint8_t mOutputCubeMatricesBind = 3;
 
-	ci::gl::GlslProgRef mRenderToCubeMap;
-	ci::gl::FboCubeMapRef mOutputCubeFbo;
+	MemoryAccount mMemory { "Network" };
 };
\ No newline at end of file
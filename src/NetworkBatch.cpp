@@ -0,0 +1,135 @@
+#include "NetworkBatch.h"
+
+#include <algorithm>
+
+#include "TaskScheduler.h"
+
+using namespace ci;
+using std::vector;
+
+NetworkTopology::NetworkTopology(NetworkSim const & sim) {
+	size_t numNodes = sim.mNetworkNodes.size();
+	mOffsets.reserve(numNodes + 1);
+	mPositions.reserve(numNodes);
+
+	mOffsets.push_back(0);
+	for (auto const & node : sim.mNetworkNodes) {
+		mNeighbors.insert(mNeighbors.end(), node.mLinks.begin(), node.mLinks.end());
+		mOffsets.push_back((uint32_t) mNeighbors.size());
+		mPositions.push_back(node.mPos);
+	}
+}
+
+size_t NetworkTopology::getByteSize() const {
+	return mOffsets.capacity() * sizeof(uint32_t) + mNeighbors.capacity() * sizeof(uint32_t) + mPositions.capacity() * sizeof(vec3);
+}
+
+NetworkRates::NetworkRates(NetworkSim const & sim)
+	: mNodeDisinfectChance(sim.mNodeDisinfectChance), mSpreadInfectionChance(sim.mSpreadInfectionChance), mMinInfected(sim.mMinInfected)
+{}
+
+NetworkBatch::NetworkBatch(NetworkTopologyRef topology, NetworkRates const & rates, int numThreads)
+	: mTopology(topology), mRates(rates)
+{
+	mNumThreads = numThreads > 0 ? numThreads : TaskScheduler::get().getConcurrency();
+}
+
+int NetworkBatch::addWorld(NetworkSim const & sim) {
+	int world = getNumWorlds();
+	size_t numNodes = mTopology->getNumNodes();
+
+	// Open a new lane every 8 worlds
+	if (world % WORLDS_PER_LANE == 0) {
+		mInfected.resize(mInfected.size() + numNodes, 0);
+		mNextInfected.resize(mInfected.size(), 0);
+	}
+
+	uint8_t * lane = getLane(mInfected, world);
+	uint8_t const bit = 1 << (world % WORLDS_PER_LANE);
+	for (size_t idx = 0; idx < numNodes; idx++) {
+		if (sim.mNetworkNodes[idx].mInfected) {
+			lane[idx] |= bit;
+		}
+	}
+
+	mRands.push_back(sim.mRand);
+	mNumInfected.push_back(sim.mNumInfected);
+	return world;
+}
+
+void NetworkBatch::step() {
+	int numLanes = (getNumWorlds() + WORLDS_PER_LANE - 1) / WORLDS_PER_LANE;
+
+	TaskScheduler::get().parallelFor(numLanes, mNumThreads, [this] (size_t lane, size_t) { stepLane((int) lane); });
+
+	std::swap(mInfected, mNextInfected);
+}
+
+void NetworkBatch::stepLane(int lane) {
+	NetworkTopology const & topology = * mTopology;
+	size_t const numNodes = topology.getNumNodes();
+	int const firstWorld = lane * WORLDS_PER_LANE;
+	int const numLaneWorlds = std::min(WORLDS_PER_LANE, getNumWorlds() - firstWorld);
+
+	uint8_t const * infected = getLane(mInfected, firstWorld);
+	uint8_t * willBeInfected = getLane(mNextInfected, firstWorld);
+	std::fill(willBeInfected, willBeInfected + numNodes, 0);
+
+	// The same bookkeeping as NetworkSim::step(), for each world's bit
+	int32_t numInfected[WORLDS_PER_LANE] = {};
+	auto setInfected = [&] (uint32_t id, int world, bool infected) {
+		uint8_t const bit = 1 << world;
+		if (((willBeInfected[id] & bit) != 0) != infected) {
+			willBeInfected[id] ^= bit;
+			numInfected[world] += infected ? 1 : -1;
+		}
+	};
+
+	for (uint32_t idx = 0; idx < numNodes; idx++) {
+		uint8_t const worlds = infected[idx];
+		if (worlds == 0) {
+			continue;
+		}
+		// Every world with this node infected. Each world still sees its own nodes in order
+		for (int world = 0; world < numLaneWorlds; world++) {
+			if (!(worlds & (1 << world))) {
+				continue;
+			}
+			SimRandom & rand = mRands[firstWorld + world];
+
+			setInfected(idx, world, !(rand.nextFloat() < mRates.mNodeDisinfectChance));
+			for (uint32_t const * other = topology.getNeighborsBegin(idx); other != topology.getNeighborsEnd(idx); other++) {
+				if (rand.nextFloat() < mRates.mSpreadInfectionChance) { setInfected(* other, world, true); }
+			}
+		}
+	}
+
+	for (int world = 0; world < numLaneWorlds; world++) {
+		SimRandom & rand = mRands[firstWorld + world];
+		if (numInfected[world] < mRates.mMinInfected) {
+			float const chance = (float) mRates.mMinInfected / numNodes;
+			for (uint32_t idx = 0; idx < numNodes; idx++) {
+				if (rand.nextFloat() < chance) { setInfected(idx, world, true); }
+			}
+		}
+		mNumInfected[firstWorld + world] = numInfected[world];
+	}
+}
+
+void NetworkBatch::disrupt(int world, vec3 dir) {
+	vec3 const disruptDir = normalize(dir);
+	uint8_t * lane = getLane(mInfected, world);
+	uint8_t const bit = 1 << (world % WORLDS_PER_LANE);
+
+	for (uint32_t idx = 0; idx < mTopology->getNumNodes(); idx++) {
+		if (distance(mTopology->getPosition(idx), disruptDir) < NETWORK_DISRUPT_RADIUS && !(lane[idx] & bit)) {
+			lane[idx] |= bit;
+			mNumInfected[world]++;
+		}
+	}
+}
+
+size_t NetworkBatch::getByteSize() const {
+	return (mInfected.capacity() + mNextInfected.capacity()) * sizeof(uint8_t) + mRands.capacity() * sizeof(SimRandom)
+		+ mNumInfected.capacity() * sizeof(uint32_t);
+}
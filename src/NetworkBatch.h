@@ -0,0 +1,88 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/Vector.h"
+
+#include "NetworkSim.h"
+#include "SimRandom.h"
+
+// Steps many independent infection worlds together, for hosts that run several installations at once.
+//
+// Worlds on the same graph share one NetworkTopology, a flat adjacency, and each keeps only its infection bits, its
+// RNG and its count. The bits are interleaved in lanes of 8 worlds, a byte per node, so one sweep over the nodes
+// steps all 8 while each node's neighbours are in cache. Lanes step in parallel, so a batch uses as many cores as
+// it has lanes. Each world draws from its RNG in the same order NetworkSim::step() does, so a world steps exactly
+// like a NetworkSim on the same graph and state.
+
+// The graph of a NetworkSim, read only once built
+class NetworkTopology {
+public:
+	// Neighbours come out in the order NetworkSim::step() visits them
+	explicit NetworkTopology(NetworkSim const & sim);
+
+	size_t getNumNodes() const { return mPositions.size(); }
+	uint32_t const * getNeighborsBegin(uint32_t node) const { return & mNeighbors[mOffsets[node]]; }
+	uint32_t const * getNeighborsEnd(uint32_t node) const { return & mNeighbors[mOffsets[node + 1]]; }
+	ci::vec3 const & getPosition(uint32_t node) const { return mPositions[node]; }
+
+	size_t getByteSize() const;
+
+private:
+	std::vector<uint32_t> mOffsets;
+	std::vector<uint32_t> mNeighbors;
+	std::vector<ci::vec3> mPositions;
+};
+
+typedef std::shared_ptr<NetworkTopology const> NetworkTopologyRef;
+
+// The rates NetworkSim steps with, shared by every world in a batch
+struct NetworkRates {
+	NetworkRates() {}
+	explicit NetworkRates(NetworkSim const & sim);
+
+	float mNodeDisinfectChance = 0.04f;
+	float mSpreadInfectionChance = 0.007f;
+	int mMinInfected = 20;
+};
+
+class NetworkBatch {
+public:
+	static int const WORLDS_PER_LANE = 8;
+
+	// Lanes are split across up to numThreads of the task scheduler's threads, 0 for all of them
+	NetworkBatch(NetworkTopologyRef topology, NetworkRates const & rates, int numThreads = 0);
+
+	// Adds a world in the infection and RNG state of a sim on the same graph. Returns its index
+	int addWorld(NetworkSim const & sim);
+
+	void step();
+	void disrupt(int world, ci::vec3 dir);
+
+	int getNumWorlds() const { return (int) mRands.size(); }
+	bool isInfected(int world, uint32_t node) const { return (getLane(mInfected, world)[node] >> (world % WORLDS_PER_LANE)) & 1; }
+	uint32_t getNumInfected(int world) const { return mNumInfected[world]; }
+	SimRandom const & getRandom(int world) const { return mRands[world]; }
+
+	NetworkTopology const & getTopology() const { return * mTopology; }
+	// Infection bits, RNGs and counts, not counting the topology
+	size_t getByteSize() const;
+
+private:
+	void stepLane(int lane);
+
+	uint8_t * getLane(std::vector<uint8_t> & bits, int world) { return & bits[(size_t) (world / WORLDS_PER_LANE) * mTopology->getNumNodes()]; }
+	uint8_t const * getLane(std::vector<uint8_t> const & bits, int world) const { return & bits[(size_t) (world / WORLDS_PER_LANE) * mTopology->getNumNodes()]; }
+
+	NetworkTopologyRef mTopology;
+	NetworkRates mRates;
+	size_t mNumThreads;
+
+	// A byte per node per lane, lane by lane, bit w of a byte for world lane * 8 + w
+	std::vector<uint8_t> mInfected;
+	std::vector<uint8_t> mNextInfected;
+	std::vector<SimRandom> mRands;
+	std::vector<uint32_t> mNumInfected;
+};
@@ -0,0 +1,28 @@
+#include "NetworkFaceBuckets.h"
+
+using namespace ci;
+
+NetworkFaceBuckets buildNetworkFaceBuckets(NetworkSim const & sim, CubeFaceFrustum const & frustum) {
+	NetworkFaceBuckets buckets;
+
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		buckets.mNodeStarts[face] = (int) buckets.mNodeIndices.size();
+		for (auto const & node : sim.mNetworkNodes) {
+			if (isPointInCubeFace(node.mPos, face, frustum)) {
+				buckets.mNodeIndices.push_back(node.mId);
+			}
+		}
+
+		buckets.mLinkStarts[face] = (int) buckets.mLinkIndices.size() / 2;
+		for (auto const & link : sim.mNetworkLinks) {
+			if (isSegmentInCubeFace(sim.mNetworkNodes[link.first].mPos, sim.mNetworkNodes[link.second].mPos, face, frustum)) {
+				buckets.mLinkIndices.push_back(link.first);
+				buckets.mLinkIndices.push_back(link.second);
+			}
+		}
+	}
+
+	buckets.mNodeStarts[NUM_CUBE_FACES] = (int) buckets.mNodeIndices.size();
+	buckets.mLinkStarts[NUM_CUBE_FACES] = (int) buckets.mLinkIndices.size() / 2;
+	return buckets;
+}
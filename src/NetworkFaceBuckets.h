@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "CubeFaces.h"
+#include "NetworkSim.h"
+
+// The network's nodes and links sorted by the cube faces they show up on, so the layered render only sends each face
+// the geometry inside its frustum. The nodes never move, so this is built once, after the graph.
+//
+// Each face's primitives are one contiguous run, in face order, and a primitive near an edge is repeated in every face
+// it reaches. The index lists go straight into index buffers over the node vertices.
+
+struct NetworkFaceBuckets {
+	// Node indices, one per point
+	std::vector<uint32_t> mNodeIndices;
+	// Node index pairs, one pair per line
+	std::vector<uint32_t> mLinkIndices;
+	// First primitive of each face's run, then the total
+	int mNodeStarts[NUM_CUBE_FACES + 1];
+	int mLinkStarts[NUM_CUBE_FACES + 1];
+
+	int getNumNodes(int face) const { return mNodeStarts[face + 1] - mNodeStarts[face]; }
+	int getNumLinks(int face) const { return mLinkStarts[face + 1] - mLinkStarts[face]; }
+};
+
+NetworkFaceBuckets buildNetworkFaceBuckets(NetworkSim const & sim, CubeFaceFrustum const & frustum);
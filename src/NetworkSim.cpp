@@ -0,0 +1,115 @@
+#include "NetworkSim.h"
+
+using namespace ci;
+using std::vector;
+
+void NetworkSim::setup()
+{
+	// Set up the simulation data
+	for (int idx = 0; idx < mNumNetworkNodes; idx++) {
+		mNetworkNodes.push_back(NetworkNode(idx, mRand.nextVec3()));
+		if (mRand.nextFloat() < 0.1) { mNetworkNodes[idx].mInfected = true; mNumInfected++; }
+	}
+
+	vector<NetworkNode *> nodePointers;
+	for (auto & node : mNetworkNodes) {
+		nodePointers.push_back(& node);
+	}
+
+	for (auto & node : mNetworkNodes) {
+		// Sort according to distance (only the nearest few need to end up in order)
+		std::partial_sort(nodePointers.begin(), nodePointers.begin() + mNumLinksPerNode + 1, nodePointers.end(), [& node] (NetworkNode * p1, NetworkNode * p2) {
+			float d1 = distance(node.mPos, p1->mPos);
+			float d2 = distance(node.mPos, p2->mPos);
+			return d1 < d2;
+		});
+		// Take the nearest ones, knowing the the first one will be the node itself
+		for (int i = 1; i <= mNumLinksPerNode; i++) {
+			node.mLinks.insert(nodePointers[i]->mId);
+			nodePointers[i]->mLinks.insert(node.mId);
+			mNetworkLinks.push_back(std::make_pair(nodePointers[i]->mId, node.mId));
+		}
+	}
+}
+
+void NetworkSim::step()
+{
+	vector<bool> willBeInfected(mNetworkNodes.size(), false);
+	// Kept up to date as the flags change, so telemetry and the minimum check never have to count them
+	uint32_t numInfected = 0;
+	auto setInfected = [&] (uint32_t id, bool infected) {
+		if (willBeInfected[id] != infected) {
+			willBeInfected[id] = infected;
+			numInfected += infected ? 1 : -1;
+		}
+	};
+
+	for (int idx = 0; idx < mNetworkNodes.size(); idx++) {
+		auto & node = mNetworkNodes[idx];
+		if (node.mInfected) {
+			if (mRand.nextFloat() < mNodeDisinfectChance) { setInfected(node.mId, false); } else { setInfected(node.mId, true); }
+			for (uint otherId : node.mLinks) {
+				if (mRand.nextFloat() < mSpreadInfectionChance) { setInfected(otherId, true); }
+			}
+		}
+	}
+
+	if (numInfected < mMinInfected) {
+		for (auto & node : mNetworkNodes) {
+			if (mRand.nextFloat() < (float) mMinInfected / mNumNetworkNodes) { setInfected(node.mId, true); }
+		}
+	}
+
+	for (int idx = 0; idx < mNetworkNodes.size(); idx++) {
+		mNetworkNodes[idx].mInfected = willBeInfected[idx];
+	}
+	mNumInfected = numInfected;
+}
+
+void NetworkSim::disrupt(vec3 dir) {
+	vec3 const disruptDir = normalize(dir);
+
+	for (auto & node : mNetworkNodes) {
+		if (distance(node.mPos, disruptDir) < NETWORK_DISRUPT_RADIUS && !node.mInfected) {
+			node.mInfected = true;
+			mNumInfected++;
+		}
+	}
+}
+
+void NetworkSim::saveState(CheckpointWriter & writer) const {
+	vector<uint8_t> infected((mNetworkNodes.size() + 7) / 8, 0);
+	for (size_t idx = 0; idx < mNetworkNodes.size(); idx++) {
+		if (mNetworkNodes[idx].mInfected) {
+			infected[idx / 8] |= 1 << (idx % 8);
+		}
+	}
+	writer.addSection("NWIN", std::move(infected), 1);
+	writer.addSection("NWRG", & mRand.getState(), sizeof(SimRandom::State), 8);
+}
+
+bool NetworkSim::restoreState(Checkpoint const & checkpoint) {
+	vector<uint8_t> infected((mNetworkNodes.size() + 7) / 8);
+	SimRandom::State randState;
+	if (!checkpoint.readSection("NWIN", infected.data(), infected.size())
+		|| !checkpoint.readSection("NWRG", & randState, sizeof(randState))) {
+		return false;
+	}
+
+	mNumInfected = 0;
+	for (size_t idx = 0; idx < mNetworkNodes.size(); idx++) {
+		mNetworkNodes[idx].mInfected = (infected[idx / 8] >> (idx % 8)) & 1;
+		mNumInfected += mNetworkNodes[idx].mInfected;
+	}
+	mRand.setState(randState);
+	return true;
+}
+
+size_t NetworkSim::getByteSize() const {
+	size_t bytes = mNetworkNodes.capacity() * sizeof(NetworkNode) + mNetworkLinks.capacity() * sizeof(mNetworkLinks[0]);
+	for (auto const & node : mNetworkNodes) {
+		// A bucket pointer per bucket, and a heap node with a next pointer and the cached hash per entry
+		bytes += node.mLinks.bucket_count() * sizeof(void *) + node.mLinks.size() * (sizeof(uint32_t) + 2 * sizeof(void *));
+	}
+	return bytes;
+}
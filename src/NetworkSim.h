@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_set>
+#include <utility>
+#include <algorithm>
+
+#include "cinder/Vector.h"
+
+#include "SimRandom.h"
+#include "Checkpoint.h"
+
+class NetworkNode {
+public:
+	bool mInfected = false;
+	uint32_t mId;
+	ci::vec3 mPos;
+	std::unordered_set<uint32_t> mLinks;
+
+	NetworkNode(uint32_t id, ci::vec3 pos) : mId(id), mPos(pos) {}
+};
+
+typedef std::shared_ptr<NetworkNode> NetworkNodeRef;
+
+// Nodes this close to a disruption's point on the sphere get infected
+float const NETWORK_DISRUPT_RADIUS = 0.45f;
+
+// The infection simulation behind NetworkApp. Touches no GL state, so it can be built on a worker thread and run headless
+class NetworkSim {
+public:
+	NetworkSim() {}
+
+	// Scatters the nodes and links each one to its nearest neighbours
+	void setup();
+	void step();
+	void disrupt(ci::vec3 dir);
+
+	// Infection bits and RNG state. The graph itself isn't saved, it's rebuilt identically from the seed by setup()
+	void saveState(CheckpointWriter & writer) const;
+	bool restoreState(Checkpoint const & checkpoint);
+
+	uint32_t getNumInfected() const { return mNumInfected; }
+
+	// Approximate heap footprint of the nodes, their link sets and the link list
+	size_t getByteSize() const;
+
+	int mNumNetworkNodes = 2000;
+	int mNumLinksPerNode = 8;
+	float mNodeDisinfectChance = 0.04;
+	float mSpreadInfectionChance = 0.007;
+	int mMinInfected = 20;
+
+	// Saved along with the infection state in checkpoints, so a restored run carries on exactly
+	SimRandom mRand;
+
+	std::vector<NetworkNode> mNetworkNodes;
+	// Maintained by every change to the infection flags
+	uint32_t mNumInfected = 0;
+	std::vector<std::pair<uint32_t, uint32_t>> mNetworkLinks;
+};
@@ -0,0 +1,157 @@
+#include "PreviewWindow.h"
+
+#include <algorithm>
+
+#include "cinder/app/App.h"
+#include "cinder/gl/VertBatch.h"
+
+using namespace ci;
+
+PreviewPolicy PreviewPolicy::reduced(int frameInterval, float resolutionScale) {
+	PreviewPolicy policy;
+	policy.mMode = Mode::REDUCED;
+	policy.mFrameInterval = std::max(frameInterval, 1);
+	policy.mResolutionScale = glm::clamp(resolutionScale, 0.1f, 1.0f);
+	return policy;
+}
+
+PreviewPolicy PreviewPolicy::disabled() {
+	PreviewPolicy policy;
+	policy.mMode = Mode::DISABLED;
+	return policy;
+}
+
+bool PreviewPolicy::parse(std::string const & text, PreviewPolicy & policy) {
+	if (text == "full") {
+		policy = full();
+	} else if (text == "reduced") {
+		policy = reduced();
+	} else if (text == "off") {
+		policy = disabled();
+	} else {
+		return false;
+	}
+	return true;
+}
+
+std::string PreviewPolicy::getName() const {
+	switch (mMode) {
+		case Mode::FULL: return "full";
+		case Mode::REDUCED: return "reduced (every " + std::to_string(mFrameInterval) + " frames at " + std::to_string(mResolutionScale) + "x)";
+		case Mode::DISABLED: return "off";
+	}
+	return "";
+}
+
+void PreviewWindow::setup(gl::GlslProgRef const & sphereShader) {
+	mSphereShader = sphereShader;
+	mSphereBatch = gl::Batch::create(geom::Sphere().center(vec3(0)).radius(1.0f).subdivisions(50), mSphereShader);
+	mMemory.addVboMesh(mSphereBatch->getVboMesh());
+
+	// Same axes and colors as gl::drawCoordinateFrame(2.0f), without the arrow heads
+	gl::VertBatch axes(GL_LINES);
+	axes.color(Color(1, 0, 0)); axes.vertex(vec3(0)); axes.vertex(vec3(2, 0, 0));
+	axes.color(Color(0, 1, 0)); axes.vertex(vec3(0)); axes.vertex(vec3(0, 2, 0));
+	axes.color(Color(0, 0, 1)); axes.vertex(vec3(0)); axes.vertex(vec3(0, 0, 2));
+	mAxesBatch = gl::Batch::create(axes, gl::getStockShader(gl::ShaderDef().color()));
+	mMemory.addVboMesh(mAxesBatch->getVboMesh());
+}
+
+void PreviewWindow::setPolicy(PreviewPolicy const & policy) {
+	mPolicy = policy;
+	mFrame = 0;
+
+	if (mPolicy.mMode != PreviewPolicy::Mode::REDUCED) {
+		releaseReducedFbo();
+	}
+}
+
+void PreviewWindow::releaseReducedFbo() {
+	if (!mReducedFbo) {
+		return;
+	}
+
+	mReducedFbo.reset();
+	mMemory.releaseAll();
+	// The cached geometry stays, so count it again
+	mMemory.addVboMesh(mSphereBatch->getVboMesh());
+	mMemory.addVboMesh(mAxesBatch->getVboMesh());
+}
+
+void PreviewWindow::cyclePolicy() {
+	switch (mPolicy.mMode) {
+		case PreviewPolicy::Mode::FULL: setPolicy(PreviewPolicy::reduced()); break;
+		case PreviewPolicy::Mode::REDUCED: setPolicy(PreviewPolicy::disabled()); break;
+		case PreviewPolicy::Mode::DISABLED: setPolicy(PreviewPolicy::full()); break;
+	}
+}
+
+bool PreviewWindow::draw(CameraPersp const & camera, gl::TextureCubeMapRef const & frame, float frameAlpha, bool drawAxes) {
+	ivec2 windowSize = app::getWindowSize();
+
+	switch (mPolicy.mMode) {
+		case PreviewPolicy::Mode::DISABLED: {
+			gl::clear();
+			return false;
+		}
+
+		case PreviewPolicy::Mode::FULL: {
+			gl::clear();
+			drawScene(camera, frame, frameAlpha, drawAxes, windowSize);
+			return true;
+		}
+
+		case PreviewPolicy::Mode::REDUCED: {
+			ivec2 reducedSize = glm::max(ivec2(vec2(windowSize) * mPolicy.mResolutionScale), ivec2(1));
+
+			bool redraw = mFrame++ % mPolicy.mFrameInterval == 0;
+			if (!mReducedFbo || mReducedFbo->getSize() != reducedSize) {
+				releaseReducedFbo();
+				mReducedFbo = gl::Fbo::create(reducedSize.x, reducedSize.y);
+				mMemory.addFbo(mReducedFbo, true);
+				redraw = true;
+			}
+
+			if (redraw) {
+				gl::ScopedFramebuffer scpFbo(mReducedFbo);
+				gl::ScopedViewport scpView(ivec2(0), reducedSize);
+				gl::clear();
+				drawScene(camera, frame, frameAlpha, drawAxes, reducedSize);
+			}
+
+			gl::clear();
+			gl::ScopedMatrices scpMat;
+			gl::setMatricesWindow(windowSize);
+			gl::draw(mReducedFbo->getColorTexture(), Rectf(vec2(0), vec2(windowSize)));
+			return false;
+		}
+	}
+
+	return false;
+}
+
+void PreviewWindow::drawScene(CameraPersp const & camera, gl::TextureCubeMapRef const & frame, float frameAlpha, bool drawAxes, ivec2 size) {
+	{
+		gl::ScopedDepth scpDepth(true);
+		gl::ScopedFaceCulling scpCull(true, GL_BACK);
+
+		gl::ScopedMatrices scpMat;
+		gl::setMatrices(camera);
+
+		gl::ScopedTextureBind scpTex(frame);
+		mSphereShader->uniform("uFrameAlpha", frameAlpha);
+		mSphereBatch->draw();
+	}
+
+	gl::ScopedMatrices scpMat;
+	gl::setMatricesWindow(size);
+	gl::drawString(std::to_string(app::App::get()->getAverageFps()), vec2(10.0f, size.y - 40.0f), ColorA(1.0f, 1.0f, 1.0f, 1.0f));
+
+	if (drawAxes) {
+		gl::ScopedDepth scpDepth(true);
+		gl::ScopedMatrices scpAxesMat;
+		gl::setMatrices(camera);
+
+		mAxesBatch->draw();
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+
+#include "cinder/Camera.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Batch.h"
+#include "cinder/gl/Fbo.h"
+
+#include "MemoryLedger.h"
+
+// How much of the frame budget the preview window gets. The show output goes out over Syphon either way
+struct PreviewPolicy {
+	enum class Mode {
+		FULL, // Drawn straight into the window every frame, with the debug overlays
+		REDUCED, // Drawn offscreen every mFrameInterval frames at mResolutionScale, and shown scaled up in between
+		DISABLED
+	};
+
+	Mode mMode = Mode::FULL;
+	int mFrameInterval = 1;
+	float mResolutionScale = 1.0f;
+
+	static PreviewPolicy full() { return PreviewPolicy(); }
+	static PreviewPolicy reduced(int frameInterval = 10, float resolutionScale = 0.5f);
+	static PreviewPolicy disabled();
+
+	// "full", "reduced" or "off". Returns false and leaves policy alone for anything else
+	static bool parse(std::string const & text, PreviewPolicy & policy);
+	std::string getName() const;
+};
+
+// The sphere preview of the current cube map frame. The preview geometry is built once, up front, instead of every frame
+class PreviewWindow {
+public:
+	PreviewWindow() {}
+
+	void setup(ci::gl::GlslProgRef const & sphereShader);
+
+	void setPolicy(PreviewPolicy const & policy);
+	PreviewPolicy const & getPolicy() const { return mPolicy; }
+	// Full, then reduced, then disabled, then back to full
+	void cyclePolicy();
+
+	// Draws into the window following the policy. Returns true if the window got a full rate redraw, which is when
+	// interactive overlays like the params menu should be drawn on top
+	bool draw(ci::CameraPersp const & camera, ci::gl::TextureCubeMapRef const & frame, float frameAlpha, bool drawAxes);
+
+private:
+	void releaseReducedFbo();
+	void drawScene(ci::CameraPersp const & camera, ci::gl::TextureCubeMapRef const & frame, float frameAlpha, bool drawAxes, ci::ivec2 size);
+
+	PreviewPolicy mPolicy;
+	uint32_t mFrame = 0;
+
+	ci::gl::GlslProgRef mSphereShader;
+	ci::gl::BatchRef mSphereBatch;
+	ci::gl::BatchRef mAxesBatch;
+	// Only exists while the policy is REDUCED
+	ci::gl::FboRef mReducedFbo;
+
+	MemoryAccount mMemory { "Preview" };
+};
@@ -1,5 +1,9 @@
 #include "ReactionDiffusionApp.h"
 
+#include <algorithm>
+
+#include "cinder/Log.h"
+
 extern uint32_t OUTPUT_CUBE_MAP_SIDE;
 
 void ReactionDiffusionApp::setup() {
@@ -20,6 +24,7 @@ void ReactionDiffusionApp::setup() {
 		glDrawBuffers(1, drawBuffers);
 		gl::clear(Color(0, 1, 0)); // Clear to all "A"
 	}
+	mMemory.addTexture(mSourceTex);
 
 	{
 		mDestTex = gl::TextureCubeMap::create(mCubeMapSide, mCubeMapSide, colorTextureFormat);
@@ -29,6 +34,7 @@ void ReactionDiffusionApp::setup() {
 		glDrawBuffers(1, drawBuffers);
 		gl::clear(Color(0, 1, 0)); // Clear to all "A"
 	}
+	mMemory.addTexture(mDestTex);
 
 	mRDProgram = gl::GlslProg::create(ci::app::loadResource("RDRunReactionDiffusion_v.glsl"), ci::app::loadResource("RDRunReactionDiffusion_f.glsl"), ci::app::loadResource("RDRunReactionDiffusion_g.glsl"));
 	mRDProgram->uniform("gridSideLength", mCubeMapSide);
@@ -44,6 +50,7 @@ void ReactionDiffusionApp::setup() {
 		auto pointVbo = gl::Vbo::create(GL_ARRAY_BUFFER, sizeof(vec3), pointBuf, GL_STATIC_DRAW);
 		auto pointVboLayout = geom::BufferLayout({ geom::AttribInfo(geom::POSITION, 3, 0, 0) });
 		mPointMesh = gl::VboMesh::create(1, GL_POINTS, { { pointVboLayout, pointVbo } });
+		mMemory.addVboMesh(mPointMesh);
 	}
 
 	mDisruptShader = gl::GlslProg::create(ci::app::loadResource("RDRunReactionDiffusion_v.glsl"), ci::app::loadResource("RDDisruptReactionDiffusion_f.glsl"), ci::app::loadResource("RDRunReactionDiffusion_g.glsl"));
@@ -52,6 +59,7 @@ void ReactionDiffusionApp::setup() {
 	mRenderRDProgram->uniform("uGridSampler", mRDRenderTextureBinding);
 
 	mCubeMapFacesMesh = makeCubeMapFaceMesh();
+	mMemory.addVboMesh(mCubeMapFacesMesh);
 	mRenderCubeMapBatch = gl::Batch::create(mCubeMapFacesMesh, mRenderRDProgram, { { geom::CUSTOM_0, "aFaceIndex" } });
 
 	auto cameraCubeMapFormat = gl::TextureCubeMap::Format()
@@ -62,11 +70,105 @@ void ReactionDiffusionApp::setup() {
 	auto cubeMapFboFmt = FboCubeMapLayered::Format().colorFormat(cameraCubeMapFormat);
 
 	mCubeMapCamera = FboCubeMapLayered::create(OUTPUT_CUBE_MAP_SIDE, OUTPUT_CUBE_MAP_SIDE, cubeMapFboFmt);
+	mMemory.addFbo(mCubeMapCamera);
 
 	setupCircleRD(20);
+
+	if (mSphereSide > 0) {
+		setupSphere();
+	} else if (mShardOptions.mNumShards > 0) {
+		setupShards();
+	}
+}
+
+void ReactionDiffusionApp::setupSphere() {
+	mSphere.reset(new RDSphereGrid(RDSphereGrid::create<RDShardPreset::Stencil>(mSphereSide)));
+	mSphereSource = ReactionDiffusionGrid(mSphereSide);
+	mSphereDest = ReactionDiffusionGrid(mSphereSide);
+	CI_LOG_I("Reaction diffusion on a " << mSphereSide << " side sphere grid, cell areas within " << mSphere->getAreaRatio() << "x");
+
+	// setupCircleRD(20) is 20 texels at the cube grid's face center, which is 20 * 4 / pi of its face coordinates
+	setupCircleReactionDiffusion(mSphereSource, 20.0f * 4.0f * mSphereSide / (glm::pi<float>() * mCubeMapSide));
+
+	auto sphereTextureFormat = gl::TextureCubeMap::Format()
+		.internalFormat(GL_R32F)
+		.wrap(GL_CLAMP_TO_EDGE)
+		.minFilter(GL_LINEAR)
+		.magFilter(GL_LINEAR)
+		.swizzleMask(GL_ZERO, GL_ZERO, GL_RED, GL_ONE)
+		.mipmap(false);
+	mSphereTex = gl::TextureCubeMap::create(mSphereSide, mSphereSide, sphereTextureFormat);
+	mMemory.addTexture(mSphereTex);
+}
+
+void ReactionDiffusionApp::updateSphere() {
+	int const numThreads = TaskScheduler::get().getConcurrency();
+	for (int i = 0; i < mUpdatesPerFrame; i++) {
+		mSphereTotalB = stepReactionDiffusionSphere<RDShardPreset>(* mSphere, mSphereSource, mSphereDest, numThreads);
+		std::swap(mSphereSource, mSphereDest);
+	}
+
+	uploadSphereTexture();
+}
+
+void ReactionDiffusionApp::uploadSphereTexture() {
+	// Rows are padded, so each one goes up on its own
+	gl::ScopedTextureBind scpTex(mSphereTex);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, mSphereSource.getStride());
+	for (int faceIdx = 0; faceIdx < NUM_CUBE_FACES; faceIdx++) {
+		glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + faceIdx, 0, 0, 0, mSphereSide, mSphereSide, GL_RED, GL_FLOAT, & mSphereSource.mB[mSphereSource.getIndex(faceIdx, 0, 0)]);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+void ReactionDiffusionApp::setupShards() {
+	mShards = RDShardCoordinator::create(mShardOptions);
+	if (!mShards) {
+		CI_LOG_W("Couldn't start the reaction diffusion shards, staying on the GPU");
+		return;
+	}
+
+	int gatherSide = mShards->getGatherSide();
+	auto shardedTextureFormat = gl::TextureCubeMap::Format()
+		.internalFormat(GL_R32F)
+		.wrap(GL_CLAMP_TO_EDGE)
+		.minFilter(GL_NEAREST)
+		.magFilter(GL_NEAREST)
+		.swizzleMask(GL_ZERO, GL_ZERO, GL_RED, GL_ONE)
+		.mipmap(false);
+	mShardedTex = gl::TextureCubeMap::create(gatherSide, gatherSide, shardedTextureFormat);
+	mMemory.addTexture(mShardedTex);
+
+	// The workers start from the same circle as the GPU, have them run ahead while the rest of setup happens
+	mShards->beginSteps(mUpdatesPerFrame);
+}
+
+// Shows the last steps the workers finished, and has them start on the next ones right away, so they step while the
+// rest of the frame is drawn
+void ReactionDiffusionApp::updateShards() {
+	if (!mShards->finishSteps() || !mShards->beginSteps(mUpdatesPerFrame)) {
+		CI_LOG_E("Reaction diffusion shards stopped responding, falling back to the GPU");
+		mShards.reset();
+		return;
+	}
+
+	int gatherSide = mShards->getGatherSide();
+	gl::ScopedTextureBind scpTex(mShardedTex);
+	for (int faceIdx = 0; faceIdx < NUM_CUBE_FACES; faceIdx++) {
+		glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + faceIdx, 0, 0, 0, gatherSide, gatherSide, GL_RED, GL_FLOAT, mShards->getFaceB(faceIdx));
+	}
 }
 
 void ReactionDiffusionApp::update() {
+	if (mSphere) {
+		updateSphere();
+		return;
+	}
+	if (mShards) {
+		updateShards();
+		return;
+	}
+
 	gl::ScopedDepth scpDepth(false);
 
 	gl::ScopedViewport scpView(0, 0, mCubeMapSide, mCubeMapSide);
@@ -93,9 +195,18 @@ void ReactionDiffusionApp::update() {
 }
 
 void ReactionDiffusionApp::disrupt(vec3 dir) {
-	dir.y *= -1;
-	// ^^^^ This is a total hack
-	// I honestly don't know why this is necessary but it is :/
+	// Flipped in y, which is a total hack: I honestly don't know why it's necessary but it is :/
+	// The CPU paths take the same point, so a disruption lands on the same texels whichever path runs
+	vec3 point = getReactionDiffusionDisruptionPoint(dir);
+
+	if (mSphere) {
+		disruptReactionDiffusionSphere(* mSphere, mSphereSource, point);
+		return;
+	}
+	if (mShards) {
+		mShards->disrupt(point);
+		return;
+	}
 
 	gl::ScopedDepth scpDepth(false);
 
@@ -103,7 +214,7 @@ void ReactionDiffusionApp::disrupt(vec3 dir) {
 	gl::ScopedMatrices scpMat;
 	gl::setMatricesWindow(mCubeMapSide, mCubeMapSide);
 
-	mDisruptShader->uniform("uDisruptionPoint", normalize(dir));
+	mDisruptShader->uniform("uDisruptionPoint", point);
 
 	gl::ScopedGlslProg scpShader(mDisruptShader);
 
@@ -112,6 +223,172 @@ void ReactionDiffusionApp::disrupt(vec3 dir) {
 	gl::draw(mPointMesh);
 }
 
+void ReactionDiffusionApp::saveState(CheckpointWriter & writer) {
+	if (mSphere) {
+		saveSphereState(writer);
+		return;
+	}
+	// The sharded state lives in the workers. Checkpoints without RDAB restore everything but reaction diffusion
+	if (mShards) {
+		CI_LOG_W("Reaction diffusion is sharded, leaving it out of the checkpoint");
+		return;
+	}
+
+	size_t const faceTexels = mCubeMapSide * mCubeMapSide;
+
+	// Stored as all of A, then all of B. R is always zero, and planar channels compress much better
+	std::vector<float> face(3 * faceTexels);
+	std::vector<float> state(2 * NUM_CUBE_FACES * faceTexels);
+
+	gl::ScopedTextureBind scpTex(mSourceTex);
+	for (int faceIdx = 0; faceIdx < NUM_CUBE_FACES; faceIdx++) {
+		glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + faceIdx, 0, GL_RGB, GL_FLOAT, face.data());
+		float * a = & state[faceIdx * faceTexels];
+		float * b = & state[(NUM_CUBE_FACES + faceIdx) * faceTexels];
+		for (size_t idx = 0; idx < faceTexels; idx++) {
+			a[idx] = face[3 * idx + 1];
+			b[idx] = face[3 * idx + 2];
+		}
+	}
+
+	writer.addSection("RDAB", state.data(), state.size() * sizeof(float), sizeof(float));
+}
+
+bool ReactionDiffusionApp::restoreState(Checkpoint const & checkpoint) {
+	if (mSphere) {
+		return restoreSphereState(checkpoint);
+	}
+	if (mShards) {
+		return false;
+	}
+
+	size_t const faceTexels = mCubeMapSide * mCubeMapSide;
+
+	std::vector<float> state(2 * NUM_CUBE_FACES * faceTexels);
+	if (!checkpoint.readSection("RDAB", state.data(), state.size() * sizeof(float))) {
+		return false;
+	}
+
+	std::vector<float> face(3 * faceTexels, 0.0f);
+	for (int faceIdx = 0; faceIdx < NUM_CUBE_FACES; faceIdx++) {
+		float const * a = & state[faceIdx * faceTexels];
+		float const * b = & state[(NUM_CUBE_FACES + faceIdx) * faceTexels];
+		for (size_t idx = 0; idx < faceTexels; idx++) {
+			face[3 * idx + 1] = a[idx];
+			face[3 * idx + 2] = b[idx];
+		}
+
+		// Into both buffers, so the frame drawn before the next update shows the restored state too
+		for (auto & tex : { mSourceTex, mDestTex }) {
+			gl::ScopedTextureBind scpTex(tex);
+			glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + faceIdx, 0, 0, 0, mCubeMapSide, mCubeMapSide, GL_RGB, GL_FLOAT, face.data());
+		}
+	}
+
+	return true;
+}
+
+// Stored as all of A, then all of B, without the ghost cells. A checkpoint from a sphere of another side has a section of
+// another size, and isn't restored
+void ReactionDiffusionApp::saveSphereState(CheckpointWriter & writer) {
+	size_t const faceCells = (size_t) mSphereSide * mSphereSide;
+	std::vector<float> state(2 * NUM_CUBE_FACES * faceCells);
+	for (int faceIdx = 0; faceIdx < NUM_CUBE_FACES; faceIdx++) {
+		for (int row = 0; row < mSphereSide; row++) {
+			size_t src = mSphereSource.getIndex(faceIdx, 0, row);
+			size_t dst = faceIdx * faceCells + (size_t) row * mSphereSide;
+			std::copy_n(& mSphereSource.mA[src], mSphereSide, & state[dst]);
+			std::copy_n(& mSphereSource.mB[src], mSphereSide, & state[NUM_CUBE_FACES * faceCells + dst]);
+		}
+	}
+
+	writer.addSection("RDSA", state.data(), state.size() * sizeof(float), sizeof(float));
+}
+
+bool ReactionDiffusionApp::restoreSphereState(Checkpoint const & checkpoint) {
+	size_t const faceCells = (size_t) mSphereSide * mSphereSide;
+	std::vector<float> state(2 * NUM_CUBE_FACES * faceCells);
+	if (!checkpoint.readSection("RDSA", state.data(), state.size() * sizeof(float))) {
+		return false;
+	}
+
+	// The ghost cells are refreshed by the next step
+	for (int faceIdx = 0; faceIdx < NUM_CUBE_FACES; faceIdx++) {
+		for (int row = 0; row < mSphereSide; row++) {
+			size_t dst = mSphereSource.getIndex(faceIdx, 0, row);
+			size_t src = faceIdx * faceCells + (size_t) row * mSphereSide;
+			std::copy_n(& state[src], mSphereSide, & mSphereSource.mA[dst]);
+			std::copy_n(& state[NUM_CUBE_FACES * faceCells + src], mSphereSide, & mSphereSource.mB[dst]);
+		}
+	}
+
+	// So the frame drawn before the next update shows the restored state too
+	uploadSphereTexture();
+	return true;
+}
+
+void ReactionDiffusionApp::collectTelemetry(TelemetrySample & sample) {
+	if (mSphere) {
+		sample.mRDMassB = mSphereTotalB;
+		sample.mRDMeanB = sample.mRDMassB / ((double) NUM_CUBE_FACES * mSphereSide * mSphereSide);
+		return;
+	}
+	if (mShards) {
+		int const side = mShards->getLayout().getSide();
+		sample.mRDMassB = mShards->getTotalB();
+		sample.mRDMeanB = sample.mRDMassB / ((double) NUM_CUBE_FACES * side * side);
+		return;
+	}
+
+	int const sampleSide = mTelemetrySampleSide;
+	size_t const bytes = NUM_CUBE_FACES * sampleSide * sampleSide * sizeof(float);
+	if (!mTelemetryFbo) {
+		auto sampleTexFmt = gl::Texture2d::Format()
+			.internalFormat(GL_RGB32F)
+			.minFilter(GL_NEAREST)
+			.magFilter(GL_NEAREST);
+		mTelemetryFbo = gl::Fbo::create(NUM_CUBE_FACES * sampleSide, sampleSide, gl::Fbo::Format().disableDepth().colorTexture(sampleTexFmt));
+		glGenFramebuffers(1, & mTelemetryFaceFbo);
+		mTelemetryPbo = gl::Pbo::create(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		mMemory.addFbo(mTelemetryFbo, false);
+		mMemory.addPbo(mTelemetryPbo);
+	}
+
+	gl::ScopedBuffer scpBuf(mTelemetryPbo);
+
+	// Read last call's samples, long since copied, so mapping doesn't wait on the GPU
+	if (mTelemetryPending) {
+		if (auto samples = static_cast<float const *>(mTelemetryPbo->mapBufferRange(0, bytes, GL_MAP_READ_BIT))) {
+			double sum = 0.0;
+			for (size_t idx = 0; idx < bytes / sizeof(float); idx++) {
+				sum += samples[idx];
+			}
+			mTelemetryMeanB = sum / (bytes / sizeof(float));
+			mTelemetryPbo->unmap();
+		}
+		mTelemetryPending = false;
+	}
+
+	// A nearest neighbour blit down to the sample grid reads one texel per sample, the latest state's
+	{
+		gl::ScopedFramebuffer scpRead(GL_READ_FRAMEBUFFER, mTelemetryFaceFbo);
+		gl::ScopedFramebuffer scpDraw(GL_DRAW_FRAMEBUFFER, mTelemetryFbo->getId());
+		for (int faceIdx = 0; faceIdx < NUM_CUBE_FACES; faceIdx++) {
+			glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + faceIdx, mSourceTex->getId(), 0);
+			glBlitFramebuffer(0, 0, mCubeMapSide, mCubeMapSide, faceIdx * sampleSide, 0, (faceIdx + 1) * sampleSide, sampleSide, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		}
+	}
+	{
+		gl::ScopedFramebuffer scpRead(GL_READ_FRAMEBUFFER, mTelemetryFbo->getId());
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glReadPixels(0, 0, NUM_CUBE_FACES * sampleSide, sampleSide, GL_BLUE, GL_FLOAT, nullptr);
+	}
+	mTelemetryPending = true;
+
+	sample.mRDMeanB = mTelemetryMeanB;
+	sample.mRDMassB = mTelemetryMeanB * NUM_CUBE_FACES * mCubeMapSide * mCubeMapSide;
+}
+
 gl::TextureCubeMapRef ReactionDiffusionApp::draw() {
 	gl::ScopedFramebuffer scpFbo(GL_FRAMEBUFFER, mCubeMapCamera->getId());
 
@@ -119,8 +396,9 @@ gl::TextureCubeMapRef ReactionDiffusionApp::draw() {
 
 	gl::clear(Color(0, 0, 0));
 
-	gl::ScopedTextureBind scpTex(mDestTex, mRDRenderTextureBinding);
+	gl::ScopedTextureBind scpTex(mSphere ? mSphereTex : mShards ? mShardedTex : mDestTex, mRDRenderTextureBinding);
 
+	mRenderRDProgram->uniform("uEquiangularGrid", (bool) mSphere);
 	mRenderCubeMapBatch->draw();
 
 	return mCubeMapCamera->getColorTex();
@@ -5,6 +5,7 @@
 
 #include "cinder/app/App.h"
 #include "cinder/gl/gl.h"
+#include "cinder/gl/Pbo.h"
 #include "cinder/Rand.h"
 #include "cinder/Camera.h"
 #include "cinder/CameraUi.h"
@@ -13,6 +14,12 @@
 
 #include "FboCubeMapLayered.h"
 #include "MeshHelpers.h"
+#include "MemoryLedger.h"
+#include "Checkpoint.h"
+#include "CubeFaces.h"
+#include "ReactionDiffusionShards.h"
+#include "ReactionDiffusionSphere.h"
+#include "Telemetry.h"
 
 using namespace ci;
 
@@ -26,13 +33,33 @@ public:
 	void disrupt(ci::vec3 dir);
 
 	void setupCircleRD(float rad);
+	void setupShards();
+	void updateShards();
+	void setupSphere();
+	void updateSphere();
+	void uploadSphereTexture();
 
-	float const mTypeAlpha_waves[2] = { 0.010, 0.047 };
-	float const mTypeEpsilon_microbes[2] = { 0.018, 0.055 };
+	// Reads the A and B channels of every face back from the GPU, or uploads them again. The sphere grid's cells don't
+	// line up with the cube's, so it has a section of its own. Not available while sharded
+	void saveState(CheckpointWriter & writer);
+	bool restoreState(Checkpoint const & checkpoint);
+	void saveSphereState(CheckpointWriter & writer);
+	bool restoreSphereState(Checkpoint const & checkpoint);
+
+	// Total and mean B. The sphere grid adds B up as it steps, and the shard workers as they downsample what they send
+	// back. The GPU cube is estimated from a grid of samples on each face, which is read on the next call
+	void collectTelemetry(TelemetrySample & sample);
+
+	// The rates of the presets the CPU kernels run, which the shader gate runs the shader with
+	float const mTypeAlpha_waves[2] = { rd_presets::AlphaWaves::FEED, rd_presets::AlphaWaves::KILL };
+	float const mTypeEpsilon_microbes[2] = { rd_presets::EpsilonMicrobes::FEED, rd_presets::EpsilonMicrobes::KILL };
 	int const mUpdatesPerFrame = 10;
 	int const mCubeMapSide = 512;
 	int const mRDReadFboBinding = 0;
 	int const mRDRenderTextureBinding = 1;
+	// Samples per face side for telemetry, 9600 in all. Not a divisor of the cube's side, so the sample spacing doesn't
+	// lock onto a pattern that's as regular as the texel grid
+	int const mTelemetrySampleSide = 40;
 
 	gl::TextureCubeMapRef mSourceTex;
 	GLuint mSourceFbo;
@@ -47,4 +74,32 @@ public:
 	gl::VboMeshRef mCubeMapFacesMesh;
 	gl::BatchRef mRenderCubeMapBatch;
 	FboCubeMapLayeredRef mCubeMapCamera;
+
+	// Set before setup() to step a bigger cube in worker processes, see ReactionDiffusionShards.h. The GPU textures
+	// above stay around, and take over again if the workers fail
+	RDShardOptions mShardOptions;
+	RDShardCoordinatorRef mShards;
+	// B gathered from the workers, swizzled so it reads as the GPU textures' blue channel
+	gl::TextureCubeMapRef mShardedTex;
+
+	// Set before setup() to step on a near uniform sphere grid of this side on the CPU instead, see
+	// ReactionDiffusionSphere.h. Takes precedence over shards
+	int mSphereSide = 0;
+	std::unique_ptr<RDSphereGrid> mSphere;
+	ReactionDiffusionGrid mSphereSource { 1 };
+	ReactionDiffusionGrid mSphereDest { 1 };
+	// B of the sphere grid, swizzled like mShardedTex, and filtered linearly as the render shader undoes the warp
+	gl::TextureCubeMapRef mSphereTex;
+
+	// Of the sphere grid's last step
+	double mSphereTotalB = TelemetrySample::none();
+
+	// B sampled from the GPU cube by a blit of each face through mTelemetryFaceFbo, and read back on the next call
+	gl::FboRef mTelemetryFbo;
+	GLuint mTelemetryFaceFbo = 0;
+	gl::PboRef mTelemetryPbo;
+	bool mTelemetryPending = false;
+	double mTelemetryMeanB = TelemetrySample::none();
+
+	MemoryAccount mMemory { "ReactionDiffusion" };
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "ReactionDiffusionKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "CubeFaces.h"
+
+using namespace ci;
+
+ReactionDiffusionGrid::ReactionDiffusionGrid(int side) : mSide(side) {
+	mA.assign(NUM_CUBE_FACES * getFaceSize(), 1.0f);
+	mB.assign(NUM_CUBE_FACES * getFaceSize(), 0.0f);
+
+	// Every texel of the ghost border maps to whichever texel its direction lands on, which is on a neighbouring face
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = -1; row <= side; row++) {
+			for (int col = -1; col <= side; col++) {
+				if (row >= 0 && row < side && col >= 0 && col < side) {
+					continue;
+				}
+
+				int srcFace, srcCol, srcRow;
+				getCubeFaceTexel(getCubeFaceTexelDirection(face, col, row, side), side, srcFace, srcCol, srcRow);
+
+				mGhostIndices.push_back(getIndex(face, col, row));
+				mGhostSources.push_back(getIndex(srcFace, srcCol, srcRow));
+			}
+		}
+	}
+}
+
+void ReactionDiffusionGrid::clear(float a, float b) {
+	std::fill(mA.begin(), mA.end(), a);
+	std::fill(mB.begin(), mB.end(), b);
+}
+
+void ReactionDiffusionGrid::fillGhostCells() {
+	for (size_t idx = 0; idx < mGhostIndices.size(); idx++) {
+		mA[mGhostIndices[idx]] = mA[mGhostSources[idx]];
+		mB[mGhostIndices[idx]] = mB[mGhostSources[idx]];
+	}
+}
+
+double ReactionDiffusionGrid::getTotalB() const {
+	double total = 0.0;
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < mSide; row++) {
+			float const * rowB = & mB[getIndex(face, 0, row)];
+			for (int col = 0; col < mSide; col++) {
+				total += rowB[col];
+			}
+		}
+	}
+	return total;
+}
+
+void setupCircleReactionDiffusion(ReactionDiffusionGrid & grid, float rad) {
+	float const STROKE_WIDTH = 8.0f;
+	int const side = grid.getSide();
+	int const POSITIVE_Z = 4;
+
+	grid.clear(1.0f, 0.0f);
+
+	vec2 center(side / 2.0f, side / 2.0f);
+	for (int row = 0; row < side; row++) {
+		for (int col = 0; col < side; col++) {
+			float dist = length(vec2(col + 0.5f, row + 0.5f) - center);
+			if (std::abs(dist - rad) <= STROKE_WIDTH / 2.0f) {
+				size_t idx = grid.getIndex(POSITIVE_Z, col, row);
+				grid.mA[idx] = 0.0f;
+				grid.mB[idx] = 1.0f;
+			}
+		}
+	}
+
+	grid.fillGhostCells();
+}
+
+vec3 getReactionDiffusionDisruptionPoint(vec3 dir) {
+	dir.y *= -1;
+	return normalize(dir);
+}
+
+void disruptReactionDiffusion(ReactionDiffusionGrid & grid, vec3 const & point) {
+	int const side = grid.getSide();
+
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				if (length(normalize(getCubeFaceTexelDirection(face, col, row, side)) - point) < RD_DISRUPT_RADIUS) {
+					size_t idx = grid.getIndex(face, col, row);
+					grid.mA[idx] = 1.0f;
+					grid.mB[idx] = 0.0f;
+				}
+			}
+		}
+	}
+
+	grid.fillGhostCells();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "cinder/Vector.h"
+
+// CPU version of the reaction diffusion simulation in RDRunReactionDiffusion_f.glsl, on the same cube map grid. The
+// steps themselves are stepReactionDiffusionModel() in ReactionDiffusionModels.h, RDPresetGrayScottAlphaWaves for the shader's.
+// Each face is stored with a one texel ghost border that's refreshed from the neighbouring faces before every step,
+// mirroring what nearest sampling across a cube map edge does on the GPU, so the stencil never has to look at face edges.
+class ReactionDiffusionGrid {
+public:
+	explicit ReactionDiffusionGrid(int side);
+
+	int getSide() const { return mSide; }
+	int getStride() const { return mSide + 2; }
+	size_t getFaceSize() const { return (size_t) getStride() * getStride(); }
+	size_t getIndex(int face, int col, int row) const { return face * getFaceSize() + (size_t) (row + 1) * getStride() + col + 1; }
+
+	void clear(float a, float b);
+	// Copies the edge texels of every face into the ghost borders of its neighbours
+	void fillGhostCells();
+
+	// Sum of B over every texel, ghost cells excluded
+	double getTotalB() const;
+
+	// Chemical concentrations, 6 padded faces each
+	std::vector<float> mA;
+	std::vector<float> mB;
+
+private:
+	int mSide;
+	// For every ghost texel, the texel it mirrors
+	std::vector<uint32_t> mGhostIndices;
+	std::vector<uint32_t> mGhostSources;
+};
+
+// DISRUPT_RADIUS in RDDisruptReactionDiffusion_f.glsl
+float const RD_DISRUPT_RADIUS = 0.45f;
+
+// Same starting state as ReactionDiffusionApp::setupCircleRD()
+void setupCircleReactionDiffusion(ReactionDiffusionGrid & grid, float rad);
+
+// The point ReactionDiffusionApp::disrupt() disrupts at for a disruption towards dir, normalized. The GPU path has
+// always flipped y, which the CPU paths have to follow to disrupt the same texels
+ci::vec3 getReactionDiffusionDisruptionPoint(ci::vec3 dir);
+
+// Same as RDDisruptReactionDiffusion_f.glsl, point has to be normalized
+void disruptReactionDiffusion(ReactionDiffusionGrid & grid, ci::vec3 const & point);
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <random>
+
+#include "CubeFaces.h"
+#include "ReactionDiffusionKernels.h"
+
+// Compile time specialized reaction diffusion kernels for the CPU grid. A preset picks the reaction model, the
+// Laplacian stencil and the diffusion rates as types and constants, so stepReactionDiffusionModel<Preset>()
+// instantiates one fully unrolled kernel per preset, with nothing in its inner loop but arithmetic on constants,
+// which the compiler is free to vectorize.
+//
+// Every model takes an explicit Euler step: new = cur + DT * (diffusion * laplacian + reaction).
+
+// 3x3 stencils as in RDRunReactionDiffusion_f.glsl, where the Laplacian is
+// CORNER * (diagonal neighbours) + EDGE * (side neighbours) + CENTER * (self)
+struct RDStencilIsotropic9 {
+	// The weights convoluteA() and convoluteB() use in the shader
+	static constexpr float CORNER = 0.05f;
+	static constexpr float EDGE = 0.2f;
+	static constexpr float CENTER = -1.0f;
+};
+
+struct RDStencil5Point {
+	static constexpr float CORNER = 0.0f;
+	static constexpr float EDGE = 0.25f;
+	static constexpr float CENTER = -1.0f;
+};
+
+// A is the substrate, B the autocatalyst
+template <typename Constants>
+struct RDGrayScott {
+	static constexpr float INITIAL_A = 1.0f;
+	static constexpr float INITIAL_B = 0.0f;
+
+	static inline void react(float a, float b, float & reactA, float & reactB) {
+		float abb = a * b * b;
+		reactA = -abb + Constants::FEED * (1.0f - a);
+		reactB = abb - (Constants::FEED + Constants::KILL) * b;
+	}
+};
+
+// A is the activator u, B the inhibitor v:
+// du = u - u^3 - v, dv = EPSILON * (u - A1 * v - A0)
+template <typename Constants>
+struct RDFitzHughNagumo {
+	static constexpr float INITIAL_A = 0.0f;
+	static constexpr float INITIAL_B = 0.0f;
+
+	static inline void react(float u, float v, float & reactA, float & reactB) {
+		reactA = u - u * u * u - v;
+		reactB = Constants::EPSILON * (u - Constants::A1 * v - Constants::A0);
+	}
+};
+
+// A is X, B is Y: dX = A - (B + 1) * X + X^2 * Y, dY = B * X - X^2 * Y
+template <typename Constants>
+struct RDBrusselator {
+	static constexpr float INITIAL_A = Constants::A;
+	static constexpr float INITIAL_B = Constants::B / Constants::A;
+
+	static inline void react(float x, float y, float & reactA, float & reactB) {
+		float xxy = x * x * y;
+		reactA = Constants::A - (Constants::B + 1.0f) * x + xxy;
+		reactB = Constants::B * x - xxy;
+	}
+};
+
+template <typename ModelType, typename StencilType, typename Rates>
+struct RDPreset {
+	typedef ModelType Model;
+	typedef StencilType Stencil;
+	static constexpr float DIFFUSION_A = Rates::DIFFUSION_A;
+	static constexpr float DIFFUSION_B = Rates::DIFFUSION_B;
+	static constexpr float DT = Rates::DT;
+};
+
+namespace rd_presets {
+	// ReactionDiffusionApp's "alpha waves", the rates the shader runs with
+	struct AlphaWaves { static constexpr float FEED = 0.010f, KILL = 0.047f; };
+	// ReactionDiffusionApp's "epsilon microbes"
+	struct EpsilonMicrobes { static constexpr float FEED = 0.018f, KILL = 0.055f; };
+	struct ShaderRates { static constexpr float DIFFUSION_A = 1.0f, DIFFUSION_B = 0.5f, DT = 1.0f; };
+	// The "kind weird" rates commented out in the shader
+	struct WeirdRates { static constexpr float DIFFUSION_A = 0.4f, DIFFUSION_B = 0.05f, DT = 1.0f; };
+
+	struct FitzHughNagumoConstants { static constexpr float EPSILON = 0.05f, A0 = -0.03f, A1 = 2.0f; };
+	struct FitzHughNagumoRates { static constexpr float DIFFUSION_A = 0.2f, DIFFUSION_B = 1.0f, DT = 0.5f; };
+
+	// B sits between the Turing threshold (1 + A * sqrt(DIFFUSION_A / DIFFUSION_B))^2 and the Hopf one 1 + A^2, so it settles into spots
+	struct BrusselatorConstants { static constexpr float A = 1.0f, B = 1.9f; };
+	struct BrusselatorRates { static constexpr float DIFFUSION_A = 1.0f, DIFFUSION_B = 8.0f, DT = 0.1f; };
+}
+
+typedef RDPreset<RDGrayScott<rd_presets::AlphaWaves>, RDStencilIsotropic9, rd_presets::ShaderRates> RDPresetGrayScottAlphaWaves;
+typedef RDPreset<RDGrayScott<rd_presets::EpsilonMicrobes>, RDStencilIsotropic9, rd_presets::ShaderRates> RDPresetGrayScottMicrobes;
+typedef RDPreset<RDGrayScott<rd_presets::AlphaWaves>, RDStencilIsotropic9, rd_presets::WeirdRates> RDPresetGrayScottWeird;
+typedef RDPreset<RDFitzHughNagumo<rd_presets::FitzHughNagumoConstants>, RDStencil5Point, rd_presets::FitzHughNagumoRates> RDPresetFitzHughNagumo;
+typedef RDPreset<RDBrusselator<rd_presets::BrusselatorConstants>, RDStencilIsotropic9, rd_presets::BrusselatorRates> RDPresetBrusselator;
+
+// One row of texels, from padded rows of the source grid (row - 1, row and row + 1 are at -stride, 0 and +stride)
+template <typename Preset>
+inline void stepReactionDiffusionRow(float const * __restrict a, float const * __restrict b, float * __restrict outA, float * __restrict outB, int side, int stride) {
+	typedef typename Preset::Stencil Stencil;
+
+	for (int col = 0; col < side; col++) {
+		float curA = a[col];
+		float curB = b[col];
+
+		float lapA = Stencil::EDGE * (a[col - stride] + a[col - 1] + a[col + 1] + a[col + stride]) + Stencil::CENTER * curA;
+		float lapB = Stencil::EDGE * (b[col - stride] + b[col - 1] + b[col + 1] + b[col + stride]) + Stencil::CENTER * curB;
+		// Folded away at compile time for stencils without corner weights
+		if (Stencil::CORNER != 0.0f) {
+			lapA += Stencil::CORNER * (a[col - stride - 1] + a[col - stride + 1] + a[col + stride - 1] + a[col + stride + 1]);
+			lapB += Stencil::CORNER * (b[col - stride - 1] + b[col - stride + 1] + b[col + stride - 1] + b[col + stride + 1]);
+		}
+
+		float reactA, reactB;
+		Preset::Model::react(curA, curB, reactA, reactB);
+
+		outA[col] = curA + Preset::DT * (Preset::DIFFUSION_A * lapA + reactA);
+		outB[col] = curB + Preset::DT * (Preset::DIFFUSION_B * lapB + reactB);
+	}
+}
+
+// One step of the preset's model from src into dst. Refreshes the ghost cells of src first
+template <typename Preset>
+void stepReactionDiffusionModel(ReactionDiffusionGrid & src, ReactionDiffusionGrid & dst) {
+	src.fillGhostCells();
+
+	int const side = src.getSide();
+	int const stride = src.getStride();
+
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < side; row++) {
+			size_t rowStart = src.getIndex(face, 0, row);
+			stepReactionDiffusionRow<Preset>(& src.mA[rowStart], & src.mB[rowStart], & dst.mA[rowStart], & dst.mB[rowStart], side, stride);
+		}
+	}
+}
+
+// The model's homogeneous steady state, with uniform noise of the given amplitude on top to let patterns form
+template <typename Preset>
+void setupReactionDiffusionModel(ReactionDiffusionGrid & grid, float noise, uint32_t seed) {
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> offset(-noise, noise);
+
+	grid.clear(Preset::Model::INITIAL_A, Preset::Model::INITIAL_B);
+	int const side = grid.getSide();
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				size_t idx = grid.getIndex(face, col, row);
+				grid.mA[idx] += offset(random);
+				grid.mB[idx] += offset(random);
+			}
+		}
+	}
+
+	grid.fillGhostCells();
+}
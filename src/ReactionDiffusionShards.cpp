@@ -0,0 +1,475 @@
+#include "ReactionDiffusionShards.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstring>
+
+#include <spawn.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "cinder/Log.h"
+
+#include "CubeFaces.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+extern char ** environ;
+
+namespace {
+	// How long the coordinator waits on a worker before giving up on the whole sharded simulation
+	double const GATHER_TIMEOUT_SECONDS = 10.0;
+	double const CONNECT_TIMEOUT_SECONDS = 10.0;
+}
+
+RDShardLayout::RDShardLayout(int side, int numShards, int rowAlignment)
+	: mSide(side), mBlocks(numShards), mLocalSizes(numShards, 0), mRowOwners(NUM_CUBE_FACES * side, -1), mRowStarts(NUM_CUBE_FACES * side, 0)
+{
+	int const totalUnits = NUM_CUBE_FACES * side / rowAlignment;
+
+	for (int shard = 0; shard < numShards; shard++) {
+		int firstRow = (int) ((int64_t) totalUnits * shard / numShards) * rowAlignment;
+		int endRow = (int) ((int64_t) totalUnits * (shard + 1) / numShards) * rowAlignment;
+
+		// A run that crosses a face edge becomes one block per face
+		for (int row = firstRow; row < endRow;) {
+			int face = row / side;
+			int blockEnd = std::min(endRow, (face + 1) * side);
+
+			RDShardBlock block = { face, row - face * side, blockEnd - row, mLocalSizes[shard] };
+			for (int blockRow = 0; blockRow < block.mNumRows; blockRow++) {
+				mRowOwners[row + blockRow] = shard;
+				mRowStarts[row + blockRow] = block.mOffset + (size_t) (blockRow + 1) * getStride() + 1;
+			}
+
+			mLocalSizes[shard] += (size_t) (block.mNumRows + 2) * getStride();
+			mBlocks[shard].push_back(block);
+			row = blockEnd;
+		}
+	}
+}
+
+vector<RDShardPlan> buildShardPlans(RDShardLayout const & layout) {
+	int const numShards = layout.getNumShards();
+	int const side = layout.getSide();
+	int const stride = layout.getStride();
+
+	vector<RDShardPlan> plans(numShards);
+	for (auto & plan : plans) {
+		plan.mSendIndices.resize(numShards);
+		plan.mReceiveIndices.resize(numShards);
+	}
+
+	for (int shard = 0; shard < numShards; shard++) {
+		for (auto const & block : layout.getBlocks(shard)) {
+			// Whoever owns the texel a ghost cell mirrors, on this face or across an edge, sends it every step
+			auto addGhost = [&] (int col, int blockRow) {
+				int row = block.mRow0 + blockRow;
+				uint32_t dst = (uint32_t) (block.mOffset + (size_t) (blockRow + 1) * stride + col + 1);
+
+				int srcFace = block.mFace, srcCol = col, srcRow = row;
+				if (col < 0 || col >= side || row < 0 || row >= side) {
+					getCubeFaceTexel(getCubeFaceTexelDirection(block.mFace, col, row, side), side, srcFace, srcCol, srcRow);
+				}
+
+				int owner = layout.getOwner(srcFace, srcRow);
+				uint32_t src = (uint32_t) layout.getLocalIndex(srcFace, srcCol, srcRow);
+				if (owner == shard) {
+					plans[shard].mLocalDst.push_back(dst);
+					plans[shard].mLocalSrc.push_back(src);
+				} else {
+					plans[shard].mReceiveIndices[owner].push_back(dst);
+					plans[owner].mSendIndices[shard].push_back(src);
+				}
+			};
+
+			for (int col = -1; col <= side; col++) {
+				addGhost(col, -1);
+				addGhost(col, block.mNumRows);
+			}
+			for (int blockRow = 0; blockRow < block.mNumRows; blockRow++) {
+				addGhost(-1, blockRow);
+				addGhost(side, blockRow);
+			}
+		}
+	}
+
+	return plans;
+}
+
+size_t getShardGatherBytes(RDShardLayout const & layout, int shard, int gatherSide) {
+	int const factor = layout.getSide() / gatherSide;
+	size_t values = 0;
+	for (auto const & block : layout.getBlocks(shard)) {
+		values += (size_t) (block.mNumRows / factor) * gatherSide;
+	}
+	// Plus the shard's total B
+	return (values + 1) * sizeof(float);
+}
+
+RDShardWorker::RDShardWorker(RDShardLayout const & layout, RDShardPlan plan, int shard)
+	: mLayout(layout), mPlan(std::move(plan)), mShard(shard)
+{
+	size_t localSize = layout.getLocalSize(shard);
+	mA.assign(localSize, 1.0f);
+	mB.assign(localSize, 0.0f);
+	mNextA = mA;
+	mNextB = mB;
+}
+
+void RDShardWorker::setupCircle(float rad) {
+	float const STROKE_WIDTH = 8.0f;
+	int const side = mLayout.getSide();
+	int const POSITIVE_Z = 4;
+
+	std::fill(mA.begin(), mA.end(), 1.0f);
+	std::fill(mB.begin(), mB.end(), 0.0f);
+
+	vec2 center(side / 2.0f, side / 2.0f);
+	for (auto const & block : mLayout.getBlocks(mShard)) {
+		if (block.mFace != POSITIVE_Z) {
+			continue;
+		}
+		for (int row = block.mRow0; row < block.mRow0 + block.mNumRows; row++) {
+			for (int col = 0; col < side; col++) {
+				float dist = length(vec2(col + 0.5f, row + 0.5f) - center);
+				if (std::abs(dist - rad) <= STROKE_WIDTH / 2.0f) {
+					size_t idx = mLayout.getLocalIndex(block.mFace, col, row);
+					mA[idx] = 0.0f;
+					mB[idx] = 1.0f;
+				}
+			}
+		}
+	}
+}
+
+void RDShardWorker::disrupt(vec3 const & point) {
+	int const side = mLayout.getSide();
+
+	for (auto const & block : mLayout.getBlocks(mShard)) {
+		for (int row = block.mRow0; row < block.mRow0 + block.mNumRows; row++) {
+			for (int col = 0; col < side; col++) {
+				if (length(normalize(getCubeFaceTexelDirection(block.mFace, col, row, side)) - point) < RD_DISRUPT_RADIUS) {
+					size_t idx = mLayout.getLocalIndex(block.mFace, col, row);
+					mA[idx] = 1.0f;
+					mB[idx] = 0.0f;
+				}
+			}
+		}
+	}
+}
+
+bool RDShardWorker::exchangeHalos(ShardTransport & transport) {
+	int const numShards = mLayout.getNumShards();
+
+	// Everything goes out before anything is waited for, so neighbours never wait on each other in a cycle
+	for (int peer = 0; peer < numShards; peer++) {
+		auto const & indices = mPlan.mSendIndices[peer];
+		if (indices.empty()) {
+			continue;
+		}
+
+		size_t count = indices.size();
+		mMessage.resize(2 * count);
+		for (size_t idx = 0; idx < count; idx++) {
+			mMessage[idx] = mA[indices[idx]];
+			mMessage[count + idx] = mB[indices[idx]];
+		}
+		if (!transport.send(peer, mMessage.data(), mMessage.size() * sizeof(float))) {
+			return false;
+		}
+	}
+
+	for (size_t idx = 0; idx < mPlan.mLocalDst.size(); idx++) {
+		mA[mPlan.mLocalDst[idx]] = mA[mPlan.mLocalSrc[idx]];
+		mB[mPlan.mLocalDst[idx]] = mB[mPlan.mLocalSrc[idx]];
+	}
+
+	for (int peer = 0; peer < numShards; peer++) {
+		auto const & indices = mPlan.mReceiveIndices[peer];
+		if (indices.empty()) {
+			continue;
+		}
+
+		size_t count = indices.size();
+		mMessage.resize(2 * count);
+		if (!transport.receive(peer, mMessage.data(), mMessage.size() * sizeof(float), -1.0)) {
+			return false;
+		}
+		for (size_t idx = 0; idx < count; idx++) {
+			mA[indices[idx]] = mMessage[idx];
+			mB[indices[idx]] = mMessage[count + idx];
+		}
+	}
+
+	return true;
+}
+
+void RDShardWorker::gather(int gatherSide, vector<float> & out) const {
+	int const side = mLayout.getSide();
+	int const stride = mLayout.getStride();
+	int const factor = side / gatherSide;
+	float const scale = 1.0f / (factor * factor);
+
+	out.clear();
+	double total = 0.0;
+	for (auto const & block : mLayout.getBlocks(mShard)) {
+		for (int row = 0; row < block.mNumRows; row += factor) {
+			for (int col = 0; col < side; col += factor) {
+				float sum = 0.0f;
+				for (int dy = 0; dy < factor; dy++) {
+					float const * b = & mB[block.mOffset + (size_t) (row + dy + 1) * stride + col + 1];
+					for (int dx = 0; dx < factor; dx++) {
+						sum += b[dx];
+					}
+				}
+				out.push_back(sum * scale);
+				total += sum;
+			}
+		}
+	}
+	out.push_back((float) total);
+}
+
+bool RDShardWorker::run(ShardTransport & transport, int gatherSide) {
+	int const coordinator = mLayout.getNumShards();
+	vector<float> gathered;
+
+	while (true) {
+		RDShardCommand command;
+		if (!transport.receive(coordinator, & command, sizeof(command), -1.0)) {
+			return false;
+		}
+		if (command.mType == RDShardCommand::QUIT) {
+			return true;
+		}
+
+		for (uint32_t idx = 0; idx < std::min<uint32_t>(command.mNumDisruptions, RDShardCommand::MAX_DISRUPTIONS); idx++) {
+			float const * point = command.mDisruptions[idx];
+			disrupt(vec3(point[0], point[1], point[2]));
+		}
+
+		for (uint32_t idx = 0; idx < command.mNumSteps; idx++) {
+			if (!step<RDShardPreset>(transport)) {
+				return false;
+			}
+		}
+
+		gather(gatherSide, gathered);
+		if (!transport.send(coordinator, gathered.data(), gathered.size() * sizeof(float))) {
+			return false;
+		}
+	}
+}
+
+RDShardCoordinator::RDShardCoordinator(RDShardOptions const & options)
+	: mLayout(options.mSide, options.mNumShards, options.mSide / options.mGatherSide), mGatherSide(options.mGatherSide)
+{
+	mFacesB.assign((size_t) NUM_CUBE_FACES * mGatherSide * mGatherSide, 0.0f);
+}
+
+RDShardCoordinatorRef RDShardCoordinator::create(RDShardOptions const & options) {
+	int const numShards = options.mNumShards;
+	if (numShards < 1 || options.mGatherSide < 1 || options.mGatherSide > options.mSide || options.mSide % options.mGatherSide != 0
+		|| numShards > NUM_CUBE_FACES * options.mGatherSide) {
+		CI_LOG_E("Can't split a " << options.mSide << " side cube into " << numShards << " shards gathered at " << options.mGatherSide);
+		return nullptr;
+	}
+
+	RDShardCoordinatorRef coordinator(new RDShardCoordinator(options));
+	int const numRanks = numShards + 1;
+	vector<string> workerArgs;
+
+	if (!options.mHosts.empty()) {
+		// Workers on other hosts are started by hand with the same addresses
+		if ((int) options.mHosts.size() != numRanks) {
+			CI_LOG_E("Need an address for each of the " << numShards << " shards and then the coordinator");
+			return nullptr;
+		}
+		coordinator->mTransport = SocketTransport::create(numShards, options.mHosts, CONNECT_TIMEOUT_SECONDS);
+	} else if (options.mTransport == "socket") {
+		// The loopback stand-in for workers on other hosts
+		vector<string> addresses;
+		string joined;
+		for (int rank = 0; rank < numRanks; rank++) {
+			addresses.push_back("127.0.0.1:" + std::to_string(options.mBasePort + rank));
+			joined += (rank ? "," : "") + addresses.back();
+		}
+		workerArgs = { "--hosts", joined };
+		if (!coordinator->spawnWorkers(options, workerArgs)) {
+			return nullptr;
+		}
+		coordinator->mTransport = SocketTransport::create(numShards, addresses, CONNECT_TIMEOUT_SECONDS);
+	} else if (options.mTransport == "shm") {
+		// A mailbox for each pair of neighbours, and both ways between every worker and the coordinator
+		auto plans = buildShardPlans(coordinator->mLayout);
+		vector<size_t> capacities((size_t) numRanks * numRanks, 0);
+		for (int from = 0; from < numShards; from++) {
+			for (int to = 0; to < numShards; to++) {
+				capacities[from * numRanks + to] = 2 * plans[from].mSendIndices[to].size() * sizeof(float);
+			}
+			capacities[from * numRanks + numShards] = getShardGatherBytes(coordinator->mLayout, from, options.mGatherSide);
+			capacities[numShards * numRanks + from] = sizeof(RDShardCommand);
+		}
+
+		string name = "/dlrd." + std::to_string(getpid());
+		coordinator->mTransport = SharedMemoryTransport::create(name, numShards, numRanks, capacities);
+		if (!coordinator->mTransport) {
+			return nullptr;
+		}
+		workerArgs = { "--shm", name };
+		if (!coordinator->spawnWorkers(options, workerArgs)) {
+			return nullptr;
+		}
+	} else {
+		CI_LOG_E("Unknown shard transport: " << options.mTransport);
+		return nullptr;
+	}
+
+	if (!coordinator->mTransport) {
+		return nullptr;
+	}
+
+	CI_LOG_I("Reaction diffusion on " << numShards << " shards over " << coordinator->mTransport->getName()
+		<< ", " << options.mSide << " per face, gathered at " << options.mGatherSide);
+	return coordinator;
+}
+
+bool RDShardCoordinator::spawnWorkers(RDShardOptions const & options, vector<string> const & transportArgs) {
+	if (!fs::exists(options.mWorkerPath)) {
+		CI_LOG_E("No reaction diffusion worker at: " << options.mWorkerPath);
+		return false;
+	}
+
+	string path = options.mWorkerPath.string();
+	for (int rank = 0; rank < options.mNumShards; rank++) {
+		vector<string> args = {
+			path,
+			"--rank", std::to_string(rank),
+			"--shards", std::to_string(options.mNumShards),
+			"--side", std::to_string(options.mSide),
+			"--gather-side", std::to_string(options.mGatherSide)
+		};
+		args.insert(args.end(), transportArgs.begin(), transportArgs.end());
+
+		vector<char *> argv;
+		for (auto & arg : args) {
+			argv.push_back(& arg[0]);
+		}
+		argv.push_back(nullptr);
+
+		pid_t pid;
+		int err = posix_spawn(& pid, path.c_str(), nullptr, nullptr, argv.data(), environ);
+		if (err != 0) {
+			CI_LOG_E("Can't start reaction diffusion worker " << rank << ": " << std::strerror(err));
+			stopWorkers();
+			return false;
+		}
+		mWorkerPids.push_back(pid);
+	}
+	return true;
+}
+
+void RDShardCoordinator::stopWorkers() {
+	typedef std::chrono::steady_clock Clock;
+	auto deadline = Clock::now() + std::chrono::seconds(2);
+
+	// Workers that got the quit command exit on their own, anything still around after that is killed
+	for (int pid : mWorkerPids) {
+		while (waitpid(pid, nullptr, WNOHANG) == 0) {
+			if (Clock::now() > deadline) {
+				kill(pid, SIGTERM);
+				waitpid(pid, nullptr, 0);
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+	mWorkerPids.clear();
+}
+
+RDShardCoordinator::~RDShardCoordinator() {
+	// After a failure the workers may be gone or stuck, so they're just stopped
+	if (mTransport && !mFailed) {
+		if (mIsStepping) {
+			finishSteps();
+		}
+
+		RDShardCommand command = {};
+		command.mType = RDShardCommand::QUIT;
+		for (int shard = 0; shard < mLayout.getNumShards(); shard++) {
+			mTransport->send(shard, & command, sizeof(command));
+		}
+	}
+
+	stopWorkers();
+	mTransport.reset();
+}
+
+void RDShardCoordinator::disrupt(vec3 const & point) {
+	mPendingDisruptions.push_back(point);
+}
+
+bool RDShardCoordinator::beginSteps(int numSteps) {
+	if (mIsStepping || mFailed) {
+		return false;
+	}
+
+	RDShardCommand command = {};
+	command.mType = RDShardCommand::STEP;
+	command.mNumSteps = numSteps;
+
+	// A burst of more disruptions than fit in one command carries over into the next frame
+	size_t numDisruptions = std::min<size_t>(mPendingDisruptions.size(), RDShardCommand::MAX_DISRUPTIONS);
+	command.mNumDisruptions = numDisruptions;
+	for (size_t idx = 0; idx < numDisruptions; idx++) {
+		command.mDisruptions[idx][0] = mPendingDisruptions[idx].x;
+		command.mDisruptions[idx][1] = mPendingDisruptions[idx].y;
+		command.mDisruptions[idx][2] = mPendingDisruptions[idx].z;
+	}
+	mPendingDisruptions.erase(mPendingDisruptions.begin(), mPendingDisruptions.begin() + numDisruptions);
+
+	for (int shard = 0; shard < mLayout.getNumShards(); shard++) {
+		if (!mTransport->send(shard, & command, sizeof(command))) {
+			mFailed = true;
+			return false;
+		}
+	}
+
+	mIsStepping = true;
+	return true;
+}
+
+bool RDShardCoordinator::finishSteps() {
+	if (!mIsStepping) {
+		return false;
+	}
+	mIsStepping = false;
+
+	int const factor = mLayout.getSide() / mGatherSide;
+	mTotalB = 0.0;
+	for (int shard = 0; shard < mLayout.getNumShards(); shard++) {
+		mMessage.resize(getShardGatherBytes(mLayout, shard, mGatherSide) / sizeof(float));
+		if (!mTransport->receive(shard, mMessage.data(), mMessage.size() * sizeof(float), GATHER_TIMEOUT_SECONDS)) {
+			CI_LOG_E("Lost reaction diffusion shard " << shard);
+			mFailed = true;
+			return false;
+		}
+
+		// Blocks arrive in order, each a run of whole downsampled rows
+		float const * values = mMessage.data();
+		for (auto const & block : mLayout.getBlocks(shard)) {
+			size_t rows = block.mNumRows / factor;
+			float * dst = & mFacesB[((size_t) block.mFace * mGatherSide + block.mRow0 / factor) * mGatherSide];
+			std::copy(values, values + rows * mGatherSide, dst);
+			values += rows * mGatherSide;
+		}
+		mTotalB += * values;
+	}
+
+	return true;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "cinder/Filesystem.h"
+#include "cinder/Vector.h"
+
+#include "ReactionDiffusionModels.h"
+#include "ShardTransport.h"
+
+// Reaction diffusion on the CPU grid, split across worker processes so the cube can be bigger than one device can
+// step at the frame rate.
+//
+// The 6 * side rows of the cube are cut into one contiguous run per shard, so a shard owns full-width row bands of
+// one or two faces. Every step, each shard sends the texels along its edges that other shards need as ghost cells,
+// the same mapping ReactionDiffusionGrid uses across face edges, then steps its own rows. The results are bit for bit
+// those of stepReactionDiffusionModel() on a single grid.
+//
+// Ranks 0 to numShards - 1 are the workers (tools/RDShardWorker.cpp), rank numShards is the coordinator in the app,
+// which hands out steps and disruptions and gathers B, downsampled to the output size, for display.
+
+// Workers always run the rates the shader uses
+typedef RDPresetGrayScottAlphaWaves RDShardPreset;
+
+// A run of full-width rows on one face, owned by one shard
+struct RDShardBlock {
+	int mFace;
+	int mRow0;
+	int mNumRows;
+	// Where its padded rows start in the owner's arrays
+	size_t mOffset;
+};
+
+class RDShardLayout {
+public:
+	// Cuts the rows at multiples of rowAlignment, so every block downsamples evenly
+	RDShardLayout(int side, int numShards, int rowAlignment);
+
+	int getSide() const { return mSide; }
+	int getStride() const { return mSide + 2; }
+	int getNumShards() const { return (int) mBlocks.size(); }
+
+	std::vector<RDShardBlock> const & getBlocks(int shard) const { return mBlocks[shard]; }
+	// Floats per channel in a shard's arrays, ghost cells included
+	size_t getLocalSize(int shard) const { return mLocalSizes[shard]; }
+
+	int getOwner(int face, int row) const { return mRowOwners[face * mSide + row]; }
+	// Index of a texel in its owner's arrays
+	size_t getLocalIndex(int face, int col, int row) const { return mRowStarts[face * mSide + row] + col; }
+
+private:
+	int mSide;
+	std::vector<std::vector<RDShardBlock>> mBlocks;
+	std::vector<size_t> mLocalSizes;
+	std::vector<int> mRowOwners;
+	std::vector<size_t> mRowStarts;
+};
+
+// How one shard's ghost cells get filled
+struct RDShardPlan {
+	// Ghost cells that mirror the shard's own texels
+	std::vector<uint32_t> mLocalDst;
+	std::vector<uint32_t> mLocalSrc;
+	// Indexed by peer shard: own texels it needs, in the order it expects them, and where texels from it go
+	std::vector<std::vector<uint32_t>> mSendIndices;
+	std::vector<std::vector<uint32_t>> mReceiveIndices;
+};
+
+// Plans for every shard, which both ends of each exchange need to agree on
+std::vector<RDShardPlan> buildShardPlans(RDShardLayout const & layout);
+
+// Sent from the coordinator to every worker each frame
+struct RDShardCommand {
+	enum Type : uint32_t { STEP = 1, QUIT = 2 };
+	static int const MAX_DISRUPTIONS = 16;
+
+	uint32_t mType;
+	uint32_t mNumSteps;
+	uint32_t mNumDisruptions;
+	float mDisruptions[MAX_DISRUPTIONS][3];
+};
+
+// Bytes of downsampled B, and the shard's total B, a shard sends the coordinator after each command
+size_t getShardGatherBytes(RDShardLayout const & layout, int shard, int gatherSide);
+
+// One shard of the grid. Runs in a worker process, or in-process for tests and benchmarks
+class RDShardWorker {
+public:
+	RDShardWorker(RDShardLayout const & layout, RDShardPlan plan, int shard);
+
+	// Same starting state as setupCircleReactionDiffusion(), for the texels this shard owns
+	void setupCircle(float rad);
+	// Same as disruptReactionDiffusion(), point has to be normalized
+	void disrupt(ci::vec3 const & point);
+
+	// Swaps ghost cells with the neighbouring shards, then steps every owned row
+	template <typename Preset>
+	bool step(ShardTransport & transport);
+
+	// B averaged over factor x factor blocks, block by block, then the total of B, as sent to the coordinator
+	void gather(int gatherSide, std::vector<float> & out) const;
+
+	// Carries out coordinator commands until told to quit. Returns false if the transport failed first
+	bool run(ShardTransport & transport, int gatherSide);
+
+	float getA(int face, int col, int row) const { return mA[mLayout.getLocalIndex(face, col, row)]; }
+	float getB(int face, int col, int row) const { return mB[mLayout.getLocalIndex(face, col, row)]; }
+
+private:
+	bool exchangeHalos(ShardTransport & transport);
+
+	RDShardLayout const & mLayout;
+	RDShardPlan mPlan;
+	int mShard;
+
+	std::vector<float> mA, mB;
+	std::vector<float> mNextA, mNextB;
+	std::vector<float> mMessage;
+};
+
+template <typename Preset>
+bool RDShardWorker::step(ShardTransport & transport) {
+	if (!exchangeHalos(transport)) {
+		return false;
+	}
+
+	int const side = mLayout.getSide();
+	int const stride = mLayout.getStride();
+	for (auto const & block : mLayout.getBlocks(mShard)) {
+		for (int row = 0; row < block.mNumRows; row++) {
+			size_t rowStart = block.mOffset + (size_t) (row + 1) * stride + 1;
+			stepReactionDiffusionRow<Preset>(& mA[rowStart], & mB[rowStart], & mNextA[rowStart], & mNextB[rowStart], side, stride);
+		}
+	}
+
+	std::swap(mA, mNextA);
+	std::swap(mB, mNextB);
+	return true;
+}
+
+struct RDShardOptions {
+	// 0 keeps the simulation on the GPU
+	int mNumShards = 0;
+	int mSide = 2048;
+	// The coordinator only ever needs B at the output resolution
+	int mGatherSide = 1024;
+	// "shm" or "socket"
+	std::string mTransport = "shm";
+	// Socket addresses of every worker and then the coordinator, for workers started by hand on other hosts.
+	// Empty to spawn local workers
+	std::vector<std::string> mHosts;
+	uint16_t mBasePort = 47100;
+	ci::fs::path mWorkerPath;
+};
+
+class RDShardCoordinator;
+typedef std::unique_ptr<RDShardCoordinator> RDShardCoordinatorRef;
+
+// The app's end of a sharded simulation
+class RDShardCoordinator {
+public:
+	// Spawns the workers unless options.mHosts lists where they are. Returns nullptr if anything fails
+	static RDShardCoordinatorRef create(RDShardOptions const & options);
+
+	// Tells the workers to quit and reaps any it spawned
+	~RDShardCoordinator();
+
+	// Applied by the workers before the next steps
+	void disrupt(ci::vec3 const & point);
+
+	// Hands out the next steps, which run while the app does other work. finishSteps() collects their result
+	bool beginSteps(int numSteps);
+	bool finishSteps();
+	bool isStepping() const { return mIsStepping; }
+	// Set once a worker stops responding. The coordinator is no use after that
+	bool hasFailed() const { return mFailed; }
+
+	int getGatherSide() const { return mGatherSide; }
+	// gatherSide x gatherSide values of B, row by row
+	float const * getFaceB(int face) const { return & mFacesB[(size_t) face * mGatherSide * mGatherSide]; }
+	// Sum of B over every texel at full resolution, summed by the workers as they gather
+	double getTotalB() const { return mTotalB; }
+
+	RDShardLayout const & getLayout() const { return mLayout; }
+	ShardTransport const & getTransport() const { return * mTransport; }
+
+private:
+	RDShardCoordinator(RDShardOptions const & options);
+
+	bool spawnWorkers(RDShardOptions const & options, std::vector<std::string> const & transportArgs);
+	void stopWorkers();
+
+	RDShardLayout mLayout;
+	int mGatherSide;
+	ShardTransportRef mTransport;
+	std::vector<int> mWorkerPids;
+
+	std::vector<ci::vec3> mPendingDisruptions;
+	bool mIsStepping = false;
+	bool mFailed = false;
+	std::vector<float> mMessage;
+	std::vector<float> mFacesB;
+	double mTotalB = 0.0;
+};
@@ -0,0 +1,215 @@
+#include "ReactionDiffusionSphere.h"
+
+using namespace ci;
+using std::vector;
+
+namespace {
+	typedef glm::dvec3 dvec3;
+
+	// Constraints in the weight fit: the Laplacian has to come out right for x, y, x^2, xy and y^2
+	int const NUM_CONSTRAINTS = 5;
+
+	// Solid angle of the spherical triangle between three unit vectors
+	double getTriangleArea(dvec3 const & a, dvec3 const & b, dvec3 const & c) {
+		return 2.0 * std::atan2(std::abs(glm::dot(a, glm::cross(b, c))), 1.0 + glm::dot(a, b) + glm::dot(b, c) + glm::dot(c, a));
+	}
+
+	// A point on the grid of one face, in warped coordinates from -1 to 1. Built in double from the face axes, since
+	// the weight fit differences points a fraction of a cell apart
+	dvec3 getWarpedDirection(int face, double u, double v) {
+		dvec3 normal(getCubeFaceDirection(face, 0.0f, 0.0f));
+		dvec3 sAxis = dvec3(getCubeFaceDirection(face, 1.0f, 0.0f)) - normal;
+		dvec3 tAxis = dvec3(getCubeFaceDirection(face, 0.0f, 1.0f)) - normal;
+		double const quarterPi = glm::pi<double>() / 4.0;
+		return glm::normalize(normal + std::tan(u * quarterPi) * sAxis + std::tan(v * quarterPi) * tAxis);
+	}
+
+	// Solves the square system matrix * x = rhs in place, by Gaussian elimination with partial pivoting
+	void solveLinear(double matrix[NUM_CONSTRAINTS][NUM_CONSTRAINTS], double rhs[NUM_CONSTRAINTS]) {
+		int const size = NUM_CONSTRAINTS;
+		for (int col = 0; col < size; col++) {
+			int pivot = col;
+			for (int row = col + 1; row < size; row++) {
+				if (std::abs(matrix[row][col]) > std::abs(matrix[pivot][col])) {
+					pivot = row;
+				}
+			}
+			std::swap(matrix[col], matrix[pivot]);
+			std::swap(rhs[col], rhs[pivot]);
+
+			for (int row = col + 1; row < size; row++) {
+				double factor = matrix[row][col] / matrix[col][col];
+				for (int idx = col; idx < size; idx++) {
+					matrix[row][idx] -= factor * matrix[col][idx];
+				}
+				rhs[row] -= factor * rhs[col];
+			}
+		}
+		for (int row = size - 1; row >= 0; row--) {
+			for (int idx = row + 1; idx < size; idx++) {
+				rhs[row] -= matrix[row][idx] * rhs[idx];
+			}
+			rhs[row] /= matrix[row][row];
+		}
+	}
+}
+
+RDSphereGrid::RDSphereGrid(int side, float edgeWeight, float cornerWeight) :
+	mSide(side), mEdgeWeight(edgeWeight), mCornerWeight(cornerWeight), mWeights((size_t) NUM_NEIGHBORS * side * side)
+{
+	// Worked out on one face, the others are the same up to a rotation
+	int const face = 4;
+	int const neighborCols[NUM_NEIGHBORS] = { -1, 1, 0, 0, -1, 1, -1, 1 };
+	int const neighborRows[NUM_NEIGHBORS] = { 0, 0, -1, 1, -1, -1, 1, 1 };
+
+	auto getCorner = [&] (int col, int row) { return getWarpedDirection(face, 2.0 * col / side - 1.0, 2.0 * row / side - 1.0); };
+
+	// The smallest cells are at the face edge midpoints. They set the scale, so no weight grows past the stencil's own
+	double cellArea = getTriangleArea(getCorner(0, side / 2), getCorner(1, side / 2), getCorner(1, side / 2 + 1))
+		+ getTriangleArea(getCorner(0, side / 2), getCorner(1, side / 2 + 1), getCorner(0, side / 2 + 1));
+	double minArea = cellArea;
+	double maxArea = 0.0;
+
+	for (int row = 0; row < side; row++) {
+		for (int col = 0; col < side; col++) {
+			dvec3 topLeft = getCorner(col, row), topRight = getCorner(col + 1, row);
+			dvec3 bottomLeft = getCorner(col, row + 1), bottomRight = getCorner(col + 1, row + 1);
+			double area = getTriangleArea(topLeft, topRight, bottomRight) + getTriangleArea(topLeft, bottomRight, bottomLeft);
+			minArea = std::min(minArea, area);
+			maxArea = std::max(maxArea, area);
+
+			// Neighbours in geodesic coordinates around the cell center, where the Laplacian is the flat one
+			dvec3 center = getWarpedDirection(face, (2.0 * col + 1.0) / side - 1.0, (2.0 * row + 1.0) / side - 1.0);
+			dvec3 xAxis = glm::normalize(glm::cross(glm::cross(center, topRight - topLeft), center));
+			dvec3 yAxis = glm::cross(center, xAxis);
+
+			double stencil[NUM_NEIGHBORS];
+			double terms[NUM_CONSTRAINTS][NUM_NEIGHBORS];
+			for (int neighbor = 0; neighbor < NUM_NEIGHBORS; neighbor++) {
+				int neighborCol = col + neighborCols[neighbor];
+				int neighborRow = row + neighborRows[neighbor];
+				bool pastCol = neighborCol < 0 || neighborCol >= side;
+				bool pastRow = neighborRow < 0 || neighborRow >= side;
+
+				// Past a cube corner only three cells meet, so the diagonal there is left out
+				stencil[neighbor] = neighbor < UP_LEFT ? edgeWeight : cornerWeight;
+				if (pastCol && pastRow) {
+					stencil[neighbor] = 0.0;
+					for (int term = 0; term < NUM_CONSTRAINTS; term++) {
+						terms[term][neighbor] = 0.0;
+					}
+					continue;
+				}
+
+				// Cells past the face edge are wherever ReactionDiffusionGrid takes their ghost cells from
+				int neighborFace = face;
+				if (pastCol || pastRow) {
+					getCubeFaceTexel(getCubeFaceTexelDirection(face, neighborCol, neighborRow, side), side, neighborFace, neighborCol, neighborRow);
+				}
+				dvec3 position = getWarpedDirection(neighborFace, (2.0 * neighborCol + 1.0) / side - 1.0, (2.0 * neighborRow + 1.0) / side - 1.0);
+
+				dvec3 tangent = position - center * glm::dot(center, position);
+				double arc = std::atan2(glm::length(tangent), glm::dot(center, position));
+				double x = arc * glm::dot(tangent, xAxis) / glm::length(tangent);
+				double y = arc * glm::dot(tangent, yAxis) / glm::length(tangent);
+
+				// Scaled to the smallest cell's size, so every term is about 1
+				double scale = 1.0 / std::sqrt(cellArea);
+				x *= scale;
+				y *= scale;
+				terms[0][neighbor] = x;
+				terms[1][neighbor] = y;
+				terms[2][neighbor] = x * x;
+				terms[3][neighbor] = x * y;
+				terms[4][neighbor] = y * y;
+			}
+
+			// The stencil's own weights would be exact on a flat square grid, so stay as close to them as the
+			// constraints allow: weights = stencil + terms^T * lambda, with (terms * terms^T) lambda = target - terms * stencil
+			double const laplacianScale = 2.0 * (edgeWeight + 2.0 * cornerWeight);
+			double const target[NUM_CONSTRAINTS] = { 0.0, 0.0, laplacianScale, 0.0, laplacianScale };
+			double normal[NUM_CONSTRAINTS][NUM_CONSTRAINTS];
+			double lambda[NUM_CONSTRAINTS];
+			for (int term = 0; term < NUM_CONSTRAINTS; term++) {
+				lambda[term] = target[term];
+				for (int neighbor = 0; neighbor < NUM_NEIGHBORS; neighbor++) {
+					lambda[term] -= terms[term][neighbor] * stencil[neighbor];
+				}
+				for (int other = 0; other < NUM_CONSTRAINTS; other++) {
+					normal[term][other] = 0.0;
+					for (int neighbor = 0; neighbor < NUM_NEIGHBORS; neighbor++) {
+						normal[term][other] += terms[term][neighbor] * terms[other][neighbor];
+					}
+				}
+			}
+			solveLinear(normal, lambda);
+
+			size_t idx = (size_t) row * side + col;
+			for (int neighbor = 0; neighbor < NUM_NEIGHBORS; neighbor++) {
+				double weight = stencil[neighbor];
+				for (int term = 0; term < NUM_CONSTRAINTS; term++) {
+					weight += terms[term][neighbor] * lambda[term];
+				}
+				mWeights[(size_t) neighbor * side * side + idx] = (float) weight;
+			}
+		}
+	}
+
+	mAreaRatio = (float) (maxArea / minArea);
+}
+
+int RDSphereGrid::getSideMatchingCube(int cubeSide) {
+	// A cube grid texel at a face center covers (2 / cubeSide)^2 steradians. The sphere grid's smallest cells, at the
+	// face edge midpoints, cover (pi / 2 / side)^2 / sqrt(2)
+	double const ratio = glm::pi<double>() / (4.0 * std::pow(2.0, 0.25));
+	return std::max(1, (int) std::lround(cubeSide * ratio));
+}
+
+vec3 RDSphereGrid::getCellDirection(int face, int col, int row) const {
+	return vec3(getWarpedDirection(face, (2.0 * col + 1.0) / mSide - 1.0, (2.0 * row + 1.0) / mSide - 1.0));
+}
+
+void disruptReactionDiffusionSphere(RDSphereGrid const & sphere, ReactionDiffusionGrid & grid, vec3 const & point) {
+	int const side = grid.getSide();
+
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		for (int row = 0; row < side; row++) {
+			for (int col = 0; col < side; col++) {
+				if (length(sphere.getCellDirection(face, col, row) - point) < RD_DISRUPT_RADIUS) {
+					size_t idx = grid.getIndex(face, col, row);
+					grid.mA[idx] = 1.0f;
+					grid.mB[idx] = 0.0f;
+				}
+			}
+		}
+	}
+
+	grid.fillGhostCells();
+}
+
+void resampleReactionDiffusionSphere(ReactionDiffusionGrid const & grid, int face, int outputSide, float * outB) {
+	int const side = grid.getSide();
+
+	// The warp is separable, so each output column and row lands on the same pair of cells on every face
+	vector<int> cells(outputSide);
+	vector<float> fractions(outputSide);
+	for (int idx = 0; idx < outputSide; idx++) {
+		float u = RDSphereGrid::warp(2.0f * (idx + 0.5f) / outputSide - 1.0f);
+		float cell = (u + 1.0f) * 0.5f * side - 0.5f;
+		cells[idx] = std::min(side - 1, (int) std::floor(cell));
+		fractions[idx] = cell - cells[idx];
+	}
+
+	for (int row = 0; row < outputSide; row++) {
+		float const * above = & grid.mB[grid.getIndex(face, 0, cells[row])];
+		float const * below = above + grid.getStride();
+		float fy = fractions[row];
+		for (int col = 0; col < outputSide; col++) {
+			int cell = cells[col];
+			float fx = fractions[col];
+			float top = above[cell] + fx * (above[cell + 1] - above[cell]);
+			float bottom = below[cell] + fx * (below[cell + 1] - below[cell]);
+			outB[row * outputSide + col] = top + fy * (bottom - top);
+		}
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "cinder/Vector.h"
+#include "glm/gtc/constants.hpp"
+
+#include "CubeFaces.h"
+#include "ReactionDiffusionKernels.h"
+#include "ReactionDiffusionModels.h"
+#include "TaskScheduler.h"
+
+// Reaction diffusion on a near uniform grid over the sphere, instead of the cube map grid, whose face corners hold
+// over five times as many texels per solid angle as its face centers. That is what the adjustedCoord correction in
+// RDRenderReactionDiffusion_f.glsl papers over.
+//
+// The grid is an equiangular cubed sphere: the cube layout stays, so ReactionDiffusionGrid, its ghost cells and cube
+// map textures all still apply, but cell (col, row) sits at face coordinates tan(pi / 4 * u), with u evenly spaced,
+// so cells differ in area by at most a factor of sqrt(2). The grid lines aren't orthogonal away from the face axes,
+// so the Laplacian takes all 8 neighbours, with weights fitted once per cell to the true neighbour positions: the
+// smallest change to the preset's own 3x3 stencil that makes it exact for quadratics on the sphere. Patterns come out
+// the same size everywhere, set by the smallest cells.
+//
+// getSideMatchingCube() picks the side whose smallest cells match the cube grid's texels at its face centers, which
+// takes under half as many cells. The render shader resamples it to the output with the same atan warp as
+// resampleReactionDiffusionSphere().
+
+class RDSphereGrid {
+public:
+	// Neighbours, in the order of the weight planes
+	enum Neighbor { LEFT, RIGHT, UP, DOWN, UP_LEFT, UP_RIGHT, DOWN_LEFT, DOWN_RIGHT, NUM_NEIGHBORS };
+
+	// Fitted around the weights of a 3x3 stencil like RDStencilIsotropic9, which presets stepped on it have to use
+	template <typename Stencil>
+	static RDSphereGrid create(int side) { return RDSphereGrid(side, Stencil::EDGE, Stencil::CORNER); }
+
+	// Side of a sphere grid whose smallest cells are the size of the cube grid's texels at its face centers
+	static int getSideMatchingCube(int cubeSide);
+
+	// Warped face coordinate of a cube face coordinate, and back. Both map -1, 0 and 1 to themselves
+	static float warp(float s) { return std::atan(s) * (4.0f / glm::pi<float>()); }
+	static float unwarp(float u) { return std::tan(u * (glm::pi<float>() / 4.0f)); }
+
+	int getSide() const { return mSide; }
+	// Normalized direction through the center of a cell
+	ci::vec3 getCellDirection(int face, int col, int row) const;
+	// Largest cell area over the smallest
+	float getAreaRatio() const { return mAreaRatio; }
+
+	template <typename Stencil>
+	bool isFittedFor() const { return mEdgeWeight == Stencil::EDGE && mCornerWeight == Stencil::CORNER; }
+
+	// Laplacian weights of every cell of a face towards one neighbour, row by row. Every face has the same ones
+	float const * getWeights(Neighbor neighbor) const { return & mWeights[(size_t) neighbor * mSide * mSide]; }
+
+private:
+	RDSphereGrid(int side, float edgeWeight, float cornerWeight);
+
+	int mSide;
+	float mEdgeWeight;
+	float mCornerWeight;
+	std::vector<float> mWeights;
+	float mAreaRatio;
+};
+
+// One row of cells, from padded rows of the source grid, with the weights of that row. Returns the row's new B summed
+template <typename Preset>
+inline float stepReactionDiffusionSphereRow(float const * __restrict a, float const * __restrict b, float * __restrict outA, float * __restrict outB,
+	float const * const * weights, int side, int stride)
+{
+	// Padded offsets of each neighbour, in Neighbor order
+	int const offsets[RDSphereGrid::NUM_NEIGHBORS] = { -1, 1, -stride, stride, -stride - 1, -stride + 1, stride - 1, stride + 1 };
+
+	float sumB = 0.0f;
+
+	for (int col = 0; col < side; col++) {
+		float curA = a[col];
+		float curB = b[col];
+
+		float lapA = 0.0f;
+		float lapB = 0.0f;
+		for (int neighbor = 0; neighbor < RDSphereGrid::NUM_NEIGHBORS; neighbor++) {
+			float weight = weights[neighbor][col];
+			lapA += weight * (a[col + offsets[neighbor]] - curA);
+			lapB += weight * (b[col + offsets[neighbor]] - curB);
+		}
+
+		float reactA, reactB;
+		Preset::Model::react(curA, curB, reactA, reactB);
+
+		outA[col] = curA + Preset::DT * (Preset::DIFFUSION_A * lapA + reactA);
+		outB[col] = curB + Preset::DT * (Preset::DIFFUSION_B * lapB + reactB);
+		sumB += outB[col];
+	}
+	return sumB;
+}
+
+// One step of the preset's model from src into dst, which have the sphere's side. Refreshes the ghost cells of src
+// first, then steps bands of rows on up to numThreads of the task scheduler's threads. Returns the total B of dst,
+// added up as the rows are stepped
+template <typename Preset>
+double stepReactionDiffusionSphere(RDSphereGrid const & sphere, ReactionDiffusionGrid & src, ReactionDiffusionGrid & dst, int numThreads = 1) {
+	assert(sphere.isFittedFor<typename Preset::Stencil>());
+	src.fillGhostCells();
+
+	int const side = src.getSide();
+	int const stride = src.getStride();
+	int const ROWS_PER_TASK = 32;
+	int const bandsPerFace = (side + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+	// Per band, and added up in order after, so the total doesn't depend on the threads
+	std::vector<double> bandsB(NUM_CUBE_FACES * bandsPerFace, 0.0);
+
+	TaskScheduler::get().parallelFor(NUM_CUBE_FACES * bandsPerFace, numThreads, [&] (size_t task, size_t) {
+		int face = (int) task / bandsPerFace;
+		int rowBegin = (int) task % bandsPerFace * ROWS_PER_TASK;
+		for (int row = rowBegin; row < std::min(side, rowBegin + ROWS_PER_TASK); row++) {
+			float const * weights[RDSphereGrid::NUM_NEIGHBORS];
+			for (int neighbor = 0; neighbor < RDSphereGrid::NUM_NEIGHBORS; neighbor++) {
+				weights[neighbor] = sphere.getWeights((RDSphereGrid::Neighbor) neighbor) + (size_t) row * side;
+			}
+			size_t rowStart = src.getIndex(face, 0, row);
+			bandsB[task] += stepReactionDiffusionSphereRow<Preset>(& src.mA[rowStart], & src.mB[rowStart], & dst.mA[rowStart], & dst.mB[rowStart], weights, side, stride);
+		}
+	});
+
+	double totalB = 0.0;
+	for (double bandB : bandsB) {
+		totalB += bandB;
+	}
+	return totalB;
+}
+
+// The same as disruptReactionDiffusion(), at the cells' true directions. Point has to be normalized
+void disruptReactionDiffusionSphere(RDSphereGrid const & sphere, ReactionDiffusionGrid & grid, ci::vec3 const & point);
+
+// B of one face of an outputSide cube map, bilinearly sampled from the sphere grid. Needs current ghost cells, as
+// after fillGhostCells()
+void resampleReactionDiffusionSphere(ReactionDiffusionGrid const & grid, int face, int outputSide, float * outB);
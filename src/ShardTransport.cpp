@@ -0,0 +1,319 @@
+#include "ShardTransport.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "cinder/Log.h"
+
+#include "Sockets.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+	uint32_t const SEGMENT_MAGIC = 0x444c5348; // "DLSH"
+	size_t const MAILBOX_ALIGN = 64;
+	double const CREATOR_SEND_TIMEOUT_SECONDS = 10.0;
+
+	struct SegmentHeader {
+		uint32_t mMagic;
+		uint32_t mNumRanks;
+		int64_t mCreatorPid;
+		uint64_t mSize;
+		// Followed by mNumRanks * mNumRanks mailbox offsets, 0 for pairs that never talk
+	};
+
+	size_t alignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Large enough that a step's halos never fill a socket, so sending to every neighbour before receiving can't stall
+	int const SOCKET_BUFFER_BYTES = 4 * 1024 * 1024;
+
+	// Spins briefly, since a halo is usually only microseconds away, then yields and finally sleeps
+	bool waitForFlag(std::atomic<uint32_t> & flag, uint32_t value, double timeoutSeconds, std::function<bool()> const & isAlive) {
+		typedef std::chrono::steady_clock Clock;
+		auto start = Clock::now();
+		auto lastAliveCheck = start;
+
+		for (uint32_t spins = 0; flag.load(std::memory_order_acquire) != value; spins++) {
+			if (spins < 2000) {
+				continue;
+			}
+
+			if (spins < 20000) {
+				std::this_thread::yield();
+			} else {
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+
+			if ((spins & 0xff) == 0) {
+				auto now = Clock::now();
+				if (timeoutSeconds >= 0.0 && std::chrono::duration<double>(now - start).count() > timeoutSeconds) {
+					return false;
+				}
+				if (now - lastAliveCheck > std::chrono::milliseconds(500)) {
+					lastAliveCheck = now;
+					if (!isAlive()) {
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+}
+
+struct SharedMemoryTransport::Mailbox {
+	std::atomic<uint32_t> mFull;
+	uint32_t mReserved;
+	uint64_t mSize;
+	uint64_t mCapacity;
+
+	uint8_t * getData() { return reinterpret_cast<uint8_t *>(this) + alignUp(sizeof(Mailbox), MAILBOX_ALIGN); }
+};
+
+ShardTransportRef SharedMemoryTransport::create(string const & name, int rank, int numRanks, vector<size_t> const & capacities) {
+	size_t const numMailboxes = (size_t) numRanks * numRanks;
+	if (capacities.size() != numMailboxes) {
+		CI_LOG_E("Need a mailbox capacity for every pair of ranks");
+		return nullptr;
+	}
+
+	vector<uint64_t> offsets(numMailboxes, 0);
+	size_t size = alignUp(sizeof(SegmentHeader) + numMailboxes * sizeof(uint64_t), MAILBOX_ALIGN);
+	for (size_t idx = 0; idx < numMailboxes; idx++) {
+		if (capacities[idx] > 0) {
+			offsets[idx] = size;
+			size += alignUp(sizeof(Mailbox), MAILBOX_ALIGN) + alignUp(capacities[idx], MAILBOX_ALIGN);
+		}
+	}
+
+	// A segment left behind by a crashed run would have the wrong size
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0 || ftruncate(fd, size) != 0) {
+		CI_LOG_E("Can't create shared memory " << name << ": " << std::strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+			shm_unlink(name.c_str());
+		}
+		return nullptr;
+	}
+
+	std::unique_ptr<SharedMemoryTransport> transport(new SharedMemoryTransport(rank, numRanks));
+	transport->mName = name;
+	transport->mIsCreator = true;
+	if (!transport->map(fd, size)) {
+		return nullptr;
+	}
+
+	auto header = reinterpret_cast<SegmentHeader *>(transport->mData);
+	header->mMagic = SEGMENT_MAGIC;
+	header->mNumRanks = numRanks;
+	header->mCreatorPid = getpid();
+	header->mSize = size;
+	std::memcpy(transport->mData + sizeof(SegmentHeader), offsets.data(), numMailboxes * sizeof(uint64_t));
+
+	for (size_t idx = 0; idx < numMailboxes; idx++) {
+		if (offsets[idx]) {
+			auto mailbox = new (transport->mData + offsets[idx]) Mailbox();
+			mailbox->mFull.store(0);
+			mailbox->mSize = 0;
+			mailbox->mCapacity = capacities[idx];
+		}
+	}
+
+	return ShardTransportRef(transport.release());
+}
+
+ShardTransportRef SharedMemoryTransport::open(string const & name, int rank) {
+	int fd = shm_open(name.c_str(), O_RDWR, 0600);
+	struct stat info;
+	if (fd < 0 || fstat(fd, & info) != 0 || (size_t) info.st_size < sizeof(SegmentHeader)) {
+		CI_LOG_E("Can't open shared memory " << name << ": " << std::strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+		}
+		return nullptr;
+	}
+
+	// The rank count isn't known until the header is mapped
+	std::unique_ptr<SharedMemoryTransport> transport(new SharedMemoryTransport(rank, 0));
+	transport->mName = name;
+	if (!transport->map(fd, info.st_size)) {
+		return nullptr;
+	}
+
+	auto header = reinterpret_cast<SegmentHeader const *>(transport->mData);
+	if (header->mMagic != SEGMENT_MAGIC || header->mSize != (uint64_t) info.st_size || rank < 0 || rank >= (int) header->mNumRanks) {
+		CI_LOG_E("Shared memory " << name << " isn't a shard segment for rank " << rank);
+		return nullptr;
+	}
+	transport->mNumRanks = header->mNumRanks;
+
+	return ShardTransportRef(transport.release());
+}
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+	if (mData) {
+		munmap(mData, mSize);
+	}
+	if (mIsCreator) {
+		shm_unlink(mName.c_str());
+	}
+}
+
+bool SharedMemoryTransport::map(int fd, size_t size) {
+	void * data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		CI_LOG_E("Can't map shared memory " << mName << ": " << std::strerror(errno));
+		return false;
+	}
+	mData = static_cast<uint8_t *>(data);
+	mSize = size;
+	return true;
+}
+
+SharedMemoryTransport::Mailbox * SharedMemoryTransport::getMailbox(int from, int to) const {
+	if (from < 0 || to < 0 || from >= mNumRanks || to >= mNumRanks) {
+		return nullptr;
+	}
+	auto offsets = reinterpret_cast<uint64_t const *>(mData + sizeof(SegmentHeader));
+	uint64_t offset = offsets[(size_t) from * mNumRanks + to];
+	return offset ? reinterpret_cast<Mailbox *>(mData + offset) : nullptr;
+}
+
+bool SharedMemoryTransport::isCreatorAlive() const {
+	pid_t creator = (pid_t) reinterpret_cast<SegmentHeader const *>(mData)->mCreatorPid;
+	return mIsCreator || kill(creator, 0) == 0 || errno == EPERM;
+}
+
+bool SharedMemoryTransport::send(int peer, void const * data, size_t size) {
+	Mailbox * mailbox = getMailbox(mRank, peer);
+	if (!mailbox || size > mailbox->mCapacity) {
+		CI_LOG_E("No room for a " << size << " byte message from rank " << mRank << " to " << peer);
+		return false;
+	}
+
+	// Wait for the peer to take the previous message. Only the creator gives up, since it has no other way of noticing
+	// that the peer died, while the others notice when the creator goes
+	if (!waitForFlag(mailbox->mFull, 0, mIsCreator ? CREATOR_SEND_TIMEOUT_SECONDS : -1.0, [this] { return isCreatorAlive(); })) {
+		CI_LOG_E("Rank " << peer << " stopped taking messages from rank " << mRank);
+		return false;
+	}
+
+	std::memcpy(mailbox->getData(), data, size);
+	mailbox->mSize = size;
+	mailbox->mFull.store(1, std::memory_order_release);
+	return true;
+}
+
+bool SharedMemoryTransport::receive(int peer, void * data, size_t size, double timeoutSeconds) {
+	Mailbox * mailbox = getMailbox(peer, mRank);
+	if (!mailbox) {
+		CI_LOG_E("No mailbox from rank " << peer << " to " << mRank);
+		return false;
+	}
+
+	if (!waitForFlag(mailbox->mFull, 1, timeoutSeconds, [this] { return isCreatorAlive(); })) {
+		return false;
+	}
+
+	if (mailbox->mSize != size) {
+		CI_LOG_E("Expected " << size << " bytes from rank " << peer << ", got " << mailbox->mSize);
+		return false;
+	}
+
+	std::memcpy(data, mailbox->getData(), size);
+	mailbox->mFull.store(0, std::memory_order_release);
+	return true;
+}
+
+ShardTransportRef SocketTransport::create(int rank, vector<string> const & addresses, double connectTimeoutSeconds) {
+	int numRanks = (int) addresses.size();
+	vector<string> hosts(numRanks);
+	vector<uint16_t> ports(numRanks);
+	for (int idx = 0; idx < numRanks; idx++) {
+		if (!parseHostPort(addresses[idx], hosts[idx], ports[idx])) {
+			CI_LOG_E("Bad shard address: " << addresses[idx]);
+			return nullptr;
+		}
+	}
+
+	std::unique_ptr<SocketTransport> transport(new SocketTransport(rank, numRanks));
+
+	int listenFd = -1;
+	if (rank + 1 < numRanks) {
+		// On this rank's own address, the interface the other ranks were told to reach it on
+		listenFd = listenTcp(hosts[rank], ports[rank], numRanks);
+		if (listenFd < 0) {
+			return nullptr;
+		}
+	}
+
+	// Connect down, announcing which rank is calling
+	bool connected = true;
+	for (int peer = 0; peer < rank && connected; peer++) {
+		int fd = connectTcp(hosts[peer], ports[peer], connectTimeoutSeconds);
+		uint32_t self = rank;
+		connected = fd >= 0 && sendAll(fd, & self, sizeof(self));
+		transport->mPeers[peer] = fd;
+	}
+
+	// Accept from above, in whatever order the higher ranks get here
+	for (int accepted = 0; accepted < numRanks - rank - 1 && connected; accepted++) {
+		int fd = acceptTcp(listenFd, connectTimeoutSeconds);
+		uint32_t peer = 0;
+		connected = fd >= 0 && receiveAll(fd, & peer, sizeof(peer), connectTimeoutSeconds) && (int) peer > rank && (int) peer < numRanks
+			&& transport->mPeers[peer] < 0;
+		if (connected) {
+			transport->mPeers[peer] = fd;
+		} else {
+			closeSocket(fd);
+		}
+	}
+
+	closeSocket(listenFd);
+
+	if (!connected) {
+		CI_LOG_E("Rank " << rank << " couldn't connect to every other shard rank");
+		return nullptr;
+	}
+
+	for (int fd : transport->mPeers) {
+		if (fd >= 0) {
+			setsockopt(fd, SOL_SOCKET, SO_SNDBUF, & SOCKET_BUFFER_BYTES, sizeof(SOCKET_BUFFER_BYTES));
+			setsockopt(fd, SOL_SOCKET, SO_RCVBUF, & SOCKET_BUFFER_BYTES, sizeof(SOCKET_BUFFER_BYTES));
+		}
+	}
+
+	return ShardTransportRef(transport.release());
+}
+
+SocketTransport::~SocketTransport() {
+	for (int & fd : mPeers) {
+		closeSocket(fd);
+	}
+}
+
+bool SocketTransport::send(int peer, void const * data, size_t size) {
+	return peer >= 0 && peer < mNumRanks && mPeers[peer] >= 0 && sendAll(mPeers[peer], data, size);
+}
+
+bool SocketTransport::receive(int peer, void * data, size_t size, double timeoutSeconds) {
+	return peer >= 0 && peer < mNumRanks && mPeers[peer] >= 0 && receiveAll(mPeers[peer], data, size, timeoutSeconds);
+}
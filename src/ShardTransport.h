@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Point to point messaging between the processes of a sharded simulation. Every participant has a rank, and each
+// ordered pair of ranks has its own channel, so a message is always of a size both ends already agree on.
+//
+// send() may block until the peer has taken the previous message on the same channel, so a step that sends to every
+// neighbour before receiving from any of them never deadlocks.
+class ShardTransport {
+public:
+	virtual ~ShardTransport() {}
+
+	virtual bool send(int peer, void const * data, size_t size) = 0;
+	// Fails after timeoutSeconds, or waits forever if it's negative. Also fails if the peer has gone away
+	virtual bool receive(int peer, void * data, size_t size, double timeoutSeconds) = 0;
+
+	virtual char const * getName() const = 0;
+
+	int getRank() const { return mRank; }
+	int getNumRanks() const { return mNumRanks; }
+
+protected:
+	ShardTransport(int rank, int numRanks) : mRank(rank), mNumRanks(numRanks) {}
+
+	int mRank;
+	int mNumRanks;
+};
+
+typedef std::unique_ptr<ShardTransport> ShardTransportRef;
+
+// Mailboxes in a named POSIX shared memory segment, one per ordered pair of ranks, for processes on the same machine.
+// The creator sizes every mailbox up front. Others open the segment by name and read the sizes from it.
+class SharedMemoryTransport : public ShardTransport {
+public:
+	// capacities[from * numRanks + to] is the largest message from one rank to the other, 0 where they never talk
+	static ShardTransportRef create(std::string const & name, int rank, int numRanks, std::vector<size_t> const & capacities);
+	static ShardTransportRef open(std::string const & name, int rank);
+
+	~SharedMemoryTransport();
+
+	bool send(int peer, void const * data, size_t size) override;
+	bool receive(int peer, void * data, size_t size, double timeoutSeconds) override;
+	char const * getName() const override { return "shm"; }
+
+private:
+	struct Mailbox;
+
+	SharedMemoryTransport(int rank, int numRanks) : ShardTransport(rank, numRanks) {}
+
+	bool map(int fd, size_t size);
+	Mailbox * getMailbox(int from, int to) const;
+	// False once the creator has exited, so openers don't wait forever on an abandoned segment
+	bool isCreatorAlive() const;
+
+	std::string mName;
+	bool mIsCreator = false;
+	uint8_t * mData = nullptr;
+	size_t mSize = 0;
+};
+
+// A TCP connection between every pair of ranks. Each rank listens on its own host:port and connects to the ranks
+// below it, so the same list of addresses works for processes on one machine over loopback or spread across hosts.
+class SocketTransport : public ShardTransport {
+public:
+	// addresses[rank] is where that rank listens, as host:port
+	static ShardTransportRef create(int rank, std::vector<std::string> const & addresses, double connectTimeoutSeconds);
+
+	~SocketTransport();
+
+	bool send(int peer, void const * data, size_t size) override;
+	bool receive(int peer, void * data, size_t size, double timeoutSeconds) override;
+	char const * getName() const override { return "socket"; }
+
+private:
+	SocketTransport(int rank, int numRanks) : ShardTransport(rank, numRanks), mPeers(numRanks, -1) {}
+
+	std::vector<int> mPeers;
+};
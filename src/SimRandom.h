@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+#include "cinder/Vector.h"
+#include "glm/gtc/constants.hpp"
+
+// A PCG32 generator with the parts of the ci::Rand interface the simulations use. Unlike ci::Rand its whole state is
+// two integers, so it can be saved into a checkpoint and restored exactly
+class SimRandom {
+public:
+	struct State {
+		uint64_t mState;
+		uint64_t mIncrement;
+	};
+
+	SimRandom() { seed(214); }
+	explicit SimRandom(uint64_t seedValue) { seed(seedValue); }
+
+	void seed(uint64_t seedValue) {
+		mState.mState = 0;
+		mState.mIncrement = (seedValue << 1) | 1;
+		nextUint();
+		mState.mState += 0x853c49e6748fea9bULL;
+		nextUint();
+	}
+
+	uint32_t nextUint() {
+		uint64_t old = mState.mState;
+		mState.mState = old * 6364136223846793005ULL + mState.mIncrement;
+		uint32_t xorShifted = (uint32_t) (((old >> 18) ^ old) >> 27);
+		uint32_t rot = (uint32_t) (old >> 59);
+		return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+	}
+
+	// Uniform in [0, 1)
+	float nextFloat() { return (nextUint() >> 8) * (1.0f / 16777216.0f); }
+	float nextFloat(float maxValue) { return nextFloat() * maxValue; }
+
+	// Uniform on the unit sphere
+	ci::vec3 nextVec3() {
+		float phi = nextFloat(glm::two_pi<float>());
+		float cosTheta = nextFloat(2.0f) - 1.0f;
+		float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+		return ci::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+	}
+
+	State const & getState() const { return mState; }
+	void setState(State const & state) { mState = state; }
+
+private:
+	State mState;
+};
@@ -0,0 +1,249 @@
+#include "Sockets.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "cinder/Log.h"
+
+using std::string;
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	// Milliseconds left before deadline, for poll(). -1 waits forever
+	int getPollTimeout(Clock::time_point deadline, bool forever) {
+		if (forever) {
+			return -1;
+		}
+		auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+		return (int) std::max<long long>(0, left);
+	}
+
+	addrinfo * resolve(string const & host, uint16_t port, int sockType) {
+		addrinfo hints;
+		std::memset(& hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = sockType;
+
+		addrinfo * result = nullptr;
+		int err = getaddrinfo(host.c_str(), std::to_string(port).c_str(), & hints, & result);
+		if (err != 0) {
+			CI_LOG_E("Can't resolve " << host << ": " << gai_strerror(err));
+			return nullptr;
+		}
+		return result;
+	}
+
+	// Stops writes to a closed peer from raising SIGPIPE on platforms without MSG_NOSIGNAL
+	void disableSigPipe(int fd) {
+#ifdef SO_NOSIGPIPE
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, & on, sizeof(on));
+#else
+		(void) fd;
+#endif
+	}
+}
+
+bool parseHostPort(string const & text, string & host, uint16_t & port) {
+	size_t colon = text.rfind(':');
+	string portText = colon == string::npos ? text : text.substr(colon + 1);
+	host = colon == string::npos || colon == 0 ? "127.0.0.1" : text.substr(0, colon);
+
+	char * end = nullptr;
+	long value = std::strtol(portText.c_str(), & end, 10);
+	if (portText.empty() || * end != '\0' || value <= 0 || value > 65535) {
+		return false;
+	}
+	port = (uint16_t) value;
+	return true;
+}
+
+int listenTcp(string const & host, uint16_t port, int backlog) {
+	addrinfo * addr = resolve(host.empty() ? "127.0.0.1" : host, port, SOCK_STREAM);
+	if (!addr) {
+		return -1;
+	}
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		CI_LOG_E("Can't create socket: " << std::strerror(errno));
+		freeaddrinfo(addr);
+		return -1;
+	}
+
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, & on, sizeof(on));
+
+	bool listening = bind(fd, addr->ai_addr, addr->ai_addrlen) == 0 && listen(fd, backlog) == 0;
+	freeaddrinfo(addr);
+	if (!listening) {
+		CI_LOG_E("Can't listen on " << host << ":" << port << ": " << std::strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int acceptTcp(int listenFd, double timeoutSeconds) {
+	pollfd pfd = { listenFd, POLLIN, 0 };
+	int timeoutMs = timeoutSeconds < 0.0 ? -1 : (int) (timeoutSeconds * 1000.0);
+	if (poll(& pfd, 1, timeoutMs) <= 0) {
+		CI_LOG_E("Timed out waiting for a connection");
+		return -1;
+	}
+
+	int fd = accept(listenFd, nullptr, nullptr);
+	if (fd < 0) {
+		CI_LOG_E("Accept failed: " << std::strerror(errno));
+		return -1;
+	}
+
+	int on = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, & on, sizeof(on));
+	disableSigPipe(fd);
+	return fd;
+}
+
+int connectTcp(string const & host, uint16_t port, double timeoutSeconds) {
+	auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeoutSeconds));
+
+	addrinfo * addr = resolve(host, port, SOCK_STREAM);
+	if (!addr) {
+		return -1;
+	}
+
+	int fd = -1;
+	// The other side may not be listening yet, so keep trying until the deadline
+	while (true) {
+		fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+		if (fd >= 0 && connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+			break;
+		}
+		if (fd >= 0) {
+			close(fd);
+			fd = -1;
+		}
+		if (Clock::now() >= deadline) {
+			CI_LOG_E("Can't connect to " << host << ":" << port << ": " << std::strerror(errno));
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+	freeaddrinfo(addr);
+
+	if (fd >= 0) {
+		int on = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, & on, sizeof(on));
+		disableSigPipe(fd);
+	}
+	return fd;
+}
+
+int connectUdp(string const & host, uint16_t port) {
+	addrinfo * addr = resolve(host, port, SOCK_DGRAM);
+	if (!addr) {
+		return -1;
+	}
+
+	int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+	if (fd < 0 || connect(fd, addr->ai_addr, addr->ai_addrlen) != 0) {
+		CI_LOG_E("Can't open UDP socket to " << host << ":" << port << ": " << std::strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(addr);
+
+	if (fd >= 0) {
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		disableSigPipe(fd);
+	}
+	return fd;
+}
+
+bool sendDatagram(int fd, void const * data, size_t size) {
+	// ECONNREFUSED just means nothing was listening for the previous datagram
+	ssize_t sent = send(fd, data, size, 0);
+	return sent == (ssize_t) size;
+}
+
+bool sendAll(int fd, void const * data, size_t size) {
+#ifdef MSG_NOSIGNAL
+	int const flags = MSG_NOSIGNAL;
+#else
+	int const flags = 0;
+#endif
+
+	auto bytes = static_cast<uint8_t const *>(data);
+	while (size > 0) {
+		ssize_t sent = send(fd, bytes, size, flags);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			CI_LOG_E("Socket send failed: " << std::strerror(errno));
+			return false;
+		}
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+bool receiveAll(int fd, void * data, size_t size, double timeoutSeconds) {
+	bool forever = timeoutSeconds < 0.0;
+	auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(forever ? 0.0 : timeoutSeconds));
+
+	auto bytes = static_cast<uint8_t *>(data);
+	while (size > 0) {
+		pollfd pfd = { fd, POLLIN, 0 };
+		int ready = poll(& pfd, 1, getPollTimeout(deadline, forever));
+		if (ready == 0) {
+			CI_LOG_E("Timed out on a socket read");
+			return false;
+		}
+		if (ready < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			CI_LOG_E("Socket poll failed: " << std::strerror(errno));
+			return false;
+		}
+
+		ssize_t got = recv(fd, bytes, size, 0);
+		if (got == 0) {
+			return false;
+		}
+		if (got < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			CI_LOG_E("Socket read failed: " << std::strerror(errno));
+			return false;
+		}
+		bytes += got;
+		size -= got;
+	}
+	return true;
+}
+
+void closeSocket(int & fd) {
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+}
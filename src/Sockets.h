@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Thin helpers over POSIX sockets, shared by the shard transport and anything else that talks over the network.
+// Every function returns -1 or false on failure, after logging why.
+
+// Splits "host:port". A bare port means localhost
+bool parseHostPort(std::string const & text, std::string & host, uint16_t & port);
+
+// A listening TCP socket on the interface host resolves to, loopback if it's empty, with SO_REUSEADDR so a restarted
+// process can take the port straight back. Only "0.0.0.0" listens on every interface
+int listenTcp(std::string const & host, uint16_t port, int backlog);
+// Waits up to timeoutSeconds for a connection, or forever if it's negative
+int acceptTcp(int listenFd, double timeoutSeconds);
+// Retries until the other side is listening or timeoutSeconds have passed. Sets TCP_NODELAY
+int connectTcp(std::string const & host, uint16_t port, double timeoutSeconds);
+
+// A UDP socket connected to host:port, so datagrams can go out with send(). Non-blocking
+int connectUdp(std::string const & host, uint16_t port);
+// Sends one datagram without waiting. Dropped, quietly, if the socket buffer is full or nobody is listening
+bool sendDatagram(int fd, void const * data, size_t size);
+
+// Blocking writes and reads of exactly size bytes. Reads wait up to timeoutSeconds, or forever if it's negative.
+// A read from a socket the other side closed fails quietly, since that's how peers normally go away
+bool sendAll(int fd, void const * data, size_t size);
+bool receiveAll(int fd, void * data, size_t size, double timeoutSeconds);
+
+void closeSocket(int & fd);
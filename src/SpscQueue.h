@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Neither side ever blocks or allocates after construction
+template <typename T>
+class SpscQueue {
+public:
+	// Capacity is rounded up to a power of two
+	explicit SpscQueue(size_t capacity) : mHead(0), mTail(0) {
+		mCapacity = 1;
+		while (mCapacity < capacity) {
+			mCapacity <<= 1;
+		}
+		mSlots.reset(new T[mCapacity]);
+	}
+
+	// Producer side. Returns false, dropping the value, if the queue is full
+	bool push(T const & value) {
+		size_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail - mHead.load(std::memory_order_acquire) == mCapacity) {
+			return false;
+		}
+		mSlots[tail & (mCapacity - 1)] = value;
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side. Returns false if there was nothing to pop
+	bool pop(T & value) {
+		size_t head = mHead.load(std::memory_order_relaxed);
+		if (head == mTail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		value = mSlots[head & (mCapacity - 1)];
+		mHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t getCapacity() const { return mCapacity; }
+
+private:
+	std::unique_ptr<T[]> mSlots;
+	size_t mCapacity;
+	// Kept on separate cache lines so the two threads don't fight over them
+	alignas(64) std::atomic<size_t> mHead;
+	alignas(64) std::atomic<size_t> mTail;
+};
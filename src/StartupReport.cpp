@@ -0,0 +1,39 @@
+#include "StartupReport.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "cinder/Log.h"
+
+void StartupReport::start() {
+	mMainThreadId = std::this_thread::get_id();
+	mTimer.start();
+}
+
+void StartupReport::record(std::string const & name, double start, double end) {
+	std::lock_guard<std::mutex> lock(mPhasesMutex);
+	mPhases.push_back({ name, std::this_thread::get_id() == mMainThreadId, start, end });
+}
+
+void StartupReport::log(std::string const & milestone) {
+	std::vector<Phase> phases;
+	{
+		std::lock_guard<std::mutex> lock(mPhasesMutex);
+		phases = mPhases;
+	}
+
+	std::sort(phases.begin(), phases.end(), [] (Phase const & p1, Phase const & p2) { return p1.mStart < p2.mStart; });
+
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(1);
+	report << "Startup: " << milestone << " after " << getSeconds() * 1000.0 << " ms";
+	for (auto & phase : phases) {
+		report << "\n  " << std::setw(40) << std::left << phase.mName
+			<< (phase.mOnMainThread ? " main   " : " worker ")
+			<< " start " << std::setw(8) << std::right << phase.mStart * 1000.0 << " ms"
+			<< " took " << std::setw(8) << std::right << (phase.mEnd - phase.mStart) * 1000.0 << " ms";
+	}
+
+	CI_LOG_I(report.str());
+}
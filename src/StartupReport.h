@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+
+#include "cinder/Timer.h"
+
+// Records when each startup phase ran, how long it took and on which thread, so a slow launch can be broken down
+class StartupReport {
+public:
+	struct Phase {
+		std::string mName;
+		bool mOnMainThread;
+		double mStart;
+		double mEnd;
+	};
+
+	// Times a phase for as long as it's in scope
+	class ScopedPhase {
+	public:
+		ScopedPhase(StartupReport & report, std::string const & name) : mReport(report), mName(name), mStart(report.getSeconds()) {}
+		~ScopedPhase() { mReport.record(mName, mStart, mReport.getSeconds()); }
+
+	private:
+		StartupReport & mReport;
+		std::string mName;
+		double mStart;
+	};
+
+	StartupReport() {}
+
+	void start();
+	double getSeconds() const { return mTimer.getSeconds(); }
+
+	// Thread safe, phases can be recorded from worker threads
+	void record(std::string const & name, double start, double end);
+	// Logs every recorded phase, in order of start time
+	void log(std::string const & milestone);
+
+private:
+	ci::Timer mTimer;
+	std::thread::id mMainThreadId;
+
+	std::mutex mPhasesMutex;
+	std::vector<Phase> mPhases;
+};
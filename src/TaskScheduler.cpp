@@ -0,0 +1,258 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+	// Which compute worker of which scheduler the current thread is, if any
+	thread_local TaskScheduler * tScheduler = nullptr;
+	thread_local int tWorkerIndex = -1;
+
+	char const * const PRIORITY_NAMES[] = { "frame", "background", "io" };
+
+	// Raises maxValue to value if it's lower
+	void updateMax(std::atomic<int> & maxValue, int value) {
+		int current = maxValue.load(std::memory_order_relaxed);
+		while (current < value && !maxValue.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+}
+
+TaskScheduler & TaskScheduler::get() {
+	static TaskScheduler scheduler((int) std::thread::hardware_concurrency() - 1, 2);
+	return scheduler;
+}
+
+TaskScheduler::TaskScheduler(int numWorkers, int numIoThreads) {
+	for (int priority = 0; priority < (int) TaskPriority::NUM_PRIORITIES; priority++) {
+		mNumQueued[priority].store(0);
+		mMaxQueued[priority].store(0);
+	}
+
+	// All of them exist before any starts, since they steal from each other
+	numWorkers = std::max(1, numWorkers);
+	for (int index = 0; index < numWorkers; index++) {
+		mWorkers.emplace_back(new Worker());
+	}
+	for (int index = 0; index < numWorkers; index++) {
+		mWorkers[index]->mThread = std::thread(& TaskScheduler::runComputeWorker, this, index);
+	}
+	for (int index = 0; index < std::max(1, numIoThreads); index++) {
+		mIoThreads.emplace_back(& TaskScheduler::runIoThread, this);
+	}
+}
+
+TaskScheduler::~TaskScheduler() {
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mStopping = true;
+	}
+	mComputeWake.notify_all();
+	mIoWake.notify_all();
+
+	for (auto & worker : mWorkers) {
+		worker->mThread.join();
+	}
+	for (auto & thread : mIoThreads) {
+		thread.join();
+	}
+}
+
+void TaskScheduler::submit(TaskPriority priority, Task task, TaskGroup * group) {
+	if (group) {
+		group->mNumPending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	TaskQueue * queue = & mSharedFrameQueue;
+	if (priority == TaskPriority::BACKGROUND) {
+		queue = & mBackgroundQueue;
+	} else if (priority == TaskPriority::IO) {
+		queue = & mIoQueue;
+	} else if (tScheduler == this) {
+		// Forked from a task, so it goes on this worker's own deque, where it's likely still in cache
+		queue = & mWorkers[tWorkerIndex]->mQueue;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queue->mMutex);
+		queue->mTasks.push_back({ std::move(task), group });
+	}
+	updateMax(mMaxQueued[(int) priority], ++mNumQueued[(int) priority]);
+
+	// Taking the lock orders this with a thread that's about to sleep, so the wake up can't be missed
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+	}
+	(priority == TaskPriority::IO ? mIoWake : mComputeWake).notify_one();
+}
+
+bool TaskScheduler::runQueuedTask(TaskQueue & queue, TaskPriority priority, ThreadStats & stats, bool fromBack, bool stolen) {
+	QueuedTask queued;
+	{
+		std::lock_guard<std::mutex> lock(queue.mMutex);
+		if (queue.mTasks.empty()) {
+			return false;
+		}
+		if (fromBack) {
+			queued = std::move(queue.mTasks.back());
+			queue.mTasks.pop_back();
+		} else {
+			queued = std::move(queue.mTasks.front());
+			queue.mTasks.pop_front();
+		}
+	}
+	mNumQueued[(int) priority]--;
+
+	queued.mTask();
+
+	stats.mNumRun.fetch_add(1, std::memory_order_relaxed);
+	if (stolen) {
+		stats.mNumStolen.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (queued.mGroup) {
+		queued.mGroup->finishTask();
+	}
+	return true;
+}
+
+bool TaskScheduler::runFrameTask() {
+	if (mNumQueued[(int) TaskPriority::FRAME].load(std::memory_order_relaxed) <= 0) {
+		return false;
+	}
+
+	int const self = tScheduler == this ? tWorkerIndex : -1;
+	ThreadStats & stats = self >= 0 ? mWorkers[self]->mStats : mWaiterStats;
+
+	if (self >= 0 && runQueuedTask(mWorkers[self]->mQueue, TaskPriority::FRAME, stats, true, false)) {
+		return true;
+	}
+	if (runQueuedTask(mSharedFrameQueue, TaskPriority::FRAME, stats, false, false)) {
+		return true;
+	}
+
+	// Starting past ourselves, so the workers don't all go for the same victim
+	int const numWorkers = (int) mWorkers.size();
+	for (int offset = 1; offset <= numWorkers; offset++) {
+		int victim = (self + offset + numWorkers) % numWorkers;
+		if (victim != self && runQueuedTask(mWorkers[victim]->mQueue, TaskPriority::FRAME, stats, false, true)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void TaskScheduler::runComputeWorker(int index) {
+	tScheduler = this;
+	tWorkerIndex = index;
+	Worker & self = * mWorkers[index];
+
+	auto hasWork = [this] {
+		return mNumQueued[(int) TaskPriority::FRAME] > 0 || mNumQueued[(int) TaskPriority::BACKGROUND] > 0;
+	};
+
+	while (true) {
+		if (runFrameTask() || runQueuedTask(mBackgroundQueue, TaskPriority::BACKGROUND, self.mStats, false, false)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mComputeWake.wait(lock, [&] { return mStopping || hasWork(); });
+		// Whatever is still queued gets run before stopping
+		if (mStopping && !hasWork()) {
+			return;
+		}
+	}
+}
+
+void TaskScheduler::runIoThread() {
+	while (true) {
+		if (runQueuedTask(mIoQueue, TaskPriority::IO, mIoStats, false, false)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mIoWake.wait(lock, [this] { return mStopping || mNumQueued[(int) TaskPriority::IO] > 0; });
+		if (mStopping && mNumQueued[(int) TaskPriority::IO] <= 0) {
+			return;
+		}
+	}
+}
+
+void TaskScheduler::parallelFor(size_t numTasks, size_t maxSlots, std::function<void(size_t task, size_t slot)> const & task) {
+	size_t numSlots = std::min(numTasks, std::min(maxSlots, (size_t) getConcurrency()));
+	if (numSlots <= 1) {
+		for (size_t idx = 0; idx < numTasks; idx++) {
+			task(idx, 0);
+		}
+		return;
+	}
+
+	// Each slot takes the next task until there are none left, so uneven tasks still balance
+	std::atomic<size_t> nextTask(0);
+	auto runSlot = [&] (size_t slot) {
+		for (size_t idx = nextTask++; idx < numTasks; idx = nextTask++) {
+			task(idx, slot);
+		}
+	};
+
+	TaskGroup group(TaskPriority::FRAME, * this);
+	for (size_t slot = 1; slot < numSlots; slot++) {
+		group.run([&runSlot, slot] { runSlot(slot); });
+	}
+	runSlot(0);
+	group.wait();
+}
+
+std::string TaskScheduler::getStatsReport() {
+	uint64_t numFrames = std::max<uint64_t>(1, mNumFrames.exchange(0));
+
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(1);
+	report << "Task scheduler, " << mWorkers.size() << " compute workers and " << mIoThreads.size() << " IO threads, per frame over "
+		<< numFrames << " frames:";
+
+	report << "\n  " << std::setw(12) << std::left << "queued";
+	for (int priority = 0; priority < (int) TaskPriority::NUM_PRIORITIES; priority++) {
+		report << "   " << PRIORITY_NAMES[priority] << " " << std::max(0, mNumQueued[priority].load())
+			<< " (max " << mMaxQueued[priority].exchange(0) << ")";
+	}
+
+	auto reportThread = [&] (std::string const & name, ThreadStats & stats) {
+		report << "\n  " << std::setw(12) << std::left << name << "   run " << stats.mNumRun.exchange(0) / (double) numFrames
+			<< "   stolen " << stats.mNumStolen.exchange(0) / (double) numFrames;
+	};
+	for (size_t index = 0; index < mWorkers.size(); index++) {
+		reportThread("worker " + std::to_string(index), mWorkers[index]->mStats);
+	}
+	reportThread("waiting", mWaiterStats);
+	reportThread("io", mIoStats);
+	return report.str();
+}
+
+TaskGroup::TaskGroup(TaskPriority priority, TaskScheduler & scheduler) : mScheduler(scheduler), mPriority(priority) {}
+
+void TaskGroup::run(TaskScheduler::Task task) {
+	mScheduler.submit(mPriority, std::move(task), this);
+}
+
+void TaskGroup::wait() {
+	while (!isDone()) {
+		if (mScheduler.runFrameTask()) {
+			continue;
+		}
+		// Nothing to help with, e.g. the rest of the group is IO. Checks back now and then for frame work to run
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDone.wait_for(lock, std::chrono::microseconds(200), [this] { return isDone(); });
+	}
+
+	// The last task may still be notifying, the group can't go away before it's let go of the lock
+	std::lock_guard<std::mutex> lock(mMutex);
+}
+
+void TaskGroup::finishTask() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mNumPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		mDone.notify_all();
+	}
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+// One pool of threads for all the CPU work of the process, so the simulations, uploads, checkpoint writes and
+// telemetry can all fork work without each starting threads of their own and oversubscribing the cores.
+//
+// Compute workers, one per core but the main thread's, each keep a deque of frame work: they push and pop their own
+// at the back, and steal from the front of the others' when theirs is empty. Frame work queued from any other thread,
+// like the main one, goes into a shared queue they all take from too. A thread waiting on a group runs frame work
+// while it waits, so forking from inside a task can't starve the pool. Background work only runs on a compute worker
+// with no frame work to do, and IO work runs on a few threads of its own, which spend most of their time blocked.
+//
+// getStatsReport() gives the queue depths and how much work each thread ran and stole since the last report.
+
+enum class TaskPriority {
+	// Work the current frame waits on
+	FRAME,
+	// Compute work nobody is waiting on yet, e.g. building the network graph at startup
+	BACKGROUND,
+	// Work that mostly waits on files, sockets or the audio decoder
+	IO,
+	NUM_PRIORITIES
+};
+
+class TaskGroup;
+
+class TaskScheduler {
+public:
+	typedef std::function<void()> Task;
+
+	// The process wide scheduler, started on first use with a compute worker per core but one, and 2 IO threads
+	static TaskScheduler & get();
+
+	// At least one compute worker, so background work always gets run
+	TaskScheduler(int numWorkers, int numIoThreads);
+	// Runs whatever is still queued, then stops the threads
+	~TaskScheduler();
+
+	// Threads that frame work runs on: the compute workers and the thread waiting for it
+	int getConcurrency() const { return (int) mWorkers.size() + 1; }
+
+	// Runs func at the priority outside of any group. The future's destructor doesn't wait for it, unlike std::async's
+	template <typename F>
+	auto async(TaskPriority priority, F func) -> std::future<decltype(func())>;
+
+	// Runs task(0) to task(numTasks - 1) as frame work on up to maxSlots threads, the calling one included, and returns
+	// once all of them have. No two tasks run on the same slot at once, so slot can pick per-thread scratch space
+	void parallelFor(size_t numTasks, size_t maxSlots, std::function<void(size_t task, size_t slot)> const & task);
+
+	// Call once per frame, from the main thread, so the report can give counts per frame
+	void beginFrame() { mNumFrames++; }
+
+	// Queue depths now and at most, and tasks run and stolen per thread, since the last report. Resets the counts
+	std::string getStatsReport();
+
+private:
+	friend class TaskGroup;
+
+	struct QueuedTask {
+		Task mTask;
+		TaskGroup * mGroup;
+	};
+
+	struct TaskQueue {
+		std::mutex mMutex;
+		std::deque<QueuedTask> mTasks;
+	};
+
+	struct ThreadStats {
+		std::atomic<uint64_t> mNumRun { 0 };
+		std::atomic<uint64_t> mNumStolen { 0 };
+	};
+
+	struct Worker {
+		TaskQueue mQueue;
+		ThreadStats mStats;
+		std::thread mThread;
+	};
+
+	void submit(TaskPriority priority, Task task, TaskGroup * group);
+	// Runs one task of frame work if there is any: the calling worker's own newest, else the oldest shared or stolen one
+	bool runFrameTask();
+	bool runQueuedTask(TaskQueue & queue, TaskPriority priority, ThreadStats & stats, bool fromBack, bool stolen);
+	void runComputeWorker(int index);
+	void runIoThread();
+
+	std::vector<std::unique_ptr<Worker>> mWorkers;
+	std::vector<std::thread> mIoThreads;
+	TaskQueue mSharedFrameQueue;
+	TaskQueue mBackgroundQueue;
+	TaskQueue mIoQueue;
+	// Frame work run by threads that aren't compute workers, while they wait on a group
+	ThreadStats mWaiterStats;
+	ThreadStats mIoStats;
+
+	std::atomic<int> mNumQueued[(int) TaskPriority::NUM_PRIORITIES];
+	std::atomic<int> mMaxQueued[(int) TaskPriority::NUM_PRIORITIES];
+	std::atomic<uint64_t> mNumFrames { 0 };
+
+	std::mutex mSleepMutex;
+	std::condition_variable mComputeWake;
+	std::condition_variable mIoWake;
+	bool mStopping = false;
+};
+
+// Work forked together and waited on together. Waiting runs frame work until the group's tasks are done, and the
+// destructor waits, so a group on the stack can't outlive what it forked. One per frame stage, or per frame for
+// work that only has to be done by the next one
+class TaskGroup {
+public:
+	explicit TaskGroup(TaskPriority priority = TaskPriority::FRAME, TaskScheduler & scheduler = TaskScheduler::get());
+	~TaskGroup() { wait(); }
+
+	TaskGroup(TaskGroup const &) = delete;
+	TaskGroup & operator=(TaskGroup const &) = delete;
+
+	void run(TaskScheduler::Task task);
+	void wait();
+	bool isDone() const { return mNumPending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class TaskScheduler;
+
+	void finishTask();
+
+	TaskScheduler & mScheduler;
+	TaskPriority mPriority;
+	std::atomic<int> mNumPending { 0 };
+	std::mutex mMutex;
+	std::condition_variable mDone;
+};
+
+template <typename F>
+auto TaskScheduler::async(TaskPriority priority, F func) -> std::future<decltype(func())> {
+	typedef decltype(func()) Result;
+	auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+	submit(priority, [task] { (* task)(); }, nullptr);
+	return task->get_future();
+}
@@ -0,0 +1,83 @@
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "cinder/Log.h"
+
+#include "Sockets.h"
+
+using std::string;
+
+namespace {
+	// Appends `,"name":value`, or nothing if the value isn't known yet
+	int appendField(char * out, size_t size, char const * name, double value) {
+		if (std::isnan(value)) {
+			return 0;
+		}
+		return std::snprintf(out, size, ",\"%s\":%.6g", name, value);
+	}
+}
+
+bool TelemetryStream::open(string const & destination, double ratePerSecond) {
+	close();
+
+	if (ratePerSecond <= 0.0) {
+		CI_LOG_E("Telemetry rate has to be positive");
+		return false;
+	}
+	mInterval = 1.0 / ratePerSecond;
+	mNextTime = 0.0;
+
+	if (destination.compare(0, 4, "udp:") == 0) {
+		string host;
+		uint16_t port;
+		if (!parseHostPort(destination.substr(4), host, port)) {
+			CI_LOG_E("Bad telemetry address: " << destination);
+			return false;
+		}
+		mSocket = connectUdp(host, port);
+		return mSocket >= 0;
+	}
+
+	mFile.open(destination, std::ios::app);
+	if (!mFile) {
+		CI_LOG_E("Couldn't open telemetry file for writing: " << destination);
+		return false;
+	}
+	return true;
+}
+
+void TelemetryStream::close() {
+	closeSocket(mSocket);
+	if (mFile.is_open()) {
+		mFile.close();
+	}
+}
+
+void TelemetryStream::publish(TelemetrySample const & sample) {
+	// Catch up without a burst if frames stalled for longer than an interval
+	mNextTime = std::max(mNextTime + mInterval, sample.mTime);
+
+	char line[512];
+	size_t const size = sizeof(line) - 2;
+	int length = std::snprintf(line, size, "{\"t\":%.3f,\"frame\":%llu,\"app\":\"%s\",\"fps\":%.1f",
+		sample.mTime, (unsigned long long) sample.mFrame, sample.mActiveApp, sample.mFps);
+	length += appendField(line + length, size - length, "network_infected", sample.mNetworkInfected);
+	length += appendField(line + length, size - length, "network_nodes", sample.mNetworkNodes);
+	length += appendField(line + length, size - length, "rd_mass_b", sample.mRDMassB);
+	length += appendField(line + length, size - length, "rd_mean_b", sample.mRDMeanB);
+	length += appendField(line + length, size - length, "flock_order", sample.mFlockOrder);
+	length += appendField(line + length, size - length, "flock_mean_speed", sample.mFlockMeanSpeed);
+	line[length++] = '}';
+	line[length++] = '\n';
+
+	if (mSocket >= 0) {
+		sendDatagram(mSocket, line, length);
+	} else {
+		// Flushed every line, so a watcher tailing the file sees each one as it's published
+		mFile.write(line, length);
+		mFile.flush();
+	}
+}
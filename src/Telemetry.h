@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <limits>
+
+// A few numbers that say whether each simulation is still alive, published at a fixed rate as one JSON object per
+// line, to a file or a UDP port, for whatever watches the installation to alert on.
+//
+// Only the active simulation is collected, and none of them costs a pass over its whole state. The network's infected
+// count is kept up to date as it steps, the sphere grid adds up B as it steps, and the shard workers as they downsample
+// B to send it back. The GPU simulations can't add anything up as they step: their steps are fragment shaders, and GL
+// 4.1 has no atomics or image stores to accumulate into. So they're sampled instead, B on a grid over each face of the
+// cube and the first few rows of birds, and read back asynchronously. Their values are estimates, one publish
+// interval old.
+
+struct TelemetrySample {
+	static double none() { return std::numeric_limits<double>::quiet_NaN(); }
+
+	double mTime = 0.0;
+	uint64_t mFrame = 0;
+	char const * mActiveApp = "";
+	double mFps = 0.0;
+
+	// Fields left at none() are left out of the line, e.g. before the first readback lands
+	double mNetworkInfected = none();
+	double mNetworkNodes = none();
+	// Sum and mean of B over the cube, or the sphere grid. 0 when the pattern has died out, near 1 when it has taken over
+	double mRDMassB = none();
+	double mRDMeanB = none();
+	// |sum of velocities| / sum of speeds, over the sampled birds: 1 when the flock heads the same way, near 0 when it's
+	// scattered
+	double mFlockOrder = none();
+	double mFlockMeanSpeed = none();
+};
+
+class TelemetryStream {
+public:
+	~TelemetryStream() { close(); }
+
+	// "udp:host:port", "udp:port" for localhost, or a file path, which is appended to
+	bool open(std::string const & destination, double ratePerSecond);
+	void close();
+	bool isOpen() const { return mSocket >= 0 || mFile.is_open(); }
+
+	// True once every 1 / rate seconds
+	bool isDue(double now) const { return isOpen() && now >= mNextTime; }
+	void publish(TelemetrySample const & sample);
+
+private:
+	int mSocket = -1;
+	std::ofstream mFile;
+	double mInterval = 1.0;
+	double mNextTime = 0.0;
+};
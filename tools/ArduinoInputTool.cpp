@@ -0,0 +1,221 @@
+// Prints what ArduinoInput reads from a device, and a test of its reading and reconnecting against pseudo-terminals.
+// With the microphone Arduino plugged in:
+//   DigitalLifeArduinoInput --listen [pattern or /dev path]
+// prints one JSON line per byte read, and one whenever the connection comes or goes.
+//
+// Build with `make arduino-input`. `make arduino-input-test` runs the test:
+//   DigitalLifeArduinoInput --local-test
+// which stands a pseudo-terminal in for the Arduino, checks that bytes written to it arrive in order, that a hang up is
+// noticed and the device picked up again when it comes back, and that a device which opens but never sends anything
+// is retried with a growing delay instead of in a tight loop.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#ifdef __APPLE__
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+
+#include "ArduinoInput.h"
+
+using std::string;
+using std::vector;
+
+typedef std::chrono::steady_clock Clock;
+
+namespace {
+	// Long enough for the I/O thread's poll timeout and a first reconnect delay
+	std::chrono::milliseconds const WAIT_TIMEOUT(3000);
+	// With the delay starting at 250 ms and doubling, the opens land at 0, 0.25, 0.75 and 1.75 s. Without the backoff
+	// it's thousands
+	std::chrono::milliseconds const FLAP_WINDOW(2000);
+	uint64_t const MAX_FLAP_CONNECTS = 4;
+}
+
+// A pseudo-terminal whose slave end plays the Arduino's serial port
+struct PseudoTerminal {
+	int mMaster = -1;
+	int mSlave = -1;
+	string mSlavePath;
+
+	bool open() {
+		char name[128];
+		if (::openpty(& mMaster, & mSlave, name, nullptr, nullptr) != 0) {
+			return false;
+		}
+		mSlavePath = name;
+		return true;
+	}
+
+	// Closing both ends hangs up anyone else holding the slave, and removes its device
+	void close() {
+		if (mSlave >= 0) {
+			::close(mSlave);
+			mSlave = -1;
+		}
+		if (mMaster >= 0) {
+			::close(mMaster);
+			mMaster = -1;
+		}
+	}
+
+	~PseudoTerminal() { close(); }
+};
+
+template <typename Predicate>
+bool waitFor(Predicate predicate) {
+	auto deadline = Clock::now() + WAIT_TIMEOUT;
+	while (!predicate()) {
+		if (Clock::now() > deadline) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	return true;
+}
+
+// Writes the bytes to the master end and pops them back off the input
+string checkRoundTrip(ArduinoInput & input, PseudoTerminal & pty, vector<uint8_t> const & bytes) {
+	if (::write(pty.mMaster, bytes.data(), bytes.size()) != (ssize_t) bytes.size()) {
+		return "writing to the pseudo-terminal failed";
+	}
+
+	vector<uint8_t> received;
+	bool complete = waitFor([&] {
+		ArduinoEvent event;
+		while (input.pop(event)) {
+			received.push_back(event.mMessage);
+		}
+		return received.size() >= bytes.size();
+	});
+	if (!complete) {
+		return "only " + std::to_string(received.size()) + " of " + std::to_string(bytes.size()) + " bytes arrived";
+	}
+	if (received != bytes) {
+		return "bytes arrived changed or out of order";
+	}
+	return string();
+}
+
+// Points the fixed device path the input watches at a pseudo-terminal, the way a replugged Arduino comes back under
+// the same name
+bool linkDevice(string const & devicePath, string const & target) {
+	std::remove(devicePath.c_str());
+	return ::symlink(target.c_str(), devicePath.c_str()) == 0;
+}
+
+string runLocalTest() {
+	string const devicePath = "/tmp/DigitalLifeArduinoTest";
+	ArduinoInput input;
+
+	// Bytes arrive in order on a connected device
+	PseudoTerminal first;
+	if (!first.open() || !linkDevice(devicePath, first.mSlavePath)) {
+		return "couldn't set up a pseudo-terminal";
+	}
+	input.start(devicePath);
+	if (!waitFor([&] { return input.isConnected(); })) {
+		return "never connected to " + first.mSlavePath;
+	}
+	vector<uint8_t> bytes;
+	for (int idx = 0; idx < 200; idx++) {
+		bytes.push_back((uint8_t) (idx * 37 + 11));
+	}
+	string failure = checkRoundTrip(input, first, bytes);
+	if (!failure.empty()) {
+		return failure;
+	}
+
+	// A hang up is noticed, and the device picked up again by the same thread once it's back
+	first.close();
+	if (!waitFor([&] { return !input.isConnected(); })) {
+		return "didn't notice the hang up";
+	}
+	PseudoTerminal second;
+	if (!second.open() || !linkDevice(devicePath, second.mSlavePath)) {
+		return "couldn't set up a pseudo-terminal";
+	}
+	if (!waitFor([&] { return input.isConnected(); })) {
+		return "never reconnected to " + second.mSlavePath;
+	}
+	failure = checkRoundTrip(input, second, { 'd', 'l', 0, 255 });
+	if (!failure.empty()) {
+		return failure;
+	}
+	input.stop();
+	second.close();
+
+	// An empty file opens fine and then reads as a hang up straight away, like a port that enumerates but never talks
+	std::remove(devicePath.c_str());
+	std::ofstream(devicePath).close();
+	uint64_t connectsBefore = input.getNumConnects();
+	input.start(devicePath);
+	std::this_thread::sleep_for(FLAP_WINDOW);
+	input.stop();
+	std::remove(devicePath.c_str());
+
+	uint64_t flapConnects = input.getNumConnects() - connectsBefore;
+	std::printf("{\"check\":\"flapping_device\",\"connects\":%llu,\"window_ms\":%d}\n",
+		(unsigned long long) flapConnects, (int) FLAP_WINDOW.count());
+	if (flapConnects == 0) {
+		return "never opened the flapping device";
+	}
+	if (flapConnects > MAX_FLAP_CONNECTS) {
+		return "reopened a device that never sent anything " + std::to_string(flapConnects) + " times in "
+			+ std::to_string(FLAP_WINDOW.count()) + " ms";
+	}
+
+	return string();
+}
+
+void listen(string const & pattern) {
+	ArduinoInput input;
+	input.start(pattern);
+
+	auto start = Clock::now();
+	bool wasConnected = false;
+	while (true) {
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if (input.isConnected() != wasConnected) {
+			wasConnected = input.isConnected();
+			std::printf("{\"t\":%.3f,\"connected\":%s,\"connects\":%llu}\n", seconds, wasConnected ? "true" : "false",
+				(unsigned long long) input.getNumConnects());
+		}
+		ArduinoEvent event;
+		while (input.pop(event)) {
+			double received = std::chrono::duration<double>(event.mReceived - start).count();
+			std::printf("{\"t\":%.3f,\"byte\":%d,\"dropped\":%llu}\n", received, (int) event.mMessage,
+				(unsigned long long) input.getNumDropped());
+		}
+		std::fflush(stdout);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+int main(int argc, char * argv[]) {
+	if (argc >= 2 && std::strcmp(argv[1], "--local-test") == 0) {
+		string failure = runLocalTest();
+		if (!failure.empty()) {
+			std::fprintf(stderr, "ArduinoInput local test failed: %s\n", failure.c_str());
+			return 1;
+		}
+		std::printf("ArduinoInput local test passed\n");
+		return 0;
+	}
+	if (argc >= 2 && std::strcmp(argv[1], "--listen") == 0) {
+		listen(argc >= 3 ? argv[2] : ArduinoInput::DEFAULT_DEVICE_PATTERN);
+		return 0;
+	}
+
+	std::fprintf(stderr, "Usage: %s --listen [pattern or /dev path] | --local-test\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,330 @@
+// The receiving end of the app's output stream, see FrameStream.h, and a loopback test of it. Start the receiver on
+// the projector host or recorder, then the app with `--output-stream tcp:<receiver host>:47300`:
+//   DigitalLifeFrameStream --receive <receiver host>:47300 [--dump latest.ppm]
+// prints a JSON line of frame rate and bandwidth every second, and with --dump writes the latest frame out with it.
+// It listens on the interface the host resolves to, or on loopback only for a bare port. 0.0.0.0 is every interface.
+// A recording the app wrote with `--output-stream <path>` plays back the same way, as fast as it decodes:
+//   DigitalLifeFrameStream --play <path> [--dump last.ppm]
+//
+// Build with `make frame-stream`. `make frame-stream-test` runs the loopback test:
+//   DigitalLifeFrameStream --local-test <frames> [--width 6144] [--height 1024] [--tile 32] [--threads n] [--port 47300]
+// which sends synthetic strips through the encoder and a loopback socket, and checks that every decoded frame matches.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameStream.h"
+#include "Sockets.h"
+#include "TaskScheduler.h"
+
+using std::string;
+using std::vector;
+
+typedef std::chrono::steady_clock Clock;
+
+double getSeconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Drops the alpha, and flips the rows, since the strip comes bottom row first from the GL readback
+bool writePpm(string const & path, FrameTileDecoder const & decoder) {
+	std::ofstream file(path, std::ios::binary);
+	file << "P6\n" << decoder.getWidth() << " " << decoder.getHeight() << "\n255\n";
+	vector<char> rgb((size_t) decoder.getWidth() * 3);
+	for (int row = decoder.getHeight() - 1; row >= 0; row--) {
+		uint8_t const * rgba = decoder.getPixels() + (size_t) row * decoder.getWidth() * 4;
+		for (int col = 0; col < decoder.getWidth(); col++) {
+			std::memcpy(& rgb[col * 3], & rgba[col * 4], 3);
+		}
+		file.write(rgb.data(), rgb.size());
+	}
+	return (bool) file;
+}
+
+// Frame rate and bandwidth of a stream, printed once a second
+struct StreamStats {
+	Clock::time_point mStart = Clock::now();
+	int mFrames = 0;
+	double mReceivedBytes = 0.0;
+	double mFrameBytes = 0.0;
+	double mDecodeSeconds = 0.0;
+
+	// True when it printed, and reset
+	bool update(FrameTileDecoder const & decoder, size_t messageSize, double decodeSeconds) {
+		mFrames++;
+		mReceivedBytes += messageSize;
+		mFrameBytes += (double) decoder.getWidth() * decoder.getHeight() * 4;
+		mDecodeSeconds += decodeSeconds;
+
+		double seconds = getSeconds(mStart);
+		if (seconds < 1.0) {
+			return false;
+		}
+		std::printf("{\"frames_per_sec\":%.1f,\"received_mb_per_sec\":%.2f,\"frame_mb_per_sec\":%.1f,\"ratio\":%.1f,"
+			"\"decode_ms\":%.2f}\n", mFrames / seconds, mReceivedBytes / seconds / 1e6, mFrameBytes / seconds / 1e6,
+			mFrameBytes / std::max(1.0, mReceivedBytes), 1000.0 * mDecodeSeconds / mFrames);
+		std::fflush(stdout);
+		* this = StreamStats();
+		return true;
+	}
+};
+
+int runReceive(string const & host, uint16_t port, string const & dumpPath) {
+	int listenFd = listenTcp(host, port, 1);
+	if (listenFd < 0) {
+		return 1;
+	}
+
+	vector<uint8_t> message;
+	while (true) {
+		int fd = acceptTcp(listenFd, -1.0);
+		if (fd < 0) {
+			continue;
+		}
+
+		std::fprintf(stderr, "Sender connected\n");
+		FrameTileDecoder decoder;
+		StreamStats stats;
+		while (receiveFrameMessage(fd, message, -1.0)) {
+			auto start = Clock::now();
+			if (!decoder.decode(message.data(), message.size(), TaskScheduler::get().getConcurrency())) {
+				continue;
+			}
+			if (stats.update(decoder, message.size(), getSeconds(start)) && !dumpPath.empty()) {
+				writePpm(dumpPath, decoder);
+			}
+		}
+		std::fprintf(stderr, "Sender went away\n");
+		closeSocket(fd);
+	}
+}
+
+int runPlay(string const & path, string const & dumpPath) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		std::fprintf(stderr, "Can't open %s\n", path.c_str());
+		return 1;
+	}
+
+	FrameTileDecoder decoder;
+	StreamStats stats;
+	vector<uint8_t> message;
+	int numFailed = 0;
+	FrameHeader header;
+	while (file.read(reinterpret_cast<char *>(& header), sizeof(header))) {
+		message.resize(sizeof(header) + header.mPayloadSize);
+		std::memcpy(message.data(), & header, sizeof(header));
+		if (header.mMagic != FrameHeader::MAGIC || !file.read(reinterpret_cast<char *>(message.data() + sizeof(header)), header.mPayloadSize)) {
+			std::fprintf(stderr, "Recording is truncated or corrupt\n");
+			break;
+		}
+
+		auto start = Clock::now();
+		if (!decoder.decode(message.data(), message.size(), TaskScheduler::get().getConcurrency())) {
+			numFailed++;
+			continue;
+		}
+		stats.update(decoder, message.size(), getSeconds(start));
+	}
+
+	if (!dumpPath.empty() && decoder.hasFrame()) {
+		writePpm(dumpPath, decoder);
+	}
+	// Frames after a corrupt one fail until the next key frame, and a recording only has the one it starts with
+	if (numFailed > 0) {
+		std::fprintf(stderr, "%d frames didn't decode\n", numFailed);
+	}
+	return 0;
+}
+
+// A stand in for the output strip, the same for the same frame on both ends: mostly black, with a few hundred birds
+// moving across it, a pattern slowly changing over one face, and every 240 frames a fade to black and back
+void drawTestFrame(int frame, int width, int height, vector<uint8_t> & pixels) {
+	int const NUM_BIRDS = 400;
+	int const FADE_PERIOD = 240;
+
+	pixels.assign((size_t) width * height * 4, 0);
+	float phase = (frame % FADE_PERIOD) / (float) FADE_PERIOD;
+	float alpha = std::min(1.0f, std::abs(phase * 4.0f - 2.0f) - 0.25f);
+	if (alpha <= 0.0f) {
+		return;
+	}
+
+	auto put = [&] (int x, int y, float r, float g, float b) {
+		uint8_t * pixel = & pixels[((size_t) y * width + x) * 4];
+		pixel[0] = (uint8_t) (r * alpha);
+		pixel[1] = (uint8_t) (g * alpha);
+		pixel[2] = (uint8_t) (b * alpha);
+		pixel[3] = 255;
+	};
+
+	// The pattern only moves every fourth frame, like reaction diffusion shown at a lower rate than it's drawn
+	int const face = height;
+	int const patternLeft = std::min(2 * face, width - face);
+	float t = (frame / 4) * 0.05f;
+	for (int y = 0; y < std::min(face, height); y++) {
+		float cy = std::cos(y * 0.031f);
+		for (int x = 0; x < face && patternLeft + x < width; x++) {
+			float value = std::sin(x * 0.027f + t) * cy;
+			if (value > 0.3f) {
+				put(patternLeft + x, y, 255.0f * value, 128.0f * value, 32.0f);
+			}
+		}
+	}
+
+	for (int bird = 0; bird < NUM_BIRDS; bird++) {
+		float speed = 0.5f + (bird % 7) * 0.25f;
+		int x = (int) (bird * 7919 + frame * speed) % (width - 3);
+		int y = (int) ((bird * 104729) % (height - 3) + 20.0f * std::sin(frame * 0.05f + bird));
+		y = std::max(0, std::min(height - 3, y));
+		for (int dy = 0; dy < 3; dy++) {
+			for (int dx = 0; dx < 3; dx++) {
+				put(x + dx, y + dy, 255.0f, 255.0f, 255.0f);
+			}
+		}
+	}
+}
+
+int runLocalTest(int numFrames, int width, int height, int tileSide, size_t numThreads, uint16_t port) {
+	int listenFd = listenTcp("127.0.0.1", port, 1);
+	if (listenFd < 0) {
+		return 1;
+	}
+
+	std::atomic<int> mismatches(0);
+	std::atomic<int> decoded(0);
+	double decodeSeconds = 0.0;
+	std::thread receiver([&] {
+		int fd = acceptTcp(listenFd, 10.0);
+		FrameTileDecoder decoder;
+		vector<uint8_t> message, expected;
+		while (fd >= 0 && receiveFrameMessage(fd, message, 10.0)) {
+			auto start = Clock::now();
+			bool ok = decoder.decode(message.data(), message.size(), numThreads);
+			decodeSeconds += getSeconds(start);
+
+			drawTestFrame((int) decoder.getFrameIndex(), width, height, expected);
+			if (!ok || std::memcmp(decoder.getPixels(), expected.data(), expected.size()) != 0) {
+				mismatches++;
+			}
+			decoded++;
+		}
+		closeSocket(fd);
+	});
+
+	int fd = connectTcp("127.0.0.1", port, 10.0);
+	if (fd < 0) {
+		receiver.join();
+		closeSocket(listenFd);
+		return 1;
+	}
+
+	FrameTileEncoder encoder(width, height, tileSide);
+	vector<uint8_t> pixels, message;
+	double encodeSeconds = 0.0;
+	double sentBytes = 0.0;
+	double changedTiles = 0.0;
+	auto start = Clock::now();
+	for (int frame = 0; frame < numFrames; frame++) {
+		drawTestFrame(frame, width, height, pixels);
+		// As the app does when a receiver connects again
+		if (frame == numFrames / 2) {
+			encoder.requestKeyFrame();
+		}
+
+		auto encodeStart = Clock::now();
+		encoder.encode(pixels.data(), (size_t) width * 4, message, numThreads);
+		encodeSeconds += getSeconds(encodeStart);
+		sentBytes += message.size();
+		changedTiles += encoder.getNumChangedTiles();
+
+		if (!sendAll(fd, message.data(), message.size())) {
+			break;
+		}
+	}
+	closeSocket(fd);
+	receiver.join();
+	double totalSeconds = getSeconds(start);
+	closeSocket(listenFd);
+
+	double frameBytes = (double) width * height * 4;
+	std::printf("{\"test\":\"frame_stream\",\"width\":%d,\"height\":%d,\"tile\":%d,\"threads\":%d,\"frames\":%d,"
+		"\"changed_tiles\":%.3f,\"encode_ms\":%.2f,\"decode_ms\":%.2f,\"encode_mb_per_sec\":%.0f,\"frame_mb\":%.2f,"
+		"\"sent_kb_per_frame\":%.1f,\"ratio\":%.1f,\"frames_per_sec\":%.1f,\"mismatches\":%d}\n",
+		width, height, tileSide, (int) numThreads, numFrames, changedTiles / numFrames / encoder.getNumTiles(),
+		1000.0 * encodeSeconds / numFrames, 1000.0 * decodeSeconds / std::max(1, decoded.load()),
+		frameBytes * numFrames / encodeSeconds / 1e6, frameBytes / 1e6, sentBytes / numFrames / 1e3,
+		frameBytes * numFrames / sentBytes, numFrames / totalSeconds, mismatches.load());
+
+	// Lossless means exactly the same, every frame
+	if (decoded != numFrames || mismatches > 0) {
+		std::fprintf(stderr, "%d of %d frames decoded, %d didn't match\n", decoded.load(), numFrames, mismatches.load());
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char ** argv) {
+	int localTestFrames = 0;
+	int width = 6144;
+	int height = 1024;
+	int tileSide = 32;
+	size_t numThreads = TaskScheduler::get().getConcurrency();
+	uint16_t port = 47300;
+	bool receive = false;
+	string receiveHost, playPath, dumpPath;
+
+	for (int idx = 1; idx + 1 < argc; idx += 2) {
+		string arg = argv[idx];
+		string value = argv[idx + 1];
+		if (arg == "--local-test") {
+			localTestFrames = std::atoi(value.c_str());
+		} else if (arg == "--receive") {
+			if (!parseHostPort(value, receiveHost, port)) {
+				std::fprintf(stderr, "Bad --receive address: %s\n", value.c_str());
+				return 1;
+			}
+			receive = true;
+		} else if (arg == "--play") {
+			playPath = value;
+		} else if (arg == "--dump") {
+			dumpPath = value;
+		} else if (arg == "--width") {
+			width = std::atoi(value.c_str());
+		} else if (arg == "--height") {
+			height = std::atoi(value.c_str());
+		} else if (arg == "--tile") {
+			tileSide = std::atoi(value.c_str());
+		} else if (arg == "--threads") {
+			numThreads = (size_t) std::max(1, std::atoi(value.c_str()));
+		} else if (arg == "--port") {
+			port = (uint16_t) std::atoi(value.c_str());
+		} else {
+			std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+			return 1;
+		}
+	}
+
+	if (receive) {
+		return runReceive(receiveHost, port, dumpPath);
+	}
+	if (!playPath.empty()) {
+		return runPlay(playPath, dumpPath);
+	}
+	if (localTestFrames > 0 && width > 3 && height > 3 && tileSide > 0) {
+		return runLocalTest(localTestFrames, width, height, tileSide, numThreads, port);
+	}
+
+	std::fprintf(stderr, "Usage: %s --receive [host:]port [--dump latest.ppm]\n"
+		"       %s --play <recording> [--dump last.ppm]\n"
+		"       %s --local-test <frames> [--width w] [--height h] [--tile t] [--threads n] [--port p]\n", argv[0], argv[0], argv[0]);
+	return 1;
+}
@@ -0,0 +1,184 @@
+// One shard of the sharded reaction diffusion simulation, see ReactionDiffusionShards.h. The app spawns these itself
+// for local shards. For shards on other hosts, start one per host with the addresses the app is given:
+//   DigitalLifeRDWorker --rank 0 --shards 2 --side 2048 --gather-side 1024 --hosts a:47100,b:47101,app:47102
+//
+// Build with `make rd-worker`. `make rd-shard-test` runs the local test below over both transports:
+//   DigitalLifeRDWorker --local-test <shards> [--transport shm | socket] [--side 512] [--gather-side 256] [--frames 20]
+// which plays the app's part, then checks the gathered faces against stepReactionDiffusionModel() on a single grid.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cinder/Filesystem.h"
+
+#include "CubeFaces.h"
+#include "ReactionDiffusionKernels.h"
+#include "ReactionDiffusionModels.h"
+#include "ReactionDiffusionShards.h"
+
+using namespace ci;
+using std::string;
+using std::vector;
+
+int const UPDATES_PER_FRAME = 10;
+
+float getCircleRadius(int side) {
+	// ReactionDiffusionApp::setupCircleRD(20) on its 512 side grid
+	return 20.0f * side / 512.0f;
+}
+
+int runWorker(int rank, int numShards, int side, int gatherSide, string const & shmName, string const & hosts) {
+	ShardTransportRef transport;
+	if (!shmName.empty()) {
+		transport = SharedMemoryTransport::open(shmName, rank);
+	} else {
+		vector<string> addresses;
+		std::stringstream stream(hosts);
+		for (string address; std::getline(stream, address, ',');) {
+			addresses.push_back(address);
+		}
+		transport = SocketTransport::create(rank, addresses, 10.0);
+	}
+	if (!transport) {
+		return 1;
+	}
+
+	RDShardLayout layout(side, numShards, side / gatherSide);
+	auto plans = buildShardPlans(layout);
+	RDShardWorker worker(layout, std::move(plans[rank]), rank);
+	worker.setupCircle(getCircleRadius(side));
+
+	return worker.run(* transport, gatherSide) ? 0 : 1;
+}
+
+// Averages B the same way RDShardWorker::gather() does, so the comparison can be exact
+float getReferenceB(ReactionDiffusionGrid const & grid, int face, int gatherCol, int gatherRow, int factor) {
+	float sum = 0.0f;
+	for (int dy = 0; dy < factor; dy++) {
+		for (int dx = 0; dx < factor; dx++) {
+			sum += grid.mB[grid.getIndex(face, gatherCol * factor + dx, gatherRow * factor + dy)];
+		}
+	}
+	return sum * (1.0f / (factor * factor));
+}
+
+int runLocalTest(RDShardOptions options, int numFrames) {
+	typedef std::chrono::steady_clock Clock;
+
+	auto coordinator = RDShardCoordinator::create(options);
+	if (!coordinator) {
+		return 1;
+	}
+
+	ReactionDiffusionGrid reference(options.mSide);
+	ReactionDiffusionGrid scratch(options.mSide);
+	setupCircleReactionDiffusion(reference, getCircleRadius(options.mSide));
+
+	vec3 const disruptPoint = normalize(vec3(0.3f, -0.2f, 1.0f));
+	double stepSeconds = 0.0;
+
+	for (int frame = 0; frame < numFrames; frame++) {
+		if (frame == numFrames / 2) {
+			coordinator->disrupt(disruptPoint);
+			disruptReactionDiffusion(reference, disruptPoint);
+		}
+
+		auto start = Clock::now();
+		if (!coordinator->beginSteps(UPDATES_PER_FRAME) || !coordinator->finishSteps()) {
+			std::fprintf(stderr, "Shards failed on frame %d\n", frame);
+			return 1;
+		}
+		stepSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+
+		for (int step = 0; step < UPDATES_PER_FRAME; step++) {
+			stepReactionDiffusionModel<RDShardPreset>(reference, scratch);
+			std::swap(reference, scratch);
+		}
+	}
+
+	int const gatherSide = coordinator->getGatherSide();
+	int const factor = options.mSide / gatherSide;
+	double maxDiff = 0.0;
+	double referenceTotalB = 0.0;
+	for (int face = 0; face < NUM_CUBE_FACES; face++) {
+		float const * faceB = coordinator->getFaceB(face);
+		for (int row = 0; row < gatherSide; row++) {
+			for (int col = 0; col < gatherSide; col++) {
+				float value = getReferenceB(reference, face, col, row, factor);
+				maxDiff = std::max(maxDiff, (double) std::abs(faceB[row * gatherSide + col] - value));
+				referenceTotalB += value * factor * factor;
+			}
+		}
+	}
+	double totalB = coordinator->getTotalB();
+
+	double cellUpdates = (double) NUM_CUBE_FACES * options.mSide * options.mSide * UPDATES_PER_FRAME * numFrames;
+	std::printf("{\"test\":\"rd_shards\",\"transport\":\"%s\",\"shards\":%d,\"side\":%d,\"frames\":%d,\"ms_per_frame\":%.2f,"
+		"\"cell_updates_per_sec\":%.0f,\"total_b\":%.3f,\"max_diff\":%g}\n",
+		coordinator->getTransport().getName(), options.mNumShards, options.mSide, numFrames, 1000.0 * stepSeconds / numFrames,
+		cellUpdates / stepSeconds, totalB, maxDiff);
+
+	// The sharded steps are the same arithmetic on the same values, so anything but an exact match is a halo bug
+	if (maxDiff != 0.0) {
+		std::fprintf(stderr, "Sharded result differs from the single grid by up to %g\n", maxDiff);
+		return 1;
+	}
+	// The total is only summed in a different order
+	if (std::abs(totalB - referenceTotalB) > 1e-4 * std::max(1.0, referenceTotalB)) {
+		std::fprintf(stderr, "Sharded total B is %f, the single grid's %f\n", totalB, referenceTotalB);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char ** argv) {
+	int rank = -1;
+	int numFrames = 20;
+	string shmName, hosts;
+
+	RDShardOptions options;
+	options.mSide = 512;
+	options.mGatherSide = 256;
+	options.mWorkerPath = fs::absolute(argv[0]);
+
+	for (int idx = 1; idx + 1 < argc; idx += 2) {
+		string arg = argv[idx];
+		string value = argv[idx + 1];
+		if (arg == "--rank") {
+			rank = std::atoi(value.c_str());
+		} else if (arg == "--shards" || arg == "--local-test") {
+			options.mNumShards = std::atoi(value.c_str());
+		} else if (arg == "--side") {
+			options.mSide = std::atoi(value.c_str());
+		} else if (arg == "--gather-side") {
+			options.mGatherSide = std::atoi(value.c_str());
+		} else if (arg == "--shm") {
+			shmName = value;
+		} else if (arg == "--hosts") {
+			hosts = value;
+		} else if (arg == "--transport") {
+			options.mTransport = value;
+		} else if (arg == "--frames") {
+			numFrames = std::atoi(value.c_str());
+		} else {
+			std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+			return 1;
+		}
+	}
+
+	if (options.mNumShards < 1 || options.mGatherSide < 1 || options.mSide % options.mGatherSide != 0) {
+		std::fprintf(stderr, "Usage: %s --rank r --shards n --side s --gather-side g (--shm name | --hosts a,b,..)\n"
+			"       %s --local-test n [--transport shm | socket] [--side s] [--gather-side g] [--frames f]\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	if (rank >= 0) {
+		return runWorker(rank, options.mNumShards, options.mSide, options.mGatherSide, shmName, hosts);
+	}
+	return runLocalTest(options, numFrames);
+}